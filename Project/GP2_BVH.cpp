@@ -0,0 +1,345 @@
+#include "GP2_BVH.h"
+#include "GP2_FrustumCuller.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+
+GP2_AABB GP2_AABB::Empty()
+{
+	return GP2_AABB{ glm::vec3{ FLT_MAX }, glm::vec3{ -FLT_MAX } };
+}
+
+GP2_AABB GP2_AABB::FromSphere(const glm::vec4& sphere)
+{
+	return GP2_AABB{ glm::vec3(sphere) - sphere.w, glm::vec3(sphere) + sphere.w };
+}
+
+void GP2_AABB::Grow(const GP2_AABB& other)
+{
+	min = glm::min(min, other.min);
+	max = glm::max(max, other.max);
+}
+
+void GP2_AABB::Grow(const glm::vec3& point)
+{
+	min = glm::min(min, point);
+	max = glm::max(max, point);
+}
+
+float GP2_AABB::GetSurfaceArea() const
+{
+	const glm::vec3 extent = max - min;
+	if (extent.x < 0.f)
+		return 0.f;
+
+	return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+void GP2_BVH::Build(const std::vector<GP2_AABB>& bounds)
+{
+	Clear();
+
+	if (bounds.empty())
+		return;
+
+	m_ObjectBounds = bounds;
+
+	std::vector<glm::vec3> centers{};
+	centers.reserve(bounds.size());
+	m_ObjectIndices.reserve(bounds.size());
+	for (size_t idx = 0; idx < bounds.size(); ++idx)
+	{
+		centers.push_back(bounds[idx].GetCenter());
+		m_ObjectIndices.push_back(static_cast<uint32_t>(idx));
+	}
+
+	// a binary tree over n leaves has at most 2n - 1 nodes
+	m_Nodes.reserve(bounds.size() * 2);
+	m_Nodes.push_back(Node{ GP2_AABB::Empty(), 0, static_cast<uint32_t>(bounds.size()) });
+
+	Subdivide(0, bounds, centers);
+}
+
+void GP2_BVH::Refit(const std::vector<GP2_AABB>& bounds)
+{
+	m_ObjectBounds = bounds;
+
+	// children are always created after their parent, so walking backwards visits them first
+	for (size_t nodeIndex = m_Nodes.size(); nodeIndex-- > 0;)
+	{
+		Node& node = m_Nodes[nodeIndex];
+		node.bounds = GP2_AABB::Empty();
+
+		if (node.IsLeaf())
+		{
+			for (uint32_t idx = node.first; idx < node.first + node.count; ++idx)
+				node.bounds.Grow(bounds[m_ObjectIndices[idx]]);
+		}
+		else
+		{
+			node.bounds.Grow(m_Nodes[node.first].bounds);
+			node.bounds.Grow(m_Nodes[node.first + 1].bounds);
+		}
+	}
+}
+
+void GP2_BVH::Clear()
+{
+	m_Nodes.clear();
+	m_ObjectIndices.clear();
+	m_ObjectBounds.clear();
+}
+
+void GP2_BVH::Subdivide(uint32_t nodeIndex, const std::vector<GP2_AABB>& bounds, const std::vector<glm::vec3>& centers)
+{
+	{
+		Node& node = m_Nodes[nodeIndex];
+		node.bounds = GP2_AABB::Empty();
+		for (uint32_t idx = node.first; idx < node.first + node.count; ++idx)
+			node.bounds.Grow(bounds[m_ObjectIndices[idx]]);
+	}
+
+	const Node node = m_Nodes[nodeIndex];
+	if (node.count <= s_MaxLeafObjects)
+		return;
+
+	int axis{};
+	float position{};
+	const float splitCost = FindSplit(node, centers, bounds, axis, position);
+	const float leafCost = static_cast<float>(node.count) * node.bounds.GetSurfaceArea();
+	if (splitCost >= leafCost)
+		return;
+
+	const auto begin = m_ObjectIndices.begin() + node.first;
+	const auto end = begin + node.count;
+	const auto middle = std::partition(begin, end, [&](uint32_t objectIndex) { return centers[objectIndex][axis] < position; });
+
+	const uint32_t leftCount = static_cast<uint32_t>(middle - begin);
+	if (leftCount == 0 || leftCount == node.count)
+		return;
+
+	const uint32_t leftIndex = static_cast<uint32_t>(m_Nodes.size());
+	m_Nodes.push_back(Node{ GP2_AABB::Empty(), node.first, leftCount });
+	m_Nodes.push_back(Node{ GP2_AABB::Empty(), node.first + leftCount, node.count - leftCount });
+
+	m_Nodes[nodeIndex].first = leftIndex;
+	m_Nodes[nodeIndex].count = 0;
+
+	Subdivide(leftIndex, bounds, centers);
+	Subdivide(leftIndex + 1, bounds, centers);
+}
+
+float GP2_BVH::FindSplit(const Node& node, const std::vector<glm::vec3>& centers, const std::vector<GP2_AABB>& bounds, int& axis, float& position) const
+{
+	struct Bin
+	{
+		GP2_AABB bounds{ GP2_AABB::Empty() };
+		uint32_t count{};
+	};
+
+	float bestCost = FLT_MAX;
+
+	GP2_AABB centerBounds = GP2_AABB::Empty();
+	for (uint32_t idx = node.first; idx < node.first + node.count; ++idx)
+		centerBounds.Grow(centers[m_ObjectIndices[idx]]);
+
+	for (int currentAxis = 0; currentAxis < 3; ++currentAxis)
+	{
+		const float axisMin = centerBounds.min[currentAxis];
+		const float axisMax = centerBounds.max[currentAxis];
+		if (axisMax <= axisMin)
+			continue;
+
+		std::array<Bin, s_BinCount> bins{};
+		const float scale = s_BinCount / (axisMax - axisMin);
+		for (uint32_t idx = node.first; idx < node.first + node.count; ++idx)
+		{
+			const uint32_t objectIndex = m_ObjectIndices[idx];
+			const int binIndex = (std::min)(s_BinCount - 1, static_cast<int>((centers[objectIndex][currentAxis] - axisMin) * scale));
+			bins[binIndex].bounds.Grow(bounds[objectIndex]);
+			++bins[binIndex].count;
+		}
+
+		// sweep from both sides so every split plane between two bins is evaluated in linear time
+		std::array<float, s_BinCount - 1> leftArea{};
+		std::array<uint32_t, s_BinCount - 1> leftCount{};
+		GP2_AABB leftBox = GP2_AABB::Empty();
+		uint32_t leftSum = 0;
+		for (int idx = 0; idx < s_BinCount - 1; ++idx)
+		{
+			leftSum += bins[idx].count;
+			leftBox.Grow(bins[idx].bounds);
+			leftCount[idx] = leftSum;
+			leftArea[idx] = leftBox.GetSurfaceArea();
+		}
+
+		GP2_AABB rightBox = GP2_AABB::Empty();
+		uint32_t rightSum = 0;
+		for (int idx = s_BinCount - 1; idx > 0; --idx)
+		{
+			rightSum += bins[idx].count;
+			rightBox.Grow(bins[idx].bounds);
+
+			const float cost = leftCount[idx - 1] * leftArea[idx - 1] + rightSum * rightBox.GetSurfaceArea();
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				axis = currentAxis;
+				position = axisMin + idx / scale;
+			}
+		}
+	}
+
+	return bestCost;
+}
+
+void GP2_BVH::QueryFrustum(const glm::mat4& viewProjection, const glm::vec3& eye, std::vector<uint32_t>& visible) const
+{
+	if (m_Nodes.empty())
+		return;
+
+	const std::array<glm::vec4, 6> planes = GP2_FrustumCuller::ExtractPlanes(viewProjection);
+	const uint32_t allPlanes = (1u << planes.size()) - 1;
+
+	// clears the planes the box is fully inside of from planeMask, false if it is fully outside any plane
+	auto testBox = [&planes](const GP2_AABB& box, uint32_t& planeMask)
+	{
+		const glm::vec3 center = box.GetCenter();
+		const glm::vec3 halfExtent = box.max - center;
+
+		for (size_t planeIndex = 0; planeIndex < planes.size(); ++planeIndex)
+		{
+			if ((planeMask & (1u << planeIndex)) == 0)
+				continue;
+
+			const glm::vec4& plane = planes[planeIndex];
+			const float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+			const float radius = glm::dot(halfExtent, glm::abs(glm::vec3(plane)));
+
+			if (distance < -radius)
+				return false;
+			if (distance > radius)
+				planeMask &= ~(1u << planeIndex);
+		}
+		return true;
+	};
+
+	// each entry carries the planes its parent was not yet fully inside of
+	struct Entry
+	{
+		uint32_t nodeIndex;
+		uint32_t planeMask;
+	};
+	std::vector<Entry> stack{};
+	stack.reserve(64);
+	stack.push_back(Entry{ 0, allPlanes });
+
+	while (!stack.empty())
+	{
+		const Entry entry = stack.back();
+		stack.pop_back();
+
+		const Node& node = m_Nodes[entry.nodeIndex];
+
+		uint32_t planeMask = entry.planeMask;
+		if (!testBox(node.bounds, planeMask))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			for (uint32_t idx = node.first; idx < node.first + node.count; ++idx)
+			{
+				// a node fully inside the frustum needs no per-object test
+				uint32_t objectMask = planeMask;
+				if (planeMask == 0 || testBox(m_ObjectBounds[m_ObjectIndices[idx]], objectMask))
+					visible.push_back(m_ObjectIndices[idx]);
+			}
+			continue;
+		}
+
+		// push the far child first so the near one is popped next
+		const Node& left = m_Nodes[node.first];
+		const Node& right = m_Nodes[node.first + 1];
+		const glm::vec3 leftOffset = left.bounds.GetCenter() - eye;
+		const glm::vec3 rightOffset = right.bounds.GetCenter() - eye;
+		const bool leftIsNear = glm::dot(leftOffset, leftOffset) <= glm::dot(rightOffset, rightOffset);
+
+		stack.push_back(Entry{ leftIsNear ? node.first + 1 : node.first, planeMask });
+		stack.push_back(Entry{ leftIsNear ? node.first : node.first + 1, planeMask });
+	}
+}
+
+bool GP2_BVH::Raycast(const glm::vec3& origin, const glm::vec3& direction, uint32_t& hitObject, float& hitDistance) const
+{
+	if (m_Nodes.empty())
+		return false;
+
+	const glm::vec3 invDirection = 1.f / direction;
+	float closest = FLT_MAX;
+	bool hit = false;
+
+	std::vector<uint32_t> stack{};
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const Node& node = m_Nodes[stack.back()];
+		stack.pop_back();
+
+		// the closest hit may have moved closer since this node was pushed
+		float distance{};
+		if (!IntersectRay(node.bounds, origin, invDirection, closest, distance))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			for (uint32_t idx = node.first; idx < node.first + node.count; ++idx)
+			{
+				const uint32_t objectIndex = m_ObjectIndices[idx];
+				if (IntersectRay(m_ObjectBounds[objectIndex], origin, invDirection, closest, distance) && distance < closest)
+				{
+					closest = distance;
+					hitObject = objectIndex;
+					hit = true;
+				}
+			}
+			continue;
+		}
+
+		float leftDistance{}, rightDistance{};
+		const bool hitLeft = IntersectRay(m_Nodes[node.first].bounds, origin, invDirection, closest, leftDistance);
+		const bool hitRight = IntersectRay(m_Nodes[node.first + 1].bounds, origin, invDirection, closest, rightDistance);
+
+		// near child on top of the stack, so it can shrink closest before the far one is tested
+		if (hitLeft && hitRight)
+		{
+			stack.push_back(leftDistance <= rightDistance ? node.first + 1 : node.first);
+			stack.push_back(leftDistance <= rightDistance ? node.first : node.first + 1);
+		}
+		else if (hitLeft)
+			stack.push_back(node.first);
+		else if (hitRight)
+			stack.push_back(node.first + 1);
+	}
+
+	if (hit)
+		hitDistance = closest;
+
+	return hit;
+}
+
+bool GP2_BVH::IntersectRay(const GP2_AABB& box, const glm::vec3& origin, const glm::vec3& invDirection, float maxDistance, float& distance)
+{
+	const glm::vec3 t0 = (box.min - origin) * invDirection;
+	const glm::vec3 t1 = (box.max - origin) * invDirection;
+	const glm::vec3 tMin = glm::min(t0, t1);
+	const glm::vec3 tMax = glm::max(t0, t1);
+
+	const float enter = (std::max)({ tMin.x, tMin.y, tMin.z, 0.f });
+	const float exit = (std::min)({ tMax.x, tMax.y, tMax.z, maxDistance });
+
+	distance = enter;
+	return enter <= exit;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+struct GP2_AABB
+{
+	glm::vec3 min{ 0.f };
+	glm::vec3 max{ 0.f };
+
+	static GP2_AABB Empty();
+	static GP2_AABB FromSphere(const glm::vec4& sphere);
+
+	void Grow(const GP2_AABB& other);
+	void Grow(const glm::vec3& point);
+
+	glm::vec3 GetCenter() const { return (min + max) * 0.5f; };
+	float GetSurfaceArea() const;
+};
+
+// Binary bounding volume hierarchy over object bounds, built with binned SAH. Objects are referenced by
+// their index in the bounds vector given to Build; Refit takes a vector in the same order and only
+// recomputes node bounds, so it stays cheap but the tree quality degrades if objects move a lot.
+class GP2_BVH
+{
+public:
+	GP2_BVH() = default;
+	~GP2_BVH() = default;
+
+	void Build(const std::vector<GP2_AABB>& bounds);
+	void Refit(const std::vector<GP2_AABB>& bounds);
+	void Clear();
+
+	// appends the objects touching the frustum, nearer subtrees are visited first so the result is
+	// roughly front to back as seen from eye
+	void QueryFrustum(const glm::mat4& viewProjection, const glm::vec3& eye, std::vector<uint32_t>& visible) const;
+
+	// closest object whose bounds the ray hits, direction does not need to be normalized
+	bool Raycast(const glm::vec3& origin, const glm::vec3& direction, uint32_t& hitObject, float& hitDistance) const;
+
+	size_t GetObjectCount() const { return m_ObjectIndices.size(); };
+	size_t GetNodeCount() const { return m_Nodes.size(); };
+
+private:
+	struct Node
+	{
+		GP2_AABB bounds;
+		// leaves: first index into m_ObjectIndices, inner nodes: index of the left child (right = left + 1)
+		uint32_t first;
+		uint32_t count;
+
+		bool IsLeaf() const { return count > 0; };
+	};
+
+	void Subdivide(uint32_t nodeIndex, const std::vector<GP2_AABB>& bounds, const std::vector<glm::vec3>& centers);
+	float FindSplit(const Node& node, const std::vector<glm::vec3>& centers, const std::vector<GP2_AABB>& bounds, int& axis, float& position) const;
+
+	static bool IntersectRay(const GP2_AABB& box, const glm::vec3& origin, const glm::vec3& invDirection, float maxDistance, float& distance);
+
+	std::vector<Node> m_Nodes{};
+	std::vector<uint32_t> m_ObjectIndices{};
+	// kept for the per-object tests in the leaves
+	std::vector<GP2_AABB> m_ObjectBounds{};
+
+	static const uint32_t s_MaxLeafObjects{ 4 };
+	static const int s_BinCount{ 12 };
+};
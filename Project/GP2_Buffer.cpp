@@ -77,11 +77,11 @@ void GP2_Buffer::CopyData(QueueFamilyIndices queueFamInd, GP2_Buffer sourceBuffe
 	cmdPool.Destroy();
 }
 
-void GP2_Buffer::BindAsVertexBuffer(VkCommandBuffer cmdBuffer)
+void GP2_Buffer::BindAsVertexBuffer(VkCommandBuffer cmdBuffer, uint32_t binding)
 {
 	VkBuffer vertexBuffers[] = { m_Buffer };
 	VkDeviceSize offsets[] = { 0 };
-	vkCmdBindVertexBuffers(cmdBuffer, 0, 1, vertexBuffers, offsets);
+	vkCmdBindVertexBuffers(cmdBuffer, binding, 1, vertexBuffers, offsets);
 }
 
 void GP2_Buffer::BindAsIndexBuffer(VkCommandBuffer cmdBuffer)
@@ -18,7 +18,7 @@ public:
 	void MapMemory(void** data);
 	void CopyData(QueueFamilyIndices queueFamInd, GP2_Buffer sourceBuffer, VkQueue graphicsQueue);
 
-	void BindAsVertexBuffer(VkCommandBuffer cmdBuffer);
+	void BindAsVertexBuffer(VkCommandBuffer cmdBuffer, uint32_t binding = 0);
 	void BindAsIndexBuffer(VkCommandBuffer cmdBuffer);
 
 	VkBuffer GetVkBuffer() const;
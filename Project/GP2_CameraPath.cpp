@@ -0,0 +1,90 @@
+#include "GP2_CameraPath.h"
+
+#include "3rdParty/json.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+	glm::vec3 ReadVec3(const nlohmann::json& value)
+	{
+		if (!value.is_array() || value.size() != 3)
+			throw std::runtime_error("camera path vectors need 3 components!");
+
+		return glm::vec3{ value[0].get<float>(), value[1].get<float>(), value[2].get<float>() };
+	}
+}
+
+void GP2_CameraPath::Load(const std::string& filePath)
+{
+	std::ifstream file{ filePath };
+	if (!file.is_open())
+		throw std::runtime_error("failed to open camera path " + filePath + "!");
+
+	m_Keyframes.clear();
+	try
+	{
+		const nlohmann::json path = nlohmann::json::parse(file);
+		for (const nlohmann::json& keyframe : path.at("keyframes"))
+		{
+			AddKeyframe(Keyframe{ keyframe.at("time").get<float>(), ReadVec3(keyframe.at("position")), ReadVec3(keyframe.at("target")) });
+		}
+	}
+	catch (const nlohmann::json::exception& e)
+	{
+		throw std::runtime_error("failed to parse camera path " + filePath + ": " + e.what());
+	}
+
+	if (m_Keyframes.empty())
+		throw std::runtime_error("camera path " + filePath + " has no keyframes!");
+}
+
+void GP2_CameraPath::AddKeyframe(const Keyframe& keyframe)
+{
+	const auto it = std::upper_bound(m_Keyframes.begin(), m_Keyframes.end(), keyframe.time,
+		[](float time, const Keyframe& other) { return time < other.time; });
+	m_Keyframes.insert(it, keyframe);
+}
+
+void GP2_CameraPath::Sample(float time, glm::vec3& position, glm::vec3& forward) const
+{
+	if (m_Keyframes.empty())
+		throw std::logic_error("sampled an empty camera path!");
+
+	glm::vec3 target{};
+	if (time <= m_Keyframes.front().time)
+	{
+		position = m_Keyframes.front().position;
+		target = m_Keyframes.front().target;
+	}
+	else if (time >= m_Keyframes.back().time)
+	{
+		position = m_Keyframes.back().position;
+		target = m_Keyframes.back().target;
+	}
+	else
+	{
+		// first keyframe after time, the one before it exists because time is past the first
+		const auto next = std::upper_bound(m_Keyframes.begin(), m_Keyframes.end(), time,
+			[](float value, const Keyframe& keyframe) { return value < keyframe.time; });
+		const auto previous = next - 1;
+
+		const float span = next->time - previous->time;
+		const float alpha = span > 0.f ? (time - previous->time) / span : 1.f;
+		position = glm::mix(previous->position, next->position, alpha);
+		target = glm::mix(previous->target, next->target, alpha);
+	}
+
+	const glm::vec3 direction = target - position;
+	forward = glm::dot(direction, direction) > 0.f ? glm::normalize(direction) : glm::vec3{ 0.f, 0.f, -1.f };
+}
+
+float GP2_CameraPath::GetDuration() const
+{
+	if (m_Keyframes.empty())
+		return 0.f;
+
+	return m_Keyframes.back().time - m_Keyframes.front().time;
+}
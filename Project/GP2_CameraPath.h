@@ -0,0 +1,31 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// Recorded camera flight for the benchmark mode, loaded from json:
+// { "keyframes": [ { "time": 0.0, "position": [ 0, 5, 50 ], "target": [ 0, 5, 0 ] }, ... ] }
+// Keyframes are sorted by time, position and target are interpolated linearly between them.
+class GP2_CameraPath
+{
+public:
+	struct Keyframe {
+		float time{};
+		glm::vec3 position{};
+		glm::vec3 target{};
+	};
+
+	// throws if the file is missing, malformed or has no keyframes
+	void Load(const std::string& filePath);
+	void AddKeyframe(const Keyframe& keyframe);
+
+	// times outside of the path clamp to its first or last keyframe
+	void Sample(float time, glm::vec3& position, glm::vec3& forward) const;
+
+	float GetDuration() const;
+	bool IsEmpty() const { return m_Keyframes.empty(); };
+
+private:
+	std::vector<Keyframe> m_Keyframes{};
+};
@@ -1,8 +1,10 @@
 #include "GP2_CommandPool.h"
+#include "GP2_CpuProfiler.h"
 #include "vulkanbase/VulkanBase.h"
 
 void GP2_CommandPool::Initialize(const VkDevice& device, const QueueFamilyIndices& queue)
 {
+	GP2_CPU_ZONE("GP2_CommandPool::Initialize");
 	m_VkDevice = device;
 
 	VkCommandPoolCreateInfo poolInfo{};
@@ -0,0 +1,59 @@
+#include "GP2_ComputePipeline.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_ResourceCache.h"
+
+#include <stdexcept>
+
+GP2_ComputePipeline::GP2_ComputePipeline(const std::string& shaderFile) :
+	m_ShaderFile(shaderFile)
+{ }
+
+void GP2_ComputePipeline::Initialize(const VulkanContext& context, const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+	GP2_CPU_ZONE("GP2_ComputePipeline::Initialize");
+	m_Device = context.device;
+	m_PipelineLayout = context.resourceCache->GetPipelineLayout(setLayouts, pushConstantRanges);
+
+	std::vector<char> shaderCode = readFile(m_ShaderFile);
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = shaderCode.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(m_Device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create shader module!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = m_PipelineLayout;
+
+	VkResult result = vkCreateComputePipelines(m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline);
+	vkDestroyShaderModule(m_Device, shaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to create compute pipeline!");
+	}
+}
+
+void GP2_ComputePipeline::Destroy()
+{
+	vkDestroyPipeline(m_Device, m_Pipeline, nullptr);
+	m_Pipeline = VK_NULL_HANDLE;
+}
+
+void GP2_ComputePipeline::Bind(VkCommandBuffer cmdBuffer) const
+{
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+}
+
+void GP2_ComputePipeline::Dispatch(VkCommandBuffer cmdBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) const
+{
+	vkCmdDispatch(cmdBuffer, groupCountX, groupCountY, groupCountZ);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+
+#include <string>
+#include <vector>
+
+// Single compute shader + its layout. The layout comes from the resource cache, so pipelines that share
+// set layouts and push constant ranges also share the VkPipelineLayout.
+class GP2_ComputePipeline
+{
+public:
+	GP2_ComputePipeline(const std::string& shaderFile);
+	~GP2_ComputePipeline() = default;
+
+	GP2_ComputePipeline(const GP2_ComputePipeline&) = delete;
+	GP2_ComputePipeline& operator=(const GP2_ComputePipeline&) = delete;
+
+	void Initialize(const VulkanContext& context, const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+	void Destroy();
+
+	void Bind(VkCommandBuffer cmdBuffer) const;
+	void Dispatch(VkCommandBuffer cmdBuffer, uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1) const;
+
+	VkPipelineLayout GetPipelineLayout() const { return m_PipelineLayout; };
+
+private:
+	std::string m_ShaderFile;
+
+	VkDevice m_Device{ VK_NULL_HANDLE };
+
+	VkPipeline m_Pipeline{ VK_NULL_HANDLE };
+	VkPipelineLayout m_PipelineLayout{ VK_NULL_HANDLE };
+};
@@ -0,0 +1,116 @@
+#include "GP2_CpuProfiler.h"
+
+#include "3rdParty/json.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+thread_local GP2_CpuProfiler::ThreadBuffer* GP2_CpuProfiler::t_Buffer{ nullptr };
+
+struct GP2_CpuProfiler::Registry {
+	std::mutex mutex{};
+	std::vector<ThreadBuffer*> buffers{};
+
+	// the tsc rate is measured between the first registered thread and the trace
+	uint64_t firstTicks{};
+	std::chrono::steady_clock::time_point firstTime{};
+};
+
+GP2_CpuProfiler::Registry& GP2_CpuProfiler::GetRegistry()
+{
+	static Registry registry{};
+	return registry;
+}
+
+GP2_CpuProfiler::ThreadBuffer* GP2_CpuProfiler::RegisterThread()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock{ registry.mutex };
+
+	if (registry.buffers.empty())
+	{
+		registry.firstTicks = Now();
+		registry.firstTime = std::chrono::steady_clock::now();
+	}
+
+	ThreadBuffer* buffer = new ThreadBuffer{};
+	buffer->threadIndex = static_cast<uint32_t>(registry.buffers.size());
+	buffer->name = "Thread " + std::to_string(buffer->threadIndex);
+	registry.buffers.push_back(buffer);
+
+	t_Buffer = buffer;
+	return buffer;
+}
+
+void GP2_CpuProfiler::SetThreadName(const std::string& name)
+{
+	ThreadBuffer* buffer = t_Buffer;
+	if (buffer == nullptr)
+		buffer = RegisterThread();
+
+	std::lock_guard<std::mutex> lock{ GetRegistry().mutex };
+	buffer->name = name;
+}
+
+void GP2_CpuProfiler::WriteTrace(const std::string& filePath)
+{
+#if !defined(GP2_CPU_PROFILING)
+	std::cout << "cpu zones are compiled out, build with GP2_CPU_PROFILING to trace " << filePath << "\n";
+#else
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock{ registry.mutex };
+	if (registry.buffers.empty())
+		return;
+
+#if defined(GP2_CPU_RDTSC)
+	const double elapsedMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - registry.firstTime).count();
+	const double ticksPerMicrosecond = elapsedMicroseconds > 0.0 ? (Now() - registry.firstTicks) / elapsedMicroseconds : 1.0;
+#else
+	const double ticksPerMicrosecond = std::chrono::steady_clock::period::den / (std::chrono::steady_clock::period::num * 1000000.0);
+#endif
+
+	nlohmann::json events = nlohmann::json::array();
+	std::vector<Zone> zones{};
+	for (const ThreadBuffer* buffer : registry.buffers)
+	{
+		events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 0 }, { "tid", buffer->threadIndex },
+			{ "args", { { "name", buffer->name } } } });
+
+		// zones the owning thread overwrote while they were copied are dropped
+		const uint64_t end = buffer->head.load(std::memory_order_acquire);
+		const uint64_t begin = end > ZoneCapacity ? end - ZoneCapacity : 0;
+		zones.clear();
+		for (uint64_t idx = begin; idx < end; ++idx)
+		{
+			const ZoneSlot& slot = buffer->zones[idx & (ZoneCapacity - 1)];
+			zones.push_back(Zone{ slot.name.load(std::memory_order_relaxed), slot.begin.load(std::memory_order_relaxed), slot.end.load(std::memory_order_relaxed) });
+		}
+
+		// pairs with the fence in Record: a copied value from a newer zone means this load sees the head that
+		// announced it, and the slot at that head may be half written
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64_t headAfterCopy = buffer->head.load(std::memory_order_relaxed);
+		const uint64_t overwritten = headAfterCopy + 1 > ZoneCapacity ? headAfterCopy + 1 - ZoneCapacity : 0;
+
+		for (uint64_t idx = (std::max)(begin, overwritten); idx < end; ++idx)
+		{
+			const Zone& zone = zones[idx - begin];
+			events.push_back({ { "name", zone.name }, { "cat", "cpu" }, { "ph", "X" }, { "pid", 0 }, { "tid", buffer->threadIndex },
+				// the very first zone began before its thread registered
+				{ "ts", static_cast<int64_t>(zone.begin - registry.firstTicks) / ticksPerMicrosecond },
+				{ "dur", (zone.end - zone.begin) / ticksPerMicrosecond } });
+		}
+	}
+
+	std::ofstream file{ filePath };
+	if (!file.is_open())
+		throw std::runtime_error("failed to open " + filePath + " for writing!");
+
+	file << nlohmann::json{ { "traceEvents", events }, { "displayTimeUnit", "ms" } }.dump() << "\n";
+	std::cout << "cpu trace written to " << filePath << "\n";
+#endif
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GP2_CPU_RDTSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Scoped cpu zones for chrome traces (chrome://tracing or ui.perfetto.dev). A zone costs two timestamp reads
+// and one store into its thread's ring buffer, no locks; every thread keeps its last ZoneCapacity zones.
+// WriteTrace may run while the threads record: the ring is a seqlock per slot, the head announces which slot
+// is written next and the reader drops every zone whose slot was reused while it copied. Without
+// GP2_CPU_PROFILING the zone macros compile to nothing.
+//
+//     GP2_CPU_ZONE("GP2_GBuffer::Initialize");
+//
+// zone names have to outlive the trace, string literals do.
+class GP2_CpuProfiler
+{
+public:
+	static constexpr uint32_t ZoneCapacity{ 1u << 16 };
+
+	struct Zone {
+		const char* name;
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	// invariant tsc on x86, converted to microseconds when the trace is written
+	static uint64_t Now()
+	{
+#if defined(GP2_CPU_RDTSC)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	static void Record(const char* name, uint64_t begin, uint64_t end)
+	{
+		ThreadBuffer* buffer = t_Buffer;
+		if (buffer == nullptr)
+			buffer = RegisterThread();
+
+		// single writer; the fence keeps the store of the head that announced this slot ahead of its overwrite,
+		// and the release store publishes the zone to WriteTrace
+		const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		ZoneSlot& slot = buffer->zones[head & (ZoneCapacity - 1)];
+		slot.name.store(name, std::memory_order_relaxed);
+		slot.begin.store(begin, std::memory_order_relaxed);
+		slot.end.store(end, std::memory_order_relaxed);
+		buffer->head.store(head + 1, std::memory_order_release);
+	}
+
+	// shown as the thread's name in the trace
+	static void SetThreadName(const std::string& name);
+
+	// every zone still in the ring buffers, of all threads that ever recorded one
+	static void WriteTrace(const std::string& filePath);
+
+private:
+	// a Zone whose fields WriteTrace can read while the owning thread overwrites them
+	struct ZoneSlot {
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<uint64_t> begin{ 0 };
+		std::atomic<uint64_t> end{ 0 };
+	};
+
+	struct ThreadBuffer {
+		std::atomic<uint64_t> head{ 0 };
+		uint32_t threadIndex{};
+		std::string name{};
+		ZoneSlot zones[ZoneCapacity]{};
+	};
+
+	// every thread's buffer, owned here and never freed so zones of finished threads still end up in the trace
+	struct Registry;
+	static Registry& GetRegistry();
+	static ThreadBuffer* RegisterThread();
+
+	static thread_local ThreadBuffer* t_Buffer;
+};
+
+class GP2_CpuZone
+{
+public:
+	explicit GP2_CpuZone(const char* name) : m_Name{ name }, m_Begin{ GP2_CpuProfiler::Now() } {}
+	~GP2_CpuZone() { GP2_CpuProfiler::Record(m_Name, m_Begin, GP2_CpuProfiler::Now()); }
+
+	GP2_CpuZone(const GP2_CpuZone&) = delete;
+	GP2_CpuZone& operator=(const GP2_CpuZone&) = delete;
+
+private:
+	const char* m_Name;
+	uint64_t m_Begin;
+};
+
+#if defined(GP2_CPU_PROFILING)
+#define GP2_CPU_ZONE_CONCAT_INNER(a, b) a##b
+#define GP2_CPU_ZONE_CONCAT(a, b) GP2_CPU_ZONE_CONCAT_INNER(a, b)
+#define GP2_CPU_ZONE(name) const GP2_CpuZone GP2_CPU_ZONE_CONCAT(gp2CpuZone, __LINE__){ name }
+// for stages that don't line up with a scope
+#define GP2_CPU_ZONE_BEGIN(zone) const uint64_t zone = GP2_CpuProfiler::Now()
+#define GP2_CPU_ZONE_END(zone, name) GP2_CpuProfiler::Record(name, zone, GP2_CpuProfiler::Now())
+#define GP2_CPU_THREAD_NAME(name) GP2_CpuProfiler::SetThreadName(name)
+#else
+#define GP2_CPU_ZONE(name) ((void)0)
+#define GP2_CPU_ZONE_BEGIN(zone) ((void)0)
+#define GP2_CPU_ZONE_END(zone, name) ((void)0)
+#define GP2_CPU_THREAD_NAME(name) ((void)0)
+#endif
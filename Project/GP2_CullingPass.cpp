@@ -0,0 +1,236 @@
+#include "GP2_CullingPass.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_HiZPyramid.h"
+#include "GP2_UniformRing.h"
+#include "GP2_ResourceCache.h"
+#include "GP2_DescriptorAllocator.h"
+
+#include <vulkanbase/VulkanBase.h>
+
+#include <array>
+
+namespace
+{
+	GP2_Buffer* UploadBuffer(const VulkanContext& context, const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+		QueueFamilyIndices queueFamInd, VkQueue graphicsQueue)
+	{
+		GP2_Buffer stagingBuffer{ context, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+		stagingBuffer.UploadMemoryData(const_cast<void*>(data));
+
+		GP2_Buffer* buffer = new GP2_Buffer{ context, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+		buffer->CopyData(queueFamInd, stagingBuffer, graphicsQueue);
+		stagingBuffer.Destroy();
+
+		return buffer;
+	}
+}
+
+void GP2_CullingPass::Initialize(const VulkanContext& context, const std::vector<GP2_CullObject>& objects, const std::vector<VkDrawIndexedIndirectCommand>& commands,
+	const std::vector<GP2_CullCommandInfo>& commandInfos, uint32_t rangeCount, const GP2_Buffer& instanceBuffer, const GP2_HiZPyramid& hiZPyramid,
+	QueueFamilyIndices queueFamInd, VkQueue graphicsQueue)
+{
+	GP2_CPU_ZONE("GP2_CullingPass::Initialize");
+	m_UniformRing = context.uniformRing;
+	m_HiZPyramid = &hiZPyramid;
+
+	m_ObjectCount = static_cast<uint32_t>(objects.size());
+	m_CommandCount = static_cast<uint32_t>(commands.size());
+
+	// only resolves when the extension was enabled on the device
+	m_DrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(context.device, "vkCmdDrawIndexedIndirectCountKHR"));
+
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(context.physicalDevice, &supportedFeatures);
+	m_MultiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+
+	// every frame starts from the arena's commands with no visible instances
+	std::vector<VkDrawIndexedIndirectCommand> commandTemplate = commands;
+	for (auto& command : commandTemplate)
+	{
+		command.instanceCount = 0;
+	}
+
+	const VkDeviceSize commandsSize = sizeof(VkDrawIndexedIndirectCommand) * commands.size();
+
+	m_ObjectBuffer = UploadBuffer(context, objects.data(), sizeof(GP2_CullObject) * objects.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, queueFamInd, graphicsQueue);
+	m_CommandTemplateBuffer = UploadBuffer(context, commandTemplate.data(), commandsSize,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, queueFamInd, graphicsQueue);
+	m_CommandInfoBuffer = UploadBuffer(context, commandInfos.data(), sizeof(GP2_CullCommandInfo) * commandInfos.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, queueFamInd, graphicsQueue);
+
+	m_CommandBuffer = new GP2_Buffer{ context, commandsSize,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+	m_CompactedCommandBuffer = new GP2_Buffer{ context, commandsSize,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+	m_DrawCountBuffer = new GP2_Buffer{ context, sizeof(uint32_t) * rangeCount,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+	m_VisibleInstanceBuffer = new GP2_Buffer{ context, instanceBuffer.GetSizeInBytes(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+
+	CreateDescriptorSet(context, instanceBuffer, hiZPyramid);
+
+	std::vector<VkPushConstantRange> pushConstantRanges(1);
+	pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRanges[0].offset = 0;
+	pushConstantRanges[0].size = sizeof(CullConstants);
+
+	const std::vector<VkDescriptorSetLayout> setLayouts{ m_UniformRing->GetDescriptorSetLayout(), m_DescriptorSetLayout };
+	m_CullPipeline.Initialize(context, setLayouts, pushConstantRanges);
+	m_CompactPipeline.Initialize(context, setLayouts, pushConstantRanges);
+}
+
+void GP2_CullingPass::Destroy()
+{
+	m_CullPipeline.Destroy();
+	m_CompactPipeline.Destroy();
+
+	for (GP2_Buffer** buffer : { &m_ObjectBuffer, &m_CommandTemplateBuffer, &m_CommandBuffer, &m_CommandInfoBuffer,
+		&m_CompactedCommandBuffer, &m_DrawCountBuffer, &m_VisibleInstanceBuffer })
+	{
+		if (*buffer == nullptr)
+			continue;
+
+		(*buffer)->Destroy();
+		delete *buffer;
+		*buffer = nullptr;
+	}
+}
+
+void GP2_CullingPass::Record(VkCommandBuffer cmdBuffer, uint32_t cameraOffset, bool useOcclusion)
+{
+	// last frame's draws have to be done reading before the commands are reset
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	VkBufferCopy copyRegion{};
+	copyRegion.size = m_CommandTemplateBuffer->GetSizeInBytes();
+	vkCmdCopyBuffer(cmdBuffer, m_CommandTemplateBuffer->GetVkBuffer(), m_CommandBuffer->GetVkBuffer(), 1, &copyRegion);
+	vkCmdFillBuffer(cmdBuffer, m_DrawCountBuffer->GetVkBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	const VkExtent2D hiZExtent = m_HiZPyramid->GetExtent();
+	CullConstants constants{};
+	constants.objectCount = m_ObjectCount;
+	constants.commandCount = m_CommandCount;
+	constants.useOcclusion = useOcclusion && m_HiZPyramid->IsValid() ? 1u : 0u;
+	constants.hiZMipCount = m_HiZPyramid->GetMipCount();
+	constants.hiZSize = glm::vec2{ static_cast<float>(hiZExtent.width), static_cast<float>(hiZExtent.height) };
+
+	const VkPipelineLayout layout = m_CullPipeline.GetPipelineLayout();
+	m_UniformRing->BindDescriptorSet(cmdBuffer, layout, cameraOffset, 0, VK_PIPELINE_BIND_POINT_COMPUTE);
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 1, 1, &m_DescriptorSet, 0, nullptr);
+	vkCmdPushConstants(cmdBuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+	m_CullPipeline.Bind(cmdBuffer);
+	m_CullPipeline.Dispatch(cmdBuffer, (m_ObjectCount + 63) / 64);
+
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	// both pipelines share the layout, so the bound sets and push constants stay valid
+	m_CompactPipeline.Bind(cmdBuffer);
+	m_CompactPipeline.Dispatch(cmdBuffer, (m_CommandCount + 63) / 64);
+
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void GP2_CullingPass::BindVisibleInstances(VkCommandBuffer cmdBuffer) const
+{
+	m_VisibleInstanceBuffer->BindAsVertexBuffer(cmdBuffer, 1);
+}
+
+void GP2_CullingPass::Draw(VkCommandBuffer cmdBuffer, uint32_t firstCommand, uint32_t commandCount, uint32_t rangeIndex) const
+{
+	if (m_DrawIndexedIndirectCount == nullptr)
+	{
+		DrawCommands(cmdBuffer, firstCommand, commandCount);
+		return;
+	}
+
+	constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	m_DrawIndexedIndirectCount(cmdBuffer, m_CompactedCommandBuffer->GetVkBuffer(), VkDeviceSize(firstCommand) * stride,
+		m_DrawCountBuffer->GetVkBuffer(), VkDeviceSize(rangeIndex) * sizeof(uint32_t), commandCount, stride);
+}
+
+void GP2_CullingPass::DrawCommands(VkCommandBuffer cmdBuffer, uint32_t firstCommand, uint32_t commandCount) const
+{
+	constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	const VkDeviceSize offset = VkDeviceSize(firstCommand) * stride;
+
+	if (m_MultiDrawIndirect)
+	{
+		vkCmdDrawIndexedIndirect(cmdBuffer, m_CommandBuffer->GetVkBuffer(), offset, commandCount, stride);
+		return;
+	}
+
+	for (uint32_t idx = 0; idx < commandCount; ++idx)
+	{
+		vkCmdDrawIndexedIndirect(cmdBuffer, m_CommandBuffer->GetVkBuffer(), offset + VkDeviceSize(idx) * stride, 1, stride);
+	}
+}
+
+void GP2_CullingPass::UpdateHiZPyramid(const VulkanContext& context, const GP2_Buffer& instanceBuffer)
+{
+	CreateDescriptorSet(context, instanceBuffer, *m_HiZPyramid);
+}
+
+void GP2_CullingPass::CreateDescriptorSet(const VulkanContext& context, const GP2_Buffer& instanceBuffer, const GP2_HiZPyramid& hiZPyramid)
+{
+	// 0 objects, 1 source instances, 2 commands, 3 visible instances, 4 command infos, 5 compacted commands, 6 draw counts, 7 hi-z
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings(8);
+	for (uint32_t idx = 0; idx < layoutBindings.size(); ++idx)
+	{
+		layoutBindings[idx].binding = idx;
+		layoutBindings[idx].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		layoutBindings[idx].descriptorCount = 1;
+		layoutBindings[idx].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		layoutBindings[idx].pImmutableSamplers = nullptr;
+	}
+	layoutBindings[7].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+	m_DescriptorSetLayout = context.resourceCache->GetDescriptorSetLayout(layoutBindings);
+	m_DescriptorSet = context.swapChainDescriptorAllocator->Allocate(m_DescriptorSetLayout);
+
+	const std::array<VkBuffer, 7> buffers{ m_ObjectBuffer->GetVkBuffer(), instanceBuffer.GetVkBuffer(), m_CommandBuffer->GetVkBuffer(),
+		m_VisibleInstanceBuffer->GetVkBuffer(), m_CommandInfoBuffer->GetVkBuffer(), m_CompactedCommandBuffer->GetVkBuffer(), m_DrawCountBuffer->GetVkBuffer() };
+
+	std::array<VkDescriptorBufferInfo, 7> bufferInfos{};
+	std::array<VkWriteDescriptorSet, 8> descriptorWrites{};
+	for (size_t idx = 0; idx < buffers.size(); ++idx)
+	{
+		bufferInfos[idx].buffer = buffers[idx];
+		bufferInfos[idx].offset = 0;
+		bufferInfos[idx].range = VK_WHOLE_SIZE;
+
+		descriptorWrites[idx].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[idx].dstSet = m_DescriptorSet;
+		descriptorWrites[idx].dstBinding = static_cast<uint32_t>(idx);
+		descriptorWrites[idx].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[idx].descriptorCount = 1;
+		descriptorWrites[idx].pBufferInfo = &bufferInfos[idx];
+	}
+
+	VkDescriptorImageInfo hiZInfo{};
+	hiZInfo.sampler = hiZPyramid.GetSampler();
+	hiZInfo.imageView = hiZPyramid.GetView();
+	hiZInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	descriptorWrites[7].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[7].dstSet = m_DescriptorSet;
+	descriptorWrites[7].dstBinding = 7;
+	descriptorWrites[7].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[7].descriptorCount = 1;
+	descriptorWrites[7].pImageInfo = &hiZInfo;
+
+	vkUpdateDescriptorSets(context.device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "GP2_Buffer.h"
+#include "GP2_ComputePipeline.h"
+
+class GP2_HiZPyramid;
+
+// one instance to be culled: world space bounding sphere (xyz center, w radius) and the draw it belongs to
+struct GP2_CullObject {
+	glm::vec4 sphere;
+	uint32_t commandIndex;
+	uint32_t padding[3];
+};
+
+// which draw range a command belongs to and where that range starts in the compacted command buffer
+struct GP2_CullCommandInfo {
+	uint32_t rangeIndex;
+	uint32_t rangeFirst;
+};
+
+// GPU-driven culling for a set of indirect draws. Every frame a compute pass tests each instance's bounding
+// sphere against the camera frustum (and optionally last frame's hi-z pyramid), appends the visible
+// transforms to a per-draw slice of the visible instance buffer and bumps that draw's instanceCount. A
+// second pass compacts the surviving draws per range and writes one draw count per range.
+//
+// Draws come from vkCmdDrawIndexedIndirectCountKHR when VK_KHR_draw_indirect_count is enabled, otherwise
+// from the uncompacted commands, where culled draws simply have an instanceCount of 0.
+class GP2_CullingPass
+{
+public:
+	GP2_CullingPass() = default;
+	~GP2_CullingPass() = default;
+
+	GP2_CullingPass(const GP2_CullingPass&) = delete;
+	GP2_CullingPass& operator=(const GP2_CullingPass&) = delete;
+
+	void Initialize(const VulkanContext& context, const std::vector<GP2_CullObject>& objects, const std::vector<VkDrawIndexedIndirectCommand>& commands,
+		const std::vector<GP2_CullCommandInfo>& commandInfos, uint32_t rangeCount, const GP2_Buffer& instanceBuffer, const GP2_HiZPyramid& hiZPyramid,
+		QueueFamilyIndices queueFamInd, VkQueue graphicsQueue);
+	void Destroy();
+
+	// the pyramid was resized, points a new set at its new view; the old set may still be in use by a frame in flight
+	void UpdateHiZPyramid(const VulkanContext& context, const GP2_Buffer& instanceBuffer);
+
+	// records both compute passes, must be outside of a render pass
+	void Record(VkCommandBuffer cmdBuffer, uint32_t cameraOffset, bool useOcclusion);
+
+	void BindVisibleInstances(VkCommandBuffer cmdBuffer) const;
+	void Draw(VkCommandBuffer cmdBuffer, uint32_t firstCommand, uint32_t commandCount, uint32_t rangeIndex) const;
+	// any run of commands, always from the uncompacted buffer since compaction only keeps whole ranges in order
+	void DrawCommands(VkCommandBuffer cmdBuffer, uint32_t firstCommand, uint32_t commandCount) const;
+
+private:
+	struct CullConstants {
+		uint32_t objectCount;
+		uint32_t commandCount;
+		uint32_t useOcclusion;
+		uint32_t hiZMipCount;
+		glm::vec2 hiZSize;
+	};
+
+	void CreateDescriptorSet(const VulkanContext& context, const GP2_Buffer& instanceBuffer, const GP2_HiZPyramid& hiZPyramid);
+
+	GP2_Buffer* m_ObjectBuffer{};
+	GP2_Buffer* m_CommandTemplateBuffer{};
+	GP2_Buffer* m_CommandBuffer{};
+	GP2_Buffer* m_CommandInfoBuffer{};
+	GP2_Buffer* m_CompactedCommandBuffer{};
+	GP2_Buffer* m_DrawCountBuffer{};
+	GP2_Buffer* m_VisibleInstanceBuffer{};
+
+	GP2_ComputePipeline m_CullPipeline{ "shaders/CullInstances.comp.spv" };
+	GP2_ComputePipeline m_CompactPipeline{ "shaders/CompactDraws.comp.spv" };
+
+	VkDescriptorSetLayout m_DescriptorSetLayout{ VK_NULL_HANDLE };
+	VkDescriptorSet m_DescriptorSet{ VK_NULL_HANDLE };
+
+	GP2_UniformRing* m_UniformRing{ nullptr };
+	const GP2_HiZPyramid* m_HiZPyramid{ nullptr };
+
+	PFN_vkCmdDrawIndexedIndirectCountKHR m_DrawIndexedIndirectCount{ nullptr };
+	bool m_MultiDrawIndirect{ false };
+
+	uint32_t m_ObjectCount{};
+	uint32_t m_CommandCount{};
+};
@@ -0,0 +1,237 @@
+#include "GP2_DeferredLighting.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_GBuffer.h"
+#include "GP2_LightClusters.h"
+#include "GP2_ShadowCascades.h"
+#include "GP2_ResourceCache.h"
+#include "GP2_DescriptorAllocator.h"
+
+#include <array>
+#include <stdexcept>
+
+GP2_DeferredLighting::GP2_DeferredLighting(const std::string& vertexShaderFile, const std::string& fragmentShaderFile) :
+	m_VertexShaderFile(vertexShaderFile), m_FragmentShaderFile(fragmentShaderFile)
+{ }
+
+void GP2_DeferredLighting::Initialize(const VulkanContext& context, const GP2_GBuffer& gBuffer, const GP2_LightClusters& lightClusters,
+	const GP2_ShadowCascades& shadowCascades)
+{
+	GP2_CPU_ZONE("GP2_DeferredLighting::Initialize");
+	m_Device = context.device;
+	m_FrameDescriptorAllocators = context.frameDescriptorAllocators;
+	m_GBuffer = &gBuffer;
+	m_LightClusters = &lightClusters;
+	m_ShadowCascades = &shadowCascades;
+
+	CreateDescriptorSetLayout(context);
+
+	std::vector<VkPushConstantRange> pushConstantRanges(1);
+	pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRanges[0].offset = 0;
+	pushConstantRanges[0].size = sizeof(LightingConstants);
+
+	m_PipelineLayout = context.resourceCache->GetPipelineLayout({ m_DescriptorSetLayout, lightClusters.GetDescriptorSetLayout(),
+		shadowCascades.GetDescriptorSetLayout() }, pushConstantRanges);
+
+	CreatePipeline(context);
+}
+
+void GP2_DeferredLighting::Destroy()
+{
+	vkDestroyPipeline(m_Device, m_Pipeline, nullptr);
+	m_Pipeline = VK_NULL_HANDLE;
+}
+
+void GP2_DeferredLighting::Draw(VkCommandBuffer cmdBuffer, VkExtent2D extent, const UniformBufferObject& camera, uint32_t frame) const
+{
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
+
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)extent.width;
+	viewport.height = (float)extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = extent;
+	vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+	const VkDescriptorSet descriptorSet = AllocateDescriptorSet(frame);
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	m_LightClusters->BindDescriptorSet(cmdBuffer, m_PipelineLayout, 1);
+	m_ShadowCascades->BindDescriptorSet(cmdBuffer, m_PipelineLayout, 2);
+
+	LightingConstants constants{};
+	constants.inverseViewProjection = glm::inverse(camera.proj * camera.view);
+	constants.renderMode = m_RenderMode;
+	vkCmdPushConstants(cmdBuffer, m_PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+
+	// one triangle covering the screen, the vertex shader builds it from the vertex index
+	vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
+}
+
+void GP2_DeferredLighting::CreateDescriptorSetLayout(const VulkanContext& context)
+{
+	// albedo, normal, material and depth, the lights come from the cluster set
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings(4);
+	for (uint32_t idx = 0; idx < 4; ++idx)
+	{
+		layoutBindings[idx].binding = idx;
+		layoutBindings[idx].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		layoutBindings[idx].descriptorCount = 1;
+		layoutBindings[idx].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+
+	m_DescriptorSetLayout = context.resourceCache->GetDescriptorSetLayout(layoutBindings);
+}
+
+VkDescriptorSet GP2_DeferredLighting::AllocateDescriptorSet(uint32_t frame) const
+{
+	// the g-buffer images belong to the frame graph and are recreated with it, a set per frame never goes stale
+	const VkDescriptorSet descriptorSet = m_FrameDescriptorAllocators[frame].Allocate(m_DescriptorSetLayout);
+
+	const std::array<VkImageView, 4> views{ m_GBuffer->GetAlbedoView(), m_GBuffer->GetNormalView(), m_GBuffer->GetMaterialView(), m_GBuffer->GetDepthView() };
+
+	std::array<VkDescriptorImageInfo, 4> imageInfos{};
+	for (size_t idx = 0; idx < imageInfos.size(); ++idx)
+	{
+		imageInfos[idx].sampler = m_GBuffer->GetSampler();
+		imageInfos[idx].imageView = views[idx];
+		imageInfos[idx].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+	imageInfos[3].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+	std::array<VkWriteDescriptorSet, 4> writes{};
+	for (uint32_t idx = 0; idx < writes.size(); ++idx)
+	{
+		writes[idx].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[idx].dstSet = descriptorSet;
+		writes[idx].dstBinding = idx;
+		writes[idx].dstArrayElement = 0;
+		writes[idx].descriptorCount = 1;
+		writes[idx].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[idx].pImageInfo = &imageInfos[idx];
+	}
+
+	vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+	return descriptorSet;
+}
+
+void GP2_DeferredLighting::CreatePipeline(const VulkanContext& context)
+{
+	const VkShaderModule vertexModule = CreateShaderModule(m_VertexShaderFile);
+	const VkShaderModule fragmentModule = CreateShaderModule(m_FragmentShaderFile);
+
+	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertexModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragmentModule;
+	shaderStages[1].pName = "main";
+
+	VkPipelineVertexInputStateCreateInfo vertexInput{};
+	vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_FALSE;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	// the fragment shader copies the g-buffer depth, so every covered pixel has to pass
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	std::array<VkDynamicState, 2> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+	pipelineInfo.pStages = shaderStages.data();
+	pipelineInfo.pVertexInputState = &vertexInput;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = m_PipelineLayout;
+	pipelineInfo.renderPass = context.renderPass;
+	pipelineInfo.subpass = 0;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	VkResult result = vkCreateGraphicsPipelines(m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline);
+	vkDestroyShaderModule(m_Device, vertexModule, nullptr);
+	vkDestroyShaderModule(m_Device, fragmentModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to create deferred lighting pipeline!");
+	}
+}
+
+VkShaderModule GP2_DeferredLighting::CreateShaderModule(const std::string& file) const
+{
+	std::vector<char> shaderCode = readFile(file);
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = shaderCode.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(m_Device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create shader module!");
+	}
+
+	return shaderModule;
+}
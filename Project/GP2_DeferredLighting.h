@@ -0,0 +1,62 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+#include <glm/glm.hpp>
+
+#include <string>
+
+#include "GP2_UniformBufferObject.h"
+
+class GP2_GBuffer;
+class GP2_LightClusters;
+class GP2_ShadowCascades;
+
+// Fullscreen lighting pass of the deferred path, recorded in the main render pass. Every pixel reads the
+// g-buffer once, rebuilds its world position from depth and accumulates the shadowed directional light plus the
+// lights binned into its cluster, so the cost is pixels x lights no matter how much geometry overlaps.
+// The g-buffer depth is written back through gl_FragDepth, so forward draws after it depth test against
+// the deferred geometry and the hi-z pyramid still sees it.
+class GP2_DeferredLighting
+{
+public:
+	GP2_DeferredLighting(const std::string& vertexShaderFile, const std::string& fragmentShaderFile);
+	~GP2_DeferredLighting() = default;
+
+	void Initialize(const VulkanContext& context, const GP2_GBuffer& gBuffer, const GP2_LightClusters& lightClusters,
+		const GP2_ShadowCascades& shadowCascades);
+	void Destroy();
+
+	// the g-buffer set is allocated from the frame's transient allocator, so it always reads the current targets
+	void Draw(VkCommandBuffer cmdBuffer, VkExtent2D extent, const UniformBufferObject& camera, uint32_t frame) const;
+
+	// same modes as GP2_PBRRenderModes: combined, albedo, normal, specular
+	void CycleRenderMode() { m_RenderMode = (m_RenderMode + 1) % 4; };
+
+private:
+	struct LightingConstants {
+		glm::mat4 inverseViewProjection;
+		int32_t renderMode;
+	};
+
+	void CreateDescriptorSetLayout(const VulkanContext& context);
+	VkDescriptorSet AllocateDescriptorSet(uint32_t frame) const;
+	void CreatePipeline(const VulkanContext& context);
+
+	VkShaderModule CreateShaderModule(const std::string& file) const;
+
+	std::string m_VertexShaderFile;
+	std::string m_FragmentShaderFile;
+
+	VkDevice m_Device{ VK_NULL_HANDLE };
+	VkPipeline m_Pipeline{ VK_NULL_HANDLE };
+	VkPipelineLayout m_PipelineLayout{ VK_NULL_HANDLE };
+
+	VkDescriptorSetLayout m_DescriptorSetLayout{ VK_NULL_HANDLE };
+	GP2_DescriptorAllocator* m_FrameDescriptorAllocators{ nullptr };
+
+	const GP2_GBuffer* m_GBuffer{ nullptr };
+	const GP2_LightClusters* m_LightClusters{ nullptr };
+	const GP2_ShadowCascades* m_ShadowCascades{ nullptr };
+
+	int32_t m_RenderMode{ 0 };
+};
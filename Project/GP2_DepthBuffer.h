@@ -30,14 +30,17 @@ public:
 	GP2_DepthBuffer() = default;
 	~GP2_DepthBuffer() = default;
 
-	void Initialize(const VulkanContext& context, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue);
+	// the transition to the attachment layout is recorded into the batch
+	void Initialize(const VulkanContext& context, GP2_UploadBatch& uploadBatch);
 	void Destroy();
 
 	VkImageView GetDepthImageView() const { return m_DepthImageView; };
+	VkImage GetDepthImage() const { return m_DepthImage; };
+	VkFormat GetDepthFormat() const { return m_DepthFormat; };
+	VkExtent2D GetExtent() const { return m_VkExtent; };
 
 private:
 	void CreateDepthImage(int width, int height, VkFormat format);
-	void TransitionLayout(QueueFamilyIndices queueFamInd, VkQueue graphicsQueue, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
 
 	
 	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
@@ -0,0 +1,32 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+
+#include <string>
+
+class GP2_UniformRing;
+
+// Depth-only pipeline for the pbr geometry: reads just the arena's position stream and the instance
+// transforms and has no fragment shader. The pbr pipelines then shade with depthCompareOp EQUAL, so their
+// fragment shaders run once per pixel. The vertex shader must compute gl_Position exactly like the pbr
+// vertex shaders, both declare it invariant.
+class GP2_DepthPrepass
+{
+public:
+	GP2_DepthPrepass(const std::string& vertexShaderFile);
+	~GP2_DepthPrepass() = default;
+
+	void Initialize(const VulkanContext& context);
+	void Destroy();
+
+	void Bind(VkCommandBuffer cmdBuffer, VkExtent2D extent, uint32_t cameraOffset) const;
+
+private:
+	std::string m_VertexShaderFile;
+
+	VkDevice m_Device{ VK_NULL_HANDLE };
+	VkPipeline m_Pipeline{ VK_NULL_HANDLE };
+	VkPipelineLayout m_PipelineLayout{ VK_NULL_HANDLE };
+
+	GP2_UniformRing* m_UniformRing{ nullptr };
+};
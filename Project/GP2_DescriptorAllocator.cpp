@@ -0,0 +1,118 @@
+#include "GP2_DescriptorAllocator.h"
+#include "GP2_CpuProfiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void GP2_DescriptorAllocator::Initialize(VkDevice device, uint32_t initialSetsPerPool, const std::vector<PoolSizeRatio>& poolRatios)
+{
+	GP2_CPU_ZONE("GP2_DescriptorAllocator::Initialize");
+	m_VkDevice = device;
+	m_SetsPerPool = initialSetsPerPool;
+	m_PoolRatios = poolRatios;
+}
+
+void GP2_DescriptorAllocator::Destroy()
+{
+	Reset();
+
+	for (VkDescriptorPool pool : m_FreePools)
+	{
+		vkDestroyDescriptorPool(m_VkDevice, pool, nullptr);
+	}
+	m_FreePools.clear();
+}
+
+VkDescriptorSet GP2_DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+	if (m_CurrentPool == VK_NULL_HANDLE)
+		m_CurrentPool = GrabPool();
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_CurrentPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet descriptorSet;
+	VkResult result = vkAllocateDescriptorSets(m_VkDevice, &allocInfo, &descriptorSet);
+
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		m_UsedPools.push_back(m_CurrentPool);
+		m_CurrentPool = GrabPool();
+
+		allocInfo.descriptorPool = m_CurrentPool;
+		result = vkAllocateDescriptorSets(m_VkDevice, &allocInfo, &descriptorSet);
+	}
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate descriptor sets!");
+	}
+
+	return descriptorSet;
+}
+
+void GP2_DescriptorAllocator::Reset()
+{
+	if (m_CurrentPool != VK_NULL_HANDLE)
+	{
+		m_UsedPools.push_back(m_CurrentPool);
+		m_CurrentPool = VK_NULL_HANDLE;
+	}
+
+	for (VkDescriptorPool pool : m_UsedPools)
+	{
+		vkResetDescriptorPool(m_VkDevice, pool, 0);
+		m_FreePools.push_back(pool);
+	}
+	m_UsedPools.clear();
+}
+
+std::vector<GP2_DescriptorAllocator::PoolSizeRatio> GP2_DescriptorAllocator::DefaultPoolRatios()
+{
+	return {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f }
+	};
+}
+
+VkDescriptorPool GP2_DescriptorAllocator::GrabPool()
+{
+	if (!m_FreePools.empty())
+	{
+		VkDescriptorPool pool = m_FreePools.back();
+		m_FreePools.pop_back();
+		return pool;
+	}
+
+	VkDescriptorPool pool = CreatePool(m_SetsPerPool);
+	m_SetsPerPool = (std::min)(m_SetsPerPool * 2, m_MaxSetsPerPool);
+	return pool;
+}
+
+VkDescriptorPool GP2_DescriptorAllocator::CreatePool(uint32_t setCount)
+{
+	std::vector<VkDescriptorPoolSize> poolSizes(m_PoolRatios.size());
+	for (size_t idx = 0; idx < m_PoolRatios.size(); ++idx)
+	{
+		poolSizes[idx].type = m_PoolRatios[idx].type;
+		poolSizes[idx].descriptorCount = (std::max)(1u, static_cast<uint32_t>(m_PoolRatios[idx].ratio * setCount));
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = setCount;
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(m_VkDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create descriptor pool!");
+	}
+
+	return pool;
+}
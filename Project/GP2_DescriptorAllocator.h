@@ -0,0 +1,43 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+
+#include <vector>
+
+// Hands out descriptor sets from a chain of pools. When the current pool runs dry a new, larger one is
+// created, so callers never have to size pools up front. Reset() recycles every pool at once, which is
+// what the per-frame transient allocators use; static allocators are only ever reset on shutdown.
+class GP2_DescriptorAllocator
+{
+public:
+	struct PoolSizeRatio
+	{
+		VkDescriptorType type;
+		float ratio;
+	};
+
+	GP2_DescriptorAllocator() = default;
+	~GP2_DescriptorAllocator() = default;
+
+	void Initialize(VkDevice device, uint32_t initialSetsPerPool, const std::vector<PoolSizeRatio>& poolRatios);
+	void Destroy();
+
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+	void Reset();
+
+	static std::vector<PoolSizeRatio> DefaultPoolRatios();
+
+private:
+	VkDescriptorPool GrabPool();
+	VkDescriptorPool CreatePool(uint32_t setCount);
+
+	static constexpr uint32_t m_MaxSetsPerPool{ 4096 };
+
+	VkDevice m_VkDevice{ VK_NULL_HANDLE };
+
+	std::vector<PoolSizeRatio> m_PoolRatios{};
+	uint32_t m_SetsPerPool{};
+
+	VkDescriptorPool m_CurrentPool{ VK_NULL_HANDLE };
+	std::vector<VkDescriptorPool> m_UsedPools{};
+	std::vector<VkDescriptorPool> m_FreePools{};
+};
@@ -0,0 +1,92 @@
+#include "GP2_DescriptorPool.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_ResourceCache.h"
+#include "GP2_DescriptorAllocator.h"
+
+GP2_DescriptorPool::GP2_DescriptorPool(VkDevice device, size_t count) :
+	m_Device(device), m_Count(count)
+{ }
+
+void GP2_DescriptorPool::Initialize(const VulkanContext& context, size_t imageCount)
+{
+	GP2_CPU_ZONE("GP2_DescriptorPool::Initialize");
+	m_DescriptorAllocator = context.descriptorAllocator;
+
+	CreateDescriptorSetLayout(context, imageCount);
+}
+
+void GP2_DescriptorPool::CreateDescriptorSets(std::vector<std::pair<VkImageView, VkSampler>> imageDatas)
+{
+	m_DescriptorSets.resize(m_Count);
+	for (size_t i = 0; i < m_Count; ++i)
+	{
+		m_DescriptorSets[i] = m_DescriptorAllocator->Allocate(m_DescriptorSetLayout);
+	}
+
+	std::vector<VkDescriptorImageInfo> imageInfos(imageDatas.size());
+	for (size_t idx = 0; idx < imageDatas.size(); ++idx)
+	{
+		imageInfos[idx].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfos[idx].imageView = imageDatas[idx].first;
+		imageInfos[idx].sampler = imageDatas[idx].second;
+	}
+
+	for (size_t i = 0; i < m_Count; ++i)
+	{
+		std::vector<VkWriteDescriptorSet> descriptorWrites(imageDatas.size());
+		for (size_t idx = 0; idx < imageDatas.size(); ++idx)
+		{
+			descriptorWrites[idx].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[idx].dstSet = m_DescriptorSets[i];
+			descriptorWrites[idx].dstBinding = static_cast<uint32_t>(idx);
+			descriptorWrites[idx].dstArrayElement = 0;
+			descriptorWrites[idx].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descriptorWrites[idx].descriptorCount = 1;
+			descriptorWrites[idx].pImageInfo = &imageInfos[idx];
+		}
+
+		vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+void GP2_DescriptorPool::UpdateImage(uint32_t binding, VkImageView imageView, VkSampler sampler)
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = imageView;
+	imageInfo.sampler = sampler;
+
+	std::vector<VkWriteDescriptorSet> descriptorWrites(m_DescriptorSets.size());
+	for (size_t i = 0; i < m_DescriptorSets.size(); ++i)
+	{
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = m_DescriptorSets[i];
+		descriptorWrites[i].dstBinding = binding;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pImageInfo = &imageInfo;
+	}
+
+	vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void GP2_DescriptorPool::BindDescriptorSet(VkCommandBuffer cmdBuffer, VkPipelineLayout layout, size_t index)
+{
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 1, 1, &m_DescriptorSets[index], 0, nullptr);
+}
+
+void GP2_DescriptorPool::CreateDescriptorSetLayout(const VulkanContext& context, size_t imageCount)
+{
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings(imageCount);
+	for (size_t idx = 0; idx < imageCount; ++idx)
+	{
+		layoutBindings[idx].binding = static_cast<uint32_t>(idx);
+		layoutBindings[idx].descriptorCount = 1;
+		layoutBindings[idx].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		layoutBindings[idx].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		layoutBindings[idx].pImmutableSamplers = nullptr;
+	}
+
+	m_DescriptorSetLayout = context.resourceCache->GetDescriptorSetLayout(layoutBindings);
+}
@@ -0,0 +1,135 @@
+#include "GP2_FrameStats.h"
+
+#include "3rdParty/json.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	nlohmann::json SummaryToJSON(const GP2_FrameStats::Summary& summary)
+	{
+		if (summary.count == 0)
+			return nullptr;
+
+		return nlohmann::json{ { "count", summary.count }, { "mean", summary.mean }, { "p50", summary.p50 },
+			{ "p95", summary.p95 }, { "p99", summary.p99 }, { "max", summary.max } };
+	}
+
+	void PrintRow(const char* name, const GP2_FrameStats::Summary& summary)
+	{
+		std::cout << std::setw(8) << name;
+		if (summary.count == 0)
+		{
+			std::cout << "  not measured\n";
+			return;
+		}
+
+		std::cout << std::setw(10) << summary.mean << std::setw(10) << summary.p50 << std::setw(10) << summary.p95
+			<< std::setw(10) << summary.p99 << std::setw(10) << summary.max << "\n";
+	}
+}
+
+double GP2_FrameStats::Percentile(std::vector<double> values, double percentile)
+{
+	if (values.empty())
+		return 0.0;
+
+	const double rank = std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * values.size());
+	const size_t index = rank > 0.0 ? static_cast<size_t>(rank) - 1 : 0;
+
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+GP2_FrameStats::Summary GP2_FrameStats::Summarize(double Frame::* timing) const
+{
+	std::vector<double> values{};
+	values.reserve(m_Frames.size());
+	for (const Frame& frame : m_Frames)
+	{
+		if (frame.*timing >= 0.0)
+			values.push_back(frame.*timing);
+	}
+
+	Summary summary{};
+	summary.count = values.size();
+	if (values.empty())
+		return summary;
+
+	double total = 0.0;
+	for (double value : values)
+	{
+		total += value;
+	}
+	summary.mean = total / values.size();
+	summary.p50 = Percentile(values, 50.0);
+	summary.p95 = Percentile(values, 95.0);
+	summary.p99 = Percentile(values, 99.0);
+	summary.max = *std::max_element(values.begin(), values.end());
+
+	return summary;
+}
+
+void GP2_FrameStats::WriteJSON(const std::string& filePath, const std::string& description) const
+{
+	nlohmann::json frames = nlohmann::json::array();
+	for (const Frame& frame : m_Frames)
+	{
+		frames.push_back({ { "cpu", frame.cpuMilliseconds },
+			{ "gpu", frame.gpuMilliseconds >= 0.0 ? nlohmann::json(frame.gpuMilliseconds) : nlohmann::json(nullptr) },
+			{ "frame", frame.frameMilliseconds } });
+	}
+
+	const nlohmann::json results{
+		{ "description", description },
+		{ "unit", "ms" },
+		{ "cpu", SummaryToJSON(Summarize(&Frame::cpuMilliseconds)) },
+		{ "gpu", SummaryToJSON(Summarize(&Frame::gpuMilliseconds)) },
+		{ "frame", SummaryToJSON(Summarize(&Frame::frameMilliseconds)) },
+		{ "frames", frames } };
+
+	std::ofstream file{ filePath };
+	if (!file.is_open())
+		throw std::runtime_error("failed to open " + filePath + " for writing!");
+
+	file << results.dump(2) << "\n";
+}
+
+void GP2_FrameStats::WriteCSV(const std::string& filePath) const
+{
+	std::ofstream file{ filePath };
+	if (!file.is_open())
+		throw std::runtime_error("failed to open " + filePath + " for writing!");
+
+	// gpu is left empty for frames without a measurement
+	file << "frame,cpu_ms,gpu_ms,frame_ms\n";
+	for (size_t idx = 0; idx < m_Frames.size(); ++idx)
+	{
+		const Frame& frame = m_Frames[idx];
+		file << idx << "," << frame.cpuMilliseconds << ",";
+		if (frame.gpuMilliseconds >= 0.0)
+			file << frame.gpuMilliseconds;
+		file << "," << frame.frameMilliseconds << "\n";
+	}
+}
+
+void GP2_FrameStats::PrintSummary() const
+{
+	const std::ios_base::fmtflags flags = std::cout.flags();
+	const std::streamsize precision = std::cout.precision();
+
+	std::cout << m_Frames.size() << " frames, ms\n" << std::fixed << std::setprecision(3)
+		<< std::setw(8) << "" << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p95"
+		<< std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+	PrintRow("cpu", Summarize(&Frame::cpuMilliseconds));
+	PrintRow("gpu", Summarize(&Frame::gpuMilliseconds));
+	PrintRow("frame", Summarize(&Frame::frameMilliseconds));
+
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Per-frame timings of a benchmark run, summarized into percentiles and written out as json and csv.
+// A negative gpu time means the frame has no gpu measurement, it is left out of the gpu summary.
+class GP2_FrameStats
+{
+public:
+	struct Frame {
+		// recording and submitting the frame on the cpu
+		double cpuMilliseconds{};
+		// first to last command of the frame's command buffer
+		double gpuMilliseconds{ -1.0 };
+		// wall clock from the start of this frame to the start of the next
+		double frameMilliseconds{};
+	};
+
+	struct Summary {
+		size_t count{};
+		double mean{};
+		double p50{};
+		double p95{};
+		double p99{};
+		double max{};
+	};
+
+	void Clear() { m_Frames.clear(); };
+	void AddFrame(const Frame& frame) { m_Frames.push_back(frame); };
+
+	const std::vector<Frame>& GetFrames() const { return m_Frames; };
+
+	// nearest rank, percentile in [0, 100]
+	static double Percentile(std::vector<double> values, double percentile);
+
+	Summary Summarize(double Frame::* timing) const;
+
+	// description is stored as is in the json, for the scene and settings the run used
+	void WriteJSON(const std::string& filePath, const std::string& description) const;
+	void WriteCSV(const std::string& filePath) const;
+	void PrintSummary() const;
+
+private:
+	std::vector<Frame> m_Frames{};
+};
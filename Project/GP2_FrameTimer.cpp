@@ -0,0 +1,22 @@
+#include "GP2_FrameTimer.h"
+#include "GP2_GpuProfiler.h"
+
+void GP2_FrameTimer::Initialize(GP2_GpuProfiler& profiler)
+{
+	m_Profiler = &profiler;
+}
+
+double GP2_FrameTimer::GetGpuMilliseconds()
+{
+	if (!IsSupported())
+		return -1.0;
+
+	// without this the frame would only be read back frameLatency frames later
+	m_Profiler->ResolveFinishedFrames();
+	return m_Profiler->GetLastFrameMilliseconds();
+}
+
+bool GP2_FrameTimer::IsSupported() const
+{
+	return m_Profiler && m_Profiler->IsSupported();
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+
+class GP2_GpuProfiler;
+
+// Gpu duration of whole frames, read from the "Frame" scope GP2_GpuProfiler already records around the frame's
+// command buffer, so a frame carries one set of timestamps. Devices without timestamp support on the graphics
+// queue report no duration.
+class GP2_FrameTimer
+{
+public:
+	GP2_FrameTimer() = default;
+	~GP2_FrameTimer() = default;
+
+	GP2_FrameTimer(const GP2_FrameTimer&) = delete;
+	GP2_FrameTimer& operator=(const GP2_FrameTimer&) = delete;
+
+	void Initialize(GP2_GpuProfiler& profiler);
+
+	// after the frame's fence, resolves it in the profiler; negative when the frame was never timed or the
+	// device can't time it
+	double GetGpuMilliseconds();
+
+	bool IsSupported() const;
+
+private:
+	GP2_GpuProfiler* m_Profiler{ nullptr };
+};
@@ -0,0 +1,207 @@
+#include "GP2_FrustumCuller.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define GP2_CULL_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GP2_CULL_SSE
+#endif
+
+namespace
+{
+	const size_t g_SimdWidth{ 8 };
+
+	// padding spheres sit at the origin with a radius no plane distance can beat
+	const float g_PaddingRadius{ -FLT_MAX };
+
+#if defined(GP2_CULL_AVX) || defined(GP2_CULL_SSE)
+	inline void AppendMask(int mask, uint32_t baseIndex, size_t count, std::vector<uint32_t>& visible)
+	{
+		while (mask != 0)
+		{
+			uint32_t bit = 0;
+			while ((mask & (1 << bit)) == 0)
+				++bit;
+			mask &= mask - 1;
+
+			if (baseIndex + bit < count)
+				visible.push_back(baseIndex + bit);
+		}
+	}
+#endif
+}
+
+uint32_t GP2_FrustumCuller::AddSphere(const glm::vec4& sphere)
+{
+	const uint32_t index = static_cast<uint32_t>(m_Count++);
+
+	if (m_Count > m_Radius.size())
+	{
+		const size_t paddedSize = m_Radius.size() + g_SimdWidth;
+		m_CenterX.resize(paddedSize, 0.f);
+		m_CenterY.resize(paddedSize, 0.f);
+		m_CenterZ.resize(paddedSize, 0.f);
+		m_Radius.resize(paddedSize, g_PaddingRadius);
+	}
+
+	m_CenterX[index] = sphere.x;
+	m_CenterY[index] = sphere.y;
+	m_CenterZ[index] = sphere.z;
+	m_Radius[index] = sphere.w;
+
+	return index;
+}
+
+void GP2_FrustumCuller::Clear()
+{
+	m_CenterX.clear();
+	m_CenterY.clear();
+	m_CenterZ.clear();
+	m_Radius.clear();
+	m_Count = 0;
+}
+
+void GP2_FrustumCuller::Cull(const glm::mat4& viewProjection, std::vector<uint32_t>& visible) const
+{
+	visible.clear();
+
+	const std::array<glm::vec4, 6> planes = ExtractPlanes(viewProjection);
+	const size_t paddedCount = m_Radius.size();
+
+#if defined(GP2_CULL_AVX)
+	for (size_t idx = 0; idx < paddedCount; idx += 8)
+	{
+		const __m256 x = _mm256_loadu_ps(&m_CenterX[idx]);
+		const __m256 y = _mm256_loadu_ps(&m_CenterY[idx]);
+		const __m256 z = _mm256_loadu_ps(&m_CenterZ[idx]);
+		const __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&m_Radius[idx]));
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const glm::vec4& plane : planes)
+		{
+			__m256 distance = _mm256_mul_ps(x, _mm256_set1_ps(plane.x));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(y, _mm256_set1_ps(plane.y)));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(z, _mm256_set1_ps(plane.z)));
+			distance = _mm256_add_ps(distance, _mm256_set1_ps(plane.w));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GT_OQ));
+		}
+
+		AppendMask(_mm256_movemask_ps(inside), static_cast<uint32_t>(idx), m_Count, visible);
+	}
+#elif defined(GP2_CULL_SSE)
+	for (size_t idx = 0; idx < paddedCount; idx += 4)
+	{
+		const __m128 x = _mm_loadu_ps(&m_CenterX[idx]);
+		const __m128 y = _mm_loadu_ps(&m_CenterY[idx]);
+		const __m128 z = _mm_loadu_ps(&m_CenterZ[idx]);
+		const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&m_Radius[idx]));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const glm::vec4& plane : planes)
+		{
+			__m128 distance = _mm_mul_ps(x, _mm_set1_ps(plane.x));
+			distance = _mm_add_ps(distance, _mm_mul_ps(y, _mm_set1_ps(plane.y)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(plane.z)));
+			distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+			inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negRadius));
+		}
+
+		AppendMask(_mm_movemask_ps(inside), static_cast<uint32_t>(idx), m_Count, visible);
+	}
+#else
+	CullScalar(viewProjection, visible);
+	(void)paddedCount;
+#endif
+}
+
+void GP2_FrustumCuller::CullScalar(const glm::mat4& viewProjection, std::vector<uint32_t>& visible) const
+{
+	visible.clear();
+
+	const std::array<glm::vec4, 6> planes = ExtractPlanes(viewProjection);
+
+	for (size_t idx = 0; idx < m_Count; ++idx)
+	{
+		bool inside = true;
+		for (const glm::vec4& plane : planes)
+		{
+			const float distance = plane.x * m_CenterX[idx] + plane.y * m_CenterY[idx] + plane.z * m_CenterZ[idx] + plane.w;
+			if (distance <= -m_Radius[idx])
+			{
+				inside = false;
+				break;
+			}
+		}
+
+		if (inside)
+			visible.push_back(static_cast<uint32_t>(idx));
+	}
+}
+
+std::array<glm::vec4, 6> GP2_FrustumCuller::ExtractPlanes(const glm::mat4& viewProjection)
+{
+	// glm is column major, row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+	const glm::mat4 rows = glm::transpose(viewProjection);
+
+	std::array<glm::vec4, 6> planes{
+		rows[3] + rows[0],
+		rows[3] - rows[0],
+		rows[3] + rows[1],
+		rows[3] - rows[1],
+		rows[2],
+		rows[3] - rows[2]
+	};
+
+	for (glm::vec4& plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return planes;
+}
+
+glm::vec4 GP2_FrustumCuller::TransformSphere(const glm::vec4& sphere, const glm::mat4& model)
+{
+	const float maxScale = (std::max)({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+	return glm::vec4{ glm::vec3(model * glm::vec4(glm::vec3(sphere), 1.f)), sphere.w * maxScale };
+}
+
+glm::vec4 GP2_FrustumCuller::MergeSpheres(const glm::vec4& a, const glm::vec4& b)
+{
+	const glm::vec3 offset = glm::vec3(b) - glm::vec3(a);
+	const float distance = glm::length(offset);
+
+	if (distance + b.w <= a.w)
+		return a;
+	if (distance + a.w <= b.w)
+		return b;
+
+	const float radius = (distance + a.w + b.w) * 0.5f;
+	const glm::vec3 center = glm::vec3(a) + offset * ((radius - a.w) / distance);
+	return glm::vec4{ center, radius };
+}
+
+float GP2_FrustumCuller::GetScreenSize(const glm::mat4& view, const glm::mat4& proj, float viewportHeight, const glm::vec4& sphere, float nearPlane)
+{
+	// distance instead of view depth, instances beside the camera would otherwise sit at depth 0
+	const float distance = glm::length(glm::vec3(view * glm::vec4(glm::vec3(sphere), 1.f))) - sphere.w;
+
+	// proj[1][1] is negated by the vulkan y flip
+	return sphere.w * std::abs(proj[1][1]) * viewportHeight / (std::max)(distance, nearPlane);
+}
+
+const char* GP2_FrustumCuller::GetSimdName()
+{
+#if defined(GP2_CULL_AVX)
+	return "AVX";
+#elif defined(GP2_CULL_SSE)
+	return "SSE";
+#else
+	return "scalar";
+#endif
+}
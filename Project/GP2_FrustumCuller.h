@@ -0,0 +1,45 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+// Bounding spheres stored as structure of arrays, so the plane tests run on 8 (AVX) or 4 (SSE) spheres at
+// once. The arrays are padded to a multiple of 8 with spheres that never pass, the simd loops need no tail.
+class GP2_FrustumCuller
+{
+public:
+	GP2_FrustumCuller() = default;
+	~GP2_FrustumCuller() = default;
+
+	uint32_t AddSphere(const glm::vec4& sphere);
+	void Clear();
+
+	size_t GetSphereCount() const { return m_Count; };
+
+	// writes the indices of the spheres that touch the frustum of viewProjection, in ascending order
+	void Cull(const glm::mat4& viewProjection, std::vector<uint32_t>& visible) const;
+	// reference implementation, used by the benchmark to validate and compare against the simd path
+	void CullScalar(const glm::mat4& viewProjection, std::vector<uint32_t>& visible) const;
+
+	// normalized planes facing inwards, vulkan depth range so the near plane is z >= 0
+	static std::array<glm::vec4, 6> ExtractPlanes(const glm::mat4& viewProjection);
+
+	// sphere as xyz center, w radius; non-uniform scale grows the radius by the largest axis
+	static glm::vec4 TransformSphere(const glm::vec4& sphere, const glm::mat4& model);
+	static glm::vec4 MergeSpheres(const glm::vec4& a, const glm::vec4& b);
+	// pixels the sphere's diameter covers along the viewport's height when the camera faces it from the distance of
+	// its nearest point, wherever it is in the view; a sphere around the camera is measured at nearPlane
+	static float GetScreenSize(const glm::mat4& view, const glm::mat4& proj, float viewportHeight, const glm::vec4& sphere, float nearPlane = 0.1f);
+
+	static const char* GetSimdName();
+
+private:
+	std::vector<float> m_CenterX{};
+	std::vector<float> m_CenterY{};
+	std::vector<float> m_CenterZ{};
+	std::vector<float> m_Radius{};
+
+	size_t m_Count{};
+};
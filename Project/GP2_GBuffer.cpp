@@ -0,0 +1,63 @@
+#include "GP2_GBuffer.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_DepthBuffer.h"
+#include "GP2_ResourceCache.h"
+
+void GP2_GBuffer::AddToGraph(const VulkanContext& context, GP2_RenderGraph& graph, GP2_RenderGraph::ExecuteFunction recordDraws)
+{
+	m_Extent = context.swapChainExtent;
+
+	m_Targets[0] = graph.CreateImage("G-buffer albedo", VK_FORMAT_R8G8B8A8_SRGB, m_Extent);
+	m_Targets[1] = graph.CreateImage("G-buffer normal", VK_FORMAT_R16G16B16A16_SFLOAT, m_Extent);
+	m_Targets[2] = graph.CreateImage("G-buffer material", VK_FORMAT_R8G8B8A8_UNORM, m_Extent);
+
+	// unlike the main depth buffer this one is sampled, so the format also needs sampled image support
+	const VkFormat depthFormat = findSupportedFormat(context.physicalDevice, { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+	m_Targets[3] = graph.CreateImage("G-buffer depth", depthFormat, m_Extent);
+
+	m_Pass = graph.AddRasterPass("G-buffer", std::move(recordDraws));
+	for (uint32_t idx = 0; idx < ColorAttachmentCount; ++idx)
+	{
+		graph.WriteColor(m_Pass, m_Targets[idx], VkClearColorValue{ {0.f, 0.f, 0.f, 0.f} });
+	}
+	graph.WriteDepth(m_Pass, m_Targets[ColorAttachmentCount], VkClearDepthStencilValue{ 1.f, 0 });
+}
+
+void GP2_GBuffer::ReadTargets(GP2_RenderGraph& graph, GP2_RenderGraph::PassHandle pass) const
+{
+	for (GP2_RenderGraph::ResourceHandle target : m_Targets)
+	{
+		graph.ReadTexture(pass, target);
+	}
+}
+
+void GP2_GBuffer::Initialize(const VulkanContext& context, const GP2_RenderGraph& graph)
+{
+	GP2_CPU_ZONE("GP2_GBuffer::Initialize");
+	// a forward graph culls the pass, there is nothing to render into or sample
+	m_RenderPass = VK_NULL_HANDLE;
+	m_Views.fill(VK_NULL_HANDLE);
+	if (!graph.IsCulled(m_Pass))
+	{
+		m_RenderPass = graph.GetRenderPass(m_Pass);
+		for (size_t idx = 0; idx < m_Targets.size(); ++idx)
+		{
+			m_Views[idx] = graph.GetView(m_Targets[idx]);
+		}
+	}
+
+	// the lighting pass reads exactly one texel per pixel
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	m_Sampler = context.resourceCache->GetSampler(samplerInfo);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+
+#include "GP2_RenderGraph.h"
+
+#include <array>
+
+// Render targets of the deferred path and the pass that fills them:
+//	0 albedo    R8G8B8A8_SRGB        rgb base color
+//	1 normal    R16G16B16A16_SFLOAT  xyz world space normal
+//	2 material  R8G8B8A8_UNORM       metalness workflow: r metalness, g roughness, a 1
+//	                                 specular workflow:  r specular, g gloss, a 0
+//	3 depth     sampled depth format
+// The targets are transient images of the render graph, which owns their memory, the render pass and the
+// framebuffer, and moves them to the read only layouts before the lighting pass samples them.
+class GP2_GBuffer
+{
+public:
+	static constexpr uint32_t ColorAttachmentCount{ 3 };
+
+	GP2_GBuffer() = default;
+	~GP2_GBuffer() = default;
+
+	GP2_GBuffer(const GP2_GBuffer&) = delete;
+	GP2_GBuffer& operator=(const GP2_GBuffer&) = delete;
+
+	// declares the targets and the pass that clears and fills them, recordDraws runs inside its render pass
+	void AddToGraph(const VulkanContext& context, GP2_RenderGraph& graph, GP2_RenderGraph::ExecuteFunction recordDraws);
+	// lets a later pass sample every target
+	void ReadTargets(GP2_RenderGraph& graph, GP2_RenderGraph::PassHandle pass) const;
+	// once the graph is compiled; the render pass and views stay null when the graph culled the pass
+	void Initialize(const VulkanContext& context, const GP2_RenderGraph& graph);
+
+	GP2_RenderGraph::PassHandle GetPass() const { return m_Pass; };
+	VkRenderPass GetRenderPass() const { return m_RenderPass; };
+	VkImageView GetAlbedoView() const { return m_Views[0]; };
+	VkImageView GetNormalView() const { return m_Views[1]; };
+	VkImageView GetMaterialView() const { return m_Views[2]; };
+	VkImageView GetDepthView() const { return m_Views[3]; };
+	VkSampler GetSampler() const { return m_Sampler; };
+	VkExtent2D GetExtent() const { return m_Extent; };
+
+private:
+	VkExtent2D m_Extent{};
+
+	std::array<GP2_RenderGraph::ResourceHandle, ColorAttachmentCount + 1> m_Targets{};
+	GP2_RenderGraph::PassHandle m_Pass{};
+
+	std::array<VkImageView, ColorAttachmentCount + 1> m_Views{};
+	VkRenderPass m_RenderPass{ VK_NULL_HANDLE };
+	VkSampler m_Sampler{ VK_NULL_HANDLE };
+};
@@ -0,0 +1,307 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+#include <algorithm>
+#include <vector>
+#include <memory>
+
+#include "GP2_Buffer.h"
+#include "GP2_Mesh.h"
+#include "GP2_Vertex.h"
+#include "GP2_CullingPass.h"
+#include "GP2_FrustumCuller.h"
+
+// range of indirect commands in an arena that belongs to one pipeline
+struct GP2_DrawRange {
+	uint32_t firstCommand;
+	uint32_t commandCount;
+	uint32_t rangeIndex;
+	// world sphere around every instance in the range
+	glm::vec4 bounds;
+};
+
+// Packs every mesh of one vertex type into a single vertex, index and instance buffer. Each mesh becomes one
+// VkDrawIndexedIndirectCommand (indices stay 16-bit and are rebased through vertexOffset), so a pipeline
+// draws all of its meshes with one bind and one vkCmdDrawIndexedIndirect. The commands are culled on the
+// gpu every frame by a GP2_CullingPass before they are drawn.
+template<class Vertex>
+class GP2_GeometryArena
+{
+public:
+	GP2_GeometryArena() = default;
+	~GP2_GeometryArena() = default;
+
+	GP2_GeometryArena(const GP2_GeometryArena&) = delete;
+	GP2_GeometryArena& operator=(const GP2_GeometryArena&) = delete;
+
+	// copies the meshes' cpu data into the arena, only valid before Build
+	GP2_DrawRange AddMeshes(const std::vector<std::unique_ptr<GP2_Mesh<Vertex>>>& meshes);
+
+	void Build(const VulkanContext& context, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue, const GP2_HiZPyramid& hiZPyramid);
+	void Destroy();
+
+	// after the pyramid passed to Build was resized
+	void UpdateHiZPyramid(const VulkanContext& context);
+
+	// records the culling compute passes, outside of the render pass and before any Draw of this frame
+	void Cull(VkCommandBuffer cmdBuffer, uint32_t cameraOffset, bool useOcclusion);
+
+	// frustum test of every command's bounds on the cpu, so commands that are entirely off screen are never
+	// queued; until the first call every command counts as visible
+	void CullCommands(const glm::mat4& viewProjection);
+	bool IsCommandVisible(uint32_t commandIndex) const { return m_CommandVisible[commandIndex] != 0; };
+
+	void Bind(VkCommandBuffer cmdBuffer) const;
+	void Draw(VkCommandBuffer cmdBuffer, const GP2_DrawRange& range) const;
+	// part of a range, for callers that interleave the commands of several ranges
+	void DrawCommands(VkCommandBuffer cmdBuffer, uint32_t firstCommand, uint32_t commandCount) const;
+
+	// position-only stream for depth passes, the indirect commands index it exactly like the full vertices
+	void BindPositions(VkCommandBuffer cmdBuffer) const;
+	void DrawAll(VkCommandBuffer cmdBuffer) const;
+
+	// positions with every instance instead of the camera-visible ones, for passes that cull on their own
+	void BindShadowCasters(VkCommandBuffer cmdBuffer) const;
+	// instanceCount instances of one command starting at firstInstance, an index into all of the arena's instances
+	void DrawInstances(VkCommandBuffer cmdBuffer, uint32_t commandIndex, uint32_t firstInstance, uint32_t instanceCount) const;
+
+	uint32_t GetCommandCount() const { return static_cast<uint32_t>(m_Commands.size()); };
+	// its firstInstance and instanceCount index GetCullObjects as well
+	const VkDrawIndexedIndirectCommand& GetCommand(uint32_t commandIndex) const { return m_Commands[commandIndex]; };
+	// world sphere around every instance of one command
+	const glm::vec4& GetCommandBounds(uint32_t commandIndex) const { return m_CommandBounds[commandIndex]; };
+	// world bounding sphere and draw command of every instance, kept on the cpu for picking
+	const std::vector<GP2_CullObject>& GetCullObjects() const { return m_CullObjects; };
+
+private:
+	GP2_Buffer* UploadBuffer(const VulkanContext& context, const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+		QueueFamilyIndices queueFamInd, VkQueue graphicsQueue);
+
+	std::vector<Vertex> m_Vertices{};
+	std::vector<uint16_t> m_Indices{};
+	std::vector<GP2_InstanceData> m_Instances{};
+	std::vector<VkDrawIndexedIndirectCommand> m_Commands{};
+	std::vector<GP2_CullObject> m_CullObjects{};
+	std::vector<glm::vec4> m_CommandBounds{};
+	GP2_FrustumCuller m_CommandCuller{};
+	std::vector<uint32_t> m_VisibleCommands{};
+	std::vector<uint8_t> m_CommandVisible{};
+	std::vector<GP2_CullCommandInfo> m_CommandInfos{};
+	std::vector<GP2_DrawRange> m_Ranges{};
+
+	GP2_Buffer* m_VertexBuffer{};
+	GP2_Buffer* m_PositionBuffer{};
+	GP2_Buffer* m_IndexBuffer{};
+	GP2_Buffer* m_InstanceBuffer{};
+
+	GP2_CullingPass m_Culling{};
+};
+
+template<class Vertex>
+GP2_DrawRange GP2_GeometryArena<Vertex>::AddMeshes(const std::vector<std::unique_ptr<GP2_Mesh<Vertex>>>& meshes)
+{
+	GP2_DrawRange range{ static_cast<uint32_t>(m_Commands.size()), 0, static_cast<uint32_t>(m_Ranges.size()), glm::vec4{ 0.f } };
+	const size_t firstObject = m_CullObjects.size();
+
+	for (const auto& mesh : meshes)
+	{
+		const glm::vec4 localSphere = mesh->GetLocalBoundingSphere();
+
+		VkDrawIndexedIndirectCommand command{};
+		command.indexCount = static_cast<uint32_t>(mesh->GetIndices().size());
+		command.firstIndex = static_cast<uint32_t>(m_Indices.size());
+		command.vertexOffset = static_cast<int32_t>(m_Vertices.size());
+		command.firstInstance = static_cast<uint32_t>(m_Instances.size());
+
+		m_Vertices.insert(m_Vertices.end(), mesh->GetVertices().begin(), mesh->GetVertices().end());
+		m_Indices.insert(m_Indices.end(), mesh->GetIndices().begin(), mesh->GetIndices().end());
+
+		// the mesh's own transform is baked into its instances, there is no per-draw uniform anymore
+		if (mesh->GetInstances().empty())
+			m_Instances.push_back(GP2_InstanceData{ mesh->GetVertexConstant() });
+		for (const auto& instance : mesh->GetInstances())
+			m_Instances.push_back(GP2_InstanceData{ mesh->GetVertexConstant() * instance.model });
+
+		command.instanceCount = static_cast<uint32_t>(m_Instances.size()) - command.firstInstance;
+
+		const uint32_t commandIndex = static_cast<uint32_t>(m_Commands.size());
+		glm::vec4 commandBounds{ 0.f };
+		for (size_t idx = command.firstInstance; idx < m_Instances.size(); ++idx)
+		{
+			GP2_CullObject object{};
+			object.sphere = GP2_FrustumCuller::TransformSphere(localSphere, m_Instances[idx].model);
+			object.commandIndex = commandIndex;
+
+			commandBounds = idx == command.firstInstance ? object.sphere : GP2_FrustumCuller::MergeSpheres(commandBounds, object.sphere);
+			range.bounds = m_CullObjects.size() == firstObject ? object.sphere : GP2_FrustumCuller::MergeSpheres(range.bounds, object.sphere);
+			m_CullObjects.push_back(object);
+		}
+
+		m_CommandBounds.push_back(commandBounds);
+		m_CommandCuller.AddSphere(commandBounds);
+		m_CommandInfos.push_back(GP2_CullCommandInfo{ range.rangeIndex, range.firstCommand });
+		m_Commands.push_back(command);
+		++range.commandCount;
+	}
+
+	m_Ranges.push_back(range);
+	return range;
+}
+
+template<class Vertex>
+void GP2_GeometryArena<Vertex>::Build(const VulkanContext& context, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue, const GP2_HiZPyramid& hiZPyramid)
+{
+	if (m_Commands.empty())
+		return;
+
+	m_VertexBuffer = UploadBuffer(context, m_Vertices.data(), sizeof(m_Vertices[0]) * m_Vertices.size(),
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, queueFamInd, graphicsQueue);
+
+	std::vector<glm::vec3> positions{};
+	positions.reserve(m_Vertices.size());
+	for (const Vertex& vertex : m_Vertices)
+		positions.push_back(vertex.pos);
+	m_PositionBuffer = UploadBuffer(context, positions.data(), sizeof(positions[0]) * positions.size(),
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, queueFamInd, graphicsQueue);
+
+	m_IndexBuffer = UploadBuffer(context, m_Indices.data(), sizeof(m_Indices[0]) * m_Indices.size(),
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT, queueFamInd, graphicsQueue);
+	// read by the culling pass, which copies the visible transforms out, and drawn directly by the shadow passes
+	m_InstanceBuffer = UploadBuffer(context, m_Instances.data(), sizeof(m_Instances[0]) * m_Instances.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, queueFamInd, graphicsQueue);
+
+	m_Culling.Initialize(context, m_CullObjects, m_Commands, m_CommandInfos, static_cast<uint32_t>(m_Ranges.size()), *m_InstanceBuffer, hiZPyramid, queueFamInd, graphicsQueue);
+	m_CommandVisible.assign(m_Commands.size(), uint8_t{ 1 });
+
+	// everything lives on the gpu now
+	m_Vertices.clear();
+	m_Vertices.shrink_to_fit();
+	m_Indices.clear();
+	m_Indices.shrink_to_fit();
+	m_Instances.clear();
+	m_Instances.shrink_to_fit();
+}
+
+template<class Vertex>
+void GP2_GeometryArena<Vertex>::Destroy()
+{
+	if (m_Commands.empty())
+		return;
+
+	m_Culling.Destroy();
+
+	for (GP2_Buffer** buffer : { &m_VertexBuffer, &m_PositionBuffer, &m_IndexBuffer, &m_InstanceBuffer })
+	{
+		if (*buffer == nullptr)
+			continue;
+
+		(*buffer)->Destroy();
+		delete *buffer;
+		*buffer = nullptr;
+	}
+}
+
+template<class Vertex>
+void GP2_GeometryArena<Vertex>::UpdateHiZPyramid(const VulkanContext& context)
+{
+	if (m_Commands.empty())
+		return;
+
+	m_Culling.UpdateHiZPyramid(context, *m_InstanceBuffer);
+}
+
+template<class Vertex>
+void GP2_GeometryArena<Vertex>::Cull(VkCommandBuffer cmdBuffer, uint32_t cameraOffset, bool useOcclusion)
+{
+	if (m_Commands.empty())
+		return;
+
+	m_Culling.Record(cmdBuffer, cameraOffset, useOcclusion);
+}
+
+template<class Vertex>
+void GP2_GeometryArena<Vertex>::CullCommands(const glm::mat4& viewProjection)
+{
+	if (m_Commands.empty())
+		return;
+
+	m_CommandCuller.Cull(viewProjection, m_VisibleCommands);
+
+	std::fill(m_CommandVisible.begin(), m_CommandVisible.end(), uint8_t{ 0 });
+	for (uint32_t commandIndex : m_VisibleCommands)
+	{
+		m_CommandVisible[commandIndex] = 1;
+	}
+}
+
+template<class Vertex>
+void GP2_GeometryArena<Vertex>::Bind(VkCommandBuffer cmdBuffer) const
+{
+	m_VertexBuffer->BindAsVertexBuffer(cmdBuffer);
+	m_Culling.BindVisibleInstances(cmdBuffer);
+	m_IndexBuffer->BindAsIndexBuffer(cmdBuffer);
+}
+
+template<class Vertex>
+void GP2_GeometryArena<Vertex>::Draw(VkCommandBuffer cmdBuffer, const GP2_DrawRange& range) const
+{
+	if (range.commandCount == 0)
+		return;
+
+	m_Culling.Draw(cmdBuffer, range.firstCommand, range.commandCount, range.rangeIndex);
+}
+
+template<class Vertex>
+void GP2_GeometryArena<Vertex>::DrawCommands(VkCommandBuffer cmdBuffer, uint32_t firstCommand, uint32_t commandCount) const
+{
+	if (commandCount == 0)
+		return;
+
+	m_Culling.DrawCommands(cmdBuffer, firstCommand, commandCount);
+}
+
+template<class Vertex>
+void GP2_GeometryArena<Vertex>::BindPositions(VkCommandBuffer cmdBuffer) const
+{
+	m_PositionBuffer->BindAsVertexBuffer(cmdBuffer);
+	m_Culling.BindVisibleInstances(cmdBuffer);
+	m_IndexBuffer->BindAsIndexBuffer(cmdBuffer);
+}
+
+template<class Vertex>
+void GP2_GeometryArena<Vertex>::DrawAll(VkCommandBuffer cmdBuffer) const
+{
+	for (const GP2_DrawRange& range : m_Ranges)
+	{
+		Draw(cmdBuffer, range);
+	}
+}
+
+template<class Vertex>
+void GP2_GeometryArena<Vertex>::BindShadowCasters(VkCommandBuffer cmdBuffer) const
+{
+	m_PositionBuffer->BindAsVertexBuffer(cmdBuffer);
+	m_InstanceBuffer->BindAsVertexBuffer(cmdBuffer, 1);
+	m_IndexBuffer->BindAsIndexBuffer(cmdBuffer);
+}
+
+template<class Vertex>
+void GP2_GeometryArena<Vertex>::DrawInstances(VkCommandBuffer cmdBuffer, uint32_t commandIndex, uint32_t firstInstance, uint32_t instanceCount) const
+{
+	const VkDrawIndexedIndirectCommand& command = m_Commands[commandIndex];
+	vkCmdDrawIndexed(cmdBuffer, command.indexCount, instanceCount, command.firstIndex, command.vertexOffset, firstInstance);
+}
+
+template<class Vertex>
+GP2_Buffer* GP2_GeometryArena<Vertex>::UploadBuffer(const VulkanContext& context, const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+	QueueFamilyIndices queueFamInd, VkQueue graphicsQueue)
+{
+	GP2_Buffer stagingBuffer{ context, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+	stagingBuffer.UploadMemoryData(const_cast<void*>(data));
+
+	GP2_Buffer* buffer = new GP2_Buffer{ context, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+	buffer->CopyData(queueFamInd, stagingBuffer, graphicsQueue);
+	stagingBuffer.Destroy();
+
+	return buffer;
+}
@@ -0,0 +1,297 @@
+#include "GP2_GpuProfiler.h"
+#include "GP2_CpuProfiler.h"
+
+#include "3rdParty/json.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+void GP2_GpuProfiler::Initialize(const VulkanContext& context, uint32_t graphicsFamily, uint32_t frameLatency, uint32_t maxScopes)
+{
+	GP2_CPU_ZONE("GP2_GpuProfiler::Initialize");
+	m_VkDevice = context.device;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(context.physicalDevice, &properties);
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(context.physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(context.physicalDevice, &familyCount, families.data());
+
+	const uint32_t validBits = families[graphicsFamily].timestampValidBits;
+	m_IsSupported = validBits > 0;
+	m_TimestampMask = validBits >= 64 ? ~uint64_t{ 0 } : (uint64_t{ 1 } << validBits) - 1;
+	m_TimestampPeriod = properties.limits.timestampPeriod;
+
+	m_QueriesPerSlot = 2 * maxScopes;
+	m_Slots.assign(frameLatency, Slot{});
+	m_CurrentSlot = 0;
+
+	if (!m_IsSupported)
+		return;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = m_QueriesPerSlot * frameLatency;
+
+	if (vkCreateQueryPool(m_VkDevice, &poolInfo, nullptr, &m_QueryPool) != VK_SUCCESS)
+		throw std::runtime_error("failed to create gpu profiler query pool!");
+}
+
+void GP2_GpuProfiler::Destroy()
+{
+	Flush();
+
+	if (m_QueryPool != VK_NULL_HANDLE)
+		vkDestroyQueryPool(m_VkDevice, m_QueryPool, nullptr);
+	m_QueryPool = VK_NULL_HANDLE;
+	m_Slots.clear();
+}
+
+void GP2_GpuProfiler::BeginFrame(VkCommandBuffer cmdBuffer)
+{
+	if (!m_IsSupported)
+		return;
+
+	m_CurrentSlot = (m_CurrentSlot + 1) % static_cast<uint32_t>(m_Slots.size());
+	Slot& slot = m_Slots[m_CurrentSlot];
+	if (slot.isPending)
+		Resolve(slot, m_CurrentSlot, false);
+
+	slot.scopes.clear();
+	slot.queryCount = 0;
+	slot.isPending = true;
+	m_OpenScopes = 0;
+
+	vkCmdResetQueryPool(cmdBuffer, m_QueryPool, m_CurrentSlot * m_QueriesPerSlot, m_QueriesPerSlot);
+	m_FrameScope = BeginScope(cmdBuffer, "Frame");
+	slot.frameScope = m_FrameScope;
+}
+
+void GP2_GpuProfiler::EndFrame(VkCommandBuffer cmdBuffer)
+{
+	EndScope(cmdBuffer, m_FrameScope);
+	m_FrameScope = InvalidScope;
+}
+
+uint32_t GP2_GpuProfiler::BeginScope(VkCommandBuffer cmdBuffer, const std::string& name)
+{
+	if (!m_IsSupported)
+		return InvalidScope;
+
+	Slot& slot = m_Slots[m_CurrentSlot];
+	if (slot.queryCount + 2 > m_QueriesPerSlot)
+		return InvalidScope;
+
+	Scope scope{};
+	scope.name = name;
+	scope.depth = m_OpenScopes++;
+	scope.beginQuery = slot.queryCount++;
+	scope.endQuery = slot.queryCount++;
+
+	vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, m_CurrentSlot * m_QueriesPerSlot + scope.beginQuery);
+
+	slot.scopes.push_back(scope);
+	return static_cast<uint32_t>(slot.scopes.size() - 1);
+}
+
+void GP2_GpuProfiler::EndScope(VkCommandBuffer cmdBuffer, uint32_t scope)
+{
+	if (scope == InvalidScope)
+		return;
+
+	const Slot& slot = m_Slots[m_CurrentSlot];
+	vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, m_CurrentSlot * m_QueriesPerSlot + slot.scopes[scope].endQuery);
+	--m_OpenScopes;
+}
+
+double GP2_GpuProfiler::GetAverageMilliseconds(const std::string& name) const
+{
+	for (const Average& average : m_Averages)
+	{
+		if (average.name == name)
+			return average.count > 0 ? average.sum / average.count : 0.0;
+	}
+	return 0.0;
+}
+
+std::string GP2_GpuProfiler::GetSummary(size_t scopeCount) const
+{
+	std::vector<std::pair<double, const std::string*>> scopes{};
+	for (const Average& average : m_Averages)
+	{
+		if (average.name != "Frame" && average.count > 0)
+			scopes.push_back({ average.sum / average.count, &average.name });
+	}
+	std::sort(scopes.begin(), scopes.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+	std::ostringstream summary{};
+	summary << std::fixed << std::setprecision(2) << "gpu " << GetAverageMilliseconds("Frame") << " ms";
+	for (size_t idx = 0; idx < (std::min)(scopeCount, scopes.size()); ++idx)
+	{
+		summary << " | " << *scopes[idx].second << " " << scopes[idx].first;
+	}
+	return summary.str();
+}
+
+void GP2_GpuProfiler::PrintAverages() const
+{
+	if (!m_IsSupported)
+	{
+		if (m_IsVerbose)
+			std::cout << "gpu profiler: no timestamp support on the graphics queue\n";
+		return;
+	}
+
+	const std::ios_base::fmtflags flags = std::cout.flags();
+	const std::streamsize precision = std::cout.precision();
+
+	std::cout << std::fixed << std::setprecision(3) << "gpu profiler, average of the last " << HistorySize << " frames, "
+		<< m_DroppedFrames << " frames dropped\n";
+	for (const Average& average : m_Averages)
+	{
+		std::cout << "  " << std::left << std::setw(24) << average.name << std::right << std::setw(10)
+			<< (average.count > 0 ? average.sum / average.count : 0.0) << " ms\n";
+	}
+
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
+
+void GP2_GpuProfiler::CaptureTrace(const std::string& filePath, uint32_t frameCount)
+{
+	m_TracePath = filePath;
+	m_TraceFramesLeft = frameCount;
+	m_HasTraceOrigin = false;
+	m_TraceEvents.clear();
+}
+
+void GP2_GpuProfiler::Flush()
+{
+	ResolvePending(true);
+
+	if (!m_TracePath.empty() && !m_TraceEvents.empty())
+		WriteTrace();
+}
+
+void GP2_GpuProfiler::ResolveFinishedFrames()
+{
+	ResolvePending(false);
+}
+
+void GP2_GpuProfiler::ResolvePending(bool wait)
+{
+	for (uint32_t offset = 1; offset <= m_Slots.size(); ++offset)
+	{
+		const uint32_t slotIndex = (m_CurrentSlot + offset) % static_cast<uint32_t>(m_Slots.size());
+		if (m_Slots[slotIndex].isPending)
+			Resolve(m_Slots[slotIndex], slotIndex, wait);
+	}
+}
+
+void GP2_GpuProfiler::Resolve(Slot& slot, uint32_t slotIndex, bool wait)
+{
+	slot.isPending = false;
+	if (slot.queryCount == 0)
+		return;
+
+	std::vector<uint64_t> timestamps(slot.queryCount);
+	const VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | (wait ? VK_QUERY_RESULT_WAIT_BIT : 0);
+	if (vkGetQueryPoolResults(m_VkDevice, m_QueryPool, slotIndex * m_QueriesPerSlot, slot.queryCount,
+		timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), flags) != VK_SUCCESS)
+	{
+		// still in flight, frameLatency is too small for the frames in flight
+		++m_DroppedFrames;
+		return;
+	}
+
+	const bool tracing = m_TraceFramesLeft > 0;
+	if (tracing && !m_HasTraceOrigin)
+	{
+		m_TraceOrigin = timestamps[slot.scopes.front().beginQuery] & m_TimestampMask;
+		m_HasTraceOrigin = true;
+	}
+
+	// a name recorded several times in one frame counts as one sample of their sum
+	std::vector<std::pair<const std::string*, double>> frameTotals{};
+	for (size_t idx = 0; idx < slot.scopes.size(); ++idx)
+	{
+		const Scope& scope = slot.scopes[idx];
+		const uint64_t begin = timestamps[scope.beginQuery] & m_TimestampMask;
+		const uint64_t end = timestamps[scope.endQuery] & m_TimestampMask;
+		const double nanoseconds = static_cast<double>((end - begin) & m_TimestampMask) * m_TimestampPeriod;
+
+		if (idx == slot.frameScope)
+			m_LastFrameMilliseconds = nanoseconds / 1000000.0;
+
+		auto total = std::find_if(frameTotals.begin(), frameTotals.end(), [&scope](const auto& other) { return *other.first == scope.name; });
+		if (total == frameTotals.end())
+			frameTotals.push_back({ &scope.name, nanoseconds / 1000000.0 });
+		else
+			total->second += nanoseconds / 1000000.0;
+
+		if (tracing)
+		{
+			const double start = static_cast<double>((begin - m_TraceOrigin) & m_TimestampMask) * m_TimestampPeriod;
+			m_TraceEvents.push_back(TraceEvent{ scope.name, scope.depth, start / 1000.0, nanoseconds / 1000.0 });
+		}
+	}
+
+	for (const auto& total : frameTotals)
+	{
+		AddSample(*total.first, total.second);
+	}
+
+	if (tracing && --m_TraceFramesLeft == 0)
+		WriteTrace();
+}
+
+void GP2_GpuProfiler::AddSample(const std::string& name, double milliseconds)
+{
+	auto it = std::find_if(m_Averages.begin(), m_Averages.end(), [&name](const Average& average) { return average.name == name; });
+	if (it == m_Averages.end())
+	{
+		m_Averages.push_back(Average{});
+		m_Averages.back().name = name;
+		it = m_Averages.end() - 1;
+	}
+
+	// the oldest sample drops out of the window
+	if (it->count == HistorySize)
+		it->sum -= it->history[it->next];
+	else
+		++it->count;
+
+	it->history[it->next] = milliseconds;
+	it->sum += milliseconds;
+	it->next = (it->next + 1) % HistorySize;
+}
+
+void GP2_GpuProfiler::WriteTrace()
+{
+	nlohmann::json events = nlohmann::json::array();
+	events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", 1 }, { "args", { { "name", "GPU" } } } });
+	for (const TraceEvent& event : m_TraceEvents)
+	{
+		events.push_back({ { "name", event.name }, { "cat", "gpu" }, { "ph", "X" }, { "pid", 1 }, { "tid", 1 },
+			{ "ts", event.start }, { "dur", event.duration }, { "args", { { "depth", event.depth } } } });
+	}
+
+	std::ofstream file{ m_TracePath };
+	if (!file.is_open())
+		throw std::runtime_error("failed to open " + m_TracePath + " for writing!");
+
+	file << nlohmann::json{ { "traceEvents", events }, { "displayTimeUnit", "ms" } }.dump() << "\n";
+	if (m_IsVerbose)
+		std::cout << "gpu trace written to " << m_TracePath << "\n";
+
+	m_TracePath.clear();
+	m_TraceFramesLeft = 0;
+	m_TraceEvents.clear();
+}
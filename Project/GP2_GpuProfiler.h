@@ -0,0 +1,120 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+
+#include <string>
+#include <vector>
+
+// Timestamp pairs around named, possibly nested, scopes of the frame's command buffer. Every frame writes into
+// its own slot of the query pool; a slot is read back when it comes around again, frameLatency frames later,
+// so reading never waits on the gpu. Resolved scopes feed rolling averages and, while capturing, a chrome
+// trace (chrome://tracing or ui.perfetto.dev).
+class GP2_GpuProfiler
+{
+public:
+	static constexpr uint32_t InvalidScope{ UINT32_MAX };
+
+	GP2_GpuProfiler() = default;
+	~GP2_GpuProfiler() = default;
+
+	GP2_GpuProfiler(const GP2_GpuProfiler&) = delete;
+	GP2_GpuProfiler& operator=(const GP2_GpuProfiler&) = delete;
+
+	// frameLatency has to be larger than the frames in flight
+	void Initialize(const VulkanContext& context, uint32_t graphicsFamily, uint32_t frameLatency = 3, uint32_t maxScopes = 64);
+	// the device has to be idle
+	void Destroy();
+
+	// resolves the slot this frame reuses, then opens the "Frame" scope; outside of any render pass
+	void BeginFrame(VkCommandBuffer cmdBuffer);
+	void EndFrame(VkCommandBuffer cmdBuffer);
+
+	// InvalidScope once the frame ran out of queries, EndScope ignores it
+	uint32_t BeginScope(VkCommandBuffer cmdBuffer, const std::string& name);
+	void EndScope(VkCommandBuffer cmdBuffer, uint32_t scope);
+
+	// per frame sum of the scopes with that name, over the last HistorySize frames it was recorded in
+	double GetAverageMilliseconds(const std::string& name) const;
+	// "Frame 3.20 ms | Shadows 1.10 | ..." with the slowest scopes first, for the window title
+	std::string GetSummary(size_t scopeCount) const;
+	void PrintAverages() const;
+
+	// the next frameCount resolved frames go into filePath, written once they are all in
+	void CaptureTrace(const std::string& filePath, uint32_t frameCount);
+	// after vkDeviceWaitIdle: resolves every frame still in flight and writes an unfinished capture
+	void Flush();
+	// after the fence of the last recorded frame: resolves it and every older frame now instead of when their
+	// slots come around again
+	void ResolveFinishedFrames();
+	// "Frame" scope of the last resolved frame, negative before the first one
+	double GetLastFrameMilliseconds() const { return m_LastFrameMilliseconds; };
+
+	bool IsSupported() const { return m_IsSupported; };
+	// status lines, like where a trace was written, only go to std::cout when verbose
+	void SetVerbose(bool verbose) { m_IsVerbose = verbose; };
+
+private:
+	static constexpr size_t HistorySize{ 64 };
+
+	struct Scope {
+		std::string name{};
+		uint32_t depth{};
+		// relative to the slot's first query
+		uint32_t beginQuery{};
+		uint32_t endQuery{};
+	};
+
+	struct Slot {
+		std::vector<Scope> scopes{};
+		uint32_t queryCount{};
+		uint32_t frameScope{ InvalidScope };
+		bool isPending{ false };
+	};
+
+	struct Average {
+		std::string name{};
+		double history[HistorySize]{};
+		size_t next{};
+		size_t count{};
+		double sum{};
+	};
+
+	struct TraceEvent {
+		std::string name{};
+		uint32_t depth{};
+		// microseconds since the first captured timestamp
+		double start{};
+		double duration{};
+	};
+
+	void Resolve(Slot& slot, uint32_t slotIndex, bool wait);
+	// oldest first, so the trace stays in frame order
+	void ResolvePending(bool wait);
+	void AddSample(const std::string& name, double milliseconds);
+	void WriteTrace();
+
+	VkDevice m_VkDevice{ VK_NULL_HANDLE };
+	VkQueryPool m_QueryPool{ VK_NULL_HANDLE };
+	bool m_IsSupported{ false };
+	bool m_IsVerbose{ false };
+
+	// nanoseconds per tick, and the bits of a timestamp that are valid on the graphics queue
+	double m_TimestampPeriod{};
+	uint64_t m_TimestampMask{};
+
+	uint32_t m_QueriesPerSlot{};
+	std::vector<Slot> m_Slots{};
+	uint32_t m_CurrentSlot{};
+	uint32_t m_OpenScopes{};
+	uint32_t m_FrameScope{ InvalidScope };
+	uint32_t m_DroppedFrames{};
+	double m_LastFrameMilliseconds{ -1.0 };
+
+	std::vector<Average> m_Averages{};
+
+	std::string m_TracePath{};
+	uint32_t m_TraceFramesLeft{};
+	bool m_HasTraceOrigin{ false };
+	uint64_t m_TraceOrigin{};
+	std::vector<TraceEvent> m_TraceEvents{};
+};
@@ -6,53 +6,52 @@
 #include "CommandBuffer.h"
 #include "GP2_Mesh.h"
 #include "GP2_Shader.h"
-#include "GP2_DescriptorPool.h"
+#include "GP2_UniformRing.h"
+#include "GP2_CpuProfiler.h"
 
-template <class UBO, class Vertex>
+template <class Vertex>
 class GP2_GraphicsPipeline2D
 {
 public:
 	GP2_GraphicsPipeline2D(const std::string& vertexShaderFile, const std::string& fragmentShaderFile);
 	~GP2_GraphicsPipeline2D() = default;
 
-	void Initialize(const VulkanContext& context, size_t descriptorPoolCount);
+	void Initialize(const VulkanContext& context);
 
 	void CleanUp();
 
-	void Record(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex);
-	void DrawScene(const GP2_CommandBuffer& cmdBuffer);
+	void Record(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, uint32_t cameraOffset);
+	void DrawScene(const GP2_CommandBuffer& cmdBuffer, uint32_t cameraOffset);
 
 	void AddMesh(std::unique_ptr<GP2_Mesh<Vertex>> mesh);
 
-	void SetUBO(UBO ubo, size_t uboIndex);
-
 private:
 	void CreateGraphicsPipeline();
 
-	VkPushConstantRange CreatePushConstantRange();
-
 	VkDevice m_Device{ VK_NULL_HANDLE };
 
 	VkPipeline m_GraphicsPipeline{ VK_NULL_HANDLE };
 	VkPipelineLayout m_PipelineLayout{ VK_NULL_HANDLE };
 
+	GP2_ResourceCache* m_ResourceCache{ nullptr };
+
 	VkRenderPass m_RenderPass{ VK_NULL_HANDLE };
 
 	GP2_Shader<Vertex> m_Shader;
 
-	GP2_DescriptorPool<UBO>* m_DescriptorPool{};
+	GP2_UniformRing* m_UniformRing{ nullptr };
 
 	std::vector<std::unique_ptr<GP2_Mesh<Vertex>>> m_Meshes{};
 };
 
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline2D<UBO, Vertex>::AddMesh(std::unique_ptr<GP2_Mesh<Vertex>> mesh)
+template <class Vertex>
+void GP2_GraphicsPipeline2D<Vertex>::AddMesh(std::unique_ptr<GP2_Mesh<Vertex>> mesh)
 {
 	m_Meshes.push_back(std::move(mesh));
 }
 
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline2D<UBO, Vertex>::CleanUp()
+template <class Vertex>
+void GP2_GraphicsPipeline2D<Vertex>::CleanUp()
 {
 	for (auto& mesh : m_Meshes)
 	{
@@ -60,46 +59,31 @@ void GP2_GraphicsPipeline2D<UBO, Vertex>::CleanUp()
 	}
 
 	vkDestroyPipeline(m_Device, m_GraphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
-
-	delete m_DescriptorPool;
 }
 
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline2D<UBO, Vertex>::Initialize(const VulkanContext& context, size_t descriptorPoolCount)
+template <class Vertex>
+void GP2_GraphicsPipeline2D<Vertex>::Initialize(const VulkanContext& context)
 {
+	GP2_CPU_ZONE("GP2_GraphicsPipeline2D::Initialize");
 	m_Device = context.device;
 	m_RenderPass = context.renderPass;
+	m_ResourceCache = context.resourceCache;
+	m_UniformRing = context.uniformRing;
 
 	m_Shader.Initialize(context.device);
 
-	m_DescriptorPool = new GP2_DescriptorPool<UBO>{ context.device, descriptorPoolCount };
-	m_DescriptorPool->Initialize(context);
-	m_DescriptorPool->CreateDescriptorSets();
-
 	CreateGraphicsPipeline();
 }
 
-template <class UBO, class Vertex>
-GP2_GraphicsPipeline2D<UBO, Vertex>::GP2_GraphicsPipeline2D(const std::string& vertexShaderFile, const std::string& fragmentShaderFile) :
+template <class Vertex>
+GP2_GraphicsPipeline2D<Vertex>::GP2_GraphicsPipeline2D(const std::string& vertexShaderFile, const std::string& fragmentShaderFile) :
 	m_Shader{ vertexShaderFile, fragmentShaderFile }
 {
 
 }
 
-template <class UBO, class Vertex>
-VkPushConstantRange GP2_GraphicsPipeline2D<UBO, Vertex>::CreatePushConstantRange()
-{
-	VkPushConstantRange pushConstantRange{};
-	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	pushConstantRange.offset = 0;
-	pushConstantRange.size = sizeof(GP2_MeshData);
-
-	return pushConstantRange;
-}
-
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline2D<UBO, Vertex>::CreateGraphicsPipeline()
+template <class Vertex>
+void GP2_GraphicsPipeline2D<Vertex>::CreateGraphicsPipeline()
 {
 	VkPipelineViewportStateCreateInfo viewportState{};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -145,17 +129,7 @@ void GP2_GraphicsPipeline2D<UBO, Vertex>::CreateGraphicsPipeline()
 	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
 	dynamicState.pDynamicStates = dynamicStates.data();
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &m_DescriptorPool->GetDescriptorSetLayout();
-	pipelineLayoutInfo.pushConstantRangeCount = 1;
-	VkPushConstantRange pushConstantRange = CreatePushConstantRange();
-	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-	if (vkCreatePipelineLayout(m_Device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create pipeline layout!");
-	}
+	m_PipelineLayout = m_ResourceCache->GetPipelineLayout({ m_UniformRing->GetDescriptorSetLayout() }, {});
 
 	VkPipelineDepthStencilStateCreateInfo depthStencil{};
 	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
@@ -199,17 +173,17 @@ void GP2_GraphicsPipeline2D<UBO, Vertex>::CreateGraphicsPipeline()
 	m_Shader.DestroyShaderModules();
 }
 
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline2D<UBO, Vertex>::DrawScene(const GP2_CommandBuffer& cmdBuffer)
+template <class Vertex>
+void GP2_GraphicsPipeline2D<Vertex>::DrawScene(const GP2_CommandBuffer& cmdBuffer, uint32_t cameraOffset)
 {
 	for (auto& mesh : m_Meshes)
 	{
-		mesh->Draw(m_PipelineLayout, cmdBuffer.GetVkCommandBuffer());
+		mesh->Draw(m_PipelineLayout, cmdBuffer.GetVkCommandBuffer(), *m_UniformRing, cameraOffset);
 	}
 }
 
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline2D<UBO, Vertex>::Record(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex)
+template <class Vertex>
+void GP2_GraphicsPipeline2D<Vertex>::Record(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, uint32_t cameraOffset)
 {
 	vkCmdBindPipeline(cmdBuffer.GetVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
 
@@ -227,13 +201,5 @@ void GP2_GraphicsPipeline2D<UBO, Vertex>::Record(const GP2_CommandBuffer& cmdBuf
 	scissor.extent = extent;
 	vkCmdSetScissor(cmdBuffer.GetVkCommandBuffer(), 0, 1, &scissor);
 
-	m_DescriptorPool->BindDescriptorSet(cmdBuffer.GetVkCommandBuffer(), m_PipelineLayout, imageIndex);
-
-	DrawScene(cmdBuffer);
-}
-
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline2D<UBO, Vertex>::SetUBO(UBO ubo, size_t uboIndex)
-{
-	m_DescriptorPool->SetUBO(ubo, uboIndex);
+	DrawScene(cmdBuffer, cameraOffset);
 }
\ No newline at end of file
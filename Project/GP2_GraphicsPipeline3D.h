@@ -6,9 +6,14 @@
 #include "GP2_Mesh.h"
 #include "GP2_Shader.h"
 #include "GP2_DescriptorPool.h"
+#include "GP2_UniformRing.h"
 #include "GP2_ImageBuffer.h"
+#include "GP2_BVH.h"
+#include "GP2_UniformBufferObject.h"
+#include "GP2_RenderQueue.h"
+#include "GP2_CpuProfiler.h"
 
-template <class UBO, class Vertex>
+template <class Vertex>
 class GP2_GraphicsPipeline3D
 {
 public:
@@ -19,42 +24,63 @@ public:
 
 	void CleanUp();
 
-	void Record(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex);
-	void DrawScene(const GP2_CommandBuffer& cmdBuffer);
+	// queues one draw per mesh whose bounds touch the camera frustum, the payload is the mesh index
+	void QueueDraws(GP2_RenderQueue& renderQueue, uint32_t pipelineId, const UniformBufferObject& camera);
 
-	void AddMesh(std::unique_ptr<GP2_Mesh<Vertex>> mesh);
+	void Bind(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex);
+	void DrawMesh(const GP2_CommandBuffer& cmdBuffer, uint32_t meshIndex, uint32_t cameraOffset);
 
-	void SetUBO(UBO ubo, size_t uboIndex);
+	void AddMesh(std::unique_ptr<GP2_Mesh<Vertex>> mesh);
+	// moves a mesh, the bvh is refitted instead of rebuilt on the next draw
+	void SetMeshTransform(size_t meshIndex, const glm::mat4& transform);
 
 private:
 	void CreateGraphicsPipeline();
 
-	VkPushConstantRange CreatePushConstantRange();
-
 	VkDevice m_Device{ VK_NULL_HANDLE };
 
 	VkPipeline m_GraphicsPipeline{ VK_NULL_HANDLE };
 	VkPipelineLayout m_PipelineLayout{ VK_NULL_HANDLE };
 
+	GP2_ResourceCache* m_ResourceCache{ nullptr };
+
 	VkRenderPass m_RenderPass{ VK_NULL_HANDLE };
 
 	GP2_Shader<Vertex> m_Shader;
 
 	GP2_ImageBuffer* m_ImageBuffer;
 
-	GP2_DescriptorPool<UBO>* m_DescriptorPool{};
+	GP2_DescriptorPool* m_DescriptorPool{};
+	GP2_UniformRing* m_UniformRing{ nullptr };
 
 	std::vector<std::unique_ptr<GP2_Mesh<Vertex>>> m_Meshes{};
+
+	// one box per mesh, same order as m_Meshes
+	GP2_BVH m_BVH{};
+	std::vector<GP2_AABB> m_MeshBounds{};
+	bool m_RebuildBVH{ false };
+	bool m_RefitBVH{ false };
+	std::vector<uint32_t> m_VisibleMeshes{};
 };
 
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline3D<UBO, Vertex>::AddMesh(std::unique_ptr<GP2_Mesh<Vertex>> mesh)
+template <class Vertex>
+void GP2_GraphicsPipeline3D<Vertex>::AddMesh(std::unique_ptr<GP2_Mesh<Vertex>> mesh)
 {
+	m_MeshBounds.push_back(GP2_AABB::FromSphere(mesh->GetBoundingSphere()));
 	m_Meshes.push_back(std::move(mesh));
+	m_RebuildBVH = true;
 }
 
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline3D<UBO, Vertex>::CleanUp()
+template <class Vertex>
+void GP2_GraphicsPipeline3D<Vertex>::SetMeshTransform(size_t meshIndex, const glm::mat4& transform)
+{
+	m_Meshes[meshIndex]->SetVertexConstant(transform);
+	m_MeshBounds[meshIndex] = GP2_AABB::FromSphere(m_Meshes[meshIndex]->GetBoundingSphere());
+	m_RefitBVH = true;
+}
+
+template <class Vertex>
+void GP2_GraphicsPipeline3D<Vertex>::CleanUp()
 {
 	for (auto& mesh : m_Meshes)
 	{
@@ -65,16 +91,18 @@ void GP2_GraphicsPipeline3D<UBO, Vertex>::CleanUp()
 	m_ImageBuffer = nullptr;
 
 	vkDestroyPipeline(m_Device, m_GraphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
 
 	delete m_DescriptorPool;
 }
 
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline3D<UBO, Vertex>::Initialize(const VulkanContext& context, size_t descriptorPoolCount, const std::string& imageFile, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue)
+template <class Vertex>
+void GP2_GraphicsPipeline3D<Vertex>::Initialize(const VulkanContext& context, size_t descriptorPoolCount, const std::string& imageFile, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue)
 {
+	GP2_CPU_ZONE("GP2_GraphicsPipeline3D::Initialize");
 	m_Device = context.device;
 	m_RenderPass = context.renderPass;
+	m_ResourceCache = context.resourceCache;
+	m_UniformRing = context.uniformRing;
 
 	m_Shader.Initialize(context.device);
 
@@ -83,33 +111,22 @@ void GP2_GraphicsPipeline3D<UBO, Vertex>::Initialize(const VulkanContext& contex
 	m_ImageBuffer->Initialize(queueFamInd, graphicsQueue, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
 
 	std::vector<std::pair<VkImageView, VkSampler>> imageDatas{ {m_ImageBuffer->GetView(), m_ImageBuffer->GetSampler()} };
-	m_DescriptorPool = new GP2_DescriptorPool<UBO>{ context.device, descriptorPoolCount };
+	m_DescriptorPool = new GP2_DescriptorPool{ context.device, descriptorPoolCount };
 	m_DescriptorPool->Initialize(context, imageDatas.size());
 	m_DescriptorPool->CreateDescriptorSets(imageDatas);
 
 	CreateGraphicsPipeline();
 }
 
-template <class UBO, class Vertex>
-GP2_GraphicsPipeline3D<UBO, Vertex>::GP2_GraphicsPipeline3D(const std::string& vertexShaderFile, const std::string& fragmentShaderFile) :
+template <class Vertex>
+GP2_GraphicsPipeline3D<Vertex>::GP2_GraphicsPipeline3D(const std::string& vertexShaderFile, const std::string& fragmentShaderFile) :
 	m_Shader{ vertexShaderFile, fragmentShaderFile }
 {
 	
 }
 
-template <class UBO, class Vertex>
-VkPushConstantRange GP2_GraphicsPipeline3D<UBO, Vertex>::CreatePushConstantRange()
-{
-	VkPushConstantRange pushConstantRange{};
-	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	pushConstantRange.offset = 0;
-	pushConstantRange.size = sizeof(GP2_MeshData);
-
-	return pushConstantRange;
-}
-
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline3D<UBO, Vertex>::CreateGraphicsPipeline()
+template <class Vertex>
+void GP2_GraphicsPipeline3D<Vertex>::CreateGraphicsPipeline()
 {
 	VkPipelineViewportStateCreateInfo viewportState{};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -155,17 +172,7 @@ void GP2_GraphicsPipeline3D<UBO, Vertex>::CreateGraphicsPipeline()
 	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
 	dynamicState.pDynamicStates = dynamicStates.data();
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &m_DescriptorPool->GetDescriptorSetLayout();
-	pipelineLayoutInfo.pushConstantRangeCount = 1;
-	VkPushConstantRange pushConstantRange = CreatePushConstantRange();
-	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-	if (vkCreatePipelineLayout(m_Device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create pipeline layout!");
-	}
+	m_PipelineLayout = m_ResourceCache->GetPipelineLayout({ m_UniformRing->GetDescriptorSetLayout(), m_DescriptorPool->GetDescriptorSetLayout() }, {});
 
 	VkPipelineDepthStencilStateCreateInfo depthStencil{};
 	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
@@ -209,17 +216,30 @@ void GP2_GraphicsPipeline3D<UBO, Vertex>::CreateGraphicsPipeline()
 	m_Shader.DestroyShaderModules();
 }
 
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline3D<UBO, Vertex>::DrawScene(const GP2_CommandBuffer& cmdBuffer)
+template <class Vertex>
+void GP2_GraphicsPipeline3D<Vertex>::QueueDraws(GP2_RenderQueue& renderQueue, uint32_t pipelineId, const UniformBufferObject& camera)
 {
-	for (auto& mesh : m_Meshes)
+	if (m_RebuildBVH)
+		m_BVH.Build(m_MeshBounds);
+	else if (m_RefitBVH)
+		m_BVH.Refit(m_MeshBounds);
+	m_RebuildBVH = false;
+	m_RefitBVH = false;
+
+	const glm::vec3 cameraPos = glm::vec3(glm::inverse(camera.view)[3]);
+	m_VisibleMeshes.clear();
+	m_BVH.QueryFrustum(camera.proj * camera.view, cameraPos, m_VisibleMeshes);
+
+	for (uint32_t meshIndex : m_VisibleMeshes)
 	{
-		mesh->Draw(m_PipelineLayout, cmdBuffer.GetVkCommandBuffer());
+		const GP2_AABB& bounds = m_MeshBounds[meshIndex];
+		const glm::vec4 sphere{ bounds.GetCenter(), glm::length(bounds.max - bounds.GetCenter()) };
+		renderQueue.Push(pipelineId, GP2_RenderQueue::GetViewDepth(camera.view, sphere), meshIndex);
 	}
 }
 
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline3D<UBO, Vertex>::Record(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex)
+template <class Vertex>
+void GP2_GraphicsPipeline3D<Vertex>::Bind(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex)
 {
 	vkCmdBindPipeline(cmdBuffer.GetVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
 
@@ -238,12 +258,10 @@ void GP2_GraphicsPipeline3D<UBO, Vertex>::Record(const GP2_CommandBuffer& cmdBuf
 	vkCmdSetScissor(cmdBuffer.GetVkCommandBuffer(), 0, 1, &scissor);
 
 	m_DescriptorPool->BindDescriptorSet(cmdBuffer.GetVkCommandBuffer(), m_PipelineLayout, imageIndex);
-
-	DrawScene(cmdBuffer);
 }
 
-template <class UBO, class Vertex>
-void GP2_GraphicsPipeline3D<UBO, Vertex>::SetUBO(UBO ubo, size_t uboIndex)
+template <class Vertex>
+void GP2_GraphicsPipeline3D<Vertex>::DrawMesh(const GP2_CommandBuffer& cmdBuffer, uint32_t meshIndex, uint32_t cameraOffset)
 {
-	m_DescriptorPool->SetUBO(ubo, uboIndex);
-}
\ No newline at end of file
+	m_Meshes[meshIndex]->Draw(m_PipelineLayout, cmdBuffer.GetVkCommandBuffer(), *m_UniformRing, cameraOffset);
+}
@@ -0,0 +1,239 @@
+#include "GP2_HiZPyramid.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_DepthBuffer.h"
+#include "GP2_ResourceCache.h"
+#include "GP2_DescriptorAllocator.h"
+#include "GP2_UploadBatch.h"
+#include "GP2_RetireQueue.h"
+
+#include <vulkanbase/VulkanBase.h>
+
+#include <algorithm>
+#include <array>
+
+void GP2_HiZPyramid::Initialize(const VulkanContext& context, const GP2_DepthBuffer& depthBuffer, GP2_UploadBatch& uploadBatch)
+{
+	GP2_CPU_ZONE("GP2_HiZPyramid::Initialize");
+	m_VkDevice = context.device;
+	m_VkPhysicalDevice = context.physicalDevice;
+
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings(2);
+	layoutBindings[0].binding = 0;
+	layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	layoutBindings[0].descriptorCount = 1;
+	layoutBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	layoutBindings[1].binding = 1;
+	layoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	layoutBindings[1].descriptorCount = 1;
+	layoutBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	m_DescriptorSetLayout = context.resourceCache->GetDescriptorSetLayout(layoutBindings);
+
+	std::vector<VkPushConstantRange> pushConstantRanges(1);
+	pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRanges[0].offset = 0;
+	pushConstantRanges[0].size = sizeof(ReduceConstants);
+
+	m_ReducePipeline.Initialize(context, { m_DescriptorSetLayout }, pushConstantRanges);
+
+	CreateTargets(context, depthBuffer, uploadBatch);
+}
+
+void GP2_HiZPyramid::Resize(const VulkanContext& context, const GP2_DepthBuffer& depthBuffer, GP2_UploadBatch& uploadBatch, GP2_RetireQueue& retireQueue)
+{
+	GP2_CPU_ZONE("GP2_HiZPyramid::Resize");
+
+	// last frame's culling may still sample the old pyramid
+	const VkDevice device = m_VkDevice;
+	const VkImage image = m_Image;
+	const VkDeviceMemory imageMemory = m_ImageMemory;
+	const VkImageView fullView = m_FullView;
+	const std::vector<VkImageView> mipViews = m_MipViews;
+	retireQueue.Push([device, image, imageMemory, fullView, mipViews]() {
+		DestroyTargets(device, image, imageMemory, fullView, mipViews);
+		});
+
+	// the old sets are retired with the swap chain allocator they came from
+	m_MipViews.clear();
+	m_DescriptorSets.clear();
+	CreateTargets(context, depthBuffer, uploadBatch);
+
+	m_IsValid = false;
+}
+
+void GP2_HiZPyramid::Destroy()
+{
+	m_ReducePipeline.Destroy();
+
+	DestroyTargets(m_VkDevice, m_Image, m_ImageMemory, m_FullView, m_MipViews);
+	m_MipViews.clear();
+}
+
+void GP2_HiZPyramid::Build(VkCommandBuffer cmdBuffer)
+{
+	m_ReducePipeline.Bind(cmdBuffer);
+
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	for (uint32_t mip = 0; mip < m_MipCount; ++mip)
+	{
+		// the next mip reads what the previous one wrote
+		if (mip > 0)
+		{
+			vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		const VkExtent2D srcExtent = mip == 0 ? m_Extent : GetMipExtent(mip - 1);
+		const VkExtent2D dstExtent = GetMipExtent(mip);
+		const ReduceConstants constants{ srcExtent.width, srcExtent.height, dstExtent.width, dstExtent.height };
+
+		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ReducePipeline.GetPipelineLayout(), 0, 1, &m_DescriptorSets[mip], 0, nullptr);
+		vkCmdPushConstants(cmdBuffer, m_ReducePipeline.GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		m_ReducePipeline.Dispatch(cmdBuffer, (dstExtent.width + 7) / 8, (dstExtent.height + 7) / 8);
+	}
+
+	m_IsValid = true;
+}
+
+void GP2_HiZPyramid::CreateTargets(const VulkanContext& context, const GP2_DepthBuffer& depthBuffer, GP2_UploadBatch& uploadBatch)
+{
+	m_Extent = depthBuffer.GetExtent();
+	m_MipCount = 1;
+	for (uint32_t size = (std::max)(m_Extent.width, m_Extent.height); size > 1; size /= 2)
+		++m_MipCount;
+
+	CreateImage();
+	CreateViews();
+	uploadBatch.AddTransition(m_Image, { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_MipCount, 0, 1 }, VK_IMAGE_LAYOUT_GENERAL,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.maxLod = static_cast<float>(m_MipCount);
+	m_Sampler = context.resourceCache->GetSampler(samplerInfo);
+
+	CreateDescriptorSets(context, depthBuffer.GetDepthImageView());
+}
+
+void GP2_HiZPyramid::DestroyTargets(VkDevice device, VkImage image, VkDeviceMemory imageMemory, VkImageView fullView, const std::vector<VkImageView>& mipViews)
+{
+	for (VkImageView view : mipViews)
+	{
+		vkDestroyImageView(device, view, nullptr);
+	}
+	vkDestroyImageView(device, fullView, nullptr);
+
+	vkDestroyImage(device, image, nullptr);
+	vkFreeMemory(device, imageMemory, nullptr);
+}
+
+void GP2_HiZPyramid::CreateImage()
+{
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = m_Extent.width;
+	imageInfo.extent.height = m_Extent.height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = m_MipCount;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+	if (vkCreateImage(m_VkDevice, &imageInfo, nullptr, &m_Image) != VK_SUCCESS)
+		throw std::runtime_error("failed to create hi-z image!\n");
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(m_VkDevice, m_Image, &memRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(m_VkDevice, &allocInfo, nullptr, &m_ImageMemory) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate hi-z image memory\n");
+
+	vkBindImageMemory(m_VkDevice, m_Image, m_ImageMemory, 0);
+}
+
+void GP2_HiZPyramid::CreateViews()
+{
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = m_Image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R32_SFLOAT;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_MipCount, 0, 1 };
+
+	if (vkCreateImageView(m_VkDevice, &viewInfo, nullptr, &m_FullView) != VK_SUCCESS)
+		throw std::runtime_error("failed to create hi-z image view!\n");
+
+	m_MipViews.resize(m_MipCount);
+	for (uint32_t mip = 0; mip < m_MipCount; ++mip)
+	{
+		viewInfo.subresourceRange.baseMipLevel = mip;
+		viewInfo.subresourceRange.levelCount = 1;
+
+		if (vkCreateImageView(m_VkDevice, &viewInfo, nullptr, &m_MipViews[mip]) != VK_SUCCESS)
+			throw std::runtime_error("failed to create hi-z image view!\n");
+	}
+}
+
+void GP2_HiZPyramid::CreateDescriptorSets(const VulkanContext& context, VkImageView depthView)
+{
+	m_DescriptorSets.resize(m_MipCount);
+	for (uint32_t mip = 0; mip < m_MipCount; ++mip)
+	{
+		m_DescriptorSets[mip] = context.swapChainDescriptorAllocator->Allocate(m_DescriptorSetLayout);
+
+		// mip 0 reduces the depth buffer itself, every other mip the one above it
+		VkDescriptorImageInfo srcInfo{};
+		srcInfo.sampler = m_Sampler;
+		srcInfo.imageView = mip == 0 ? depthView : m_MipViews[mip - 1];
+		srcInfo.imageLayout = mip == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorImageInfo dstInfo{};
+		dstInfo.imageView = m_MipViews[mip];
+		dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = m_DescriptorSets[mip];
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pImageInfo = &srcInfo;
+
+		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet = m_DescriptorSets[mip];
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pImageInfo = &dstInfo;
+
+		vkUpdateDescriptorSets(m_VkDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+VkExtent2D GP2_HiZPyramid::GetMipExtent(uint32_t mip) const
+{
+	return VkExtent2D{ (std::max)(1u, m_Extent.width >> mip), (std::max)(1u, m_Extent.height >> mip) };
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+
+#include <vector>
+#include <stdexcept>
+
+#include "GP2_ComputePipeline.h"
+
+class GP2_DepthBuffer;
+class GP2_UploadBatch;
+class GP2_RetireQueue;
+
+// Max-depth mip chain of the depth buffer (R32_SFLOAT, kept in GENERAL layout). Built by a compute pass of the
+// frame graph after the main pass and sampled by the culling pass of the next frame, so occlusion tests run
+// against last frame's depth.
+class GP2_HiZPyramid
+{
+public:
+	GP2_HiZPyramid() = default;
+	~GP2_HiZPyramid() = default;
+
+	GP2_HiZPyramid(const GP2_HiZPyramid&) = delete;
+	GP2_HiZPyramid& operator=(const GP2_HiZPyramid&) = delete;
+
+	// the pyramid's move to GENERAL is recorded into the batch
+	void Initialize(const VulkanContext& context, const GP2_DepthBuffer& depthBuffer, GP2_UploadBatch& uploadBatch);
+	// rebuilds the image, views and sets for a resized depth buffer and retires the old ones; the view changes,
+	// so sets sampling the pyramid have to be written again, and it is invalid until the next Build
+	void Resize(const VulkanContext& context, const GP2_DepthBuffer& depthBuffer, GP2_UploadBatch& uploadBatch, GP2_RetireQueue& retireQueue);
+	void Destroy();
+
+	// the frame graph moves the depth buffer to DEPTH_STENCIL_READ_ONLY_OPTIMAL and orders the pyramid
+	// against the culling reads before, only the barriers between mips are recorded here
+	void Build(VkCommandBuffer cmdBuffer);
+
+	VkImage GetImage() const { return m_Image; };
+	VkImageView GetView() const { return m_FullView; };
+	VkSampler GetSampler() const { return m_Sampler; };
+	VkExtent2D GetExtent() const { return m_Extent; };
+	uint32_t GetMipCount() const { return m_MipCount; };
+
+	// false until the first Build, the pyramid content is undefined before that
+	bool IsValid() const { return m_IsValid; };
+
+private:
+	struct ReduceConstants {
+		uint32_t srcWidth;
+		uint32_t srcHeight;
+		uint32_t dstWidth;
+		uint32_t dstHeight;
+	};
+
+	// everything sized after the depth buffer
+	void CreateTargets(const VulkanContext& context, const GP2_DepthBuffer& depthBuffer, GP2_UploadBatch& uploadBatch);
+	static void DestroyTargets(VkDevice device, VkImage image, VkDeviceMemory imageMemory, VkImageView fullView, const std::vector<VkImageView>& mipViews);
+	void CreateImage();
+	void CreateViews();
+	void CreateDescriptorSets(const VulkanContext& context, VkImageView depthView);
+
+	VkExtent2D GetMipExtent(uint32_t mip) const;
+
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	{
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(m_VkPhysicalDevice, &memProperties);
+
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+	VkDevice m_VkDevice{ VK_NULL_HANDLE };
+	VkPhysicalDevice m_VkPhysicalDevice{ VK_NULL_HANDLE };
+
+	VkExtent2D m_Extent{};
+	uint32_t m_MipCount{};
+
+	VkImage m_Image{ VK_NULL_HANDLE };
+	VkDeviceMemory m_ImageMemory{ VK_NULL_HANDLE };
+	VkImageView m_FullView{ VK_NULL_HANDLE };
+	std::vector<VkImageView> m_MipViews{};
+	VkSampler m_Sampler{ VK_NULL_HANDLE };
+
+	GP2_ComputePipeline m_ReducePipeline{ "shaders/HiZReduce.comp.spv" };
+	VkDescriptorSetLayout m_DescriptorSetLayout{ VK_NULL_HANDLE };
+	std::vector<VkDescriptorSet> m_DescriptorSets{};
+
+	bool m_IsValid{ false };
+};
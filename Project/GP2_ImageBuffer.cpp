@@ -1,144 +1,94 @@
 #include "GP2_ImageBuffer.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_ResourceCache.h"
+#include "GP2_TextureDecoder.h"
+#include "GP2_UploadBatch.h"
 
 #include <vulkanbase/VulkanBase.h>
 
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+
 GP2_ImageBuffer::GP2_ImageBuffer(const VulkanContext& context) :
-	m_VkDevice(context.device), m_VkPhysicalDevice(context.physicalDevice)
+	m_VkDevice(context.device), m_VkPhysicalDevice(context.physicalDevice), m_ResourceCache(context.resourceCache)
 {
 
 }
 
 void GP2_ImageBuffer::Initialize(QueueFamilyIndices queueFamInd, VkQueue graphicsQueue, VkFormat format, VkImageAspectFlags aspectFlags)
 {
-	CreateImage(format);
-
-	TransitionLayout(queueFamInd, graphicsQueue, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	CopyBufferToImage(m_StagingBuffer->GetVkBuffer(), queueFamInd, graphicsQueue);
-	TransitionLayout(queueFamInd, graphicsQueue, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-	m_StagingBuffer->Destroy();
-	delete m_StagingBuffer;
-	m_StagingBuffer = nullptr;
-
-	m_ImageView = createImageViewStatic(m_VkDevice, m_Image, format, aspectFlags);
-	CreateSampler();
+	GP2_CPU_ZONE("GP2_ImageBuffer::Initialize");
+	GP2_UploadBatch uploadBatch{};
+	uploadBatch.Initialize(m_VkDevice, queueFamInd);
+	Initialize(uploadBatch, format, aspectFlags);
+	uploadBatch.Submit(graphicsQueue);
+	uploadBatch.Destroy();
 }
 
-void GP2_ImageBuffer::TransitionLayout(QueueFamilyIndices queueFamInd, VkQueue graphicsQueue, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
+void GP2_ImageBuffer::Initialize(GP2_UploadBatch& uploadBatch, VkFormat format, VkImageAspectFlags aspectFlags)
 {
-	// beginsingletimecommands in vulkan tutorial
-	GP2_CommandPool cmdPool{};
-	cmdPool.Initialize(m_VkDevice, queueFamInd);
-	GP2_CommandBuffer cmdBuffer = cmdPool.CreateCommandBuffer();
-	cmdBuffer.BeginRecording(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-	// the other suff in potentionally the wrong place
-	VkImageMemoryBarrier barrier{};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.oldLayout = oldLayout;
-	barrier.newLayout = newLayout;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.image = m_Image;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-
-	VkPipelineStageFlags srcStage;
-	VkPipelineStageFlags dstStage;
-
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-	{
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	GP2_CPU_ZONE("GP2_ImageBuffer::Initialize");
+	if (m_PendingDecode.valid())
+		m_PendingDecode.get();
 
-		srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	// cooked images already hold their mips, the others blit them
+	const bool compressed = m_CompressedFormat != VK_FORMAT_UNDEFINED;
+	if (compressed)
+	{
+		format = m_CompressedFormat;
 	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+	else
 	{
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		// the mips are blitted with linear filtering, formats that can't do that keep a single level
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(m_VkPhysicalDevice, format, &formatProperties);
+		const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		const bool canBlit = (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
 
-		srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		m_MipLevels = canBlit ? static_cast<uint32_t>(std::floor(std::log2((std::max)(m_ImageWidth, m_ImageHeight)))) + 1 : 1;
 	}
-	else
-		throw std::invalid_argument("unsupported layout transition! \n");
-
-	vkCmdPipelineBarrier(
-		cmdBuffer.GetVkCommandBuffer(),
-		srcStage, dstStage,
-		0,
-		0, nullptr,
-		0, nullptr,
-		1, &barrier
-	);
-
-	// end singletimecommands in vulkan tutorial
-	cmdBuffer.EndRecording();
-
-	VkSubmitInfo submitInfo{};
-	cmdBuffer.Submit(submitInfo);
-	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue);
-
-	auto rawBuffer = cmdBuffer.GetVkCommandBuffer();
-	vkFreeCommandBuffers(m_VkDevice, cmdPool.GetVkCommandPool(), 1, &rawBuffer);
-	cmdPool.Destroy();
-}
 
-void GP2_ImageBuffer::CopyBufferToImage(VkBuffer buffer, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue)
-{
-	// beginsingletimecommands in vulkan tutorial
-	GP2_CommandPool cmdPool{};
-	cmdPool.Initialize(m_VkDevice, queueFamInd);
-	GP2_CommandBuffer cmdBuffer = cmdPool.CreateCommandBuffer();
-	cmdBuffer.BeginRecording(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-	// other stuff
-	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-	region.imageOffset = { 0,0,0 };
-	region.imageExtent = {
-		static_cast<uint32_t>(m_ImageWidth),
-		static_cast<uint32_t>(m_ImageHeight),
-		1
-	};
-
-	vkCmdCopyBufferToImage(
-		cmdBuffer.GetVkCommandBuffer(),
-		buffer,
-		m_Image,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1,
-		&region
-	);
-
-	// end singletimecommands in vulkan tutorial
-	cmdBuffer.EndRecording();
-
-	VkSubmitInfo submitInfo{};
-	cmdBuffer.Submit(submitInfo);
-	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue);
-
-	auto rawBuffer = cmdBuffer.GetVkCommandBuffer();
-	vkFreeCommandBuffers(m_VkDevice, cmdPool.GetVkCommandPool(), 1, &rawBuffer);
-	cmdPool.Destroy();
+	CreateImage(format);
+
+	GP2_ImageUpload upload{};
+	upload.image = m_Image;
+	upload.width = static_cast<uint32_t>(m_ImageWidth);
+	upload.height = static_cast<uint32_t>(m_ImageHeight);
+	upload.mipLevels = m_MipLevels;
+	upload.buffer = m_StagingBuffer->GetVkBuffer();
+
+	// one region per level in the staging buffer, only level 0 unless the image was cooked
+	upload.regions.resize(m_LevelOffsets.size());
+	for (uint32_t level = 0; level < upload.regions.size(); ++level)
+	{
+		VkBufferImageCopy& region = upload.regions[level];
+		region.bufferOffset = m_LevelOffsets[level];
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0,0,0 };
+		region.imageExtent = {
+			GP2_TextureCompression::GetMipDimension(upload.width, level),
+			GP2_TextureCompression::GetMipDimension(upload.height, level),
+			1
+		};
+	}
+
+	uploadBatch.AddImage(upload);
+	// the batch frees it once the copy has run
+	uploadBatch.AddStagingBuffer(m_StagingBuffer);
+	m_StagingBuffer = nullptr;
+
+	m_ImageView = createImageViewStatic(m_VkDevice, m_Image, format, aspectFlags, m_MipLevels);
+	CreateSampler();
 }
 
 void GP2_ImageBuffer::Destroy()
 {
-	vkDestroySampler(m_VkDevice, m_Sampler, nullptr);
 	vkDestroyImageView(m_VkDevice, m_ImageView, nullptr);
 
 	vkDestroyImage(m_VkDevice, m_Image, nullptr);
@@ -147,6 +97,26 @@ void GP2_ImageBuffer::Destroy()
 
 void GP2_ImageBuffer::LoadImageData(const std::string& filePath, const VulkanContext& context)
 {
+	GP2_CPU_ZONE("GP2_ImageBuffer::LoadImageData");
+	const std::string cookedPath = GP2_TextureCompression::GetCookedPath(filePath);
+	if (SupportsBlockCompression() && std::filesystem::exists(cookedPath))
+	{
+		LoadCompressedData(cookedPath, context);
+		return;
+	}
+
+	if (context.textureDecoder)
+	{
+		GP2_TextureDecoder::ReadImageSize(filePath, m_ImageWidth, m_ImageHeight);
+		m_ImageChannels = 4;
+
+		void* mapped{};
+		m_StagingBuffer = new GP2_Buffer{ context, static_cast<VkDeviceSize>(m_ImageWidth) * m_ImageHeight * 4, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+		m_StagingBuffer->MapMemory(&mapped);
+		m_PendingDecode = context.textureDecoder->Decode(filePath, static_cast<uint8_t*>(mapped));
+		return;
+	}
+
 	stbi_uc* pixels = stbi_load(filePath.c_str(), &m_ImageWidth, &m_ImageHeight, &m_ImageChannels, STBI_rgb_alpha);
 
 	VkDeviceSize imageSize = static_cast<VkDeviceSize>(m_ImageWidth) * m_ImageHeight * 4;
@@ -160,6 +130,36 @@ void GP2_ImageBuffer::LoadImageData(const std::string& filePath, const VulkanCon
 	stbi_image_free(pixels);
 }
 
+void GP2_ImageBuffer::LoadCompressedData(const std::string& filePath, const VulkanContext& context)
+{
+	const GP2_CompressedTexture texture = GP2_TextureCompression::ReadDDS(filePath);
+
+	m_ImageWidth = static_cast<int>(texture.width);
+	m_ImageHeight = static_cast<int>(texture.height);
+	m_MipLevels = static_cast<uint32_t>(texture.mips.size());
+	m_CompressedFormat = GetCompressedFormat(texture.format);
+
+	// every level back to back, the copy addresses them through m_LevelOffsets
+	std::vector<uint8_t> levels{};
+	m_LevelOffsets.clear();
+	for (const std::vector<uint8_t>& mip : texture.mips)
+	{
+		m_LevelOffsets.push_back(levels.size());
+		levels.insert(levels.end(), mip.begin(), mip.end());
+	}
+
+	m_StagingBuffer = new GP2_Buffer{ context, levels.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+	m_StagingBuffer->UploadMemoryData(levels.data());
+}
+
+bool GP2_ImageBuffer::SupportsBlockCompression() const
+{
+	// createLogicalDevice enables textureCompressionBC whenever it is supported
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(m_VkPhysicalDevice, &features);
+	return features.textureCompressionBC == VK_TRUE;
+}
+
 void GP2_ImageBuffer::CreateImage(VkFormat format)
 {
 	VkImageCreateInfo imageInfo{};
@@ -168,12 +168,13 @@ void GP2_ImageBuffer::CreateImage(VkFormat format)
 	imageInfo.extent.width = static_cast<uint32_t>(m_ImageWidth);
 	imageInfo.extent.height = static_cast<uint32_t>(m_ImageHeight);
 	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
+	imageInfo.mipLevels = m_MipLevels;
 	imageInfo.arrayLayers = 1;
 	imageInfo.format = format;
 	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	// transfer src so the mip chain can be blitted from level 0
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 	imageInfo.flags = 0;
@@ -216,13 +217,29 @@ void GP2_ImageBuffer::CreateSampler()
 	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerInfo.mipLodBias = 0.f;
 	samplerInfo.minLod = 0.f;
-	samplerInfo.maxLod = 0.f;
+	// no clamp, so every texture shares this sampler and the view limits it to its own mip count
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
-	if (vkCreateSampler(m_VkDevice, &samplerInfo, nullptr, &m_Sampler) != VK_SUCCESS)
-		throw std::runtime_error("failed to create texture sampler!");
+	m_Sampler = m_ResourceCache->GetSampler(samplerInfo);
+}
+
+VkFormat GP2_ImageBuffer::GetCompressedFormat(GP2_TextureFormat format)
+{
+	switch (format)
+	{
+	case GP2_TextureFormat::BC1: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+	case GP2_TextureFormat::BC1_SRGB: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+	case GP2_TextureFormat::BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
+	case GP2_TextureFormat::BC3_SRGB: return VK_FORMAT_BC3_SRGB_BLOCK;
+	case GP2_TextureFormat::BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+	case GP2_TextureFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+	case GP2_TextureFormat::BC7: return VK_FORMAT_BC7_UNORM_BLOCK;
+	case GP2_TextureFormat::BC7_SRGB: return VK_FORMAT_BC7_SRGB_BLOCK;
+	}
+	return VK_FORMAT_UNDEFINED;
 }
 
-VkImageView GP2_ImageBuffer::createImageViewStatic(VkDevice Vkdevice, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
+VkImageView GP2_ImageBuffer::createImageViewStatic(VkDevice Vkdevice, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels)
 {
 	VkImageViewCreateInfo viewInfo{};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -231,7 +248,7 @@ VkImageView GP2_ImageBuffer::createImageViewStatic(VkDevice Vkdevice, VkImage im
 	viewInfo.format = format;
 	viewInfo.subresourceRange.aspectMask = aspectFlags;
 	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.levelCount = mipLevels;
 	viewInfo.subresourceRange.baseArrayLayer = 0;
 	viewInfo.subresourceRange.layerCount = 1;
 
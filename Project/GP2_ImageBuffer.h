@@ -3,6 +3,12 @@
 #include <vulkanbase/VulkanUtil.h>
 
 #include "GP2_Buffer.h"
+#include "GP2_TextureCompression.h"
+
+#include <future>
+#include <vector>
+
+class GP2_UploadBatch;
 
 class GP2_ImageBuffer
 {
@@ -10,10 +16,16 @@ public:
 	GP2_ImageBuffer(const VulkanContext& context);
 	~GP2_ImageBuffer() = default;
 
+	// a cooked .dds next to filePath is loaded instead when the device supports bc formats, see tools/TextureCooker.cpp
+	// pngs and jpgs decode on the context's texture decoder, Initialize waits for them
 	void LoadImageData(const std::string& filePath, const VulkanContext& context);
+	// format only applies to uncompressed images, cooked ones keep the format they were cooked to
 	void Initialize(QueueFamilyIndices queueFamInd, VkQueue graphicsQueue, VkFormat format, VkImageAspectFlags aspectFlags);
+	// records the upload into the batch, the image can be bound right away but is only filled once the batch is submitted
+	void Initialize(GP2_UploadBatch& uploadBatch, VkFormat format, VkImageAspectFlags aspectFlags);
 
-	static VkImageView GP2_ImageBuffer::createImageViewStatic(VkDevice Vkdevice, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+	static VkFormat GetCompressedFormat(GP2_TextureFormat format);
+	static VkImageView GP2_ImageBuffer::createImageViewStatic(VkDevice Vkdevice, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels = 1);
 
 	VkImageView GetView() const { return m_ImageView; };
 	VkSampler GetSampler() const { return m_Sampler; };
@@ -21,9 +33,10 @@ public:
 	void Destroy();
 
 private:
+	void LoadCompressedData(const std::string& filePath, const VulkanContext& context);
+	bool SupportsBlockCompression() const;
+
 	void CreateImage(VkFormat format);
-	void TransitionLayout(QueueFamilyIndices queueFamInd, VkQueue graphicsQueue, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-	void CopyBufferToImage(VkBuffer buffer, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue);
 
 	void CreateSampler();
 
@@ -44,6 +57,11 @@ private:
 	int m_ImageWidth{};
 	int m_ImageHeight{};
 	int m_ImageChannels{};
+	uint32_t m_MipLevels{ 1 };
+
+	// set for cooked images, which bring every mip level in the staging buffer
+	VkFormat m_CompressedFormat{ VK_FORMAT_UNDEFINED };
+	std::vector<VkDeviceSize> m_LevelOffsets{ 0 };
 
 	VkImage m_Image{};
 	VkDeviceMemory m_ImageMemory{};
@@ -51,7 +69,10 @@ private:
 	VkSampler m_Sampler{};
 
 	GP2_Buffer* m_StagingBuffer{};
+	// the decode writing into the mapped staging buffer
+	std::future<void> m_PendingDecode{};
 
 	VkDevice m_VkDevice;
 	VkPhysicalDevice m_VkPhysicalDevice;
+	GP2_ResourceCache* m_ResourceCache;
 };
@@ -0,0 +1,133 @@
+#include "GP2_ImageWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+	void AppendBigEndian(std::vector<uint8_t>& bytes, uint32_t value)
+	{
+		bytes.push_back(static_cast<uint8_t>(value >> 24));
+		bytes.push_back(static_cast<uint8_t>(value >> 16));
+		bytes.push_back(static_cast<uint8_t>(value >> 8));
+		bytes.push_back(static_cast<uint8_t>(value));
+	}
+
+	std::array<uint32_t, 256> BuildCrcTable()
+	{
+		std::array<uint32_t, 256> table{};
+		for (uint32_t idx = 0; idx < table.size(); ++idx)
+		{
+			uint32_t value = idx;
+			for (int bit = 0; bit < 8; ++bit)
+				value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+			table[idx] = value;
+		}
+		return table;
+	}
+
+	const uint8_t g_PNGSignature[8]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	// largest payload of a stored deflate block
+	const size_t g_MaxStoredBlock{ 65535 };
+}
+
+void GP2_ImageWriter::WritePNG(const std::string& filePath, uint32_t width, uint32_t height, const uint8_t* rgba)
+{
+	std::vector<uint8_t> header{};
+	AppendBigEndian(header, width);
+	AppendBigEndian(header, height);
+	// 8 bits per channel, rgba, deflate, adaptive filtering, no interlace
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+
+	// every row starts with its filter type, 0 keeps the bytes as they are
+	const size_t rowBytes = static_cast<size_t>(width) * 4;
+	std::vector<uint8_t> scanlines{};
+	scanlines.reserve((rowBytes + 1) * height);
+	for (uint32_t row = 0; row < height; ++row)
+	{
+		scanlines.push_back(0);
+		scanlines.insert(scanlines.end(), rgba + row * rowBytes, rgba + (row + 1) * rowBytes);
+	}
+
+	// zlib stream of stored blocks: no compression, fastest default window
+	std::vector<uint8_t> imageData{ 0x78, 0x01 };
+	imageData.reserve(scanlines.size() + scanlines.size() / g_MaxStoredBlock * 5 + 16);
+	size_t offset = 0;
+	do
+	{
+		const size_t blockSize = (std::min)(g_MaxStoredBlock, scanlines.size() - offset);
+		const bool lastBlock = offset + blockSize == scanlines.size();
+
+		imageData.push_back(lastBlock ? 1 : 0);
+		imageData.push_back(static_cast<uint8_t>(blockSize));
+		imageData.push_back(static_cast<uint8_t>(blockSize >> 8));
+		imageData.push_back(static_cast<uint8_t>(~blockSize));
+		imageData.push_back(static_cast<uint8_t>(~blockSize >> 8));
+		imageData.insert(imageData.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+
+		offset += blockSize;
+	} while (offset < scanlines.size());
+	AppendBigEndian(imageData, Adler32(scanlines.data(), scanlines.size()));
+
+	std::vector<uint8_t> png(std::begin(g_PNGSignature), std::end(g_PNGSignature));
+	AppendChunk(png, "IHDR", header);
+	AppendChunk(png, "IDAT", imageData);
+	AppendChunk(png, "IEND", {});
+
+	std::ofstream file{ filePath, std::ios::binary };
+	if (!file.is_open())
+		throw std::runtime_error("failed to open " + filePath + " for writing!");
+
+	file.write(reinterpret_cast<const char*>(png.data()), png.size());
+	if (!file.good())
+		throw std::runtime_error("failed to write " + filePath + "!");
+}
+
+uint32_t GP2_ImageWriter::Crc32(const uint8_t* data, size_t size, uint32_t crc)
+{
+	static const std::array<uint32_t, 256> table = BuildCrcTable();
+
+	crc = ~crc;
+	for (size_t idx = 0; idx < size; ++idx)
+		crc = table[(crc ^ data[idx]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+uint32_t GP2_ImageWriter::Adler32(const uint8_t* data, size_t size, uint32_t adler)
+{
+	uint32_t a = adler & 0xFFFF;
+	uint32_t b = adler >> 16;
+
+	// 5552 bytes is the most that can be summed before b may overflow
+	while (size > 0)
+	{
+		const size_t count = (std::min)(size, size_t{ 5552 });
+		for (size_t idx = 0; idx < count; ++idx)
+		{
+			a += data[idx];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+
+		data += count;
+		size -= count;
+	}
+
+	return (b << 16) | a;
+}
+
+void GP2_ImageWriter::AppendChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data)
+{
+	AppendBigEndian(png, static_cast<uint32_t>(data.size()));
+
+	// the crc covers the type and the data
+	const size_t typeOffset = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data.begin(), data.end());
+
+	AppendBigEndian(png, Crc32(png.data() + typeOffset, png.size() - typeOffset));
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Writes frames read back from the gpu. The png encoder only uses uncompressed deflate blocks, so files are
+// about the size of the raw pixels, but it needs neither zlib nor a third party writer.
+class GP2_ImageWriter
+{
+public:
+	// rgba8, rows top to bottom, throws if the file can't be written
+	static void WritePNG(const std::string& filePath, uint32_t width, uint32_t height, const uint8_t* rgba);
+
+	static uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+	static uint32_t Adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+
+private:
+	static void AppendChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data);
+};
@@ -0,0 +1,126 @@
+#include "GP2_LightClusters.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_LightSet.h"
+#include "GP2_Buffer.h"
+#include "GP2_ResourceCache.h"
+#include "GP2_DescriptorAllocator.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+
+void GP2_LightClusters::Initialize(const VulkanContext& context, const GP2_LightSet& lights)
+{
+	GP2_CPU_ZONE("GP2_LightClusters::Initialize");
+	m_ParamsBuffer = new GP2_Buffer{ context, sizeof(ClusterParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+	m_ParamsBuffer->MapMemory(&m_MappedParams);
+
+	m_ClusterCountBuffer = new GP2_Buffer{ context, sizeof(uint32_t) * ClusterCount,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+	m_ClusterIndexBuffer = new GP2_Buffer{ context, sizeof(uint32_t) * ClusterCount * MaxLightsPerCluster,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+
+	CreateDescriptorSet(context, lights);
+
+	m_ClusterPipeline.Initialize(context, { m_DescriptorSetLayout }, {});
+
+	// nothing is lit until the first Update
+	ClusterParams params{};
+	memcpy(m_MappedParams, &params, sizeof(params));
+}
+
+void GP2_LightClusters::Destroy()
+{
+	m_ClusterPipeline.Destroy();
+
+	for (GP2_Buffer** buffer : { &m_ParamsBuffer, &m_ClusterCountBuffer, &m_ClusterIndexBuffer })
+	{
+		if (*buffer == nullptr)
+			continue;
+
+		(*buffer)->Destroy();
+		delete *buffer;
+		*buffer = nullptr;
+	}
+	m_MappedParams = nullptr;
+}
+
+void GP2_LightClusters::Update(const UniformBufferObject& camera, VkExtent2D extent, float nearPlane, float farPlane, uint32_t lightCount)
+{
+	ClusterParams params{};
+	params.view = camera.view;
+	params.inverseProjection = glm::inverse(camera.proj);
+	params.cameraPosition = glm::inverse(camera.view)[3];
+	params.gridSize = glm::uvec4{ GridSizeX, GridSizeY, GridSizeZ, lightCount };
+	params.screenDepth = glm::vec4{ static_cast<float>(extent.width), static_cast<float>(extent.height), nearPlane, farPlane };
+
+	// slices are spaced exponentially: slice k starts at near * (far / near)^(k / GridSizeZ)
+	const float logRange = std::log(farPlane / nearPlane);
+	params.sliceScaleBias = glm::vec4{ GridSizeZ / logRange, -GridSizeZ * std::log(nearPlane) / logRange, 0.f, 0.f };
+
+	memcpy(m_MappedParams, &params, sizeof(params));
+}
+
+void GP2_LightClusters::Record(VkCommandBuffer cmdBuffer)
+{
+	// last frame's shading has to be done reading the clusters before they are rebuilt
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	m_ClusterPipeline.Bind(cmdBuffer);
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ClusterPipeline.GetPipelineLayout(), 0, 1, &m_DescriptorSet, 0, nullptr);
+
+	// one invocation per cluster, matches local_size_x in ClusterLights.comp
+	m_ClusterPipeline.Dispatch(cmdBuffer, (ClusterCount + 63) / 64);
+
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void GP2_LightClusters::BindDescriptorSet(VkCommandBuffer cmdBuffer, VkPipelineLayout layout, uint32_t setIndex) const
+{
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, setIndex, 1, &m_DescriptorSet, 0, nullptr);
+}
+
+void GP2_LightClusters::CreateDescriptorSet(const VulkanContext& context, const GP2_LightSet& lights)
+{
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings(4);
+	for (uint32_t idx = 0; idx < layoutBindings.size(); ++idx)
+	{
+		layoutBindings[idx].binding = idx;
+		layoutBindings[idx].descriptorType = idx == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		layoutBindings[idx].descriptorCount = 1;
+		layoutBindings[idx].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+
+	m_DescriptorSetLayout = context.resourceCache->GetDescriptorSetLayout(layoutBindings);
+	m_DescriptorSet = context.descriptorAllocator->Allocate(m_DescriptorSetLayout);
+
+	const std::array<VkBuffer, 4> buffers{ m_ParamsBuffer->GetVkBuffer(), lights.GetVkBuffer(),
+		m_ClusterCountBuffer->GetVkBuffer(), m_ClusterIndexBuffer->GetVkBuffer() };
+
+	std::array<VkDescriptorBufferInfo, 4> bufferInfos{};
+	std::array<VkWriteDescriptorSet, 4> writes{};
+	for (uint32_t idx = 0; idx < writes.size(); ++idx)
+	{
+		bufferInfos[idx].buffer = buffers[idx];
+		bufferInfos[idx].offset = 0;
+		bufferInfos[idx].range = VK_WHOLE_SIZE;
+
+		writes[idx].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[idx].dstSet = m_DescriptorSet;
+		writes[idx].dstBinding = idx;
+		writes[idx].dstArrayElement = 0;
+		writes[idx].descriptorCount = 1;
+		writes[idx].descriptorType = layoutBindings[idx].descriptorType;
+		writes[idx].pBufferInfo = &bufferInfos[idx];
+	}
+
+	vkUpdateDescriptorSets(context.device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+#include <glm/glm.hpp>
+
+#include "GP2_ComputePipeline.h"
+#include "GP2_UniformBufferObject.h"
+
+class GP2_Buffer;
+class GP2_LightSet;
+
+// Clustered light culling. The view frustum is split into a froxel grid: screen tiles in x and y and
+// exponentially spaced view depth slices in z. Each frame a compute pass tests every light's bounding sphere
+// against every froxel and stores up to MaxLightsPerCluster light indices per froxel. Shaders then find their
+// froxel from the pixel position and view depth and only loop over its lights.
+//
+// The descriptor set is shared by the compute pass and every shader that reads the clusters:
+//	0 ClusterParams uniform buffer
+//	1 lights
+//	2 light count per cluster
+//	3 light indices, MaxLightsPerCluster slots per cluster
+class GP2_LightClusters
+{
+public:
+	static constexpr uint32_t GridSizeX{ 16 };
+	static constexpr uint32_t GridSizeY{ 9 };
+	static constexpr uint32_t GridSizeZ{ 24 };
+	static constexpr uint32_t ClusterCount{ GridSizeX * GridSizeY * GridSizeZ };
+	static constexpr uint32_t MaxLightsPerCluster{ 128 };
+
+	GP2_LightClusters() = default;
+	~GP2_LightClusters() = default;
+
+	GP2_LightClusters(const GP2_LightClusters&) = delete;
+	GP2_LightClusters& operator=(const GP2_LightClusters&) = delete;
+
+	void Initialize(const VulkanContext& context, const GP2_LightSet& lights);
+	void Destroy();
+
+	// writes this frame's camera and light count, the fence must have been waited on
+	void Update(const UniformBufferObject& camera, VkExtent2D extent, float nearPlane, float farPlane, uint32_t lightCount);
+
+	// must be outside of a render pass and before any draw that reads the clusters
+	void Record(VkCommandBuffer cmdBuffer);
+
+	void BindDescriptorSet(VkCommandBuffer cmdBuffer, VkPipelineLayout layout, uint32_t setIndex) const;
+
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_DescriptorSetLayout; };
+
+private:
+	// std140, matches ClusterParams in shaders/ClusteredLights.glsl
+	struct ClusterParams {
+		glm::mat4 view;
+		glm::mat4 inverseProjection;
+		glm::vec4 cameraPosition;
+		// xyz grid size, w light count
+		glm::uvec4 gridSize;
+		// xy screen size in pixels, z near plane, w far plane
+		glm::vec4 screenDepth;
+		// slice = log(viewDepth) * x + y
+		glm::vec4 sliceScaleBias;
+	};
+
+	void CreateDescriptorSet(const VulkanContext& context, const GP2_LightSet& lights);
+
+	GP2_Buffer* m_ParamsBuffer{ nullptr };
+	void* m_MappedParams{ nullptr };
+	GP2_Buffer* m_ClusterCountBuffer{ nullptr };
+	GP2_Buffer* m_ClusterIndexBuffer{ nullptr };
+
+	GP2_ComputePipeline m_ClusterPipeline{ "shaders/ClusterLights.comp.spv" };
+
+	VkDescriptorSetLayout m_DescriptorSetLayout{ VK_NULL_HANDLE };
+	VkDescriptorSet m_DescriptorSet{ VK_NULL_HANDLE };
+};
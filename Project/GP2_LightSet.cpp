@@ -0,0 +1,80 @@
+#include "GP2_LightSet.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_Buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+void GP2_LightSet::Initialize(const VulkanContext& context, uint32_t maxLights)
+{
+	GP2_CPU_ZONE("GP2_LightSet::Initialize");
+	m_MaxLights = maxLights;
+
+	m_Buffer = new GP2_Buffer{ context, sizeof(GP2_Light) * maxLights, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+	m_Buffer->MapMemory(&m_MappedData);
+}
+
+void GP2_LightSet::Destroy()
+{
+	if (m_Buffer == nullptr)
+		return;
+
+	// destroying the buffer frees its memory, which implicitly unmaps it
+	m_Buffer->Destroy();
+	delete m_Buffer;
+	m_Buffer = nullptr;
+	m_MappedData = nullptr;
+}
+
+void GP2_LightSet::AddLight(const GP2_Light& light)
+{
+	if (m_Lights.size() >= m_MaxLights)
+		return;
+
+	m_Lights.push_back(light);
+}
+
+void GP2_LightSet::GenerateLights(uint32_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float radius, uint32_t seed)
+{
+	std::mt19937 generator{ seed };
+	std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+
+	for (uint32_t idx = 0; idx < count; ++idx)
+	{
+		const glm::vec3 position = glm::mix(boundsMin, boundsMax, glm::vec3{ unit(generator), unit(generator), unit(generator) });
+
+		// saturated colors, so the individual lights are easy to tell apart
+		glm::vec3 color{ unit(generator), unit(generator), unit(generator) };
+		color /= (std::max)({ color.r, color.g, color.b, 0.001f });
+
+		GP2_Light light{ glm::vec4{ position, radius }, glm::vec4{ color, 2.f + 3.f * unit(generator) } };
+		if (idx % 4 == 3)
+		{
+			const glm::vec3 direction = glm::normalize(glm::vec3{ unit(generator) - 0.5f, -1.f, unit(generator) - 0.5f });
+			light.spotDirectionCone = glm::vec4{ direction, std::cos(glm::radians(30.f)) };
+			// spots concentrate their light, so they reach further
+			light.positionRadius.w *= 2.f;
+		}
+
+		AddLight(light);
+	}
+}
+
+void GP2_LightSet::Upload()
+{
+	if (!m_Lights.empty())
+		memcpy(m_MappedData, m_Lights.data(), sizeof(GP2_Light) * m_Lights.size());
+}
+
+VkBuffer GP2_LightSet::GetVkBuffer() const
+{
+	return m_Buffer->GetVkBuffer();
+}
+
+VkDeviceSize GP2_LightSet::GetSizeInBytes() const
+{
+	return m_Buffer->GetSizeInBytes();
+}
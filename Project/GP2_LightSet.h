@@ -0,0 +1,58 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+class GP2_Buffer;
+
+// std430 layout, matches the Light struct in shaders/ClusteredLights.glsl
+struct GP2_Light {
+	// xyz world position, w radius of influence
+	glm::vec4 positionRadius;
+	// rgb color, w intensity
+	glm::vec4 colorIntensity;
+	// xyz direction a spot light points in, w cosine of its outer cone angle; point lights have w <= -1
+	glm::vec4 spotDirectionCone{ 0.f, -1.f, 0.f, -1.f };
+};
+
+// The scene's point and spot lights in a host visible storage buffer. Lights are edited on the cpu and copied over
+// with Upload, the buffer is sized for a fixed maximum so it never has to be recreated.
+class GP2_LightSet
+{
+public:
+	GP2_LightSet() = default;
+	~GP2_LightSet() = default;
+
+	GP2_LightSet(const GP2_LightSet&) = delete;
+	GP2_LightSet& operator=(const GP2_LightSet&) = delete;
+
+	void Initialize(const VulkanContext& context, uint32_t maxLights);
+	void Destroy();
+
+	void Clear() { m_Lights.clear(); };
+	void AddLight(const GP2_Light& light);
+
+	// scatters count lights with random colors through a box, every fourth one a spot light aimed downwards;
+	// the same seed always gives the same lights
+	void GenerateLights(uint32_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float radius, uint32_t seed);
+
+	// must not be called while the gpu may still read the previous contents
+	void Upload();
+
+	VkBuffer GetVkBuffer() const;
+	VkDeviceSize GetSizeInBytes() const;
+
+	uint32_t GetLightCount() const { return static_cast<uint32_t>(m_Lights.size()); };
+	uint32_t GetMaxLights() const { return m_MaxLights; };
+	const std::vector<GP2_Light>& GetLights() const { return m_Lights; };
+
+private:
+	std::vector<GP2_Light> m_Lights{};
+	uint32_t m_MaxLights{};
+
+	GP2_Buffer* m_Buffer{ nullptr };
+	void* m_MappedData{ nullptr };
+};
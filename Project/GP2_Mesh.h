@@ -3,10 +3,14 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <memory>
+#include <algorithm>
 
 #include "CommandBuffer.h"
 #include "GP2_Buffer.h"
 #include "GP2_Vertex.h"
+#include "GP2_UniformRing.h"
+#include "GP2_FrustumCuller.h"
+#include "GP2_CpuProfiler.h"
 
 template<class Vertex>
 class GP2_Mesh
@@ -18,7 +22,7 @@ public:
 	void Initialize(const VulkanContext& context, GP2_CommandBuffer cmdBuffer, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue);
 	void DestroyMesh();
 
-	void Draw(VkPipelineLayout pipelineLayout, VkCommandBuffer cmdBuffer);
+	void Draw(VkPipelineLayout pipelineLayout, VkCommandBuffer cmdBuffer, GP2_UniformRing& uniformRing, uint32_t cameraOffset);
 
 	void AddVertex(std::vector<Vertex> vertices);
 	void AddIndex(uint16_t index);
@@ -26,14 +30,30 @@ public:
 
 	void SetVertexConstant(glm::mat4 data) { m_VertexConstant.model = data; };
 
+	// every instance is drawn in the same vkCmdDrawIndexed; without any instances the mesh draws once
+	void AddInstance(const glm::mat4& model) { m_Instances.push_back(GP2_InstanceData{ model }); };
+	size_t GetInstanceCount() const { return m_Instances.size(); };
+
+	const std::vector<Vertex>& GetVertices() const { return m_Vertices; };
+	const std::vector<uint16_t>& GetIndices() const { return m_Indices; };
+	const std::vector<GP2_InstanceData>& GetInstances() const { return m_Instances; };
+	const glm::mat4& GetVertexConstant() const { return m_VertexConstant.model; };
+
+	// xyz center, w radius; the local sphere is centered on the vertices' aabb
+	glm::vec4 GetLocalBoundingSphere() const;
+	// encloses every instance with the vertex constant applied
+	glm::vec4 GetBoundingSphere() const;
+
 	bool ParseOBJ(const std::string& filename, bool flipAxisAndWinding = true);
 
 private:	
 	GP2_Buffer* m_VertexBuffer{};
 	GP2_Buffer* m_IndexBuffer{};
+	GP2_Buffer* m_InstanceBuffer{};
 
 	std::vector<Vertex> m_Vertices{};
 	std::vector<uint16_t> m_Indices{};
+	std::vector<GP2_InstanceData> m_Instances{};
 
 	VkDevice m_VkDevice{ VK_NULL_HANDLE };
 
@@ -43,6 +63,7 @@ private:
 template<class Vertex>
 void GP2_Mesh<Vertex>::Initialize(const VulkanContext& context, GP2_CommandBuffer cmdBuffer, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue)
 {
+	GP2_CPU_ZONE("GP2_Mesh::Initialize");
 	m_VkDevice = context.device;
 
 	GP2_Buffer stagingVertexBuffer{ context, sizeof(m_Vertices[0]) * m_Vertices.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
@@ -56,6 +77,15 @@ void GP2_Mesh<Vertex>::Initialize(const VulkanContext& context, GP2_CommandBuffe
 	m_IndexBuffer = new GP2_Buffer{ context, sizeof(m_Indices[0]) * m_Indices.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
 	m_IndexBuffer->CopyData(queueFamInd, stagingIndexBuffer, graphicsQueue);
 	stagingIndexBuffer.Destroy();
+
+	if (m_Instances.empty())
+		AddInstance(glm::mat4{ 1.f });
+
+	GP2_Buffer stagingInstanceBuffer{ context, sizeof(m_Instances[0]) * m_Instances.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+	stagingInstanceBuffer.UploadMemoryData(m_Instances.data());
+	m_InstanceBuffer = new GP2_Buffer{ context, sizeof(m_Instances[0]) * m_Instances.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+	m_InstanceBuffer->CopyData(queueFamInd, stagingInstanceBuffer, graphicsQueue);
+	stagingInstanceBuffer.Destroy();
 }
 
 template<class Vertex>
@@ -66,17 +96,63 @@ void GP2_Mesh<Vertex>::DestroyMesh()
 
 	m_IndexBuffer->Destroy();
 	delete m_IndexBuffer;
+
+	m_InstanceBuffer->Destroy();
+	delete m_InstanceBuffer;
 }
 
 template<class Vertex>
-void GP2_Mesh<Vertex>::Draw(VkPipelineLayout pipelineLayout, VkCommandBuffer cmdBuffer)
+void GP2_Mesh<Vertex>::Draw(VkPipelineLayout pipelineLayout, VkCommandBuffer cmdBuffer, GP2_UniformRing& uniformRing, uint32_t cameraOffset)
 {
 	m_VertexBuffer->BindAsVertexBuffer(cmdBuffer);
+	m_InstanceBuffer->BindAsVertexBuffer(cmdBuffer, 1);
 	m_IndexBuffer->BindAsIndexBuffer(cmdBuffer);
 
-	vkCmdPushConstants(cmdBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GP2_MeshData), &m_VertexConstant);
+	const uint32_t objectOffset = uniformRing.Push(m_VertexConstant);
+	uniformRing.BindDescriptorSet(cmdBuffer, pipelineLayout, cameraOffset, objectOffset);
+
+	vkCmdDrawIndexed(cmdBuffer, static_cast<uint32_t>(m_Indices.size()), static_cast<uint32_t>(m_Instances.size()), 0, 0, 0);
+}
+
+template<class Vertex>
+glm::vec4 GP2_Mesh<Vertex>::GetLocalBoundingSphere() const
+{
+	if (m_Vertices.empty())
+		return glm::vec4{ 0.f };
+
+	glm::vec3 minPos{ m_Vertices[0].pos };
+	glm::vec3 maxPos{ m_Vertices[0].pos };
+	for (const auto& vertex : m_Vertices)
+	{
+		minPos = glm::min(minPos, vertex.pos);
+		maxPos = glm::max(maxPos, vertex.pos);
+	}
+
+	const glm::vec3 center = (minPos + maxPos) * 0.5f;
+	float radius = 0.f;
+	for (const auto& vertex : m_Vertices)
+	{
+		radius = (std::max)(radius, glm::length(vertex.pos - center));
+	}
+
+	return glm::vec4{ center, radius };
+}
+
+template<class Vertex>
+glm::vec4 GP2_Mesh<Vertex>::GetBoundingSphere() const
+{
+	const glm::vec4 localSphere = GetLocalBoundingSphere();
+
+	if (m_Instances.empty())
+		return GP2_FrustumCuller::TransformSphere(localSphere, m_VertexConstant.model);
+
+	glm::vec4 sphere = GP2_FrustumCuller::TransformSphere(localSphere, m_VertexConstant.model * m_Instances[0].model);
+	for (size_t idx = 1; idx < m_Instances.size(); ++idx)
+	{
+		sphere = GP2_FrustumCuller::MergeSpheres(sphere, GP2_FrustumCuller::TransformSphere(localSphere, m_VertexConstant.model * m_Instances[idx].model));
+	}
 
-	vkCmdDrawIndexed(cmdBuffer, static_cast<uint32_t>(m_Indices.size()), 1, 0, 0, 0);
+	return sphere;
 }
 
 template<class Vertex>
@@ -101,6 +177,7 @@ template<class Vertex>
 bool GP2_Mesh<Vertex>::ParseOBJ(const std::string& filename, bool flipAxisAndWinding)
 
 {
+	GP2_CPU_ZONE("GP2_Mesh::ParseOBJ");
 	std::ifstream file(filename);
 	if (!file)
 		return false;
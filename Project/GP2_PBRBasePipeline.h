@@ -1,13 +1,24 @@
 #pragma once
 
 #include <vulkanbase/VulkanUtil.h>
+#include <algorithm>
+#include <cmath>
 #include <string>
 
 #include "CommandBuffer.h"
 #include "GP2_Mesh.h"
 #include "GP2_Shader.h"
 #include "GP2_DescriptorPool.h"
+#include "GP2_UniformRing.h"
 #include "GP2_ImageBuffer.h"
+#include "GP2_GeometryArena.h"
+#include "GP2_RenderQueue.h"
+#include "GP2_LightClusters.h"
+#include "GP2_ShadowCascades.h"
+#include "GP2_TextureStreamer.h"
+#include "GP2_UploadBatch.h"
+#include "GP2_UniformBufferObject.h"
+#include "GP2_CpuProfiler.h"
 
 enum class GP2_PBRRenderModes {
 	Combined,
@@ -16,103 +27,137 @@ enum class GP2_PBRRenderModes {
 	Specular
 };
 
-template <class UBO, class Vertex>
+template <class Vertex>
 class GP2_PBRBasePipeline
 {
 public:
-	GP2_PBRBasePipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile);
+	GP2_PBRBasePipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const std::string& gBufferFragmentShaderFile);
 	virtual ~GP2_PBRBasePipeline() = default;
 
-	virtual void Initialize(const VulkanContext& context, size_t descriptorPoolCount);
+	virtual void Initialize(const VulkanContext& context, size_t descriptorPoolCount, GP2_GeometryArena<Vertex>& geometryArena);
 	virtual void CleanUp();
 
+	// variant that writes the deferred path's g-buffer instead of shading, needs Initialize to have run
+	void InitializeGBuffer(VkRenderPass gBufferRenderPass, uint32_t colorAttachmentCount);
+
+	// registers the textures with the context's streamer, which queues their tail loads. UploadTextureMaps waits
+	// for them and records the uploads, so every pipeline's textures should be set before the first one is uploaded
 	virtual void SetTextureMaps(const VulkanContext& context, const std::string& diffuse, const std::string& normal,
-		const std::string& gloss, const std::string& specular, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue) = 0;
+		const std::string& gloss, const std::string& specular) = 0;
+	virtual void UploadTextureMaps(GP2_UploadBatch& uploadBatch) = 0;
 
-	void Record(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex);
+	// asks the streamer for the mips the largest instance of the visible commands needs, once per frame
+	void RequestTextureLevels(const UniformBufferObject& camera, VkExtent2D extent);
 
-	void AddMesh(std::unique_ptr<GP2_Mesh<Vertex>> mesh);
+	// one entry per indirect command that passed the arena's CullCommands, at the depth of its nearest instance;
+	// the payload is the command's index within the range, so the meshes sort among everything else
+	void QueueDraws(GP2_RenderQueue& renderQueue, uint32_t pipelineId, const UniformBufferObject& camera);
 
-	void SetUBO(UBO ubo, size_t uboIndex);
+	// after a depth prepass the depth-equal variant is bound, it neither writes depth nor shades hidden fragments
+	void Bind(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex, uint32_t cameraOffset, bool afterDepthPrepass);
+	void BindGBuffer(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex, uint32_t cameraOffset);
+	void Draw(const GP2_CommandBuffer& cmdBuffer);
+	// a run of queued commands, firstCommand is relative to the range like the queue payload
+	void DrawCommands(const GP2_CommandBuffer& cmdBuffer, uint32_t firstCommand, uint32_t commandCount);
+
+	void AddMesh(std::unique_ptr<GP2_Mesh<Vertex>> mesh);
 
 	void CycleRenderMode() { m_RenderMode = static_cast<GP2_PBRRenderModes>((int(m_RenderMode) + 1) % 4); };
 
 protected:
-	GP2_DescriptorPool<UBO>* m_DescriptorPool{ nullptr };
+	GP2_DescriptorPool* m_DescriptorPool{ nullptr };
+
+	GP2_TextureStreamer* m_TextureStreamer{ nullptr };
+	// in material set binding order
+	std::vector<GP2_TextureStreamer::Handle> m_TextureMaps{};
 
 private: 
-	void DrawScene(const GP2_CommandBuffer& cmdBuffer);
 	void CreateGraphicsPipeline();
+	void SetViewportAndBindSets(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex, uint32_t cameraOffset);
 
 	static std::vector<VkPushConstantRange> CreatePushConstantRange();
 
 	VkDevice m_Device{ VK_NULL_HANDLE };
 
 	VkPipeline m_GraphicsPipeline{ VK_NULL_HANDLE };
+	VkPipeline m_DepthEqualPipeline{ VK_NULL_HANDLE };
+	VkPipeline m_GBufferPipeline{ VK_NULL_HANDLE };
 	VkPipelineLayout m_PipelineLayout{ VK_NULL_HANDLE };
 
+	GP2_ResourceCache* m_ResourceCache{ nullptr };
+	GP2_UniformRing* m_UniformRing{ nullptr };
+	GP2_LightClusters* m_LightClusters{ nullptr };
+	GP2_ShadowCascades* m_ShadowCascades{ nullptr };
+
 	VkRenderPass m_RenderPass{ VK_NULL_HANDLE };
 
 	GP2_Shader<Vertex> m_Shader;
+	GP2_Shader<Vertex> m_GBufferShader;
 
+	// meshes only hold their cpu data until Initialize hands them to the geometry arena
 	std::vector<std::unique_ptr<GP2_Mesh<Vertex>>> m_Meshes{};
 
+	GP2_GeometryArena<Vertex>* m_GeometryArena{ nullptr };
+	GP2_DrawRange m_DrawRange{};
+
 	GP2_PBRRenderModes m_RenderMode{ GP2_PBRRenderModes::Combined };
 };
 
-template <class UBO, class Vertex>
-GP2_PBRBasePipeline<UBO, Vertex>::GP2_PBRBasePipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile) :
-	m_Shader{ vertexShaderFile, fragmentShaderFile }
+template <class Vertex>
+GP2_PBRBasePipeline<Vertex>::GP2_PBRBasePipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const std::string& gBufferFragmentShaderFile) :
+	m_Shader{ vertexShaderFile, fragmentShaderFile },
+	m_GBufferShader{ vertexShaderFile, gBufferFragmentShaderFile }
 { }
 
-template <class UBO, class Vertex>
-void GP2_PBRBasePipeline<UBO, Vertex>::AddMesh(std::unique_ptr<GP2_Mesh<Vertex>> mesh)
+template <class Vertex>
+void GP2_PBRBasePipeline<Vertex>::AddMesh(std::unique_ptr<GP2_Mesh<Vertex>> mesh)
 {
 	m_Meshes.push_back(std::move(mesh));
 }
 
-template <class UBO, class Vertex>
-void GP2_PBRBasePipeline<UBO, Vertex>::CleanUp()
+template <class Vertex>
+void GP2_PBRBasePipeline<Vertex>::CleanUp()
 {
-	for (auto& mesh : m_Meshes)
-	{
-		mesh->DestroyMesh();
-	}
-
 	vkDestroyPipeline(m_Device, m_GraphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+	vkDestroyPipeline(m_Device, m_DepthEqualPipeline, nullptr);
+	vkDestroyPipeline(m_Device, m_GBufferPipeline, nullptr);
 
 	delete m_DescriptorPool;
 }
 
-template <class UBO, class Vertex>
-void GP2_PBRBasePipeline<UBO, Vertex>::Initialize(const VulkanContext& context, size_t descriptorPoolCount)
+template <class Vertex>
+void GP2_PBRBasePipeline<Vertex>::Initialize(const VulkanContext& context, size_t descriptorPoolCount, GP2_GeometryArena<Vertex>& geometryArena)
 {
+	GP2_CPU_ZONE("GP2_PBRBasePipeline::Initialize");
+	m_GeometryArena = &geometryArena;
+	m_DrawRange = geometryArena.AddMeshes(m_Meshes);
+	m_Meshes.clear();
+
 	m_Device = context.device;
 	m_RenderPass = context.renderPass;
+	m_ResourceCache = context.resourceCache;
+	m_UniformRing = context.uniformRing;
+	m_LightClusters = context.lightClusters;
+	m_ShadowCascades = context.shadowCascades;
 
 	m_Shader.Initialize(context.device);
 
 	CreateGraphicsPipeline();
 }
 
-template <class UBO, class Vertex>
-std::vector<VkPushConstantRange> GP2_PBRBasePipeline<UBO, Vertex>::CreatePushConstantRange()
+template <class Vertex>
+std::vector<VkPushConstantRange> GP2_PBRBasePipeline<Vertex>::CreatePushConstantRange()
 {
-	std::vector<VkPushConstantRange> pushConstantRanges(2);
-	pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	std::vector<VkPushConstantRange> pushConstantRanges(1);
+	pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 	pushConstantRanges[0].offset = 0;
-	pushConstantRanges[0].size = sizeof(GP2_MeshData);
-
-	pushConstantRanges[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	pushConstantRanges[1].offset = sizeof(GP2_MeshData);
-	pushConstantRanges[1].size = sizeof(m_RenderMode);
+	pushConstantRanges[0].size = sizeof(m_RenderMode);
 
 	return pushConstantRanges;
 }
 
-template <class UBO, class Vertex>
-void GP2_PBRBasePipeline<UBO, Vertex>::CreateGraphicsPipeline()
+template <class Vertex>
+void GP2_PBRBasePipeline<Vertex>::CreateGraphicsPipeline()
 {
 	VkPipelineViewportStateCreateInfo viewportState{};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -158,17 +203,9 @@ void GP2_PBRBasePipeline<UBO, Vertex>::CreateGraphicsPipeline()
 	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
 	dynamicState.pDynamicStates = dynamicStates.data();
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &m_DescriptorPool->GetDescriptorSetLayout();
-	pipelineLayoutInfo.pushConstantRangeCount = 2;
-	auto pushConstantRanges = CreatePushConstantRange();
-	pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
-
-	if (vkCreatePipelineLayout(m_Device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create pipeline layout!");
-	}
+	// set 0 camera and object, set 1 material, set 2 light clusters, set 3 shadow cascades
+	m_PipelineLayout = m_ResourceCache->GetPipelineLayout({ m_UniformRing->GetDescriptorSetLayout(), m_DescriptorPool->GetDescriptorSetLayout(),
+		m_LightClusters->GetDescriptorSetLayout(), m_ShadowCascades->GetDescriptorSetLayout() }, CreatePushConstantRange());
 
 	VkPipelineDepthStencilStateCreateInfo depthStencil{};
 	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
@@ -209,23 +246,166 @@ void GP2_PBRBasePipeline<UBO, Vertex>::CreateGraphicsPipeline()
 		throw std::runtime_error("failed to create graphics pipeline!");
 	}
 
+	// depth is already resolved by the prepass, only the closest fragment passes
+	depthStencil.depthWriteEnable = VK_FALSE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_EQUAL;
+
+	if (vkCreateGraphicsPipelines(m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_DepthEqualPipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create graphics pipeline!");
+	}
+
 	m_Shader.DestroyShaderModules();
 }
 
-template <class UBO, class Vertex>
-void GP2_PBRBasePipeline<UBO, Vertex>::DrawScene(const GP2_CommandBuffer& cmdBuffer)
+template <class Vertex>
+void GP2_PBRBasePipeline<Vertex>::InitializeGBuffer(VkRenderPass gBufferRenderPass, uint32_t colorAttachmentCount)
+{
+	// the g-buffer render passes of later graphs are compatible with the first one
+	if (m_GBufferPipeline != VK_NULL_HANDLE)
+		return;
+
+	m_GBufferShader.Initialize(m_Device);
+
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	// one opaque write per g-buffer target
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_FALSE;
+	std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(colorAttachmentCount, colorBlendAttachment);
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = colorAttachmentCount;
+	colorBlending.pAttachments = colorBlendAttachments.data();
+
+	std::vector<VkDynamicState> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	// same layout as the forward variants, so material sets and push constants bind the same way
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = m_GBufferShader.GetShaderStages().data();
+	pipelineInfo.pVertexInputState = &m_GBufferShader.CreateVertexInputStateInfo();
+	pipelineInfo.pInputAssemblyState = &m_GBufferShader.CreateInputAssemblyStateInfo();
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = m_PipelineLayout;
+	pipelineInfo.renderPass = gBufferRenderPass;
+	pipelineInfo.subpass = 0;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	if (vkCreateGraphicsPipelines(m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_GBufferPipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create g-buffer pipeline!");
+	}
+
+	m_GBufferShader.DestroyShaderModules();
+}
+
+template <class Vertex>
+void GP2_PBRBasePipeline<Vertex>::RequestTextureLevels(const UniformBufferObject& camera, VkExtent2D extent)
+{
+	if (m_DrawRange.commandCount == 0)
+		return;
+
+	// every instance is measured at its own nearest point, the range's bounds usually contain the camera
+	const std::vector<GP2_CullObject>& objects = m_GeometryArena->GetCullObjects();
+	float screenPixels = 0.f;
+	for (uint32_t idx = 0; idx < m_DrawRange.commandCount; ++idx)
+	{
+		if (!m_GeometryArena->IsCommandVisible(m_DrawRange.firstCommand + idx))
+			continue;
+
+		const VkDrawIndexedIndirectCommand& command = m_GeometryArena->GetCommand(m_DrawRange.firstCommand + idx);
+		for (uint32_t instance = command.firstInstance; instance < command.firstInstance + command.instanceCount; ++instance)
+		{
+			screenPixels = (std::max)(screenPixels, GP2_FrustumCuller::GetScreenSize(camera.view, camera.proj, static_cast<float>(extent.height), objects[instance].sphere));
+		}
+	}
+
+	// no command of the range is on screen
+	if (screenPixels <= 0.f)
+		return;
+
+	for (GP2_TextureStreamer::Handle textureMap : m_TextureMaps)
+	{
+		m_TextureStreamer->RequestScreenSize(textureMap, screenPixels);
+	}
+}
+
+template <class Vertex>
+void GP2_PBRBasePipeline<Vertex>::QueueDraws(GP2_RenderQueue& renderQueue, uint32_t pipelineId, const UniformBufferObject& camera)
 {
-	for (auto& mesh : m_Meshes)
+	if (m_DrawRange.commandCount == 0)
+		return;
+
+	for (uint32_t idx = 0; idx < m_DrawRange.commandCount; ++idx)
 	{
-		mesh->Draw(m_PipelineLayout, cmdBuffer.GetVkCommandBuffer());
+		if (!m_GeometryArena->IsCommandVisible(m_DrawRange.firstCommand + idx))
+			continue;
+
+		const glm::vec4& bounds = m_GeometryArena->GetCommandBounds(m_DrawRange.firstCommand + idx);
+		renderQueue.Push(pipelineId, GP2_RenderQueue::GetViewDepth(camera.view, bounds), idx);
 	}
 }
 
-template <class UBO, class Vertex>
-void GP2_PBRBasePipeline<UBO, Vertex>::Record(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex)
+template <class Vertex>
+void GP2_PBRBasePipeline<Vertex>::Bind(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex, uint32_t cameraOffset, bool afterDepthPrepass)
 {
-	vkCmdBindPipeline(cmdBuffer.GetVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+	vkCmdBindPipeline(cmdBuffer.GetVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, afterDepthPrepass ? m_DepthEqualPipeline : m_GraphicsPipeline);
 
+	SetViewportAndBindSets(cmdBuffer, extent, imageIndex, cameraOffset);
+}
+
+template <class Vertex>
+void GP2_PBRBasePipeline<Vertex>::BindGBuffer(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex, uint32_t cameraOffset)
+{
+	vkCmdBindPipeline(cmdBuffer.GetVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_GBufferPipeline);
+
+	SetViewportAndBindSets(cmdBuffer, extent, imageIndex, cameraOffset);
+}
+
+template <class Vertex>
+void GP2_PBRBasePipeline<Vertex>::SetViewportAndBindSets(const GP2_CommandBuffer& cmdBuffer, VkExtent2D extent, int imageIndex, uint32_t cameraOffset)
+{
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
@@ -241,14 +421,32 @@ void GP2_PBRBasePipeline<UBO, Vertex>::Record(const GP2_CommandBuffer& cmdBuffer
 	vkCmdSetScissor(cmdBuffer.GetVkCommandBuffer(), 0, 1, &scissor);
 
 	m_DescriptorPool->BindDescriptorSet(cmdBuffer.GetVkCommandBuffer(), m_PipelineLayout, imageIndex);
+	m_LightClusters->BindDescriptorSet(cmdBuffer.GetVkCommandBuffer(), m_PipelineLayout, 2);
+	m_ShadowCascades->BindDescriptorSet(cmdBuffer.GetVkCommandBuffer(), m_PipelineLayout, 3);
 
-	vkCmdPushConstants(cmdBuffer.GetVkCommandBuffer(), m_PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(GP2_MeshData), sizeof(m_RenderMode), &m_RenderMode);
+	vkCmdPushConstants(cmdBuffer.GetVkCommandBuffer(), m_PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(m_RenderMode), &m_RenderMode);
 
-	DrawScene(cmdBuffer);
+	// transforms are baked into the arena's instances, the object slot only needs an identity
+	m_UniformRing->BindDescriptorSet(cmdBuffer.GetVkCommandBuffer(), m_PipelineLayout, cameraOffset, m_UniformRing->GetIdentityObjectOffset());
 }
 
-template <class UBO, class Vertex>
-void GP2_PBRBasePipeline<UBO, Vertex>::SetUBO(UBO ubo, size_t uboIndex)
+template <class Vertex>
+void GP2_PBRBasePipeline<Vertex>::Draw(const GP2_CommandBuffer& cmdBuffer)
 {
-	m_DescriptorPool->SetUBO(ubo, uboIndex);
+	m_GeometryArena->Bind(cmdBuffer.GetVkCommandBuffer());
+	m_GeometryArena->Draw(cmdBuffer.GetVkCommandBuffer(), m_DrawRange);
+}
+
+template <class Vertex>
+void GP2_PBRBasePipeline<Vertex>::DrawCommands(const GP2_CommandBuffer& cmdBuffer, uint32_t firstCommand, uint32_t commandCount)
+{
+	// the whole range in order can still use the compacted draws
+	if (firstCommand == 0 && commandCount == m_DrawRange.commandCount)
+	{
+		Draw(cmdBuffer);
+		return;
+	}
+
+	m_GeometryArena->Bind(cmdBuffer.GetVkCommandBuffer());
+	m_GeometryArena->DrawCommands(cmdBuffer.GetVkCommandBuffer(), m_DrawRange.firstCommand + firstCommand, commandCount);
 }
\ No newline at end of file
@@ -1,80 +1,67 @@
 #pragma once
 
 #include "GP2_PBRBasePipeline.h"
+#include "GP2_CpuProfiler.h"
 
-template <class UBO, class Vertex>
-class GP2_PBRMetalnessPipeline final : public GP2_PBRBasePipeline<UBO, Vertex>
+template <class Vertex>
+class GP2_PBRMetalnessPipeline final : public GP2_PBRBasePipeline<Vertex>
 {
 public:
-	GP2_PBRMetalnessPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile);
+	GP2_PBRMetalnessPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const std::string& gBufferFragmentShaderFile);
 	virtual ~GP2_PBRMetalnessPipeline() = default;
 
 	void SetTextureMaps(const VulkanContext& context, const std::string& diffuse, const std::string& normal,
-		const std::string& metalness, const std::string& roughness, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue) override;
+		const std::string& metalness, const std::string& roughness) override;
+	void UploadTextureMaps(GP2_UploadBatch& uploadBatch) override;
 
-	virtual void Initialize(const VulkanContext& context, size_t descriptorPoolCount);
-	virtual void CleanUp() override;
-
-private:
-	GP2_ImageBuffer* m_DiffuseMap;
-	GP2_ImageBuffer* m_NormalMap;
-	GP2_ImageBuffer* m_MetalnessMap;
-	GP2_ImageBuffer* m_RoughnessMap;
+	virtual void Initialize(const VulkanContext& context, size_t descriptorPoolCount, GP2_GeometryArena<Vertex>& geometryArena) override;
 };
 
-template<class UBO, class Vertex>
-void GP2_PBRMetalnessPipeline<UBO, Vertex>::SetTextureMaps(const VulkanContext& context, const std::string& diffuse, const std::string& normal,
-	const std::string& metalness, const std::string& roughness, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue)
+template<class Vertex>
+void GP2_PBRMetalnessPipeline<Vertex>::SetTextureMaps(const VulkanContext& context, const std::string& diffuse, const std::string& normal,
+	const std::string& metalness, const std::string& roughness)
 {
-	m_DiffuseMap = new GP2_ImageBuffer{ context };
-	m_DiffuseMap->LoadImageData(diffuse, context);
-	m_DiffuseMap->Initialize(queueFamInd, graphicsQueue, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
-
-	m_NormalMap = new GP2_ImageBuffer{ context };
-	m_NormalMap->LoadImageData(normal, context);
-	m_NormalMap->Initialize(queueFamInd, graphicsQueue, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
-
-	m_MetalnessMap = new GP2_ImageBuffer{ context };
-	m_MetalnessMap->LoadImageData(metalness, context);
-	m_MetalnessMap->Initialize(queueFamInd, graphicsQueue, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+	m_TextureStreamer = context.textureStreamer;
 
-	m_RoughnessMap = new GP2_ImageBuffer{ context };
-	m_RoughnessMap->LoadImageData(roughness, context);
-	m_RoughnessMap->Initialize(queueFamInd, graphicsQueue, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+	// bindings 0, 1 and 2 of the material set, metalness in red, roughness in green so one fetch samples both
+	m_TextureMaps.push_back(m_TextureStreamer->Register(diffuse, GP2_TextureUsage::Albedo));
+	m_TextureMaps.push_back(m_TextureStreamer->Register(normal, GP2_TextureUsage::Normal));
+	m_TextureMaps.push_back(m_TextureStreamer->Register(metalness, GP2_TextureUsage::Packed, roughness));
 }
 
-template <class UBO, class Vertex>
-void GP2_PBRMetalnessPipeline<UBO, Vertex>::CleanUp()
+template<class Vertex>
+void GP2_PBRMetalnessPipeline<Vertex>::UploadTextureMaps(GP2_UploadBatch& uploadBatch)
 {
-	m_DiffuseMap->Destroy();
-	m_DiffuseMap = nullptr;
-	m_NormalMap->Destroy();
-	m_NormalMap = nullptr;
-	m_MetalnessMap->Destroy();
-	m_MetalnessMap = nullptr;
-	m_RoughnessMap->Destroy();
-	m_RoughnessMap = nullptr;
-
-	GP2_PBRBasePipeline<UBO, Vertex>::CleanUp();
+	for (GP2_TextureStreamer::Handle textureMap : m_TextureMaps)
+	{
+		m_TextureStreamer->Upload(textureMap, uploadBatch);
+	}
 }
 
-template <class UBO, class Vertex>
-void GP2_PBRMetalnessPipeline<UBO, Vertex>::Initialize(const VulkanContext& context, size_t descriptorPoolCount)
+template <class Vertex>
+void GP2_PBRMetalnessPipeline<Vertex>::Initialize(const VulkanContext& context, size_t descriptorPoolCount, GP2_GeometryArena<Vertex>& geometryArena)
 {
+	GP2_CPU_ZONE("GP2_PBRMetalnessPipeline::Initialize");
 	std::vector<std::pair<VkImageView, VkSampler>> imageDatas;
-	imageDatas.push_back(std::make_pair(m_DiffuseMap->GetView(), m_DiffuseMap->GetSampler()));
-	imageDatas.push_back(std::make_pair(m_NormalMap->GetView(), m_NormalMap->GetSampler()));
-	imageDatas.push_back(std::make_pair(m_MetalnessMap->GetView(), m_MetalnessMap->GetSampler()));
-	imageDatas.push_back(std::make_pair(m_RoughnessMap->GetView(), m_RoughnessMap->GetSampler()));
+	for (GP2_TextureStreamer::Handle textureMap : m_TextureMaps)
+	{
+		imageDatas.push_back(std::make_pair(m_TextureStreamer->GetView(textureMap), m_TextureStreamer->GetSampler()));
+	}
 
-	m_DescriptorPool = new GP2_DescriptorPool<UBO>{ context.device, descriptorPoolCount, imageDatas.size() };
+	m_DescriptorPool = new GP2_DescriptorPool{ context.device, descriptorPoolCount };
 	m_DescriptorPool->Initialize(context, imageDatas.size());
 	m_DescriptorPool->CreateDescriptorSets(imageDatas);
 
-	GP2_PBRBasePipeline<UBO, Vertex>::Initialize(context, descriptorPoolCount);
+	// the streamer swaps images as their levels load or get evicted
+	for (uint32_t binding = 0; binding < m_TextureMaps.size(); ++binding)
+	{
+		m_TextureStreamer->AddBinding(m_TextureMaps[binding], m_DescriptorPool, binding);
+	}
+
+	GP2_PBRBasePipeline<Vertex>::Initialize(context, descriptorPoolCount, geometryArena);
 }
 
-template <class UBO, class Vertex>
-GP2_PBRMetalnessPipeline<UBO, Vertex>::GP2_PBRMetalnessPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile) :
-	GP2_PBRBasePipeline<UBO, Vertex>(vertexShaderFile, fragmentShaderFile)
+template <class Vertex>
+GP2_PBRMetalnessPipeline<Vertex>::GP2_PBRMetalnessPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const std::string& gBufferFragmentShaderFile) :
+	GP2_PBRBasePipeline<Vertex>(vertexShaderFile, fragmentShaderFile, gBufferFragmentShaderFile)
 { }
\ No newline at end of file
@@ -1,80 +1,67 @@
 #pragma once
 
 #include "GP2_PBRBasePipeline.h"
+#include "GP2_CpuProfiler.h"
 
-template <class UBO, class Vertex>
-class GP2_PBRSpecularPipeline final : public GP2_PBRBasePipeline<UBO, Vertex>
+template <class Vertex>
+class GP2_PBRSpecularPipeline final : public GP2_PBRBasePipeline<Vertex>
 {
 public:
-	GP2_PBRSpecularPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile);
+	GP2_PBRSpecularPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const std::string& gBufferFragmentShaderFile);
 	virtual ~GP2_PBRSpecularPipeline() = default;
 
 	void SetTextureMaps(const VulkanContext& context, const std::string& diffuse, const std::string& normal,
-		const std::string& gloss, const std::string& specular, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue) override;
+		const std::string& gloss, const std::string& specular) override;
+	void UploadTextureMaps(GP2_UploadBatch& uploadBatch) override;
 
-	void Initialize(const VulkanContext& context, size_t descriptorPoolCount) override;
-	void CleanUp() override;
-
-private:
-	GP2_ImageBuffer* m_DiffuseMap;
-	GP2_ImageBuffer* m_NormalMap;
-	GP2_ImageBuffer* m_GlossMap;
-	GP2_ImageBuffer* m_SpecularMap;
+	void Initialize(const VulkanContext& context, size_t descriptorPoolCount, GP2_GeometryArena<Vertex>& geometryArena) override;
 };
 
-template<class UBO, class Vertex>
-void GP2_PBRSpecularPipeline<UBO, Vertex>::SetTextureMaps(const VulkanContext& context, const std::string& diffuse, const std::string& normal,
-	const std::string& gloss, const std::string& specular, QueueFamilyIndices queueFamInd, VkQueue graphicsQueue)
+template<class Vertex>
+void GP2_PBRSpecularPipeline<Vertex>::SetTextureMaps(const VulkanContext& context, const std::string& diffuse, const std::string& normal,
+	const std::string& gloss, const std::string& specular)
 {
-	m_DiffuseMap = new GP2_ImageBuffer{ context };
-	m_DiffuseMap->LoadImageData(diffuse, context);
-	m_DiffuseMap->Initialize(queueFamInd, graphicsQueue, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
-
-	m_NormalMap = new GP2_ImageBuffer{ context };
-	m_NormalMap->LoadImageData(normal, context);
-	m_NormalMap->Initialize(queueFamInd, graphicsQueue, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
-
-	m_GlossMap = new GP2_ImageBuffer{ context };
-	m_GlossMap->LoadImageData(gloss, context);
-	m_GlossMap->Initialize(queueFamInd, graphicsQueue, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+	m_TextureStreamer = context.textureStreamer;
 
-	m_SpecularMap = new GP2_ImageBuffer{ context };
-	m_SpecularMap->LoadImageData(specular, context);
-	m_SpecularMap->Initialize(queueFamInd, graphicsQueue, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+	// bindings 0, 1 and 2 of the material set, gloss in red, specular in green so one fetch samples both
+	m_TextureMaps.push_back(m_TextureStreamer->Register(diffuse, GP2_TextureUsage::Albedo));
+	m_TextureMaps.push_back(m_TextureStreamer->Register(normal, GP2_TextureUsage::Normal));
+	m_TextureMaps.push_back(m_TextureStreamer->Register(gloss, GP2_TextureUsage::Packed, specular));
 }
 
-template <class UBO, class Vertex>
-void GP2_PBRSpecularPipeline<UBO, Vertex>::CleanUp()
+template<class Vertex>
+void GP2_PBRSpecularPipeline<Vertex>::UploadTextureMaps(GP2_UploadBatch& uploadBatch)
 {
-	m_DiffuseMap->Destroy();
-	m_DiffuseMap = nullptr;
-	m_NormalMap->Destroy();
-	m_NormalMap = nullptr;
-	m_GlossMap->Destroy();
-	m_GlossMap = nullptr;
-	m_SpecularMap->Destroy();
-	m_SpecularMap = nullptr;
-
-	GP2_PBRBasePipeline<UBO, Vertex>::CleanUp();
+	for (GP2_TextureStreamer::Handle textureMap : m_TextureMaps)
+	{
+		m_TextureStreamer->Upload(textureMap, uploadBatch);
+	}
 }
 
-template <class UBO, class Vertex>
-void GP2_PBRSpecularPipeline<UBO, Vertex>::Initialize(const VulkanContext& context, size_t descriptorPoolCount)
+template <class Vertex>
+void GP2_PBRSpecularPipeline<Vertex>::Initialize(const VulkanContext& context, size_t descriptorPoolCount, GP2_GeometryArena<Vertex>& geometryArena)
 {
+	GP2_CPU_ZONE("GP2_PBRSpecularPipeline::Initialize");
 	std::vector<std::pair<VkImageView, VkSampler>> imageDatas;
-	imageDatas.push_back(std::make_pair(m_DiffuseMap->GetView(), m_DiffuseMap->GetSampler()));
-	imageDatas.push_back(std::make_pair(m_NormalMap->GetView(), m_NormalMap->GetSampler()));
-	imageDatas.push_back(std::make_pair(m_GlossMap->GetView(), m_GlossMap->GetSampler()));
-	imageDatas.push_back(std::make_pair(m_SpecularMap->GetView(), m_SpecularMap->GetSampler()));
+	for (GP2_TextureStreamer::Handle textureMap : m_TextureMaps)
+	{
+		imageDatas.push_back(std::make_pair(m_TextureStreamer->GetView(textureMap), m_TextureStreamer->GetSampler()));
+	}
 
-	m_DescriptorPool = new GP2_DescriptorPool<UBO>{ context.device, descriptorPoolCount, imageDatas.size()};
+	m_DescriptorPool = new GP2_DescriptorPool{ context.device, descriptorPoolCount };
 	m_DescriptorPool->Initialize(context, imageDatas.size());
 	m_DescriptorPool->CreateDescriptorSets(imageDatas);
 
-	GP2_PBRBasePipeline<UBO, Vertex>::Initialize(context, descriptorPoolCount);
+	// the streamer swaps images as their levels load or get evicted
+	for (uint32_t binding = 0; binding < m_TextureMaps.size(); ++binding)
+	{
+		m_TextureStreamer->AddBinding(m_TextureMaps[binding], m_DescriptorPool, binding);
+	}
+
+	GP2_PBRBasePipeline<Vertex>::Initialize(context, descriptorPoolCount, geometryArena);
 }
 
-template <class UBO, class Vertex>
-GP2_PBRSpecularPipeline<UBO, Vertex>::GP2_PBRSpecularPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile) :
-	GP2_PBRBasePipeline<UBO, Vertex>(vertexShaderFile, fragmentShaderFile)
+template <class Vertex>
+GP2_PBRSpecularPipeline<Vertex>::GP2_PBRSpecularPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const std::string& gBufferFragmentShaderFile) :
+	GP2_PBRBasePipeline<Vertex>(vertexShaderFile, fragmentShaderFile, gBufferFragmentShaderFile)
 { }
\ No newline at end of file
@@ -0,0 +1,878 @@
+#include "GP2_RenderGraph.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_RetireQueue.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	const VkAccessFlags g_WriteAccess{ VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT };
+
+	VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+void GP2_RenderGraph::Initialize(const VulkanContext& context)
+{
+	m_VkDevice = context.device;
+	m_VkPhysicalDevice = context.physicalDevice;
+}
+
+void GP2_RenderGraph::Destroy()
+{
+	DestroyObjects(m_VkDevice, TakeObjects());
+}
+
+void GP2_RenderGraph::Retire(GP2_RetireQueue& retireQueue)
+{
+	const VkDevice device = m_VkDevice;
+	retireQueue.Push([device, objects = TakeObjects()]() {
+		DestroyObjects(device, objects);
+		});
+}
+
+GP2_RenderGraph::VulkanObjects GP2_RenderGraph::TakeObjects()
+{
+	VulkanObjects objects{};
+	for (Pass& pass : m_Passes)
+	{
+		objects.framebuffers.insert(objects.framebuffers.end(), pass.framebuffers.begin(), pass.framebuffers.end());
+		objects.renderPasses.push_back(pass.renderPass);
+	}
+
+	for (Resource& resource : m_Resources)
+	{
+		if (resource.imported)
+			continue;
+
+		objects.views.insert(objects.views.end(), resource.views.begin(), resource.views.end());
+		objects.images.insert(objects.images.end(), resource.images.begin(), resource.images.end());
+	}
+
+	for (MemoryBlock& block : m_MemoryBlocks)
+	{
+		objects.memory.push_back(block.memory);
+	}
+
+	m_Passes.clear();
+	m_Resources.clear();
+	m_MemoryBlocks.clear();
+	m_FinalBarriers = BarrierBatch{};
+	m_IsCompiled = false;
+
+	return objects;
+}
+
+void GP2_RenderGraph::DestroyObjects(VkDevice device, const VulkanObjects& objects)
+{
+	for (VkFramebuffer framebuffer : objects.framebuffers)
+	{
+		vkDestroyFramebuffer(device, framebuffer, nullptr);
+	}
+	for (VkRenderPass renderPass : objects.renderPasses)
+	{
+		vkDestroyRenderPass(device, renderPass, nullptr);
+	}
+	for (VkImageView view : objects.views)
+	{
+		vkDestroyImageView(device, view, nullptr);
+	}
+	for (VkImage image : objects.images)
+	{
+		vkDestroyImage(device, image, nullptr);
+	}
+	for (VkDeviceMemory memory : objects.memory)
+	{
+		vkFreeMemory(device, memory, nullptr);
+	}
+}
+
+GP2_RenderGraph::ResourceHandle GP2_RenderGraph::CreateImage(const std::string& name, VkFormat format, VkExtent2D extent)
+{
+	Resource resource{};
+	resource.name = name;
+	resource.format = format;
+	resource.extent = extent;
+
+	m_Resources.push_back(resource);
+	return static_cast<ResourceHandle>(m_Resources.size() - 1);
+}
+
+GP2_RenderGraph::ResourceHandle GP2_RenderGraph::ImportImage(const std::string& name, const std::vector<VkImage>& images, const std::vector<VkImageView>& views,
+	VkFormat format, VkExtent2D extent, const ImageState& initialState, const ImageState& finalState)
+{
+	if (images.empty() || images.size() != views.size())
+		throw std::invalid_argument("imported image " + name + " needs one view per image!");
+
+	Resource resource{};
+	resource.name = name;
+	resource.format = format;
+	resource.extent = extent;
+	resource.imported = true;
+	resource.images = images;
+	resource.views = views;
+	resource.initialState = initialState;
+	resource.finalState = finalState;
+
+	m_Resources.push_back(resource);
+	return static_cast<ResourceHandle>(m_Resources.size() - 1);
+}
+
+GP2_RenderGraph::PassHandle GP2_RenderGraph::AddRasterPass(const std::string& name, ExecuteFunction execute)
+{
+	Pass pass{};
+	pass.name = name;
+	pass.execute = std::move(execute);
+
+	m_Passes.push_back(std::move(pass));
+	return static_cast<PassHandle>(m_Passes.size() - 1);
+}
+
+GP2_RenderGraph::PassHandle GP2_RenderGraph::AddComputePass(const std::string& name, ExecuteFunction execute)
+{
+	const PassHandle pass = AddRasterPass(name, std::move(execute));
+	m_Passes[pass].compute = true;
+	return pass;
+}
+
+void GP2_RenderGraph::SetSideEffects(PassHandle pass)
+{
+	m_Passes.at(pass).sideEffects = true;
+}
+
+void GP2_RenderGraph::WriteColor(PassHandle pass, ResourceHandle resource)
+{
+	AddUse(pass, resource, Usage::ColorAttachment, nullptr);
+}
+
+void GP2_RenderGraph::WriteColor(PassHandle pass, ResourceHandle resource, const VkClearColorValue& clear)
+{
+	VkClearValue clearValue{};
+	clearValue.color = clear;
+	AddUse(pass, resource, Usage::ColorAttachment, &clearValue);
+}
+
+void GP2_RenderGraph::WriteDepth(PassHandle pass, ResourceHandle resource)
+{
+	AddUse(pass, resource, Usage::DepthAttachment, nullptr);
+}
+
+void GP2_RenderGraph::WriteDepth(PassHandle pass, ResourceHandle resource, const VkClearDepthStencilValue& clear)
+{
+	VkClearValue clearValue{};
+	clearValue.depthStencil = clear;
+	AddUse(pass, resource, Usage::DepthAttachment, &clearValue);
+}
+
+void GP2_RenderGraph::WriteStorage(PassHandle pass, ResourceHandle resource)
+{
+	AddUse(pass, resource, Usage::Storage, nullptr);
+}
+
+void GP2_RenderGraph::ReadTexture(PassHandle pass, ResourceHandle resource)
+{
+	AddUse(pass, resource, Usage::Sampled, nullptr);
+}
+
+void GP2_RenderGraph::AddUse(PassHandle pass, ResourceHandle resource, Usage usage, const VkClearValue* clear)
+{
+	if (m_IsCompiled)
+		throw std::logic_error("render graph is already compiled!");
+
+	Pass& target = m_Passes.at(pass);
+	const Resource& image = m_Resources.at(resource);
+
+	const bool attachment = usage == Usage::ColorAttachment || usage == Usage::DepthAttachment;
+	if (target.compute && attachment)
+		throw std::invalid_argument("compute pass " + target.name + " can't have attachments!");
+	if (!target.compute && usage == Usage::Storage)
+		throw std::invalid_argument("raster pass " + target.name + " can't write storage images!");
+	if (attachment && (usage == Usage::DepthAttachment) != IsDepthFormat(image.format))
+		throw std::invalid_argument(image.name + " has the wrong format for its attachment in " + target.name + "!");
+
+	// one use per image and pass, a layout can't be two things at once
+	for (const Use& use : target.uses)
+	{
+		if (use.resource == resource)
+			throw std::invalid_argument(image.name + " is used twice by " + target.name + "!");
+	}
+
+	Use use{};
+	use.resource = resource;
+	use.usage = usage;
+	if (clear != nullptr)
+	{
+		use.clear = true;
+		use.clearValue = *clear;
+	}
+	target.uses.push_back(use);
+}
+
+void GP2_RenderGraph::Compile()
+{
+	GP2_CPU_ZONE("GP2_RenderGraph::Compile");
+	if (m_IsCompiled)
+		throw std::logic_error("render graph is already compiled!");
+
+	CullPasses();
+	ComputeLifetimes();
+	CreateTransientImages();
+	PlaceTransientImages();
+
+	std::vector<TrackedState> initialStates(m_Resources.size());
+	for (size_t idx = 0; idx < m_Resources.size(); ++idx)
+	{
+		const Resource& resource = m_Resources[idx];
+		if (resource.imported)
+			initialStates[idx] = TrackedState{ resource.initialState.layout, resource.initialState.stages, resource.initialState.access, 0 };
+	}
+
+	// transient images start a frame the way the previous frame left them, so the first
+	// walk only finds those states and the second one computes the barriers
+	std::vector<BarrierBatch> passBatches{};
+	std::vector<TrackedState> states{ initialStates };
+	CompileBarriers(states, passBatches, m_FinalBarriers);
+
+	for (size_t idx = 0; idx < m_Resources.size(); ++idx)
+	{
+		if (!m_Resources[idx].imported)
+			initialStates[idx] = states[idx];
+	}
+	CompileBarriers(initialStates, passBatches, m_FinalBarriers);
+
+	for (uint32_t idx = 0; idx < m_Passes.size(); ++idx)
+	{
+		Pass& pass = m_Passes[idx];
+		pass.barriers = std::move(passBatches[idx]);
+
+		if (!pass.culled && !pass.compute)
+			CreateRenderPass(idx);
+	}
+
+	m_IsCompiled = true;
+}
+
+void GP2_RenderGraph::SetPassEnabled(PassHandle pass, bool enabled)
+{
+	m_Passes.at(pass).enabled = enabled;
+}
+
+void GP2_RenderGraph::Execute(VkCommandBuffer cmdBuffer, uint32_t imageIndex)
+{
+	for (const Pass& pass : m_Passes)
+	{
+		if (pass.culled)
+			continue;
+
+		RecordBarriers(cmdBuffer, pass.barriers, imageIndex);
+		if (!pass.enabled)
+			continue;
+
+		if (pass.compute)
+		{
+			pass.execute(cmdBuffer);
+			continue;
+		}
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = pass.renderPass;
+		renderPassInfo.framebuffer = pass.framebuffers[pass.framebuffers.size() > 1 ? imageIndex : 0];
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = pass.extent;
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+		renderPassInfo.pClearValues = pass.clearValues.data();
+
+		vkCmdBeginRenderPass(cmdBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		pass.execute(cmdBuffer);
+		vkCmdEndRenderPass(cmdBuffer);
+	}
+
+	RecordBarriers(cmdBuffer, m_FinalBarriers, imageIndex);
+}
+
+VkRenderPass GP2_RenderGraph::GetRenderPass(PassHandle pass) const
+{
+	const Pass& target = m_Passes.at(pass);
+	if (target.renderPass == VK_NULL_HANDLE)
+		throw std::logic_error(target.name + " has no render pass, it is culled, a compute pass or not compiled yet!");
+	return target.renderPass;
+}
+
+VkImageView GP2_RenderGraph::GetView(ResourceHandle resource) const
+{
+	const Resource& image = m_Resources.at(resource);
+	if (image.views.empty())
+		throw std::logic_error(image.name + " has no view, it is unused or not compiled yet!");
+	return image.views[0];
+}
+
+VkExtent2D GP2_RenderGraph::GetExtent(ResourceHandle resource) const
+{
+	return m_Resources.at(resource).extent;
+}
+
+bool GP2_RenderGraph::IsCulled(PassHandle pass) const
+{
+	return m_Passes.at(pass).culled;
+}
+
+void GP2_RenderGraph::PrintStatistics() const
+{
+	uint32_t culledPasses = 0;
+	for (const Pass& pass : m_Passes)
+	{
+		if (pass.culled)
+			++culledPasses;
+	}
+
+	uint32_t transientImages = 0;
+	VkDeviceSize separateBytes = 0;
+	for (const Resource& resource : m_Resources)
+	{
+		if (resource.imported || !resource.used)
+			continue;
+
+		++transientImages;
+		separateBytes += resource.requirements.size;
+	}
+
+	VkDeviceSize aliasedBytes = 0;
+	for (const MemoryBlock& block : m_MemoryBlocks)
+	{
+		aliasedBytes += block.size;
+	}
+
+	const std::ios_base::fmtflags flags = std::cout.flags();
+	const std::streamsize precision = std::cout.precision();
+
+	constexpr double megabyte = 1024.0 * 1024.0;
+	std::cout << "render graph, " << m_Passes.size() - culledPasses << " passes (" << culledPasses << " culled)\n" << std::fixed << std::setprecision(1)
+		<< "  " << transientImages << " transient images: " << aliasedBytes / megabyte << " MB, "
+		<< separateBytes / megabyte << " MB without aliasing\n";
+
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
+
+void GP2_RenderGraph::CullPasses()
+{
+	// backwards: a pass lives when it writes something a later living pass depends on
+	std::vector<bool> needed(m_Resources.size(), false);
+	for (size_t idx = m_Passes.size(); idx-- > 0;)
+	{
+		Pass& pass = m_Passes[idx];
+
+		bool live = pass.sideEffects;
+		for (const Use& use : pass.uses)
+		{
+			if (IsWrite(use.usage) && (m_Resources[use.resource].imported || needed[use.resource]))
+				live = true;
+		}
+
+		pass.culled = !live;
+		if (!live)
+			continue;
+
+		// whatever it writes is produced here, what it reads or loads comes from an earlier pass
+		for (const Use& use : pass.uses)
+		{
+			if (IsWrite(use.usage))
+				needed[use.resource] = false;
+		}
+		for (const Use& use : pass.uses)
+		{
+			if (!IsWrite(use.usage) || !use.clear)
+				needed[use.resource] = true;
+		}
+	}
+}
+
+void GP2_RenderGraph::ComputeLifetimes()
+{
+	for (uint32_t idx = 0; idx < m_Passes.size(); ++idx)
+	{
+		Pass& pass = m_Passes[idx];
+		if (pass.culled)
+			continue;
+
+		for (Use& use : pass.uses)
+		{
+			Resource& resource = m_Resources[use.resource];
+			if (resource.imported)
+				continue;
+
+			if (!resource.used)
+			{
+				if (!IsWrite(use.usage))
+					throw std::logic_error(pass.name + " reads " + resource.name + " before any pass writes it!");
+
+				resource.used = true;
+				resource.firstPass = idx;
+				use.discard = true;
+			}
+			resource.lastPass = idx;
+
+			switch (use.usage)
+			{
+			case Usage::ColorAttachment:
+				resource.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+				break;
+			case Usage::DepthAttachment:
+				resource.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+				break;
+			case Usage::Storage:
+				resource.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+				break;
+			case Usage::Sampled:
+				resource.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+				break;
+			}
+		}
+	}
+}
+
+void GP2_RenderGraph::CreateTransientImages()
+{
+	for (Resource& resource : m_Resources)
+	{
+		if (resource.imported || !resource.used)
+			continue;
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = resource.extent.width;
+		imageInfo.extent.height = resource.extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = resource.format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = resource.usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkImage image{ VK_NULL_HANDLE };
+		if (vkCreateImage(m_VkDevice, &imageInfo, nullptr, &image) != VK_SUCCESS)
+			throw std::runtime_error("failed to create render graph image " + resource.name + "!");
+
+		resource.images.push_back(image);
+		vkGetImageMemoryRequirements(m_VkDevice, image, &resource.requirements);
+	}
+}
+
+void GP2_RenderGraph::PlaceTransientImages()
+{
+	std::vector<ResourceHandle> order{};
+	for (ResourceHandle handle = 0; handle < m_Resources.size(); ++handle)
+	{
+		if (!m_Resources[handle].imported && m_Resources[handle].used)
+			order.push_back(handle);
+	}
+
+	// largest first, the smaller images then fill the gaps left between them
+	std::stable_sort(order.begin(), order.end(), [this](ResourceHandle first, ResourceHandle second) {
+		return m_Resources[first].requirements.size > m_Resources[second].requirements.size;
+	});
+
+	std::vector<std::vector<ResourceHandle>> placed{};
+	for (ResourceHandle handle : order)
+	{
+		Resource& resource = m_Resources[handle];
+		const uint32_t memoryType = FindMemoryType(resource.requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		uint32_t blockIndex = 0;
+		while (blockIndex < m_MemoryBlocks.size() && m_MemoryBlocks[blockIndex].memoryType != memoryType)
+			++blockIndex;
+		if (blockIndex == m_MemoryBlocks.size())
+		{
+			m_MemoryBlocks.push_back(MemoryBlock{ VK_NULL_HANDLE, 0, memoryType });
+			placed.emplace_back();
+		}
+
+		// only images alive in the same passes are in the way
+		std::vector<const Resource*> overlapping{};
+		for (ResourceHandle other : placed[blockIndex])
+		{
+			const Resource& otherResource = m_Resources[other];
+			if (otherResource.firstPass <= resource.lastPass && resource.firstPass <= otherResource.lastPass)
+				overlapping.push_back(&otherResource);
+		}
+		std::sort(overlapping.begin(), overlapping.end(), [](const Resource* first, const Resource* second) {
+			return first->offset < second->offset;
+		});
+
+		VkDeviceSize offset = 0;
+		for (const Resource* other : overlapping)
+		{
+			if (offset + resource.requirements.size <= other->offset)
+				break;
+			offset = (std::max)(offset, AlignUp(other->offset + other->requirements.size, resource.requirements.alignment));
+		}
+
+		resource.block = blockIndex;
+		resource.offset = offset;
+		placed[blockIndex].push_back(handle);
+
+		MemoryBlock& block = m_MemoryBlocks[blockIndex];
+		block.size = (std::max)(block.size, offset + resource.requirements.size);
+	}
+
+	for (MemoryBlock& block : m_MemoryBlocks)
+	{
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = block.size;
+		allocInfo.memoryTypeIndex = block.memoryType;
+
+		if (vkAllocateMemory(m_VkDevice, &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+			throw std::runtime_error("failed to allocate render graph memory!");
+	}
+
+	for (ResourceHandle handle : order)
+	{
+		Resource& resource = m_Resources[handle];
+		vkBindImageMemory(m_VkDevice, resource.images[0], m_MemoryBlocks[resource.block].memory, resource.offset);
+
+		// depth is only ever sampled through its depth aspect
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = resource.images[0];
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = resource.format;
+		viewInfo.subresourceRange = { IsDepthFormat(resource.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		VkImageView view{ VK_NULL_HANDLE };
+		if (vkCreateImageView(m_VkDevice, &viewInfo, nullptr, &view) != VK_SUCCESS)
+			throw std::runtime_error("failed to create render graph image view " + resource.name + "!");
+		resource.views.push_back(view);
+	}
+}
+
+void GP2_RenderGraph::CompileBarriers(std::vector<TrackedState>& states, std::vector<BarrierBatch>& passBatches, BarrierBatch& finalBatch) const
+{
+	passBatches.assign(m_Passes.size(), BarrierBatch{});
+	for (uint32_t idx = 0; idx < m_Passes.size(); ++idx)
+	{
+		const Pass& pass = m_Passes[idx];
+		if (pass.culled)
+			continue;
+
+		BarrierBatch& batch = passBatches[idx];
+		for (const Use& use : pass.uses)
+		{
+			TrackedState& state = states[use.resource];
+
+			VkImageLayout layout{};
+			VkPipelineStageFlags stages{};
+			VkAccessFlags access{};
+			GetUsageState(pass, use, layout, stages, access);
+
+			Barrier barrier{ use.resource, state.layout, layout, state.writeAccess, access };
+			VkPipelineStageFlags srcStages = 0;
+			bool needsBarrier = false;
+
+			if (use.discard)
+			{
+				// the memory may have belonged to another image since this one last used it,
+				// whoever touched it last has to be done before it is overwritten
+				const Resource& resource = m_Resources[use.resource];
+				srcStages = state.writeStages | state.readStages;
+				for (ResourceHandle other = 0; other < m_Resources.size(); ++other)
+				{
+					if (other == use.resource || !AliasesMemory(resource, m_Resources[other]))
+						continue;
+
+					srcStages |= states[other].writeStages | states[other].readStages;
+					batch.memorySrcAccess |= states[other].writeAccess;
+				}
+				if (batch.memorySrcAccess != 0)
+					batch.memoryDstAccess |= access;
+
+				barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				needsBarrier = true;
+			}
+			else if (IsWrite(use.usage) || state.layout != layout)
+			{
+				srcStages = state.writeStages | state.readStages;
+				needsBarrier = state.layout != layout || srcStages != 0;
+			}
+			else
+			{
+				// reads after reads only wait when a new stage has yet to see the last write
+				srcStages = state.writeStages;
+				needsBarrier = state.writeStages != 0 && (stages & ~state.readStages) != 0;
+			}
+
+			if (needsBarrier)
+			{
+				batch.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+				batch.dstStages |= stages;
+				batch.barriers.push_back(barrier);
+			}
+
+			if (IsWrite(use.usage))
+				state = TrackedState{ layout, stages, access & g_WriteAccess, 0 };
+			else if (state.layout != layout)
+				state = TrackedState{ layout, stages, 0, stages };
+			else
+				state.readStages |= stages;
+		}
+	}
+
+	finalBatch = BarrierBatch{};
+	for (ResourceHandle handle = 0; handle < m_Resources.size(); ++handle)
+	{
+		const Resource& resource = m_Resources[handle];
+		if (!resource.imported)
+			continue;
+
+		const TrackedState& state = states[handle];
+		const ImageState& finalState = resource.finalState;
+
+		const bool layoutChange = state.layout != finalState.layout;
+		if (!layoutChange && (finalState.stages == 0 || state.writeStages == 0))
+			continue;
+
+		const VkPipelineStageFlags srcStages = layoutChange ? state.writeStages | state.readStages : state.writeStages;
+		finalBatch.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		finalBatch.dstStages |= finalState.stages != 0 ? finalState.stages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		finalBatch.barriers.push_back(Barrier{ handle, state.layout, finalState.layout, state.writeAccess, finalState.access });
+	}
+}
+
+void GP2_RenderGraph::CreateRenderPass(uint32_t passIndex)
+{
+	Pass& pass = m_Passes[passIndex];
+
+	std::vector<VkAttachmentDescription> attachments{};
+	std::vector<VkAttachmentReference> colorAttachmentRefs{};
+	VkAttachmentReference depthAttachmentRef{};
+	bool hasDepth = false;
+	std::vector<const Resource*> attachmentResources{};
+
+	for (const Use& use : pass.uses)
+	{
+		if (use.usage != Usage::ColorAttachment && use.usage != Usage::DepthAttachment)
+			continue;
+
+		const Resource& resource = m_Resources[use.resource];
+		if (!attachmentResources.empty() && (resource.extent.width != pass.extent.width || resource.extent.height != pass.extent.height))
+			throw std::logic_error("attachments of " + pass.name + " differ in size!");
+		pass.extent = resource.extent;
+
+		VkImageLayout layout{};
+		VkPipelineStageFlags stages{};
+		VkAccessFlags access{};
+		GetUsageState(pass, use, layout, stages, access);
+
+		// stored for any later pass and for the owner of an imported image
+		const bool consumedLater = resource.imported || resource.lastPass > passIndex;
+
+		// the graph's barriers do every layout transition, the render pass keeps the layout
+		VkAttachmentDescription attachment{};
+		attachment.format = resource.format;
+		attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		attachment.loadOp = use.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : use.discard ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_LOAD;
+		attachment.storeOp = consumedLater ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.initialLayout = layout;
+		attachment.finalLayout = layout;
+
+		const VkAttachmentReference reference{ static_cast<uint32_t>(attachments.size()), layout };
+		if (use.usage == Usage::DepthAttachment)
+		{
+			if (hasDepth)
+				throw std::logic_error(pass.name + " writes more than one depth attachment!");
+			hasDepth = true;
+			depthAttachmentRef = reference;
+		}
+		else
+		{
+			colorAttachmentRefs.push_back(reference);
+		}
+
+		attachments.push_back(attachment);
+		attachmentResources.push_back(&resource);
+		pass.clearValues.push_back(use.clearValue);
+	}
+
+	if (attachments.empty())
+		throw std::logic_error("raster pass " + pass.name + " has no attachments!");
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = static_cast<uint32_t>(colorAttachmentRefs.size());
+	subpass.pColorAttachments = colorAttachmentRefs.data();
+	subpass.pDepthStencilAttachment = hasDepth ? &depthAttachmentRef : nullptr;
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	renderPassInfo.pAttachments = attachments.data();
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+
+	if (vkCreateRenderPass(m_VkDevice, &renderPassInfo, nullptr, &pass.renderPass) != VK_SUCCESS)
+		throw std::runtime_error("failed to create render pass for " + pass.name + "!");
+
+	// one framebuffer per image of the imported attachments, swap chain images mostly
+	size_t framebufferCount = 1;
+	for (const Resource* resource : attachmentResources)
+	{
+		if (resource->views.size() > 1 && framebufferCount > 1 && resource->views.size() != framebufferCount)
+			throw std::logic_error("attachments of " + pass.name + " have different image counts!");
+		framebufferCount = (std::max)(framebufferCount, resource->views.size());
+	}
+
+	std::vector<VkImageView> views(attachmentResources.size());
+	for (size_t framebufferIdx = 0; framebufferIdx < framebufferCount; ++framebufferIdx)
+	{
+		for (size_t idx = 0; idx < attachmentResources.size(); ++idx)
+		{
+			const std::vector<VkImageView>& resourceViews = attachmentResources[idx]->views;
+			views[idx] = resourceViews.size() > 1 ? resourceViews[framebufferIdx] : resourceViews[0];
+		}
+
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = pass.renderPass;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+		framebufferInfo.pAttachments = views.data();
+		framebufferInfo.width = pass.extent.width;
+		framebufferInfo.height = pass.extent.height;
+		framebufferInfo.layers = 1;
+
+		VkFramebuffer framebuffer{ VK_NULL_HANDLE };
+		if (vkCreateFramebuffer(m_VkDevice, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+			throw std::runtime_error("failed to create framebuffer for " + pass.name + "!");
+		pass.framebuffers.push_back(framebuffer);
+	}
+}
+
+bool GP2_RenderGraph::AliasesMemory(const Resource& first, const Resource& second) const
+{
+	if (first.imported || second.imported || !first.used || !second.used || first.block != second.block)
+		return false;
+
+	return first.offset < second.offset + second.requirements.size && second.offset < first.offset + first.requirements.size;
+}
+
+void GP2_RenderGraph::GetUsageState(const Pass& pass, const Use& use, VkImageLayout& layout, VkPipelineStageFlags& stages, VkAccessFlags& access) const
+{
+	switch (use.usage)
+	{
+	case Usage::ColorAttachment:
+		layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		break;
+	case Usage::DepthAttachment:
+		layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		break;
+	case Usage::Storage:
+		layout = VK_IMAGE_LAYOUT_GENERAL;
+		stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		break;
+	case Usage::Sampled:
+		layout = IsDepthFormat(m_Resources[use.resource].format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		stages = pass.compute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		access = VK_ACCESS_SHADER_READ_BIT;
+		break;
+	}
+}
+
+void GP2_RenderGraph::RecordBarriers(VkCommandBuffer cmdBuffer, const BarrierBatch& batch, uint32_t imageIndex)
+{
+	if (batch.barriers.empty() && batch.memorySrcAccess == 0)
+		return;
+
+	m_BarrierScratch.clear();
+	for (const Barrier& barrier : batch.barriers)
+	{
+		const Resource& resource = m_Resources[barrier.resource];
+
+		VkImageMemoryBarrier imageBarrier{};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.oldLayout = barrier.oldLayout;
+		imageBarrier.newLayout = barrier.newLayout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = resource.images[resource.images.size() > 1 ? imageIndex : 0];
+		// imported images may have mips and layers, the barrier covers all of them
+		imageBarrier.subresourceRange = { GetBarrierAspect(resource.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+		imageBarrier.srcAccessMask = barrier.srcAccess;
+		imageBarrier.dstAccessMask = barrier.dstAccess;
+		m_BarrierScratch.push_back(imageBarrier);
+	}
+
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = batch.memorySrcAccess;
+	memoryBarrier.dstAccessMask = batch.memoryDstAccess;
+	const uint32_t memoryBarrierCount = batch.memorySrcAccess != 0 ? 1 : 0;
+
+	vkCmdPipelineBarrier(cmdBuffer, batch.srcStages, batch.dstStages, 0, memoryBarrierCount, &memoryBarrier, 0, nullptr,
+		static_cast<uint32_t>(m_BarrierScratch.size()), m_BarrierScratch.data());
+}
+
+bool GP2_RenderGraph::IsWrite(Usage usage)
+{
+	return usage != Usage::Sampled;
+}
+
+bool GP2_RenderGraph::IsDepthFormat(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+VkImageAspectFlags GP2_RenderGraph::GetBarrierAspect(VkFormat format)
+{
+	// layout transitions of combined formats have to name both aspects
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return IsDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+uint32_t GP2_RenderGraph::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(m_VkPhysicalDevice, &memProperties);
+
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find suitable memory type!");
+}
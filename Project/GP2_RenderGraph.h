@@ -0,0 +1,210 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class GP2_RetireQueue;
+
+// Frame graph: passes declare which images they write as attachments or storage and which they sample, and
+// Compile turns that into everything the passes used to hand write. Passes nothing consumes are culled,
+// transient images are placed in shared memory so images with disjoint lifetimes alias, every raster pass
+// gets a render pass and framebuffers, and the barriers and layout transitions between passes are computed
+// once. Execute only replays them around the pass callbacks.
+// The topology is fixed after Compile; work that depends on runtime toggles is skipped with SetPassEnabled
+// or inside the callbacks.
+class GP2_RenderGraph
+{
+public:
+	using ResourceHandle = uint32_t;
+	using PassHandle = uint32_t;
+	using ExecuteFunction = std::function<void(VkCommandBuffer)>;
+
+	// how an imported image is left before the graph runs and how it has to be left after it,
+	// stages 0 means whoever else uses the image synchronizes with the graph's work themselves
+	struct ImageState {
+		VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkPipelineStageFlags stages{ 0 };
+		VkAccessFlags access{ 0 };
+	};
+
+	GP2_RenderGraph() = default;
+	~GP2_RenderGraph() = default;
+
+	GP2_RenderGraph(const GP2_RenderGraph&) = delete;
+	GP2_RenderGraph& operator=(const GP2_RenderGraph&) = delete;
+
+	void Initialize(const VulkanContext& context);
+	// also forgets every pass and resource, the graph can be declared again afterwards
+	void Destroy();
+	// same, but the vulkan objects are only destroyed once frames still executing the graph are done
+	void Retire(GP2_RetireQueue& retireQueue);
+
+	// owned by the graph, contents don't survive from one frame to the next
+	ResourceHandle CreateImage(const std::string& name, VkFormat format, VkExtent2D extent);
+	// owned by the caller; with more than one image, Execute picks the one at imageIndex. Barriers cover every
+	// mip and layer, the view is only used as an attachment
+	ResourceHandle ImportImage(const std::string& name, const std::vector<VkImage>& images, const std::vector<VkImageView>& views,
+		VkFormat format, VkExtent2D extent, const ImageState& initialState, const ImageState& finalState);
+
+	// passes run in the order they are added
+	PassHandle AddRasterPass(const std::string& name, ExecuteFunction execute);
+	PassHandle AddComputePass(const std::string& name, ExecuteFunction execute);
+	// never culled, for passes whose results leave the graph some other way
+	void SetSideEffects(PassHandle pass);
+
+	// attachments are bound in the order they are declared; without a clear value the contents are loaded
+	void WriteColor(PassHandle pass, ResourceHandle resource);
+	void WriteColor(PassHandle pass, ResourceHandle resource, const VkClearColorValue& clear);
+	void WriteDepth(PassHandle pass, ResourceHandle resource);
+	void WriteDepth(PassHandle pass, ResourceHandle resource, const VkClearDepthStencilValue& clear);
+	// compute passes only, the image is in GENERAL
+	void WriteStorage(PassHandle pass, ResourceHandle resource);
+	// sampled by the fragment shaders of a raster pass or by a compute pass
+	void ReadTexture(PassHandle pass, ResourceHandle resource);
+
+	void Compile();
+
+	// a disabled pass records nothing, its barriers still are so the layouts stay what Compile expects
+	void SetPassEnabled(PassHandle pass, bool enabled);
+	void Execute(VkCommandBuffer cmdBuffer, uint32_t imageIndex);
+
+	// valid after Compile
+	VkRenderPass GetRenderPass(PassHandle pass) const;
+	VkImageView GetView(ResourceHandle resource) const;
+	VkExtent2D GetExtent(ResourceHandle resource) const;
+	bool IsCulled(PassHandle pass) const;
+
+	void PrintStatistics() const;
+
+private:
+	enum class Usage {
+		ColorAttachment,
+		DepthAttachment,
+		Storage,
+		Sampled
+	};
+
+	struct Use {
+		ResourceHandle resource{};
+		Usage usage{ Usage::Sampled };
+		bool clear{ false };
+		VkClearValue clearValue{};
+		// first use of a transient image this frame, whatever it held is thrown away
+		bool discard{ false };
+	};
+
+	struct Resource {
+		std::string name{};
+		VkFormat format{ VK_FORMAT_UNDEFINED };
+		VkExtent2D extent{};
+		bool imported{ false };
+		std::vector<VkImage> images{};
+		std::vector<VkImageView> views{};
+		ImageState initialState{};
+		ImageState finalState{};
+
+		// transient images only, passes are indices of the first and last pass using them
+		VkImageUsageFlags usage{ 0 };
+		bool used{ false };
+		uint32_t firstPass{};
+		uint32_t lastPass{};
+		VkMemoryRequirements requirements{};
+		uint32_t block{};
+		VkDeviceSize offset{};
+	};
+
+	struct Barrier {
+		ResourceHandle resource{};
+		VkImageLayout oldLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkImageLayout newLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkAccessFlags srcAccess{ 0 };
+		VkAccessFlags dstAccess{ 0 };
+	};
+
+	// one vkCmdPipelineBarrier, the memory barrier covers writes to aliased memory of other images
+	struct BarrierBatch {
+		VkPipelineStageFlags srcStages{ 0 };
+		VkPipelineStageFlags dstStages{ 0 };
+		VkAccessFlags memorySrcAccess{ 0 };
+		VkAccessFlags memoryDstAccess{ 0 };
+		std::vector<Barrier> barriers{};
+	};
+
+	struct Pass {
+		std::string name{};
+		bool compute{ false };
+		ExecuteFunction execute{};
+		bool sideEffects{ false };
+		std::vector<Use> uses{};
+
+		bool culled{ false };
+		bool enabled{ true };
+		BarrierBatch barriers{};
+
+		VkRenderPass renderPass{ VK_NULL_HANDLE };
+		std::vector<VkFramebuffer> framebuffers{};
+		VkExtent2D extent{};
+		std::vector<VkClearValue> clearValues{};
+	};
+
+	struct MemoryBlock {
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkDeviceSize size{ 0 };
+		uint32_t memoryType{};
+	};
+
+	// what the barriers have to wait for, per image while they are computed
+	struct TrackedState {
+		VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkPipelineStageFlags writeStages{ 0 };
+		VkAccessFlags writeAccess{ 0 };
+		// stages that already see the last write
+		VkPipelineStageFlags readStages{ 0 };
+	};
+
+	// everything Compile created, handed out so it can outlive the declarations
+	struct VulkanObjects {
+		std::vector<VkFramebuffer> framebuffers{};
+		std::vector<VkRenderPass> renderPasses{};
+		std::vector<VkImageView> views{};
+		std::vector<VkImage> images{};
+		std::vector<VkDeviceMemory> memory{};
+	};
+
+	VulkanObjects TakeObjects();
+	static void DestroyObjects(VkDevice device, const VulkanObjects& objects);
+
+	void AddUse(PassHandle pass, ResourceHandle resource, Usage usage, const VkClearValue* clear);
+
+	void CullPasses();
+	void ComputeLifetimes();
+	void CreateTransientImages();
+	void PlaceTransientImages();
+	void CompileBarriers(std::vector<TrackedState>& states, std::vector<BarrierBatch>& passBatches, BarrierBatch& finalBatch) const;
+	void CreateRenderPass(uint32_t passIndex);
+
+	bool AliasesMemory(const Resource& first, const Resource& second) const;
+	void GetUsageState(const Pass& pass, const Use& use, VkImageLayout& layout, VkPipelineStageFlags& stages, VkAccessFlags& access) const;
+	void RecordBarriers(VkCommandBuffer cmdBuffer, const BarrierBatch& batch, uint32_t imageIndex);
+
+	static bool IsWrite(Usage usage);
+	static bool IsDepthFormat(VkFormat format);
+	static VkImageAspectFlags GetBarrierAspect(VkFormat format);
+
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+	VkDevice m_VkDevice{ VK_NULL_HANDLE };
+	VkPhysicalDevice m_VkPhysicalDevice{ VK_NULL_HANDLE };
+
+	std::vector<Resource> m_Resources{};
+	std::vector<Pass> m_Passes{};
+	std::vector<MemoryBlock> m_MemoryBlocks{};
+	// imported images are handed back in their final layout after the last pass
+	BarrierBatch m_FinalBarriers{};
+	bool m_IsCompiled{ false };
+
+	std::vector<VkImageMemoryBarrier> m_BarrierScratch{};
+};
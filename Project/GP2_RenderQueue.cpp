@@ -0,0 +1,65 @@
+#include "GP2_RenderQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+void GP2_RenderQueue::Clear()
+{
+	m_Entries.clear();
+}
+
+void GP2_RenderQueue::Push(uint32_t pipelineId, float viewDepth, uint32_t payload)
+{
+	const float normalizedDepth = std::clamp((viewDepth - m_NearPlane) / (m_FarPlane - m_NearPlane), 0.f, 1.f);
+	const uint32_t depth = static_cast<uint32_t>(static_cast<double>(normalizedDepth) * UINT32_MAX);
+
+	// logarithmic, so the buckets near the camera where overdraw matters most stay narrow
+	const float clampedDepth = std::clamp(viewDepth, m_NearPlane, m_FarPlane);
+	const float logDepth = std::log(clampedDepth / m_NearPlane) / std::log(m_FarPlane / m_NearPlane);
+	const uint32_t depthBucket = static_cast<uint32_t>(logDepth * 0xFF);
+
+	m_Entries.push_back(Entry{ MakeKey(depthBucket, pipelineId, depth), payload });
+}
+
+void GP2_RenderQueue::Sort()
+{
+	// lsd radix sort, one byte per pass; passes where every key has the same byte are skipped, which is
+	// most of the pipeline bytes in a typical frame
+	m_SortBuffer.resize(m_Entries.size());
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		std::array<size_t, 256> counts{};
+		for (const Entry& entry : m_Entries)
+			++counts[(entry.key >> shift) & 0xFF];
+
+		if (std::find(counts.begin(), counts.end(), m_Entries.size()) != counts.end())
+			continue;
+
+		size_t offset = 0;
+		for (size_t& count : counts)
+		{
+			const size_t bucketSize = count;
+			count = offset;
+			offset += bucketSize;
+		}
+
+		for (const Entry& entry : m_Entries)
+			m_SortBuffer[counts[(entry.key >> shift) & 0xFF]++] = entry;
+
+		m_Entries.swap(m_SortBuffer);
+	}
+}
+
+uint64_t GP2_RenderQueue::MakeKey(uint32_t depthBucket, uint32_t pipelineId, uint32_t depth)
+{
+	return (static_cast<uint64_t>(depthBucket & 0xFF) << 56) | (static_cast<uint64_t>(pipelineId & 0xFFFFFF) << 32) | depth;
+}
+
+float GP2_RenderQueue::GetViewDepth(const glm::mat4& view, const glm::vec4& sphere)
+{
+	// the camera looks down -z in view space
+	const float centerDepth = -(view * glm::vec4(glm::vec3(sphere), 1.f)).z;
+	return centerDepth - sphere.w;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+// Collects the visible draws of a frame as 64-bit sort keys and orders them with a radix sort. From the most
+// significant bit down a key holds a coarse depth bucket (8 bits, logarithmic between the near and far plane),
+// the pipeline id (24 bits) and the linear view depth (32 bits). Opaque draws go front to back bucket by
+// bucket, across pipelines, and within a bucket they are grouped by pipeline and again ordered front to back.
+// There is no material field: every pipeline owns exactly one texture set, so the pipeline id already
+// identifies the bound state.
+class GP2_RenderQueue
+{
+public:
+	struct Entry
+	{
+		uint64_t key;
+		// meaning is up to the pipeline that queued the draw, e.g. a mesh index
+		uint32_t payload;
+	};
+
+	GP2_RenderQueue() = default;
+	~GP2_RenderQueue() = default;
+
+	void Clear();
+	void Push(uint32_t pipelineId, float viewDepth, uint32_t payload);
+	void Sort();
+
+	const std::vector<Entry>& GetEntries() const { return m_Entries; };
+
+	void SetDepthRange(float nearPlane, float farPlane) { m_NearPlane = nearPlane; m_FarPlane = farPlane; };
+
+	static uint64_t MakeKey(uint32_t depthBucket, uint32_t pipelineId, uint32_t depth);
+	static uint32_t GetDepthBucket(uint64_t key) { return static_cast<uint32_t>(key >> 56); };
+	static uint32_t GetPipelineId(uint64_t key) { return static_cast<uint32_t>(key >> 32) & 0xFFFFFF; };
+
+	// distance of the nearest point of a sphere along the camera's view direction
+	static float GetViewDepth(const glm::mat4& view, const glm::vec4& sphere);
+
+private:
+	std::vector<Entry> m_Entries{};
+	std::vector<Entry> m_SortBuffer{};
+
+	float m_NearPlane{ 0.1f };
+	float m_FarPlane{ 100.f };
+};
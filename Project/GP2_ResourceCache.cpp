@@ -0,0 +1,197 @@
+#include "GP2_ResourceCache.h"
+#include "GP2_CpuProfiler.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace
+{
+	void HashCombine(size_t& seed, size_t value)
+	{
+		seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+	}
+
+	template<class T>
+	void HashValue(size_t& seed, const T& value)
+	{
+		HashCombine(seed, std::hash<T>{}(value));
+	}
+
+	bool BindingsEqual(const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+	{
+		return a.binding == b.binding && a.descriptorType == b.descriptorType && a.descriptorCount == b.descriptorCount
+			&& a.stageFlags == b.stageFlags && a.pImmutableSamplers == b.pImmutableSamplers;
+	}
+
+	bool PushConstantRangesEqual(const VkPushConstantRange& a, const VkPushConstantRange& b)
+	{
+		return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+	}
+}
+
+bool GP2_DescriptorSetLayoutKey::operator==(const GP2_DescriptorSetLayoutKey& other) const
+{
+	return std::equal(bindings.begin(), bindings.end(), other.bindings.begin(), other.bindings.end(), BindingsEqual);
+}
+
+bool GP2_PipelineLayoutKey::operator==(const GP2_PipelineLayoutKey& other) const
+{
+	return setLayouts == other.setLayouts &&
+		std::equal(pushConstantRanges.begin(), pushConstantRanges.end(), other.pushConstantRanges.begin(), other.pushConstantRanges.end(), PushConstantRangesEqual);
+}
+
+bool GP2_SamplerKey::operator==(const GP2_SamplerKey& other) const
+{
+	const VkSamplerCreateInfo& a = info;
+	const VkSamplerCreateInfo& b = other.info;
+
+	return a.flags == b.flags && a.magFilter == b.magFilter && a.minFilter == b.minFilter && a.mipmapMode == b.mipmapMode
+		&& a.addressModeU == b.addressModeU && a.addressModeV == b.addressModeV && a.addressModeW == b.addressModeW
+		&& a.mipLodBias == b.mipLodBias && a.anisotropyEnable == b.anisotropyEnable && a.maxAnisotropy == b.maxAnisotropy
+		&& a.compareEnable == b.compareEnable && a.compareOp == b.compareOp && a.minLod == b.minLod && a.maxLod == b.maxLod
+		&& a.borderColor == b.borderColor && a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
+
+size_t GP2_ResourceCacheHash::operator()(const GP2_DescriptorSetLayoutKey& key) const
+{
+	size_t seed = key.bindings.size();
+	for (const auto& binding : key.bindings)
+	{
+		HashValue(seed, binding.binding);
+		HashValue(seed, static_cast<uint32_t>(binding.descriptorType));
+		HashValue(seed, binding.descriptorCount);
+		HashValue(seed, binding.stageFlags);
+	}
+	return seed;
+}
+
+size_t GP2_ResourceCacheHash::operator()(const GP2_PipelineLayoutKey& key) const
+{
+	size_t seed = key.setLayouts.size();
+	for (VkDescriptorSetLayout layout : key.setLayouts)
+	{
+		HashValue(seed, layout);
+	}
+	for (const auto& range : key.pushConstantRanges)
+	{
+		HashValue(seed, range.stageFlags);
+		HashValue(seed, range.offset);
+		HashValue(seed, range.size);
+	}
+	return seed;
+}
+
+size_t GP2_ResourceCacheHash::operator()(const GP2_SamplerKey& key) const
+{
+	const VkSamplerCreateInfo& info = key.info;
+
+	size_t seed = 0;
+	HashValue(seed, static_cast<uint32_t>(info.magFilter));
+	HashValue(seed, static_cast<uint32_t>(info.minFilter));
+	HashValue(seed, static_cast<uint32_t>(info.mipmapMode));
+	HashValue(seed, static_cast<uint32_t>(info.addressModeU));
+	HashValue(seed, static_cast<uint32_t>(info.addressModeV));
+	HashValue(seed, static_cast<uint32_t>(info.addressModeW));
+	HashValue(seed, info.anisotropyEnable);
+	HashValue(seed, info.maxAnisotropy);
+	HashValue(seed, info.compareEnable);
+	HashValue(seed, static_cast<uint32_t>(info.compareOp));
+	HashValue(seed, info.minLod);
+	HashValue(seed, info.maxLod);
+	return seed;
+}
+
+void GP2_ResourceCache::Initialize(VkDevice device)
+{
+	GP2_CPU_ZONE("GP2_ResourceCache::Initialize");
+	m_VkDevice = device;
+}
+
+void GP2_ResourceCache::Destroy()
+{
+	for (auto& layout : m_PipelineLayouts)
+	{
+		vkDestroyPipelineLayout(m_VkDevice, layout.second, nullptr);
+	}
+	m_PipelineLayouts.clear();
+
+	for (auto& layout : m_DescriptorSetLayouts)
+	{
+		vkDestroyDescriptorSetLayout(m_VkDevice, layout.second, nullptr);
+	}
+	m_DescriptorSetLayouts.clear();
+
+	for (auto& sampler : m_Samplers)
+	{
+		vkDestroySampler(m_VkDevice, sampler.second, nullptr);
+	}
+	m_Samplers.clear();
+}
+
+VkDescriptorSetLayout GP2_ResourceCache::GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	GP2_DescriptorSetLayoutKey key{ bindings };
+	std::sort(key.bindings.begin(), key.bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+		return a.binding < b.binding;
+		});
+
+	auto it = m_DescriptorSetLayouts.find(key);
+	if (it != m_DescriptorSetLayouts.end())
+		return it->second;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+	layoutInfo.pBindings = key.bindings.data();
+
+	VkDescriptorSetLayout layout;
+	if (vkCreateDescriptorSetLayout(m_VkDevice, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor set layout");
+	}
+
+	m_DescriptorSetLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+VkPipelineLayout GP2_ResourceCache::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+	GP2_PipelineLayoutKey key{ setLayouts, pushConstantRanges };
+
+	auto it = m_PipelineLayouts.find(key);
+	if (it != m_PipelineLayouts.end())
+		return it->second;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(key.setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = key.setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(key.pushConstantRanges.size());
+	pipelineLayoutInfo.pPushConstantRanges = key.pushConstantRanges.data();
+
+	VkPipelineLayout layout;
+	if (vkCreatePipelineLayout(m_VkDevice, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+
+	m_PipelineLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+VkSampler GP2_ResourceCache::GetSampler(const VkSamplerCreateInfo& samplerInfo)
+{
+	GP2_SamplerKey key{ samplerInfo };
+	key.info.pNext = nullptr;
+
+	auto it = m_Samplers.find(key);
+	if (it != m_Samplers.end())
+		return it->second;
+
+	VkSampler sampler;
+	if (vkCreateSampler(m_VkDevice, &key.info, nullptr, &sampler) != VK_SUCCESS)
+		throw std::runtime_error("failed to create texture sampler!");
+
+	m_Samplers.emplace(key, sampler);
+	return sampler;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+
+#include <vector>
+#include <unordered_map>
+
+// Layouts, pipeline layouts and samplers are immutable, so identical create infos can share one object.
+// The cache owns everything it hands out; callers must not destroy the returned handles.
+
+struct GP2_DescriptorSetLayoutKey
+{
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+	bool operator==(const GP2_DescriptorSetLayoutKey& other) const;
+};
+
+struct GP2_PipelineLayoutKey
+{
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	std::vector<VkPushConstantRange> pushConstantRanges;
+
+	bool operator==(const GP2_PipelineLayoutKey& other) const;
+};
+
+struct GP2_SamplerKey
+{
+	VkSamplerCreateInfo info;
+
+	bool operator==(const GP2_SamplerKey& other) const;
+};
+
+struct GP2_ResourceCacheHash
+{
+	size_t operator()(const GP2_DescriptorSetLayoutKey& key) const;
+	size_t operator()(const GP2_PipelineLayoutKey& key) const;
+	size_t operator()(const GP2_SamplerKey& key) const;
+};
+
+class GP2_ResourceCache
+{
+public:
+	GP2_ResourceCache() = default;
+	~GP2_ResourceCache() = default;
+
+	GP2_ResourceCache(const GP2_ResourceCache&) = delete;
+	GP2_ResourceCache& operator=(const GP2_ResourceCache&) = delete;
+
+	void Initialize(VkDevice device);
+	void Destroy();
+
+	VkDescriptorSetLayout GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+	VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+	VkSampler GetSampler(const VkSamplerCreateInfo& samplerInfo);
+
+private:
+	VkDevice m_VkDevice{ VK_NULL_HANDLE };
+
+	std::unordered_map<GP2_DescriptorSetLayoutKey, VkDescriptorSetLayout, GP2_ResourceCacheHash> m_DescriptorSetLayouts{};
+	std::unordered_map<GP2_PipelineLayoutKey, VkPipelineLayout, GP2_ResourceCacheHash> m_PipelineLayouts{};
+	std::unordered_map<GP2_SamplerKey, VkSampler, GP2_ResourceCacheHash> m_Samplers{};
+};
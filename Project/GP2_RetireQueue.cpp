@@ -0,0 +1,35 @@
+#include "GP2_RetireQueue.h"
+
+#include <utility>
+
+void GP2_RetireQueue::Initialize(uint32_t framesInFlight)
+{
+	m_FramesInFlight = framesInFlight;
+	m_Frame = 0;
+}
+
+void GP2_RetireQueue::Destroy()
+{
+	for (Entry& entry : m_Entries)
+	{
+		entry.destroy();
+	}
+	m_Entries.clear();
+}
+
+void GP2_RetireQueue::Push(std::function<void()> destroy)
+{
+	m_Entries.push_back(Entry{ m_Frame, std::move(destroy) });
+}
+
+void GP2_RetireQueue::BeginFrame()
+{
+	++m_Frame;
+
+	// the fence just waited on belongs to the frame framesInFlight frames back, anything pushed up to then is unused
+	while (!m_Entries.empty() && m_Entries.front().frame + m_FramesInFlight <= m_Frame)
+	{
+		m_Entries.front().destroy();
+		m_Entries.pop_front();
+	}
+}
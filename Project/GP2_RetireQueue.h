@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// Deferred destruction for resources that are replaced while frames using them may still be in flight. Push
+// tags the work with the current frame; BeginFrame, called right after the wait on the frame's fence, runs
+// everything pushed at least framesInFlight frames ago, which the gpu is done with by then. Nothing here
+// waits for the device to go idle.
+class GP2_RetireQueue
+{
+public:
+	GP2_RetireQueue() = default;
+	~GP2_RetireQueue() = default;
+
+	GP2_RetireQueue(const GP2_RetireQueue&) = delete;
+	GP2_RetireQueue& operator=(const GP2_RetireQueue&) = delete;
+
+	void Initialize(uint32_t framesInFlight);
+	// runs everything still queued, only once the device is idle
+	void Destroy();
+
+	void Push(std::function<void()> destroy);
+	void BeginFrame();
+
+	size_t GetPendingCount() const { return m_Entries.size(); };
+
+private:
+	struct Entry {
+		uint64_t frame;
+		std::function<void()> destroy;
+	};
+
+	uint32_t m_FramesInFlight{ 1 };
+	uint64_t m_Frame{ 0 };
+	// pushed in frame order, so the ones that can go are always at the front
+	std::deque<Entry> m_Entries{};
+};
@@ -2,8 +2,10 @@
 #include <vulkan/vulkan_core.h>
 #include <vector>
 #include <string>
+#include <array>
 
 #include "GP2_Vertex.h"
+#include "GP2_CpuProfiler.h"
 
 template<class Vertex>
 class GP2_Shader final
@@ -37,7 +39,7 @@ private:
 	std::string m_VertexShaderFile;
 	std::string m_FragmentShaderFile;
 
-	VkVertexInputBindingDescription m_BindingDescription{};
+	std::array<VkVertexInputBindingDescription, 2> m_BindingDescriptions{};
 	VkVertexInputAttributeDescription* m_AttributeDescriptions{};
 	uint32_t m_AttributeCount{};
 
@@ -49,14 +51,19 @@ private:
 template<class Vertex>
 void GP2_Shader<Vertex>::Initialize(const VkDevice& vkDevice)
 {
+	GP2_CPU_ZONE("GP2_Shader::Initialize");
 	m_Device = vkDevice;
 
-	m_BindingDescription = Vertex::GetBindingDescription();
+	// binding 0 is the mesh's vertices, binding 1 the per-instance transforms
+	m_BindingDescriptions[0] = Vertex::GetBindingDescription();
+	m_BindingDescriptions[1] = GP2_InstanceData::GetBindingDescription();
 
 	auto attriDescriptions = Vertex::GetAttributeDescriptions();
-	m_AttributeCount = static_cast<uint32_t>(attriDescriptions.size());
+	auto instanceDescriptions = GP2_InstanceData::GetAttributeDescriptions();
+	m_AttributeCount = static_cast<uint32_t>(attriDescriptions.size() + instanceDescriptions.size());
 	m_AttributeDescriptions = new VkVertexInputAttributeDescription[m_AttributeCount];
 	std::copy(attriDescriptions.begin(), attriDescriptions.end(), m_AttributeDescriptions);
+	std::copy(instanceDescriptions.begin(), instanceDescriptions.end(), m_AttributeDescriptions + attriDescriptions.size());
 
 	m_ShaderStages.push_back(CreateVertexShaderInfo());
 	m_ShaderStages.push_back(CreateFragmentShaderInfo());
@@ -78,9 +85,9 @@ VkPipelineVertexInputStateCreateInfo GP2_Shader<Vertex>::CreateVertexInputStateI
 {
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(m_BindingDescriptions.size());
 	vertexInputInfo.vertexAttributeDescriptionCount = m_AttributeCount;
-	vertexInputInfo.pVertexBindingDescriptions = &m_BindingDescription;
+	vertexInputInfo.pVertexBindingDescriptions = m_BindingDescriptions.data();
 	vertexInputInfo.pVertexAttributeDescriptions = m_AttributeDescriptions;
 	return vertexInputInfo;
 }
@@ -0,0 +1,547 @@
+#include "GP2_ShadowCascades.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_Buffer.h"
+#include "GP2_DepthBuffer.h"
+#include "GP2_ResourceCache.h"
+#include "GP2_DescriptorAllocator.h"
+#include "GP2_UploadBatch.h"
+#include "GP2_Vertex.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+GP2_ShadowCascades::GP2_ShadowCascades(const std::string& vertexShaderFile) :
+	m_VertexShaderFile(vertexShaderFile)
+{ }
+
+void GP2_ShadowCascades::Initialize(const VulkanContext& context, const Settings& settings, GP2_UploadBatch& uploadBatch)
+{
+	GP2_CPU_ZONE("GP2_ShadowCascades::Initialize");
+	m_VkDevice = context.device;
+	m_VkPhysicalDevice = context.physicalDevice;
+
+	m_Settings = settings;
+	m_Settings.cascadeCount = std::clamp(m_Settings.cascadeCount, 1u, MaxCascades);
+	m_Settings.resolution = (std::max)(m_Settings.resolution, 1u);
+
+	CreateImage();
+	CreateRenderPass();
+	CreateFramebuffers();
+
+	// with shadows disabled or nothing to cast, Record never renders and the render pass never moves the array
+	uploadBatch.AddTransition(m_Image, { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, m_Settings.cascadeCount }, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+		VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+	m_ParamsBuffer = new GP2_Buffer{ context, sizeof(ShadowParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+	m_ParamsBuffer->MapMemory(&m_MappedParams);
+
+	CreateDescriptorSet(context);
+	CreatePipeline(context);
+
+	// nothing is shadowed until the first Update
+	ShadowParams params{};
+	memcpy(m_MappedParams, &params, sizeof(params));
+}
+
+void GP2_ShadowCascades::Destroy()
+{
+	vkDestroyPipeline(m_VkDevice, m_Pipeline, nullptr);
+	m_Pipeline = VK_NULL_HANDLE;
+
+	for (VkFramebuffer framebuffer : m_Framebuffers)
+		vkDestroyFramebuffer(m_VkDevice, framebuffer, nullptr);
+	m_Framebuffers.clear();
+
+	vkDestroyRenderPass(m_VkDevice, m_RenderPass, nullptr);
+	m_RenderPass = VK_NULL_HANDLE;
+
+	for (VkImageView view : m_LayerViews)
+		vkDestroyImageView(m_VkDevice, view, nullptr);
+	m_LayerViews.clear();
+
+	vkDestroyImageView(m_VkDevice, m_ArrayView, nullptr);
+	vkDestroyImage(m_VkDevice, m_Image, nullptr);
+	vkFreeMemory(m_VkDevice, m_ImageMemory, nullptr);
+	m_ArrayView = VK_NULL_HANDLE;
+	m_Image = VK_NULL_HANDLE;
+	m_ImageMemory = VK_NULL_HANDLE;
+
+	if (m_ParamsBuffer != nullptr)
+	{
+		m_ParamsBuffer->Destroy();
+		delete m_ParamsBuffer;
+		m_ParamsBuffer = nullptr;
+	}
+	m_MappedParams = nullptr;
+}
+
+void GP2_ShadowCascades::SetCasters(const std::vector<GP2_CullObject>& casters)
+{
+	m_Culler.Clear();
+	m_CasterCommands.clear();
+	m_CasterCommands.reserve(casters.size());
+
+	// the arena stores one cull object per instance, in instance order
+	for (const GP2_CullObject& caster : casters)
+	{
+		m_Culler.AddSphere(caster.sphere);
+		m_CasterCommands.push_back(caster.commandIndex);
+	}
+}
+
+void GP2_ShadowCascades::Update(const UniformBufferObject& camera, float nearPlane, float farPlane, const glm::vec3& lightDirection)
+{
+	const uint32_t cascadeCount = m_Settings.cascadeCount;
+	const float shadowFar = (std::min)(farPlane, m_Settings.shadowDistance);
+	const float resolution = static_cast<float>(m_Settings.resolution);
+
+	ShadowParams params{};
+	params.settings = glm::vec4{ m_Enabled ? static_cast<float>(cascadeCount) : 0.f, 1.f / resolution, static_cast<float>(m_Settings.pcfRadius), 0.f };
+
+	// rays through the frustum corners, scaled so their view depth is 1
+	const glm::mat4 inverseProjection = glm::inverse(camera.proj);
+	const glm::mat4 inverseView = glm::inverse(camera.view);
+	std::array<glm::vec3, 4> cornerRays{};
+	for (uint32_t idx = 0; idx < 4; ++idx)
+	{
+		const glm::vec4 ndc{ (idx & 1) ? 1.f : -1.f, (idx & 2) ? 1.f : -1.f, 1.f, 1.f };
+		const glm::vec4 corner = inverseProjection * ndc;
+		cornerRays[idx] = glm::vec3{ corner } / -corner.z;
+	}
+
+	const glm::vec3 toLight = glm::normalize(lightDirection);
+	const glm::vec3 up = std::abs(toLight.y) > 0.99f ? glm::vec3{ 0.f, 0.f, 1.f } : glm::vec3{ 0.f, 1.f, 0.f };
+
+	// glm produces a -1..1 depth range, vulkan expects 0..1
+	glm::mat4 clipCorrection{ 1.f };
+	clipCorrection[2][2] = 0.5f;
+	clipCorrection[3][2] = 0.5f;
+
+	float splitNear = nearPlane;
+	for (uint32_t cascade = 0; cascade < cascadeCount; ++cascade)
+	{
+		const float ratio = static_cast<float>(cascade + 1) / cascadeCount;
+		const float logSplit = nearPlane * std::pow(shadowFar / nearPlane, ratio);
+		const float uniformSplit = nearPlane + (shadowFar - nearPlane) * ratio;
+		const float splitFar = m_Settings.splitLambda * logSplit + (1.f - m_Settings.splitLambda) * uniformSplit;
+
+		std::array<glm::vec3, 8> corners{};
+		glm::vec3 center{ 0.f };
+		for (uint32_t idx = 0; idx < 4; ++idx)
+		{
+			corners[idx] = glm::vec3{ inverseView * glm::vec4{ cornerRays[idx] * splitNear, 1.f } };
+			corners[idx + 4] = glm::vec3{ inverseView * glm::vec4{ cornerRays[idx] * splitFar, 1.f } };
+			center += corners[idx] + corners[idx + 4];
+		}
+		center /= 8.f;
+
+		// a sphere keeps the cascade the same size however the camera rotates, rounding it keeps it stable
+		float radius = 0.f;
+		for (const glm::vec3& corner : corners)
+			radius = (std::max)(radius, glm::length(corner - center));
+		radius = std::ceil(radius * 16.f) / 16.f;
+
+		// casters between the light and the cascade are kept by pulling the near plane towards the light
+		const glm::mat4 lightView = glm::lookAt(center + toLight * radius, center, up);
+		glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, -m_Settings.shadowDistance, 2.f * radius);
+
+		// move the projection so the world origin lands on a texel corner, the cascade then only moves in whole texels
+		const glm::vec4 origin = lightProjection * lightView * glm::vec4{ 0.f, 0.f, 0.f, 1.f };
+		const glm::vec2 originTexels = glm::vec2{ origin } * (resolution * 0.5f);
+		const glm::vec2 snapOffset = (glm::round(originTexels) - originTexels) * (2.f / resolution);
+		lightProjection[3][0] += snapOffset.x;
+		lightProjection[3][1] += snapOffset.y;
+
+		m_CascadeViewProjection[cascade] = clipCorrection * lightProjection * lightView;
+		params.cascadeViewProjection[cascade] = m_CascadeViewProjection[cascade];
+		params.splitDepths[cascade] = splitFar;
+		params.texelWorldSizes[cascade] = 2.f * radius / resolution;
+
+		// runs of consecutive visible instances of the same command become one instanced draw
+		std::vector<CasterRun>& runs = m_CasterRuns[cascade];
+		runs.clear();
+		m_Culler.Cull(m_CascadeViewProjection[cascade], m_Visible);
+		for (uint32_t instance : m_Visible)
+		{
+			const uint32_t commandIndex = m_CasterCommands[instance];
+			if (!runs.empty() && runs.back().commandIndex == commandIndex && runs.back().firstInstance + runs.back().instanceCount == instance)
+				++runs.back().instanceCount;
+			else
+				runs.push_back(CasterRun{ commandIndex, instance, 1 });
+		}
+
+		splitNear = splitFar;
+	}
+
+	memcpy(m_MappedParams, &params, sizeof(params));
+}
+
+void GP2_ShadowCascades::BindDescriptorSet(VkCommandBuffer cmdBuffer, VkPipelineLayout layout, uint32_t setIndex) const
+{
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, setIndex, 1, &m_DescriptorSet, 0, nullptr);
+}
+
+void GP2_ShadowCascades::BeginCascade(VkCommandBuffer cmdBuffer, uint32_t cascade) const
+{
+	const VkExtent2D extent{ m_Settings.resolution, m_Settings.resolution };
+
+	VkClearValue clearValue{};
+	clearValue.depthStencil = { 1.f, 0 };
+
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = m_RenderPass;
+	renderPassInfo.framebuffer = m_Framebuffers[cascade];
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = extent;
+	renderPassInfo.clearValueCount = 1;
+	renderPassInfo.pClearValues = &clearValue;
+
+	vkCmdBeginRenderPass(cmdBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
+
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)extent.width;
+	viewport.height = (float)extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = extent;
+	vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+	vkCmdPushConstants(cmdBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &m_CascadeViewProjection[cascade]);
+}
+
+void GP2_ShadowCascades::EndCascade(VkCommandBuffer cmdBuffer) const
+{
+	vkCmdEndRenderPass(cmdBuffer);
+}
+
+void GP2_ShadowCascades::CreateImage()
+{
+	m_Format = findSupportedFormat(m_VkPhysicalDevice, { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM },
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = m_Settings.resolution;
+	imageInfo.extent.height = m_Settings.resolution;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = m_Settings.cascadeCount;
+	imageInfo.format = m_Format;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+	if (vkCreateImage(m_VkDevice, &imageInfo, nullptr, &m_Image) != VK_SUCCESS)
+		throw std::runtime_error("failed to create shadow map image!\n");
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(m_VkDevice, m_Image, &memRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(m_VkDevice, &allocInfo, nullptr, &m_ImageMemory) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate shadow map image memory\n");
+
+	vkBindImageMemory(m_VkDevice, m_Image, m_ImageMemory, 0);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = m_Image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+	viewInfo.format = m_Format;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = m_Settings.cascadeCount;
+
+	if (vkCreateImageView(m_VkDevice, &viewInfo, nullptr, &m_ArrayView) != VK_SUCCESS)
+		throw std::runtime_error("failed to create shadow map image view!");
+
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.subresourceRange.layerCount = 1;
+	m_LayerViews.resize(m_Settings.cascadeCount);
+	for (uint32_t layer = 0; layer < m_Settings.cascadeCount; ++layer)
+	{
+		viewInfo.subresourceRange.baseArrayLayer = layer;
+		if (vkCreateImageView(m_VkDevice, &viewInfo, nullptr, &m_LayerViews[layer]) != VK_SUCCESS)
+			throw std::runtime_error("failed to create shadow map image view!");
+	}
+}
+
+void GP2_ShadowCascades::CreateRenderPass()
+{
+	VkAttachmentDescription depthAttachment{};
+	depthAttachment.format = m_Format;
+	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef{};
+	depthAttachmentRef.attachment = 0;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 0;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	// last frame's shading has to be done sampling before the layer is cleared,
+	// and this frame's shading may only sample once the layer is written
+	std::array<VkSubpassDependency, 2> dependencies{};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].srcAccessMask = 0;
+	dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &depthAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	renderPassInfo.pDependencies = dependencies.data();
+
+	if (vkCreateRenderPass(m_VkDevice, &renderPassInfo, nullptr, &m_RenderPass) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create shadow render pass!");
+	}
+}
+
+void GP2_ShadowCascades::CreateFramebuffers()
+{
+	m_Framebuffers.resize(m_LayerViews.size());
+	for (size_t idx = 0; idx < m_LayerViews.size(); ++idx)
+	{
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = m_RenderPass;
+		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.pAttachments = &m_LayerViews[idx];
+		framebufferInfo.width = m_Settings.resolution;
+		framebufferInfo.height = m_Settings.resolution;
+		framebufferInfo.layers = 1;
+
+		if (vkCreateFramebuffer(m_VkDevice, &framebufferInfo, nullptr, &m_Framebuffers[idx]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shadow framebuffer!");
+		}
+	}
+}
+
+void GP2_ShadowCascades::CreateDescriptorSet(const VulkanContext& context)
+{
+	// hardware pcf: every tap compares and bilinearly filters 4 texels, if the format can be filtered
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_VkPhysicalDevice, m_Format, &formatProperties);
+	const VkFilter filter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	// outside of the map counts as lit
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = filter;
+	samplerInfo.minFilter = filter;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	samplerInfo.compareEnable = VK_TRUE;
+	samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	m_Sampler = context.resourceCache->GetSampler(samplerInfo);
+
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings(2);
+	layoutBindings[0].binding = 0;
+	layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	layoutBindings[0].descriptorCount = 1;
+	layoutBindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	layoutBindings[1].binding = 1;
+	layoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	layoutBindings[1].descriptorCount = 1;
+	layoutBindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	m_DescriptorSetLayout = context.resourceCache->GetDescriptorSetLayout(layoutBindings);
+	m_DescriptorSet = context.descriptorAllocator->Allocate(m_DescriptorSetLayout);
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = m_ArrayView;
+	imageInfo.sampler = m_Sampler;
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = m_ParamsBuffer->GetVkBuffer();
+	bufferInfo.offset = 0;
+	bufferInfo.range = VK_WHOLE_SIZE;
+
+	std::array<VkWriteDescriptorSet, 2> writes{};
+	for (uint32_t idx = 0; idx < writes.size(); ++idx)
+	{
+		writes[idx].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[idx].dstSet = m_DescriptorSet;
+		writes[idx].dstBinding = idx;
+		writes[idx].dstArrayElement = 0;
+		writes[idx].descriptorCount = 1;
+		writes[idx].descriptorType = layoutBindings[idx].descriptorType;
+	}
+	writes[0].pImageInfo = &imageInfo;
+	writes[1].pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(m_VkDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void GP2_ShadowCascades::CreatePipeline(const VulkanContext& context)
+{
+	std::vector<VkPushConstantRange> pushConstantRanges(1);
+	pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRanges[0].offset = 0;
+	pushConstantRanges[0].size = sizeof(glm::mat4);
+
+	m_PipelineLayout = context.resourceCache->GetPipelineLayout({}, pushConstantRanges);
+
+	std::vector<char> shaderCode = readFile(m_VertexShaderFile);
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = shaderCode.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(m_VkDevice, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create shader module!");
+	}
+
+	VkPipelineShaderStageCreateInfo vertexStage{};
+	vertexStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vertexStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vertexStage.module = shaderModule;
+	vertexStage.pName = "main";
+
+	// same streams as the depth prepass: the arena's positions and, here, all of its instances
+	std::array<VkVertexInputBindingDescription, 2> bindings{};
+	bindings[0].binding = 0;
+	bindings[0].stride = sizeof(glm::vec3);
+	bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	bindings[1] = GP2_InstanceData::GetBindingDescription();
+
+	std::array<VkVertexInputAttributeDescription, 5> attributes{};
+	attributes[0].binding = 0;
+	attributes[0].location = 0;
+	attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributes[0].offset = 0;
+	const auto instanceAttributes = GP2_InstanceData::GetAttributeDescriptions();
+	std::copy(instanceAttributes.begin(), instanceAttributes.end(), attributes.begin() + 1);
+
+	VkPipelineVertexInputStateCreateInfo vertexInput{};
+	vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+	vertexInput.pVertexBindingDescriptions = bindings.data();
+	vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+	vertexInput.pVertexAttributeDescriptions = attributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	// both faces cast, so thin and open meshes still shadow; the bias keeps lit surfaces from shadowing themselves
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterizer.depthBiasEnable = VK_TRUE;
+	rasterizer.depthBiasConstantFactor = 1.25f;
+	rasterizer.depthBiasSlopeFactor = 1.75f;
+	rasterizer.depthBiasClamp = 0.f;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = 0;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	std::array<VkDynamicState, 2> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 1;
+	pipelineInfo.pStages = &vertexStage;
+	pipelineInfo.pVertexInputState = &vertexInput;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = m_PipelineLayout;
+	pipelineInfo.renderPass = m_RenderPass;
+	pipelineInfo.subpass = 0;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	VkResult result = vkCreateGraphicsPipelines(m_VkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline);
+	vkDestroyShaderModule(m_VkDevice, shaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to create shadow pipeline!");
+	}
+}
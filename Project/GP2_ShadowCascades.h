@@ -0,0 +1,170 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "GP2_FrustumCuller.h"
+#include "GP2_GeometryArena.h"
+#include "GP2_UniformBufferObject.h"
+
+class GP2_Buffer;
+class GP2_UploadBatch;
+
+// Cascaded shadow maps for the directional light. The camera frustum up to the shadow distance is split into
+// cascades (practical split scheme, blending logarithmic and uniform splits), each fitted with a bounding
+// sphere so its size doesn't change as the camera turns, and snapped to whole shadow texels so edges don't
+// shimmer while it moves. Every cascade is one layer of a depth array, rendered with a depth-only pipeline
+// from the pbr arena's position stream. The instances are culled on the cpu per cascade and the visible
+// ones are drawn in runs of consecutive instances.
+//
+// The descriptor set is read by every shader that receives shadows, see shaders/ShadowCascades.glsl:
+//	0 shadow map array with a comparison sampler
+//	1 ShadowParams uniform buffer
+class GP2_ShadowCascades
+{
+public:
+	static constexpr uint32_t MaxCascades{ 4 };
+
+	struct Settings {
+		uint32_t resolution{ 2048 };
+		uint32_t cascadeCount{ 4 };
+		// cascades end here even if the far plane is further away
+		float shadowDistance{ 60.f };
+		// 0 uniform splits, 1 logarithmic splits
+		float splitLambda{ 0.75f };
+		// pcf kernel is (2 * radius + 1)^2 bilinear comparison taps
+		int32_t pcfRadius{ 1 };
+	};
+
+	GP2_ShadowCascades(const std::string& vertexShaderFile);
+	~GP2_ShadowCascades() = default;
+
+	GP2_ShadowCascades(const GP2_ShadowCascades&) = delete;
+	GP2_ShadowCascades& operator=(const GP2_ShadowCascades&) = delete;
+
+	// the array's move to its sampled layout is recorded into the batch, so it is valid to bind before any Record
+	void Initialize(const VulkanContext& context, const Settings& settings, GP2_UploadBatch& uploadBatch);
+	void Destroy();
+
+	// world bounding sphere and draw command of every instance of the arena that casts shadows
+	void SetCasters(const std::vector<GP2_CullObject>& casters);
+
+	// fits the cascades to this frame's camera and culls the casters, the fence must have been waited on
+	void Update(const UniformBufferObject& camera, float nearPlane, float farPlane, const glm::vec3& lightDirection);
+
+	// one depth pass per cascade, outside of a render pass and before any draw that samples the shadows
+	template<class Vertex>
+	void Record(VkCommandBuffer cmdBuffer, const GP2_GeometryArena<Vertex>& arena) const;
+
+	void BindDescriptorSet(VkCommandBuffer cmdBuffer, VkPipelineLayout layout, uint32_t setIndex) const;
+
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_DescriptorSetLayout; };
+
+	// disabled shadows skip the depth passes and the shaders treat everything as lit
+	void SetEnabled(bool enabled) { m_Enabled = enabled; };
+	bool IsEnabled() const { return m_Enabled; };
+
+private:
+	// std140, matches ShadowParams in shaders/ShadowCascades.glsl
+	struct ShadowParams {
+		std::array<glm::mat4, MaxCascades> cascadeViewProjection;
+		// far view depth of every cascade
+		glm::vec4 splitDepths;
+		// world size of one shadow texel per cascade, used for the normal offset
+		glm::vec4 texelWorldSizes;
+		// x cascade count (0 disables the lookup), y shadow texel size in uv, z pcf radius
+		glm::vec4 settings;
+	};
+
+	// consecutive visible instances of one draw command
+	struct CasterRun {
+		uint32_t commandIndex;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+	};
+
+	void CreateImage();
+	void CreateRenderPass();
+	void CreateFramebuffers();
+	void CreateDescriptorSet(const VulkanContext& context);
+	void CreatePipeline(const VulkanContext& context);
+
+	void BeginCascade(VkCommandBuffer cmdBuffer, uint32_t cascade) const;
+	void EndCascade(VkCommandBuffer cmdBuffer) const;
+
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	{
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(m_VkPhysicalDevice, &memProperties);
+
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+	std::string m_VertexShaderFile;
+
+	Settings m_Settings{};
+	bool m_Enabled{ true };
+
+	VkDevice m_VkDevice{ VK_NULL_HANDLE };
+	VkPhysicalDevice m_VkPhysicalDevice{ VK_NULL_HANDLE };
+
+	VkFormat m_Format{ VK_FORMAT_UNDEFINED };
+	VkImage m_Image{ VK_NULL_HANDLE };
+	VkDeviceMemory m_ImageMemory{ VK_NULL_HANDLE };
+	// the array view is sampled, the layer views are rendered to
+	VkImageView m_ArrayView{ VK_NULL_HANDLE };
+	std::vector<VkImageView> m_LayerViews{};
+	std::vector<VkFramebuffer> m_Framebuffers{};
+	VkRenderPass m_RenderPass{ VK_NULL_HANDLE };
+	VkSampler m_Sampler{ VK_NULL_HANDLE };
+
+	VkPipeline m_Pipeline{ VK_NULL_HANDLE };
+	VkPipelineLayout m_PipelineLayout{ VK_NULL_HANDLE };
+
+	GP2_Buffer* m_ParamsBuffer{ nullptr };
+	void* m_MappedParams{ nullptr };
+
+	VkDescriptorSetLayout m_DescriptorSetLayout{ VK_NULL_HANDLE };
+	VkDescriptorSet m_DescriptorSet{ VK_NULL_HANDLE };
+
+	GP2_FrustumCuller m_Culler{};
+	std::vector<uint32_t> m_CasterCommands{};
+	std::vector<uint32_t> m_Visible{};
+
+	std::array<glm::mat4, MaxCascades> m_CascadeViewProjection{};
+	std::array<std::vector<CasterRun>, MaxCascades> m_CasterRuns{};
+};
+
+template<class Vertex>
+void GP2_ShadowCascades::Record(VkCommandBuffer cmdBuffer, const GP2_GeometryArena<Vertex>& arena) const
+{
+	if (!m_Enabled || arena.GetCommandCount() == 0)
+		return;
+
+	for (uint32_t cascade = 0; cascade < m_Settings.cascadeCount; ++cascade)
+	{
+		// the pass also clears the layer, so empty cascades still begin and end it
+		BeginCascade(cmdBuffer, cascade);
+
+		if (!m_CasterRuns[cascade].empty())
+			arena.BindShadowCasters(cmdBuffer);
+
+		for (const CasterRun& run : m_CasterRuns[cascade])
+		{
+			arena.DrawInstances(cmdBuffer, run.commandIndex, run.firstInstance, run.instanceCount);
+		}
+
+		EndCascade(cmdBuffer);
+	}
+}
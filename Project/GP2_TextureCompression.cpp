@@ -0,0 +1,678 @@
+#include "GP2_TextureCompression.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GP2_BC_SSE
+#endif
+
+namespace
+{
+	// dds layout, see the DDS_HEADER and DDS_HEADER_DXT10 documentation
+	struct DDSPixelFormat {
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rBitMask;
+		uint32_t gBitMask;
+		uint32_t bBitMask;
+		uint32_t aBitMask;
+	};
+
+	struct DDSHeader {
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DDSPixelFormat pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DDSHeaderDX10 {
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+	}
+
+	const uint32_t g_DDSMagic{ MakeFourCC('D', 'D', 'S', ' ') };
+	const uint32_t g_DDSFlagsTexture{ 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000 };
+	const uint32_t g_DDSPixelFormatFourCC{ 0x4 };
+	const uint32_t g_DDSCapsTexture{ 0x1000 | 0x400000 | 0x8 };
+	const uint32_t g_DDSResourceTexture2D{ 3 };
+
+	struct DXGIFormat {
+		GP2_TextureFormat format;
+		uint32_t dxgi;
+	};
+
+	const std::array<DXGIFormat, 8> g_DXGIFormats{ {
+		{ GP2_TextureFormat::BC1, 71 },
+		{ GP2_TextureFormat::BC1_SRGB, 72 },
+		{ GP2_TextureFormat::BC3, 77 },
+		{ GP2_TextureFormat::BC3_SRGB, 78 },
+		{ GP2_TextureFormat::BC4, 80 },
+		{ GP2_TextureFormat::BC5, 83 },
+		{ GP2_TextureFormat::BC7, 98 },
+		{ GP2_TextureFormat::BC7_SRGB, 99 }
+	} };
+
+	inline uint16_t To565(int r, int g, int b)
+	{
+		return static_cast<uint16_t>((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+	}
+
+	inline void From565(uint16_t color, int& r, int& g, int& b)
+	{
+		r = (color >> 11) & 31;
+		g = (color >> 5) & 63;
+		b = color & 31;
+		r = (r << 3) | (r >> 2);
+		g = (g << 2) | (g >> 4);
+		b = (b << 3) | (b >> 2);
+	}
+
+	inline void WriteU16(uint8_t* destination, uint16_t value)
+	{
+		destination[0] = static_cast<uint8_t>(value & 0xFF);
+		destination[1] = static_cast<uint8_t>(value >> 8);
+	}
+
+	float SrgbToLinear(uint8_t value)
+	{
+		const float c = value / 255.f;
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	uint8_t LinearToSrgb(float value)
+	{
+		const float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+		return static_cast<uint8_t>(std::clamp(c * 255.f + 0.5f, 0.f, 255.f));
+	}
+
+	const std::array<float, 256> g_SrgbToLinear = []()
+	{
+		std::array<float, 256> table{};
+		for (int idx = 0; idx < 256; ++idx)
+			table[idx] = SrgbToLinear(static_cast<uint8_t>(idx));
+		return table;
+	}();
+}
+
+void GP2_TextureCompression::EncodeBC1Block(const uint8_t* rgba, uint8_t* block)
+{
+	std::array<int, 3> minColor{};
+	std::array<int, 3> maxColor{};
+
+#if defined(GP2_BC_SSE)
+	const __m128i pixels[4] = {
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba)),
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + 16)),
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + 32)),
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + 48))
+	};
+
+	// per channel min and max of 16 pixels, folded down to the lowest pixel of the register
+	__m128i minimum = _mm_min_epu8(_mm_min_epu8(pixels[0], pixels[1]), _mm_min_epu8(pixels[2], pixels[3]));
+	__m128i maximum = _mm_max_epu8(_mm_max_epu8(pixels[0], pixels[1]), _mm_max_epu8(pixels[2], pixels[3]));
+	minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 8));
+	maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 8));
+	minimum = _mm_min_epu8(minimum, _mm_srli_si128(minimum, 4));
+	maximum = _mm_max_epu8(maximum, _mm_srli_si128(maximum, 4));
+
+	const uint32_t minPacked = static_cast<uint32_t>(_mm_cvtsi128_si32(minimum));
+	const uint32_t maxPacked = static_cast<uint32_t>(_mm_cvtsi128_si32(maximum));
+	for (int channel = 0; channel < 3; ++channel)
+	{
+		minColor[channel] = (minPacked >> (8 * channel)) & 0xFF;
+		maxColor[channel] = (maxPacked >> (8 * channel)) & 0xFF;
+	}
+#else
+	minColor = { 255, 255, 255 };
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			minColor[channel] = (std::min)(minColor[channel], int(rgba[pixel * 4 + channel]));
+			maxColor[channel] = (std::max)(maxColor[channel], int(rgba[pixel * 4 + channel]));
+		}
+	}
+#endif
+
+	// the bounding box has four diagonals, the signs of the red/green and blue/green covariance pick the one
+	// that follows the colors
+	std::array<int, 3> mean{};
+	for (int pixel = 0; pixel < 16; ++pixel)
+		for (int channel = 0; channel < 3; ++channel)
+			mean[channel] += rgba[pixel * 4 + channel];
+	for (int& channel : mean)
+		channel = (channel + 8) / 16;
+
+	int covarianceRG = 0;
+	int covarianceBG = 0;
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		const int g = rgba[pixel * 4 + 1] - mean[1];
+		covarianceRG += (rgba[pixel * 4 + 0] - mean[0]) * g;
+		covarianceBG += (rgba[pixel * 4 + 2] - mean[2]) * g;
+	}
+
+	std::array<int, 3> endpoint0 = maxColor;
+	std::array<int, 3> endpoint1 = minColor;
+	if (covarianceRG < 0)
+		std::swap(endpoint0[0], endpoint1[0]);
+	if (covarianceBG < 0)
+		std::swap(endpoint0[2], endpoint1[2]);
+
+	// pulling the endpoints in by 1/16 of the range lowers the average error of the interpolated colors
+	for (int channel = 0; channel < 3; ++channel)
+	{
+		const int inset = (endpoint0[channel] - endpoint1[channel]) / 16;
+		endpoint0[channel] = std::clamp(endpoint0[channel] - inset, 0, 255);
+		endpoint1[channel] = std::clamp(endpoint1[channel] + inset, 0, 255);
+	}
+
+	uint16_t color0 = To565(endpoint0[0], endpoint0[1], endpoint0[2]);
+	uint16_t color1 = To565(endpoint1[0], endpoint1[1], endpoint1[2]);
+
+	// color0 > color1 selects the 4 color mode; equal endpoints make every index 0
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	WriteU16(block, color0);
+	WriteU16(block + 2, color1);
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		int r0, g0, b0, r1, g1, b1;
+		From565(color0, r0, g0, b0);
+		From565(color1, r1, g1, b1);
+
+		const int axisR = r1 - r0;
+		const int axisG = g1 - g0;
+		const int axisB = b1 - b0;
+		const int lengthSquared = axisR * axisR + axisG * axisG + axisB * axisB;
+
+		// projection t along color0 -> color1 rounds to the nearest of the 4 palette colors:
+		// 3t / length^2 crosses 0.5, 1.5 and 2.5, or 6t crosses 1, 3 and 5 length^2
+		std::array<int32_t, 16> steps{};
+
+#if defined(GP2_BC_SSE)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i base = _mm_set_epi16(0, int16_t(b0), int16_t(g0), int16_t(r0), 0, int16_t(b0), int16_t(g0), int16_t(r0));
+		const __m128i axis = _mm_set_epi16(0, int16_t(axisB), int16_t(axisG), int16_t(axisR), 0, int16_t(axisB), int16_t(axisG), int16_t(axisR));
+		const __m128i threshold1 = _mm_set1_epi32(lengthSquared);
+		const __m128i threshold2 = _mm_set1_epi32(3 * lengthSquared);
+		const __m128i threshold3 = _mm_set1_epi32(5 * lengthSquared);
+
+		for (int group = 0; group < 4; ++group)
+		{
+			const __m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(pixels[group], zero), base);
+			const __m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(pixels[group], zero), base);
+
+			// madd leaves r*ar + g*ag and b*ab + a*0 per pixel, the two halves are summed below
+			const __m128 productsLow = _mm_castsi128_ps(_mm_madd_epi16(low, axis));
+			const __m128 productsHigh = _mm_castsi128_ps(_mm_madd_epi16(high, axis));
+			const __m128i even = _mm_castps_si128(_mm_shuffle_ps(productsLow, productsHigh, _MM_SHUFFLE(2, 0, 2, 0)));
+			const __m128i odd = _mm_castps_si128(_mm_shuffle_ps(productsLow, productsHigh, _MM_SHUFFLE(3, 1, 3, 1)));
+			const __m128i t = _mm_add_epi32(even, odd);
+			const __m128i t6 = _mm_add_epi32(_mm_slli_epi32(t, 2), _mm_slli_epi32(t, 1));
+
+			// every passed threshold adds -1
+			__m128i step = _mm_cmpgt_epi32(t6, threshold1);
+			step = _mm_add_epi32(step, _mm_cmpgt_epi32(t6, threshold2));
+			step = _mm_add_epi32(step, _mm_cmpgt_epi32(t6, threshold3));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&steps[group * 4]), _mm_sub_epi32(zero, step));
+		}
+#else
+		for (int pixel = 0; pixel < 16; ++pixel)
+		{
+			const int t = (rgba[pixel * 4 + 0] - r0) * axisR + (rgba[pixel * 4 + 1] - g0) * axisG + (rgba[pixel * 4 + 2] - b0) * axisB;
+			steps[pixel] = (6 * t > lengthSquared) + (6 * t > 3 * lengthSquared) + (6 * t > 5 * lengthSquared);
+		}
+#endif
+
+		// steps from color0 to the bc1 codes: color0, 2/3 color0, 1/3 color0, color1
+		const std::array<uint32_t, 4> stepToCode{ 0, 2, 3, 1 };
+		for (int pixel = 0; pixel < 16; ++pixel)
+			indices |= stepToCode[steps[pixel]] << (2 * pixel);
+	}
+
+	block[4] = static_cast<uint8_t>(indices);
+	block[5] = static_cast<uint8_t>(indices >> 8);
+	block[6] = static_cast<uint8_t>(indices >> 16);
+	block[7] = static_cast<uint8_t>(indices >> 24);
+}
+
+void GP2_TextureCompression::EncodeBC3Block(const uint8_t* rgba, uint8_t* block)
+{
+	std::array<uint8_t, 16> alpha{};
+	for (int pixel = 0; pixel < 16; ++pixel)
+		alpha[pixel] = rgba[pixel * 4 + 3];
+
+	EncodeBC4Block(alpha.data(), block);
+	EncodeBC1Block(rgba, block + 8);
+}
+
+void GP2_TextureCompression::EncodeBC4Block(const uint8_t* values, uint8_t* block)
+{
+	int minimum = 255;
+	int maximum = 0;
+
+#if defined(GP2_BC_SSE)
+	const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+
+	__m128i minimumVector = _mm_min_epu8(samples, _mm_srli_si128(samples, 8));
+	__m128i maximumVector = _mm_max_epu8(samples, _mm_srli_si128(samples, 8));
+	minimumVector = _mm_min_epu8(minimumVector, _mm_srli_si128(minimumVector, 4));
+	maximumVector = _mm_max_epu8(maximumVector, _mm_srli_si128(maximumVector, 4));
+	minimumVector = _mm_min_epu8(minimumVector, _mm_srli_si128(minimumVector, 2));
+	maximumVector = _mm_max_epu8(maximumVector, _mm_srli_si128(maximumVector, 2));
+	minimumVector = _mm_min_epu8(minimumVector, _mm_srli_si128(minimumVector, 1));
+	maximumVector = _mm_max_epu8(maximumVector, _mm_srli_si128(maximumVector, 1));
+
+	minimum = _mm_cvtsi128_si32(minimumVector) & 0xFF;
+	maximum = _mm_cvtsi128_si32(maximumVector) & 0xFF;
+#else
+	for (int idx = 0; idx < 16; ++idx)
+	{
+		minimum = (std::min)(minimum, int(values[idx]));
+		maximum = (std::max)(maximum, int(values[idx]));
+	}
+#endif
+
+	// endpoint0 > endpoint1 selects the 8 value mode; equal endpoints make every index 0
+	block[0] = static_cast<uint8_t>(maximum);
+	block[1] = static_cast<uint8_t>(minimum);
+
+	uint64_t indices = 0;
+	const int range = maximum - minimum;
+	if (range > 0)
+	{
+		// step from the minimum is round(7 (v - min) / range), so 14 (v - min) is compared with odd multiples of range
+		std::array<int16_t, 16> steps{};
+
+#if defined(GP2_BC_SSE)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i base = _mm_set1_epi16(int16_t(minimum));
+		const __m128i fourteen = _mm_set1_epi16(14);
+
+		const __m128i halves[2] = { _mm_unpacklo_epi8(samples, zero), _mm_unpackhi_epi8(samples, zero) };
+		for (int half = 0; half < 2; ++half)
+		{
+			const __m128i scaled = _mm_mullo_epi16(_mm_sub_epi16(halves[half], base), fourteen);
+
+			__m128i step = zero;
+			for (int threshold = 1; threshold < 14; threshold += 2)
+				step = _mm_add_epi16(step, _mm_cmpgt_epi16(scaled, _mm_set1_epi16(int16_t(threshold * range))));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&steps[half * 8]), _mm_sub_epi16(zero, step));
+		}
+#else
+		for (int idx = 0; idx < 16; ++idx)
+		{
+			const int scaled = (values[idx] - minimum) * 14;
+			for (int threshold = 1; threshold < 14; threshold += 2)
+				steps[idx] += scaled > threshold * range;
+		}
+#endif
+
+		// codes count down from the maximum: 0 is endpoint0, 1 endpoint1, 2..7 the interpolated values
+		for (int idx = 0; idx < 16; ++idx)
+		{
+			const int fromMaximum = 7 - steps[idx];
+			const uint64_t code = fromMaximum == 0 ? 0 : (fromMaximum == 7 ? 1 : fromMaximum + 1);
+			indices |= code << (3 * idx);
+		}
+	}
+
+	for (int byte = 0; byte < 6; ++byte)
+		block[2 + byte] = static_cast<uint8_t>(indices >> (8 * byte));
+}
+
+void GP2_TextureCompression::EncodeBC5Block(const uint8_t* rgba, uint8_t* block)
+{
+	std::array<uint8_t, 16> red{};
+	std::array<uint8_t, 16> green{};
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		red[pixel] = rgba[pixel * 4 + 0];
+		green[pixel] = rgba[pixel * 4 + 1];
+	}
+
+	EncodeBC4Block(red.data(), block);
+	EncodeBC4Block(green.data(), block + 8);
+}
+
+GP2_CompressedTexture GP2_TextureCompression::Cook(const uint8_t* rgba, uint32_t width, uint32_t height, GP2_TextureUsage usage)
+{
+	GP2_CompressedTexture texture{};
+	texture.width = width;
+	texture.height = height;
+
+	switch (usage)
+	{
+	case GP2_TextureUsage::Albedo:
+	{
+		bool hasAlpha = false;
+		for (size_t pixel = 0; pixel < size_t(width) * height && !hasAlpha; ++pixel)
+			hasAlpha = rgba[pixel * 4 + 3] < 255;
+		texture.format = hasAlpha ? GP2_TextureFormat::BC3_SRGB : GP2_TextureFormat::BC1_SRGB;
+		break;
+	}
+	case GP2_TextureUsage::Normal:
+	case GP2_TextureUsage::Packed:
+		texture.format = GP2_TextureFormat::BC5;
+		break;
+	case GP2_TextureUsage::Mask:
+		texture.format = GP2_TextureFormat::BC4;
+		break;
+	}
+
+	const std::vector<std::vector<uint8_t>> levels = BuildMipChain(rgba, width, height, usage);
+	for (uint32_t level = 0; level < levels.size(); ++level)
+	{
+		texture.mips.push_back(Compress(levels[level].data(), GetMipDimension(width, level), GetMipDimension(height, level), texture.format));
+	}
+
+	return texture;
+}
+
+std::vector<uint8_t> GP2_TextureCompression::Compress(const uint8_t* rgba, uint32_t width, uint32_t height, GP2_TextureFormat format)
+{
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+	const uint32_t blockSize = GetBlockSize(format);
+
+	std::vector<uint8_t> blocks(size_t(blocksX) * blocksY * blockSize);
+	std::array<uint8_t, 64> pixels{};
+	std::array<uint8_t, 16> red{};
+
+	for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+		{
+			for (uint32_t y = 0; y < 4; ++y)
+			{
+				const uint32_t sourceY = (std::min)(blockY * 4 + y, height - 1);
+				for (uint32_t x = 0; x < 4; ++x)
+				{
+					const uint32_t sourceX = (std::min)(blockX * 4 + x, width - 1);
+					memcpy(&pixels[(y * 4 + x) * 4], &rgba[(size_t(sourceY) * width + sourceX) * 4], 4);
+				}
+			}
+
+			uint8_t* block = &blocks[(size_t(blockY) * blocksX + blockX) * blockSize];
+			switch (format)
+			{
+			case GP2_TextureFormat::BC1:
+			case GP2_TextureFormat::BC1_SRGB:
+				EncodeBC1Block(pixels.data(), block);
+				break;
+			case GP2_TextureFormat::BC3:
+			case GP2_TextureFormat::BC3_SRGB:
+				EncodeBC3Block(pixels.data(), block);
+				break;
+			case GP2_TextureFormat::BC4:
+				for (int pixel = 0; pixel < 16; ++pixel)
+					red[pixel] = pixels[pixel * 4];
+				EncodeBC4Block(red.data(), block);
+				break;
+			case GP2_TextureFormat::BC5:
+				EncodeBC5Block(pixels.data(), block);
+				break;
+			default:
+				throw std::invalid_argument("bc7 encoding is not supported!");
+			}
+		}
+	}
+
+	return blocks;
+}
+
+std::vector<uint8_t> GP2_TextureCompression::PackChannels(const uint8_t* redRgba, const uint8_t* greenRgba, uint32_t width, uint32_t height)
+{
+	std::vector<uint8_t> packed(size_t(width) * height * 4);
+	for (size_t pixel = 0; pixel < size_t(width) * height; ++pixel)
+	{
+		packed[pixel * 4 + 0] = redRgba[pixel * 4];
+		packed[pixel * 4 + 1] = greenRgba[pixel * 4];
+		packed[pixel * 4 + 2] = 0;
+		packed[pixel * 4 + 3] = 255;
+	}
+
+	return packed;
+}
+
+std::vector<std::vector<uint8_t>> GP2_TextureCompression::BuildMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, GP2_TextureUsage usage)
+{
+	std::vector<std::vector<uint8_t>> levels{};
+	levels.emplace_back(rgba, rgba + size_t(width) * height * 4);
+
+	while (width > 1 || height > 1)
+	{
+		const uint32_t nextWidth = (std::max)(width / 2, 1u);
+		const uint32_t nextHeight = (std::max)(height / 2, 1u);
+
+		std::vector<uint8_t> next(size_t(nextWidth) * nextHeight * 4);
+		DownsampleLevel(levels.back().data(), width, height, usage, next.data());
+
+		levels.push_back(std::move(next));
+		width = nextWidth;
+		height = nextHeight;
+	}
+
+	return levels;
+}
+
+void GP2_TextureCompression::DownsampleLevel(const uint8_t* rgba, uint32_t width, uint32_t height, GP2_TextureUsage usage, uint8_t* nextRgba)
+{
+	const uint32_t nextWidth = (std::max)(width / 2, 1u);
+	const uint32_t nextHeight = (std::max)(height / 2, 1u);
+
+	for (uint32_t y = 0; y < nextHeight; ++y)
+	{
+		for (uint32_t x = 0; x < nextWidth; ++x)
+		{
+			// 2x2 box, odd edges reuse their last row or column
+			const std::array<const uint8_t*, 4> texels{
+				&rgba[(size_t((std::min)(2 * y, height - 1)) * width + (std::min)(2 * x, width - 1)) * 4],
+				&rgba[(size_t((std::min)(2 * y, height - 1)) * width + (std::min)(2 * x + 1, width - 1)) * 4],
+				&rgba[(size_t((std::min)(2 * y + 1, height - 1)) * width + (std::min)(2 * x, width - 1)) * 4],
+				&rgba[(size_t((std::min)(2 * y + 1, height - 1)) * width + (std::min)(2 * x + 1, width - 1)) * 4]
+			};
+			uint8_t* destination = &nextRgba[(size_t(y) * nextWidth + x) * 4];
+
+			if (usage == GP2_TextureUsage::Albedo)
+			{
+				// srgb values are averaged as light, not as encoded values, or the mips darken
+				for (int channel = 0; channel < 3; ++channel)
+				{
+					float sum = 0.f;
+					for (const uint8_t* texel : texels)
+						sum += g_SrgbToLinear[texel[channel]];
+					destination[channel] = LinearToSrgb(sum * 0.25f);
+				}
+				destination[3] = static_cast<uint8_t>((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);
+			}
+			else if (usage == GP2_TextureUsage::Normal)
+			{
+				// the average of unit normals is shorter than one, renormalize it
+				float normal[3]{};
+				for (const uint8_t* texel : texels)
+					for (int channel = 0; channel < 3; ++channel)
+						normal[channel] += texel[channel] / 127.5f - 1.f;
+
+				const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				for (int channel = 0; channel < 3; ++channel)
+				{
+					const float unit = length > 1e-6f ? normal[channel] / length : (channel == 2 ? 1.f : 0.f);
+					destination[channel] = static_cast<uint8_t>(std::clamp((unit + 1.f) * 127.5f + 0.5f, 0.f, 255.f));
+				}
+				destination[3] = 255;
+			}
+			else
+			{
+				for (int channel = 0; channel < 4; ++channel)
+					destination[channel] = static_cast<uint8_t>((texels[0][channel] + texels[1][channel] + texels[2][channel] + texels[3][channel] + 2) / 4);
+			}
+		}
+	}
+}
+
+void GP2_TextureCompression::WriteDDS(const std::string& filePath, const GP2_CompressedTexture& texture)
+{
+	std::ofstream file{ filePath, std::ios::binary };
+	if (!file.is_open())
+		throw std::runtime_error("failed to open " + filePath + " for writing!");
+
+	auto dxgi = std::find_if(g_DXGIFormats.begin(), g_DXGIFormats.end(), [&](const DXGIFormat& entry) { return entry.format == texture.format; });
+
+	DDSHeader header{};
+	header.size = sizeof(DDSHeader);
+	header.flags = g_DDSFlagsTexture;
+	header.height = texture.height;
+	header.width = texture.width;
+	header.pitchOrLinearSize = texture.mips.empty() ? 0 : static_cast<uint32_t>(texture.mips[0].size());
+	header.depth = 1;
+	header.mipMapCount = static_cast<uint32_t>(texture.mips.size());
+	header.pixelFormat.size = sizeof(DDSPixelFormat);
+	header.pixelFormat.flags = g_DDSPixelFormatFourCC;
+	header.pixelFormat.fourCC = MakeFourCC('D', 'X', '1', '0');
+	header.caps = g_DDSCapsTexture;
+
+	DDSHeaderDX10 headerDX10{};
+	headerDX10.dxgiFormat = dxgi->dxgi;
+	headerDX10.resourceDimension = g_DDSResourceTexture2D;
+	headerDX10.arraySize = 1;
+
+	file.write(reinterpret_cast<const char*>(&g_DDSMagic), sizeof(g_DDSMagic));
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&headerDX10), sizeof(headerDX10));
+	for (const std::vector<uint8_t>& mip : texture.mips)
+		file.write(reinterpret_cast<const char*>(mip.data()), mip.size());
+
+	if (!file.good())
+		throw std::runtime_error("failed to write " + filePath + "!");
+}
+
+GP2_CompressedTexture GP2_TextureCompression::ReadDDS(const std::string& filePath)
+{
+	std::ifstream file{ filePath, std::ios::binary };
+	if (!file.is_open())
+		throw std::runtime_error("failed to open " + filePath + "!");
+
+	uint32_t magic{};
+	DDSHeader header{};
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file.good() || magic != g_DDSMagic || header.size != sizeof(DDSHeader) || (header.pixelFormat.flags & g_DDSPixelFormatFourCC) == 0)
+		throw std::runtime_error(filePath + " is not a block compressed dds file!");
+
+	GP2_CompressedTexture texture{};
+	texture.width = header.width;
+	texture.height = header.height;
+
+	const uint32_t fourCC = header.pixelFormat.fourCC;
+	if (fourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		DDSHeaderDX10 headerDX10{};
+		file.read(reinterpret_cast<char*>(&headerDX10), sizeof(headerDX10));
+
+		auto dxgi = std::find_if(g_DXGIFormats.begin(), g_DXGIFormats.end(), [&](const DXGIFormat& entry) { return entry.dxgi == headerDX10.dxgiFormat; });
+		if (!file.good() || dxgi == g_DXGIFormats.end() || headerDX10.resourceDimension != g_DDSResourceTexture2D || headerDX10.arraySize > 1)
+			throw std::runtime_error(filePath + " has an unsupported dxgi format!");
+
+		texture.format = dxgi->format;
+	}
+	// legacy headers as older tools write them
+	else if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+		texture.format = GP2_TextureFormat::BC1;
+	else if (fourCC == MakeFourCC('D', 'X', 'T', '5'))
+		texture.format = GP2_TextureFormat::BC3;
+	else if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U'))
+		texture.format = GP2_TextureFormat::BC4;
+	else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U'))
+		texture.format = GP2_TextureFormat::BC5;
+	else
+		throw std::runtime_error(filePath + " has an unsupported format!");
+
+	const uint32_t mipCount = (std::max)(header.mipMapCount, 1u);
+	const uint32_t blockSize = GetBlockSize(texture.format);
+	for (uint32_t level = 0; level < mipCount; ++level)
+	{
+		const size_t blocksX = (GetMipDimension(texture.width, level) + 3) / 4;
+		const size_t blocksY = (GetMipDimension(texture.height, level) + 3) / 4;
+
+		std::vector<uint8_t> mip(blocksX * blocksY * blockSize);
+		file.read(reinterpret_cast<char*>(mip.data()), mip.size());
+		if (!file.good())
+			throw std::runtime_error(filePath + " is truncated!");
+
+		texture.mips.push_back(std::move(mip));
+	}
+
+	return texture;
+}
+
+uint32_t GP2_TextureCompression::GetBlockSize(GP2_TextureFormat format)
+{
+	switch (format)
+	{
+	case GP2_TextureFormat::BC1:
+	case GP2_TextureFormat::BC1_SRGB:
+	case GP2_TextureFormat::BC4:
+		return 8;
+	default:
+		return 16;
+	}
+}
+
+uint32_t GP2_TextureCompression::GetMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+	for (uint32_t size = (std::max)(width, height); size > 1; size >>= 1)
+		++levels;
+	return levels;
+}
+
+uint32_t GP2_TextureCompression::GetScreenLevel(uint32_t width, uint32_t height, float screenPixels)
+{
+	// a texture twice the screen size is sampled from its next level
+	const float texels = static_cast<float>((std::max)(width, height));
+	if (screenPixels >= texels)
+		return 0;
+
+	const uint32_t level = static_cast<uint32_t>(std::floor(std::log2(texels / (std::max)(screenPixels, 1.f))));
+	return (std::min)(level, GetMipCount(width, height) - 1);
+}
+
+const char* GP2_TextureCompression::GetSimdName()
+{
+#if defined(GP2_BC_SSE)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
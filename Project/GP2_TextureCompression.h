@@ -0,0 +1,85 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// block compressed formats a cooked texture can hold, bc7 is only read (from external cookers), never encoded
+enum class GP2_TextureFormat {
+	BC1,
+	BC1_SRGB,
+	BC3,
+	BC3_SRGB,
+	BC4,
+	BC5,
+	BC7,
+	BC7_SRGB
+};
+
+// what a texture holds decides its format and how its mips are filtered
+enum class GP2_TextureUsage {
+	// srgb color, bc1 or bc3 when it has alpha
+	Albedo,
+	// tangent space normal, bc5 keeps x and y and the shaders rebuild z
+	Normal,
+	// single channel data like roughness, metalness, gloss or specular, bc4 from the red channel
+	Mask,
+	// two single channel maps packed into red and green by PackChannels, bc5
+	Packed
+};
+
+struct GP2_CompressedTexture {
+	GP2_TextureFormat format{ GP2_TextureFormat::BC1 };
+	uint32_t width{};
+	uint32_t height{};
+	// level 0 first, every level is its blocks in row order
+	std::vector<std::vector<uint8_t>> mips{};
+};
+
+// Offline texture cooking: rgba8 images are filtered into a full mip chain, every level is encoded into 4x4
+// blocks and the result is stored as a dds file with a dx10 header. The encoders fit each block's endpoints
+// to its bounding box and pick indices by projecting onto the endpoint axis, which runs 4 pixels (bc1) or
+// all 16 values (bc4) per sse2 instruction. Quality is below an exhaustive encoder but cooking a 1k map
+// takes milliseconds.
+class GP2_TextureCompression
+{
+public:
+	// rgba is 16 pixels in row order
+	static void EncodeBC1Block(const uint8_t* rgba, uint8_t* block);
+	// bc1 color after a bc4 alpha block
+	static void EncodeBC3Block(const uint8_t* rgba, uint8_t* block);
+	// values are 16 single channel samples in row order
+	static void EncodeBC4Block(const uint8_t* values, uint8_t* block);
+	// red and green as two bc4 blocks
+	static void EncodeBC5Block(const uint8_t* rgba, uint8_t* block);
+
+	static GP2_CompressedTexture Cook(const uint8_t* rgba, uint32_t width, uint32_t height, GP2_TextureUsage usage);
+
+	// encodes one level, partial blocks at the edges repeat their last row and column
+	static std::vector<uint8_t> Compress(const uint8_t* rgba, uint32_t width, uint32_t height, GP2_TextureFormat format);
+	// rgba8 levels down to 1x1, level 0 is a copy of the input
+	static std::vector<std::vector<uint8_t>> BuildMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, GP2_TextureUsage usage);
+	// one step of BuildMipChain, nextRgba holds the half size level
+	static void DownsampleLevel(const uint8_t* rgba, uint32_t width, uint32_t height, GP2_TextureUsage usage, uint8_t* nextRgba);
+
+	// red and green take the red channel of two maps of the same size, blue is 0 and alpha 255
+	static std::vector<uint8_t> PackChannels(const uint8_t* redRgba, const uint8_t* greenRgba, uint32_t width, uint32_t height);
+
+	// where the cooker writes a map and where GP2_ImageBuffer looks for it
+	static std::string GetCookedPath(const std::string& sourceFile) { return std::filesystem::path{ sourceFile }.replace_extension(".dds").string(); };
+	static std::string GetPackedPath(const std::string& redSourceFile) { return std::filesystem::path{ redSourceFile }.replace_extension("").string() + "_packed.dds"; };
+
+	static void WriteDDS(const std::string& filePath, const GP2_CompressedTexture& texture);
+	// throws if the file is missing or isn't a dds this loader understands
+	static GP2_CompressedTexture ReadDDS(const std::string& filePath);
+
+	static uint32_t GetBlockSize(GP2_TextureFormat format);
+	static uint32_t GetMipDimension(uint32_t dimension, uint32_t level) { return (std::max)(dimension >> level, 1u); };
+	// levels down to 1x1
+	static uint32_t GetMipCount(uint32_t width, uint32_t height);
+	// finest level a texture needs when it covers screenPixels along its larger side, one texel per pixel
+	static uint32_t GetScreenLevel(uint32_t width, uint32_t height, float screenPixels);
+
+	static const char* GetSimdName();
+};
@@ -0,0 +1,224 @@
+#include "GP2_TextureDecoder.h"
+#include "GP2_CpuProfiler.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	// the buffer the running decode on this thread writes its result into, handed to stb by Allocate
+	struct DecodeTarget {
+		uint8_t* destination{ nullptr };
+		size_t size{};
+		bool taken{ false };
+	};
+
+	thread_local DecodeTarget t_DecodeTarget{};
+}
+
+GP2_TextureDecoder::GP2_TextureDecoder(uint32_t threadCount)
+{
+	if (threadCount == 0)
+		threadCount = (std::max)(std::thread::hardware_concurrency(), 2u) - 1;
+
+	for (uint32_t idx = 0; idx < threadCount; ++idx)
+	{
+		m_Workers.emplace_back(&GP2_TextureDecoder::WorkerLoop, this, idx);
+	}
+}
+
+GP2_TextureDecoder::~GP2_TextureDecoder()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Stopping = true;
+	}
+	m_JobAvailable.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+void GP2_TextureDecoder::ReadImageSize(const std::string& filePath, int& width, int& height)
+{
+	int channels{};
+	if (!stbi_info(filePath.c_str(), &width, &height, &channels)) {
+		throw std::runtime_error("failed to read texture image " + filePath + "!");
+	}
+}
+
+std::future<void> GP2_TextureDecoder::Decode(const std::string& filePath, uint8_t* destination)
+{
+	return Submit([this, filePath, destination]()
+		{
+			int width{};
+			int height{};
+			ReadImageSize(filePath, width, height);
+			LoadPixels(filePath, width, height, destination);
+		});
+}
+
+void GP2_TextureDecoder::DecodeNow(const std::string& filePath, int width, int height, uint8_t* destination)
+{
+	LoadPixels(filePath, width, height, destination);
+}
+
+void GP2_TextureDecoder::PrintStatistics() const
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+
+	const std::ios_base::fmtflags flags = std::cout.flags();
+	const std::streamsize precision = std::cout.precision();
+
+	// a decode faster than the clock's resolution has no rate
+	const auto rate = [](double megabytes, double seconds) { return seconds > 0.0 ? megabytes / seconds : 0.0; };
+
+	constexpr double megabyte = 1024.0 * 1024.0;
+	std::cout << "texture decode, " << m_Workers.size() << " threads\n" << std::fixed << std::setprecision(1);
+	for (const auto& [codec, statistics] : m_Statistics)
+	{
+		if (statistics.images == 0)
+			continue;
+
+		const double decodedMegabytes = statistics.decodedBytes / megabyte;
+		const double wallSeconds = std::chrono::duration<double>(statistics.lastEnd - statistics.firstStart).count();
+
+		std::cout << "  " << codec << ": " << statistics.images << " images, "
+			<< statistics.encodedBytes / megabyte << " MB -> " << decodedMegabytes << " MB, "
+			<< rate(decodedMegabytes, statistics.decodeSeconds) << " MB/s per thread, "
+			<< rate(decodedMegabytes, wallSeconds) << " MB/s over " << wallSeconds * 1000.0 << " ms\n";
+	}
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
+
+std::future<void> GP2_TextureDecoder::Submit(std::function<void()> job)
+{
+	std::packaged_task<void()> task{ std::move(job) };
+	std::future<void> result = task.get_future();
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Jobs.push(std::move(task));
+	}
+	m_JobAvailable.notify_one();
+
+	return result;
+}
+
+void GP2_TextureDecoder::WorkerLoop(uint32_t workerIndex)
+{
+	GP2_CPU_THREAD_NAME("Texture decoder " + std::to_string(workerIndex));
+
+	while (true)
+	{
+		std::packaged_task<void()> task;
+		{
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			m_JobAvailable.wait(lock, [this]() { return m_Stopping || !m_Jobs.empty(); });
+
+			// queued decodes still finish, someone may be waiting on them
+			if (m_Jobs.empty())
+				return;
+
+			task = std::move(m_Jobs.front());
+			m_Jobs.pop();
+		}
+
+		// exceptions end up in the future
+		task();
+	}
+}
+
+void* GP2_TextureDecoder::Allocate(size_t size)
+{
+	DecodeTarget& target = t_DecodeTarget;
+	if (target.destination && !target.taken && size == target.size)
+	{
+		target.taken = true;
+		return target.destination;
+	}
+	return malloc(size);
+}
+
+void* GP2_TextureDecoder::Reallocate(void* pointer, size_t oldSize, size_t newSize)
+{
+	// an intermediate buffer that happened to match the size, moves out of the destination
+	const DecodeTarget& target = t_DecodeTarget;
+	if (pointer && pointer == target.destination)
+	{
+		void* moved = malloc(newSize);
+		if (moved)
+			memcpy(moved, pointer, (std::min)(oldSize, newSize));
+		return moved;
+	}
+	return realloc(pointer, newSize);
+}
+
+void GP2_TextureDecoder::Free(void* pointer)
+{
+	if (pointer && pointer == t_DecodeTarget.destination)
+		return;
+	free(pointer);
+}
+
+void GP2_TextureDecoder::LoadPixels(const std::string& filePath, int width, int height, uint8_t* destination)
+{
+	GP2_CPU_ZONE("GP2_TextureDecoder::LoadPixels");
+	const Clock::time_point start = Clock::now();
+
+	const size_t decodedBytes = static_cast<size_t>(width) * height * 4;
+	t_DecodeTarget = DecodeTarget{ destination, decodedBytes, false };
+
+	int loadedWidth{};
+	int loadedHeight{};
+	int channels{};
+	stbi_uc* pixels = stbi_load(filePath.c_str(), &loadedWidth, &loadedHeight, &channels, STBI_rgb_alpha);
+
+	// anything stb frees from here on is its own
+	t_DecodeTarget = DecodeTarget{};
+
+	if (!pixels) {
+		throw std::runtime_error("failed to load texture image " + filePath + "!");
+	}
+	if (loadedWidth != width || loadedHeight != height) {
+		if (pixels != destination)
+			stbi_image_free(pixels);
+		throw std::runtime_error("texture image " + filePath + " changed while loading!");
+	}
+
+	// the result landed somewhere else when stb converted it out of the destination
+	if (pixels != destination)
+	{
+		memcpy(destination, pixels, decodedBytes);
+		stbi_image_free(pixels);
+	}
+
+	const Clock::time_point end = Clock::now();
+
+	std::string codec = std::filesystem::path{ filePath }.extension().string();
+	codec.erase(0, 1);
+	std::transform(codec.begin(), codec.end(), codec.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	std::error_code error;
+	const uintmax_t encodedBytes = std::filesystem::file_size(filePath, error);
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	CodecStatistics& statistics = m_Statistics[codec];
+	if (statistics.images == 0 || start < statistics.firstStart)
+		statistics.firstStart = start;
+	statistics.lastEnd = (std::max)(statistics.lastEnd, end);
+	++statistics.images;
+	statistics.encodedBytes += error ? 0 : encodedBytes;
+	statistics.decodedBytes += decodedBytes;
+	statistics.decodeSeconds += std::chrono::duration<double>(end - start).count();
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Decodes png, jpg and tga textures on a pool of worker threads. GP2_ImageBuffer reads the image header on
+// the loading thread, sizes and maps its staging buffer and queues the decode, the worker then writes the
+// pixels into the mapped memory. Initialize waits for its decode, so every texture loaded before the first
+// one is initialized decodes concurrently.
+//
+// stb_image allocates through Allocate, Reallocate and Free (see main.cpp). While a decode runs, the first
+// allocation the size of the rgba8 result is the destination itself, so png and jpg decode straight into the
+// staging memory and only other codecs, whose result stb converts in a second buffer, pay for a copy.
+class GP2_TextureDecoder
+{
+public:
+	// 0 leaves one hardware thread to the loading thread and gives the pool the others
+	explicit GP2_TextureDecoder(uint32_t threadCount = 0);
+	~GP2_TextureDecoder();
+
+	GP2_TextureDecoder(const GP2_TextureDecoder&) = delete;
+	GP2_TextureDecoder& operator=(const GP2_TextureDecoder&) = delete;
+
+	// header only, throws if the file can't be read
+	static void ReadImageSize(const std::string& filePath, int& width, int& height);
+
+	// rgba8 into destination, which holds width * height * 4 bytes, get() rethrows decode failures
+	std::future<void> Decode(const std::string& filePath, uint8_t* destination);
+	// same as Decode on the calling thread, for jobs that already run on the pool, the size comes from ReadImageSize
+	void DecodeNow(const std::string& filePath, int width, int height, uint8_t* destination);
+
+	// any other loading work, get() rethrows what the job threw
+	std::future<void> Submit(std::function<void()> job);
+
+	// decoded MB/s per codec since construction, per worker and over the wall time the codec was busy
+	void PrintStatistics() const;
+
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()); };
+
+	// STBI_MALLOC, STBI_REALLOC_SIZED and STBI_FREE
+	static void* Allocate(size_t size);
+	static void* Reallocate(void* pointer, size_t oldSize, size_t newSize);
+	static void Free(void* pointer);
+
+private:
+	using Clock = std::chrono::high_resolution_clock;
+
+	struct CodecStatistics {
+		uint32_t images{};
+		uint64_t encodedBytes{};
+		uint64_t decodedBytes{};
+		double decodeSeconds{};
+		Clock::time_point firstStart{};
+		Clock::time_point lastEnd{};
+	};
+
+	void WorkerLoop(uint32_t workerIndex);
+
+	// stbi_load into destination, which Allocate hands to stb as its result buffer
+	void LoadPixels(const std::string& filePath, int width, int height, uint8_t* destination);
+
+	std::vector<std::thread> m_Workers{};
+	std::queue<std::packaged_task<void()>> m_Jobs{};
+	bool m_Stopping{ false };
+
+	mutable std::mutex m_Mutex{};
+	std::condition_variable m_JobAvailable{};
+
+	// keyed by lowercase file extension
+	std::map<std::string, CodecStatistics> m_Statistics{};
+};
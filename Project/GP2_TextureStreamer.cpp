@@ -0,0 +1,624 @@
+#include "GP2_TextureStreamer.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_Buffer.h"
+#include "GP2_DescriptorPool.h"
+#include "GP2_ImageBuffer.h"
+#include "GP2_ResourceCache.h"
+#include "GP2_TextureDecoder.h"
+#include "GP2_UploadBatch.h"
+
+#include <vulkanbase/VulkanBase.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+void GP2_TextureStreamer::Initialize(const VulkanContext& context, const Settings& settings)
+{
+	GP2_CPU_ZONE("GP2_TextureStreamer::Initialize");
+	m_Settings = settings;
+	m_Context = context;
+	m_VkDevice = context.device;
+	m_VkPhysicalDevice = context.physicalDevice;
+	m_Decoder = context.textureDecoder;
+
+	if (!m_Decoder) {
+		throw std::runtime_error("texture streaming needs a texture decoder!");
+	}
+
+	// createLogicalDevice enables textureCompressionBC whenever it is supported
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(m_VkPhysicalDevice, &features);
+	m_SupportsBC = features.textureCompressionBC == VK_TRUE;
+
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(m_VkPhysicalDevice, &properties);
+
+	// same sampler as GP2_ImageBuffer, the view's mip count is what limits the lod
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.anisotropyEnable = VK_TRUE;
+	samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.mipLodBias = 0.f;
+	samplerInfo.minLod = 0.f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	m_Sampler = context.resourceCache->GetSampler(samplerInfo);
+}
+
+void GP2_TextureStreamer::Destroy()
+{
+	for (Texture& texture : m_Textures)
+	{
+		GP2_Buffer* stagingBuffer = nullptr;
+		if (texture.load.done.valid())
+		{
+			texture.load.done.wait();
+			stagingBuffer = texture.load.result->stagingBuffer;
+		}
+		DropLevels(texture);
+
+		Release(Retired{ texture.image, texture.memory, texture.view, stagingBuffer });
+	}
+	m_Textures.clear();
+
+	for (const Retired& retired : m_Retired)
+	{
+		Release(retired);
+	}
+	m_Retired.clear();
+
+	m_ResidentBytes = 0;
+	m_LoadsInFlight = 0;
+}
+
+GP2_TextureStreamer::Handle GP2_TextureStreamer::Register(const std::string& filePath, GP2_TextureUsage usage, const std::string& greenFilePath)
+{
+	Texture texture{};
+	texture.source.filePath = filePath;
+	texture.source.greenFilePath = greenFilePath;
+	texture.source.usage = usage;
+
+	const std::string cookedPath = usage == GP2_TextureUsage::Packed ? GP2_TextureCompression::GetPackedPath(filePath) : GP2_TextureCompression::GetCookedPath(filePath);
+	if (m_SupportsBC && std::filesystem::exists(cookedPath))
+		texture.source.cookedPath = cookedPath;
+
+	const Handle handle = static_cast<Handle>(m_Textures.size());
+	m_Textures.push_back(std::move(texture));
+	QueueLoad(handle, UINT32_MAX);
+
+	return handle;
+}
+
+void GP2_TextureStreamer::Upload(Handle handle, GP2_UploadBatch& uploadBatch)
+{
+	Texture& texture = m_Textures[handle];
+
+	texture.load.done.get();
+	--m_LoadsInFlight;
+	const std::shared_ptr<LoadedLevels> loaded = std::move(texture.load.result);
+	texture.load = {};
+
+	texture.format = loaded->format;
+	texture.width = loaded->width;
+	texture.height = loaded->height;
+	texture.levelCount = loaded->levelCount;
+
+	// every level up to tailSize texels
+	texture.tailLevel = 0;
+	while (texture.tailLevel + 1 < texture.levelCount && (std::max)(GP2_TextureCompression::GetMipDimension(texture.width, texture.tailLevel), GP2_TextureCompression::GetMipDimension(texture.height, texture.tailLevel)) > m_Settings.tailSize)
+		++texture.tailLevel;
+	texture.residentLevel = texture.tailLevel;
+	texture.wantedLevel = texture.levelCount;
+
+	CreateImage(texture, texture.residentLevel);
+
+	// the tail is a plain upload, every level comes from the staging buffer
+	GP2_ImageUpload upload{};
+	upload.image = texture.image;
+	upload.width = GP2_TextureCompression::GetMipDimension(texture.width, texture.residentLevel);
+	upload.height = GP2_TextureCompression::GetMipDimension(texture.height, texture.residentLevel);
+	upload.mipLevels = texture.levelCount - texture.residentLevel;
+
+	upload.buffer = loaded->stagingBuffer->GetVkBuffer();
+
+	upload.regions.resize(upload.mipLevels);
+	for (uint32_t level = 0; level < upload.mipLevels; ++level)
+	{
+		VkBufferImageCopy& region = upload.regions[level];
+		region.bufferOffset = loaded->offsets[texture.residentLevel + level];
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		region.imageExtent = { GP2_TextureCompression::GetMipDimension(upload.width, level), GP2_TextureCompression::GetMipDimension(upload.height, level), 1 };
+	}
+
+	uploadBatch.AddImage(upload);
+
+	// the finer levels come from the same buffer once they are requested
+	texture.levels = loaded;
+	if (texture.residentLevel == 0)
+		DropLevels(texture);
+
+	m_ResidentBytes += GetLevelRangeBytes(texture, texture.residentLevel, texture.levelCount);
+}
+
+void GP2_TextureStreamer::AddBinding(Handle handle, GP2_DescriptorPool* descriptorPool, uint32_t binding)
+{
+	m_Textures[handle].bindings.emplace_back(descriptorPool, binding);
+}
+
+void GP2_TextureStreamer::RequestScreenSize(Handle handle, float screenPixels)
+{
+	Texture& texture = m_Textures[handle];
+
+	const uint32_t level = GP2_TextureCompression::GetScreenLevel(texture.width, texture.height, screenPixels);
+	texture.wantedLevel = (std::min)({ texture.wantedLevel, level, texture.levelCount - 1 });
+	texture.lastNeededFrame = m_Frame;
+}
+
+void GP2_TextureStreamer::Update(VkCommandBuffer cmdBuffer)
+{
+	// the fence of the frame that last used these has passed
+	for (const Retired& retired : m_Retired)
+	{
+		Release(retired);
+	}
+	m_Retired.clear();
+
+	// finished loads, the wanted levels are the previous frame's requests
+	for (Handle handle = 0; handle < m_Textures.size(); ++handle)
+	{
+		Texture& texture = m_Textures[handle];
+		if (!texture.load.done.valid() || texture.load.done.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready)
+			continue;
+
+		texture.load.done.get();
+		--m_LoadsInFlight;
+		texture.levels = std::move(texture.load.result);
+		const uint32_t firstLevel = texture.load.firstLevel;
+		texture.load = {};
+
+		// the texture may no longer need every level it asked for, the rest stays cached
+		const uint32_t newResidentLevel = (std::max)(firstLevel, texture.wantedLevel);
+		if (newResidentLevel < texture.residentLevel && MakeRoom(GetLevelRangeBytes(texture, newResidentLevel, texture.residentLevel), handle, cmdBuffer))
+			Reallocate(texture, newResidentLevel, texture.levels.get(), cmdBuffer);
+		if (texture.residentLevel == 0)
+			DropLevels(texture);
+	}
+
+	MakeRoom(0, UINT32_MAX, cmdBuffer);
+
+	// what every texture could free, to clamp new loads to what fits
+	const auto getEvictableBytes = [this]()
+		{
+			VkDeviceSize evictableBytes = 0;
+			for (const Texture& texture : m_Textures)
+			{
+				evictableBytes += GetLevelRangeBytes(texture, texture.residentLevel, (std::max)(GetKeepLevel(texture), texture.residentLevel));
+			}
+			return evictableBytes;
+		};
+	VkDeviceSize evictableBytes = getEvictableBytes();
+
+	for (Handle handle = 0; handle < m_Textures.size(); ++handle)
+	{
+		Texture& texture = m_Textures[handle];
+		if (texture.load.done.valid() || texture.wantedLevel >= texture.residentLevel)
+			continue;
+
+		uint32_t firstLevel = texture.wantedLevel;
+		while (firstLevel < texture.residentLevel && m_ResidentBytes - evictableBytes + GetLevelRangeBytes(texture, firstLevel, texture.residentLevel) > m_Settings.budget)
+			++firstLevel;
+
+		if (firstLevel >= texture.residentLevel)
+			continue;
+
+		// cached levels are copied this frame, only textures without them go to the decoder
+		if (texture.levels)
+		{
+			if (MakeRoom(GetLevelRangeBytes(texture, firstLevel, texture.residentLevel), handle, cmdBuffer))
+				Reallocate(texture, firstLevel, texture.levels.get(), cmdBuffer);
+			if (texture.residentLevel == 0)
+				DropLevels(texture);
+			evictableBytes = getEvictableBytes();
+		}
+		else if (m_LoadsInFlight < m_Settings.maxLoadsInFlight)
+		{
+			QueueLoad(handle, firstLevel);
+		}
+	}
+
+	// the next frame's draws request again
+	for (Texture& texture : m_Textures)
+	{
+		texture.wantedLevel = texture.levelCount;
+	}
+	++m_Frame;
+}
+
+void GP2_TextureStreamer::PrintStatistics() const
+{
+	const std::ios_base::fmtflags flags = std::cout.flags();
+	const std::streamsize precision = std::cout.precision();
+
+	constexpr double megabyte = 1024.0 * 1024.0;
+	std::cout << std::fixed << std::setprecision(1) << "texture streaming: " << m_ResidentBytes / megabyte << " / "
+		<< m_Settings.budget / megabyte << " MB resident, " << m_LoadsInFlight << " loads in flight\n";
+	for (const Texture& texture : m_Textures)
+	{
+		std::cout << "  " << texture.source.filePath << ": " << GP2_TextureCompression::GetMipDimension(texture.width, texture.residentLevel)
+			<< "x" << GP2_TextureCompression::GetMipDimension(texture.height, texture.residentLevel) << " of " << texture.width << "x" << texture.height
+			<< (texture.source.cookedPath.empty() ? "" : " (cooked)") << (texture.levels ? ", levels cached" : "") << "\n";
+	}
+
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
+
+void GP2_TextureStreamer::LoadLevels(const VulkanContext& context, const Source& source, GP2_TextureDecoder* decoder, LoadedLevels& result)
+{
+	GP2_CPU_ZONE("GP2_TextureStreamer::LoadLevels");
+	GP2_CompressedTexture cooked{};
+	uint32_t bytesPerTexel = 0;
+
+	if (!source.cookedPath.empty())
+	{
+		cooked = GP2_TextureCompression::ReadDDS(source.cookedPath);
+		result.format = GP2_ImageBuffer::GetCompressedFormat(cooked.format);
+		result.width = cooked.width;
+		result.height = cooked.height;
+		result.levelCount = static_cast<uint32_t>(cooked.mips.size());
+	}
+	else
+	{
+		int width{};
+		int height{};
+		GP2_TextureDecoder::ReadImageSize(source.filePath, width, height);
+		result.width = static_cast<uint32_t>(width);
+		result.height = static_cast<uint32_t>(height);
+		result.levelCount = GP2_TextureCompression::GetMipCount(result.width, result.height);
+
+		switch (source.usage)
+		{
+		case GP2_TextureUsage::Albedo: result.format = VK_FORMAT_R8G8B8A8_SRGB; bytesPerTexel = 4; break;
+		case GP2_TextureUsage::Normal: result.format = VK_FORMAT_R8G8B8A8_UNORM; bytesPerTexel = 4; break;
+		case GP2_TextureUsage::Mask: result.format = VK_FORMAT_R8_UNORM; bytesPerTexel = 1; break;
+		case GP2_TextureUsage::Packed: result.format = VK_FORMAT_R8G8_UNORM; bytesPerTexel = 2; break;
+		}
+	}
+
+	const auto levelWidth = [&result](uint32_t level) { return GP2_TextureCompression::GetMipDimension(result.width, level); };
+	const auto levelHeight = [&result](uint32_t level) { return GP2_TextureCompression::GetMipDimension(result.height, level); };
+
+	VkDeviceSize size = 0;
+	for (uint32_t level = 0; level < result.levelCount; ++level)
+	{
+		result.offsets.push_back(size);
+		size += cooked.mips.empty() ? VkDeviceSize(levelWidth(level)) * levelHeight(level) * bytesPerTexel : cooked.mips[level].size();
+	}
+
+	result.stagingBuffer = new GP2_Buffer{ context, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+	void* mapped{};
+	result.stagingBuffer->MapMemory(&mapped);
+	uint8_t* staging = static_cast<uint8_t*>(mapped);
+
+	try
+	{
+		if (!cooked.mips.empty())
+		{
+			for (uint32_t level = 0; level < result.levelCount; ++level)
+				memcpy(staging + result.offsets[level], cooked.mips[level].data(), cooked.mips[level].size());
+		}
+		else if (bytesPerTexel == 4)
+		{
+			// level 0 is decoded in place and every mip is filtered from the one above it
+			decoder->DecodeNow(source.filePath, static_cast<int>(result.width), static_cast<int>(result.height), staging + result.offsets[0]);
+			for (uint32_t level = 1; level < result.levelCount; ++level)
+			{
+				GP2_TextureCompression::DownsampleLevel(staging + result.offsets[level - 1], levelWidth(level - 1), levelHeight(level - 1), source.usage, staging + result.offsets[level]);
+			}
+		}
+		else
+		{
+			std::vector<uint8_t> rgba(size_t(result.width) * result.height * 4);
+			decoder->DecodeNow(source.filePath, static_cast<int>(result.width), static_cast<int>(result.height), rgba.data());
+			if (source.usage == GP2_TextureUsage::Packed)
+			{
+				int greenWidth{};
+				int greenHeight{};
+				GP2_TextureDecoder::ReadImageSize(source.greenFilePath, greenWidth, greenHeight);
+				if (static_cast<uint32_t>(greenWidth) != result.width || static_cast<uint32_t>(greenHeight) != result.height) {
+					throw std::runtime_error("packed texture images differ in size!");
+				}
+
+				std::vector<uint8_t> green(rgba.size());
+				decoder->DecodeNow(source.greenFilePath, greenWidth, greenHeight, green.data());
+				rgba = GP2_TextureCompression::PackChannels(rgba.data(), green.data(), result.width, result.height);
+			}
+
+			// mips are filtered as rgba8, single and two channel images keep only what they sample
+			std::vector<uint8_t> next{};
+			for (uint32_t level = 0; level < result.levelCount; ++level)
+			{
+				uint8_t* destination = staging + result.offsets[level];
+				for (size_t texel = 0; texel < size_t(levelWidth(level)) * levelHeight(level); ++texel)
+					memcpy(&destination[texel * bytesPerTexel], &rgba[texel * 4], bytesPerTexel);
+
+				if (level + 1 < result.levelCount)
+				{
+					next.resize(size_t(levelWidth(level + 1)) * levelHeight(level + 1) * 4);
+					GP2_TextureCompression::DownsampleLevel(rgba.data(), levelWidth(level), levelHeight(level), source.usage, next.data());
+					rgba.swap(next);
+				}
+			}
+		}
+	}
+	catch (...)
+	{
+		result.stagingBuffer->Destroy();
+		delete result.stagingBuffer;
+		result.stagingBuffer = nullptr;
+		throw;
+	}
+}
+
+void GP2_TextureStreamer::QueueLoad(Handle handle, uint32_t firstLevel)
+{
+	Texture& texture = m_Textures[handle];
+	texture.load.result = std::make_shared<LoadedLevels>();
+	texture.load.firstLevel = firstLevel;
+
+	const VulkanContext context = m_Context;
+	const Source source = texture.source;
+	const std::shared_ptr<LoadedLevels> result = texture.load.result;
+	GP2_TextureDecoder* decoder = m_Decoder;
+
+	texture.load.done = m_Decoder->Submit([context, source, decoder, result]()
+		{
+			LoadLevels(context, source, decoder, *result);
+		});
+	++m_LoadsInFlight;
+}
+
+void GP2_TextureStreamer::Reallocate(Texture& texture, uint32_t newResidentLevel, const LoadedLevels* loaded, VkCommandBuffer cmdBuffer)
+{
+	const uint32_t oldResidentLevel = texture.residentLevel;
+	const VkImage oldImage = texture.image;
+	Retired retired{ texture.image, texture.memory, texture.view, nullptr };
+
+	CreateImage(texture, newResidentLevel);
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	// the old image may have been written by a swap earlier in this same command buffer
+	std::array<VkImageMemoryBarrier, 2> toTransfer{ barrier, barrier };
+	toTransfer[0].image = texture.image;
+	toTransfer[0].subresourceRange.levelCount = texture.levelCount - newResidentLevel;
+	toTransfer[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	toTransfer[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	toTransfer[0].srcAccessMask = 0;
+	toTransfer[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	toTransfer[1].image = oldImage;
+	toTransfer[1].subresourceRange.levelCount = texture.levelCount - oldResidentLevel;
+	toTransfer[1].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	toTransfer[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	toTransfer[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	toTransfer[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	const uint32_t barrierCount = oldImage != VK_NULL_HANDLE ? 2 : 1;
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, barrierCount, toTransfer.data());
+
+	// new levels from the staging buffer
+	if (loaded && newResidentLevel < oldResidentLevel)
+	{
+		std::vector<VkBufferImageCopy> regions(oldResidentLevel - newResidentLevel);
+		for (uint32_t level = newResidentLevel; level < oldResidentLevel; ++level)
+		{
+			VkBufferImageCopy& region = regions[level - newResidentLevel];
+			region.bufferOffset = loaded->offsets[level];
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = level - newResidentLevel;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = { 0, 0, 0 };
+			region.imageExtent = { GP2_TextureCompression::GetMipDimension(texture.width, level), GP2_TextureCompression::GetMipDimension(texture.height, level), 1 };
+		}
+
+		vkCmdCopyBufferToImage(cmdBuffer, retired.stagingBuffer->GetVkBuffer(), texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(regions.size()), regions.data());
+	}
+
+	// levels both images hold move over on the gpu
+	if (oldImage != VK_NULL_HANDLE)
+	{
+		std::vector<VkImageCopy> copies{};
+		for (uint32_t level = (std::max)(newResidentLevel, oldResidentLevel); level < texture.levelCount; ++level)
+		{
+			VkImageCopy copy{};
+			copy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - oldResidentLevel, 0, 1 };
+			copy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - newResidentLevel, 0, 1 };
+			copy.extent = { GP2_TextureCompression::GetMipDimension(texture.width, level), GP2_TextureCompression::GetMipDimension(texture.height, level), 1 };
+			copies.push_back(copy);
+		}
+
+		vkCmdCopyImage(cmdBuffer, oldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(copies.size()), copies.data());
+	}
+
+	VkImageMemoryBarrier toShader = toTransfer[0];
+	toShader.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	toShader.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	toShader.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	// a later swap in the same frame may copy out of it again
+	toShader.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toShader);
+
+	m_ResidentBytes -= GetLevelRangeBytes(texture, oldResidentLevel, texture.levelCount);
+	m_ResidentBytes += GetLevelRangeBytes(texture, newResidentLevel, texture.levelCount);
+	texture.residentLevel = newResidentLevel;
+
+	m_Retired.push_back(retired);
+	UpdateBindings(texture);
+}
+
+void GP2_TextureStreamer::CreateImage(Texture& texture, uint32_t residentLevel)
+{
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = GP2_TextureCompression::GetMipDimension(texture.width, residentLevel);
+	imageInfo.extent.height = GP2_TextureCompression::GetMipDimension(texture.height, residentLevel);
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = texture.levelCount - residentLevel;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = texture.format;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// the next swap copies the resident levels out of it again
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+	if (vkCreateImage(m_VkDevice, &imageInfo, nullptr, &texture.image) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create streamed texture image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(m_VkDevice, texture.image, &memRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(m_VkDevice, &allocInfo, nullptr, &texture.memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate streamed texture memory!");
+	}
+
+	vkBindImageMemory(m_VkDevice, texture.image, texture.memory, 0);
+
+	texture.view = GP2_ImageBuffer::createImageViewStatic(m_VkDevice, texture.image, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, imageInfo.mipLevels);
+}
+
+void GP2_TextureStreamer::UpdateBindings(const Texture& texture) const
+{
+	for (const auto& [descriptorPool, binding] : texture.bindings)
+	{
+		descriptorPool->UpdateImage(binding, texture.view, m_Sampler);
+	}
+}
+
+void GP2_TextureStreamer::DropLevels(Texture& texture)
+{
+	if (!texture.levels)
+		return;
+
+	// copies recorded this frame may still read it
+	m_Retired.push_back(Retired{ VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE, texture.levels->stagingBuffer });
+	texture.levels.reset();
+}
+
+void GP2_TextureStreamer::Release(const Retired& retired)
+{
+	vkDestroyImageView(m_VkDevice, retired.view, nullptr);
+	vkDestroyImage(m_VkDevice, retired.image, nullptr);
+	vkFreeMemory(m_VkDevice, retired.memory, nullptr);
+
+	if (retired.stagingBuffer)
+	{
+		retired.stagingBuffer->Destroy();
+		delete retired.stagingBuffer;
+	}
+}
+
+bool GP2_TextureStreamer::MakeRoom(VkDeviceSize neededBytes, Handle keep, VkCommandBuffer cmdBuffer)
+{
+	while (m_ResidentBytes + neededBytes > m_Settings.budget)
+	{
+		Texture* victim = nullptr;
+		for (Handle handle = 0; handle < m_Textures.size(); ++handle)
+		{
+			Texture& texture = m_Textures[handle];
+			if (handle == keep || texture.residentLevel >= GetKeepLevel(texture))
+				continue;
+
+			if (!victim || texture.lastNeededFrame < victim->lastNeededFrame)
+				victim = &texture;
+		}
+
+		if (!victim)
+			return false;
+
+		// an evicted texture is rarely needed again soon, its cached levels are not worth the host memory
+		Reallocate(*victim, victim->residentLevel + 1, nullptr, cmdBuffer);
+		DropLevels(*victim);
+	}
+
+	return true;
+}
+
+uint32_t GP2_TextureStreamer::GetKeepLevel(const Texture& texture) const
+{
+	if (texture.lastNeededFrame < m_Frame)
+		return texture.tailLevel;
+
+	return (std::min)(texture.wantedLevel, texture.tailLevel);
+}
+
+VkDeviceSize GP2_TextureStreamer::GetLevelBytes(const Texture& texture, uint32_t level) const
+{
+	const uint32_t width = GP2_TextureCompression::GetMipDimension(texture.width, level);
+	const uint32_t height = GP2_TextureCompression::GetMipDimension(texture.height, level);
+
+	switch (texture.format)
+	{
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		return VkDeviceSize((width + 3) / 4) * ((height + 3) / 4) * 8;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return VkDeviceSize((width + 3) / 4) * ((height + 3) / 4) * 16;
+	case VK_FORMAT_R8_UNORM:
+		return VkDeviceSize(width) * height;
+	case VK_FORMAT_R8G8_UNORM:
+		return VkDeviceSize(width) * height * 2;
+	default:
+		return VkDeviceSize(width) * height * 4;
+	}
+}
+
+VkDeviceSize GP2_TextureStreamer::GetLevelRangeBytes(const Texture& texture, uint32_t firstLevel, uint32_t endLevel) const
+{
+	VkDeviceSize bytes = 0;
+	for (uint32_t level = firstLevel; level < endLevel; ++level)
+	{
+		bytes += GetLevelBytes(texture, level);
+	}
+	return bytes;
+}
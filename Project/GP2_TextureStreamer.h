@@ -0,0 +1,187 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GP2_TextureCompression.h"
+
+class GP2_Buffer;
+class GP2_DescriptorPool;
+class GP2_UploadBatch;
+
+// Texture residency for the pbr materials. A texture starts with only its coarse mips (the tail, every level
+// up to Settings::tailSize) on the gpu. Pipelines report how large their geometry is on screen each frame, which
+// decides the finest level each texture needs. A texture's first load runs on the texture decoder's threads and
+// puts every level (cooked dds levels, or a decoded png with mips built on the cpu) into a staging buffer, which
+// the texture keeps until all its levels are resident or it loses one to the budget; until then requests are
+// served from it without decoding again. Update records a copy into a larger
+// image that takes the new levels from a staging buffer and the resident ones from the old image. When the
+// resident levels exceed the budget, the finest level of the least recently needed textures is dropped the
+// same way, into a smaller image. Tails are never evicted.
+//
+// Images are swapped at the start of a frame, so the streamer rewrites the descriptor bindings registered with
+// AddBinding before anything is recorded, and destroys the old image once that frame's fence has passed.
+class GP2_TextureStreamer
+{
+public:
+	using Handle = uint32_t;
+
+	struct Settings {
+		// gpu memory all resident levels may use together, tails included
+		VkDeviceSize budget{ 256ull * 1024 * 1024 };
+		// levels whose larger side is at most this many texels are loaded at startup and never evicted
+		uint32_t tailSize{ 64 };
+		// level loads queued on the decoder at once
+		uint32_t maxLoadsInFlight{ 4 };
+	};
+
+	GP2_TextureStreamer() = default;
+	~GP2_TextureStreamer() = default;
+
+	GP2_TextureStreamer(const GP2_TextureStreamer&) = delete;
+	GP2_TextureStreamer& operator=(const GP2_TextureStreamer&) = delete;
+
+	// needs the context's texture decoder
+	void Initialize(const VulkanContext& context, const Settings& settings);
+	void Destroy();
+
+	// queues the tail load, Packed textures take the red channel of filePath and of greenFilePath
+	Handle Register(const std::string& filePath, GP2_TextureUsage usage, const std::string& greenFilePath = "");
+	// waits for the tail, creates the first image and records its upload into the batch
+	void Upload(Handle handle, GP2_UploadBatch& uploadBatch);
+
+	VkImageView GetView(Handle handle) const { return m_Textures[handle].view; };
+	VkSampler GetSampler() const { return m_Sampler; };
+
+	// binding of a material set that samples the texture, rewritten whenever its image changes
+	void AddBinding(Handle handle, GP2_DescriptorPool* descriptorPool, uint32_t binding);
+
+	// the texture covers about screenPixels pixels along its larger side this frame
+	void RequestScreenSize(Handle handle, float screenPixels);
+
+	// after the frame's fence and before anything that samples the textures is recorded
+	void Update(VkCommandBuffer cmdBuffer);
+
+	VkDeviceSize GetResidentBytes() const { return m_ResidentBytes; };
+	// level loads queued on the decoder or waiting for their upload
+	uint32_t GetLoadsInFlight() const { return m_LoadsInFlight; };
+	void PrintStatistics() const;
+
+private:
+	// every level of a texture back to back in a staging buffer, produced on a decoder thread
+	struct LoadedLevels {
+		VkFormat format{ VK_FORMAT_UNDEFINED };
+		uint32_t width{};
+		uint32_t height{};
+		uint32_t levelCount{};
+		GP2_Buffer* stagingBuffer{ nullptr };
+		// where each level starts in the staging buffer
+		std::vector<VkDeviceSize> offsets{};
+	};
+
+	struct PendingLoad {
+		std::shared_ptr<LoadedLevels> result{};
+		std::future<void> done{};
+		// finest level the load is for, after clamping to the budget, UINT32_MAX for the tail
+		uint32_t firstLevel{};
+	};
+
+	struct Source {
+		std::string filePath{};
+		std::string greenFilePath{};
+		GP2_TextureUsage usage{ GP2_TextureUsage::Albedo };
+		// a cooked dds next to the source, read instead of decoding it
+		std::string cookedPath{};
+	};
+
+	struct Texture {
+		Source source{};
+
+		VkFormat format{ VK_FORMAT_UNDEFINED };
+		uint32_t width{};
+		uint32_t height{};
+		uint32_t levelCount{};
+		uint32_t tailLevel{};
+		// finest level on the gpu, the image's mip 0
+		uint32_t residentLevel{};
+		// finest level this frame's draws asked for, levelCount when nothing drew the texture
+		uint32_t wantedLevel{};
+		uint64_t lastNeededFrame{};
+
+		VkImage image{ VK_NULL_HANDLE };
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkImageView view{ VK_NULL_HANDLE };
+
+		PendingLoad load{};
+		// every level from the last load, see DropLevels
+		std::shared_ptr<LoadedLevels> levels{};
+		std::vector<std::pair<GP2_DescriptorPool*, uint32_t>> bindings{};
+	};
+
+	// everything one image swap leaves behind, destroyed at the next Update
+	struct Retired {
+		VkImage image{ VK_NULL_HANDLE };
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkImageView view{ VK_NULL_HANDLE };
+		GP2_Buffer* stagingBuffer{ nullptr };
+	};
+
+	// runs on a decoder thread, a png's level 0 is decoded straight into the staging buffer
+	static void LoadLevels(const VulkanContext& context, const Source& source, GP2_TextureDecoder* decoder, LoadedLevels& result);
+	void QueueLoad(Handle handle, uint32_t firstLevel);
+
+	// replaces the image with one whose mip 0 is newResidentLevel, loaded holds the levels the old image lacks
+	void Reallocate(Texture& texture, uint32_t newResidentLevel, const LoadedLevels* loaded, VkCommandBuffer cmdBuffer);
+	void CreateImage(Texture& texture, uint32_t residentLevel);
+	void UpdateBindings(const Texture& texture) const;
+	// retires the staging buffer of the texture's cached levels, the next request for a level decodes again
+	void DropLevels(Texture& texture);
+	void Release(const Retired& retired);
+
+	// evicts the finest level of the least recently needed textures until neededBytes more fit in the budget
+	bool MakeRoom(VkDeviceSize neededBytes, Handle keep, VkCommandBuffer cmdBuffer);
+	// levels finer than this can be evicted: the tail for textures nothing drew last frame, the wanted level otherwise
+	uint32_t GetKeepLevel(const Texture& texture) const;
+
+	VkDeviceSize GetLevelBytes(const Texture& texture, uint32_t level) const;
+	VkDeviceSize GetLevelRangeBytes(const Texture& texture, uint32_t firstLevel, uint32_t endLevel) const;
+
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	{
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(m_VkPhysicalDevice, &memProperties);
+
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+	Settings m_Settings{};
+	VulkanContext m_Context{};
+
+	VkDevice m_VkDevice{ VK_NULL_HANDLE };
+	VkPhysicalDevice m_VkPhysicalDevice{ VK_NULL_HANDLE };
+	GP2_TextureDecoder* m_Decoder{ nullptr };
+	bool m_SupportsBC{ false };
+
+	VkSampler m_Sampler{ VK_NULL_HANDLE };
+
+	std::vector<Texture> m_Textures{};
+	std::vector<Retired> m_Retired{};
+
+	VkDeviceSize m_ResidentBytes{};
+	// starts at 1, textures that were never drawn have lastNeededFrame 0
+	uint64_t m_Frame{ 1 };
+	uint32_t m_LoadsInFlight{};
+};
@@ -0,0 +1,116 @@
+#include "GP2_UniformRing.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_ResourceCache.h"
+#include "GP2_DescriptorAllocator.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+void GP2_UniformRing::Initialize(const VulkanContext& context, size_t frameCount, VkDeviceSize bytesPerFrame, VkDeviceSize cameraRange, VkDeviceSize objectRange)
+{
+	GP2_CPU_ZONE("GP2_UniformRing::Initialize");
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(context.physicalDevice, &properties);
+	m_Alignment = properties.limits.minUniformBufferOffsetAlignment;
+
+	m_BytesPerFrame = (bytesPerFrame + m_Alignment - 1) / m_Alignment * m_Alignment;
+	m_CameraRange = cameraRange;
+	m_ObjectRange = objectRange;
+
+	// the identity slot sits behind the last frame's slice, BeginFrame never hands it out
+	const VkDeviceSize identitySize = (std::max)(objectRange, VkDeviceSize(sizeof(glm::mat4)));
+	m_IdentityObjectOffset = static_cast<uint32_t>(m_BytesPerFrame * frameCount);
+
+	m_Buffer = new GP2_Buffer{ context, m_BytesPerFrame * frameCount + identitySize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+
+	void* mapped{};
+	m_Buffer->MapMemory(&mapped);
+	m_Mapped = static_cast<uint8_t*>(mapped);
+
+	const glm::mat4 identity{ 1.f };
+	memset(m_Mapped + m_IdentityObjectOffset, 0, static_cast<size_t>(identitySize));
+	memcpy(m_Mapped + m_IdentityObjectOffset, &identity, sizeof(identity));
+
+	CreateDescriptorSet(context);
+}
+
+void GP2_UniformRing::Destroy()
+{
+	m_Buffer->Destroy();
+	delete m_Buffer;
+	m_Buffer = nullptr;
+	m_Mapped = nullptr;
+}
+
+void GP2_UniformRing::BeginFrame(size_t frameIndex)
+{
+	m_Head = m_BytesPerFrame * frameIndex;
+	m_FrameEnd = m_Head + m_BytesPerFrame;
+}
+
+uint32_t GP2_UniformRing::Push(const void* data, VkDeviceSize size)
+{
+	const VkDeviceSize offset = (m_Head + m_Alignment - 1) / m_Alignment * m_Alignment;
+	if (offset + size > m_FrameEnd)
+		throw std::runtime_error("uniform ring ran out of space for this frame!");
+
+	memcpy(m_Mapped + offset, data, static_cast<size_t>(size));
+	m_Head = offset + size;
+
+	return static_cast<uint32_t>(offset);
+}
+
+void GP2_UniformRing::BindDescriptorSet(VkCommandBuffer cmdBuffer, VkPipelineLayout layout, uint32_t cameraOffset, uint32_t objectOffset,
+	VkPipelineBindPoint bindPoint) const
+{
+	std::array<uint32_t, 2> dynamicOffsets{ cameraOffset, objectOffset };
+	vkCmdBindDescriptorSets(cmdBuffer, bindPoint, layout, 0, 1, &m_DescriptorSet,
+		static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+}
+
+void GP2_UniformRing::CreateDescriptorSet(const VulkanContext& context)
+{
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings(2);
+	layoutBindings[0].binding = 0;
+	layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	layoutBindings[0].descriptorCount = 1;
+	layoutBindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	layoutBindings[0].pImmutableSamplers = nullptr;
+
+	layoutBindings[1].binding = 1;
+	layoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	layoutBindings[1].descriptorCount = 1;
+	layoutBindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	layoutBindings[1].pImmutableSamplers = nullptr;
+
+	m_DescriptorSetLayout = context.resourceCache->GetDescriptorSetLayout(layoutBindings);
+	m_DescriptorSet = context.descriptorAllocator->Allocate(m_DescriptorSetLayout);
+
+	std::array<VkDescriptorBufferInfo, 2> bufferInfos{};
+	bufferInfos[0].buffer = m_Buffer->GetVkBuffer();
+	bufferInfos[0].offset = 0;
+	bufferInfos[0].range = m_CameraRange;
+
+	bufferInfos[1].buffer = m_Buffer->GetVkBuffer();
+	bufferInfos[1].offset = 0;
+	bufferInfos[1].range = m_ObjectRange;
+
+	std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+	for (size_t idx = 0; idx < descriptorWrites.size(); ++idx)
+	{
+		descriptorWrites[idx].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[idx].dstSet = m_DescriptorSet;
+		descriptorWrites[idx].dstBinding = static_cast<uint32_t>(idx);
+		descriptorWrites[idx].dstArrayElement = 0;
+		descriptorWrites[idx].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		descriptorWrites[idx].descriptorCount = 1;
+		descriptorWrites[idx].pBufferInfo = &bufferInfos[idx];
+	}
+
+	vkUpdateDescriptorSets(context.device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+#include <vulkanbase/VulkanUtil.h>
+
+#include "GP2_Buffer.h"
+
+// One persistently mapped uniform buffer split into a slice per frame in flight. Everything that changes
+// per frame (camera, per-object constants) is pushed into the current slice and addressed through dynamic
+// offsets on a single descriptor set, so no pipeline owns its own uniform buffer anymore.
+//
+// Set 0 of every pipeline layout is this ring's set:
+//   binding 0: camera data (UNIFORM_BUFFER_DYNAMIC, also visible to compute for culling)
+//   binding 1: object data (UNIFORM_BUFFER_DYNAMIC)
+class GP2_UniformRing
+{
+public:
+	GP2_UniformRing() = default;
+	~GP2_UniformRing() = default;
+
+	GP2_UniformRing(const GP2_UniformRing&) = delete;
+	GP2_UniformRing& operator=(const GP2_UniformRing&) = delete;
+
+	void Initialize(const VulkanContext& context, size_t frameCount, VkDeviceSize bytesPerFrame, VkDeviceSize cameraRange, VkDeviceSize objectRange);
+	void Destroy();
+
+	void BeginFrame(size_t frameIndex);
+
+	uint32_t Push(const void* data, VkDeviceSize size);
+
+	template<class T>
+	uint32_t Push(const T& data) { return Push(&data, sizeof(T)); }
+
+	// object slot holding an identity model matrix, written once at Initialize and outside every frame's slice,
+	// for draws whose transforms live somewhere else (instances)
+	uint32_t GetIdentityObjectOffset() const { return m_IdentityObjectOffset; }
+
+	void BindDescriptorSet(VkCommandBuffer cmdBuffer, VkPipelineLayout layout, uint32_t cameraOffset, uint32_t objectOffset,
+		VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) const;
+
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_DescriptorSetLayout; }
+	VkBuffer GetVkBuffer() const { return m_Buffer->GetVkBuffer(); }
+
+private:
+	void CreateDescriptorSet(const VulkanContext& context);
+
+	GP2_Buffer* m_Buffer{ nullptr };
+	uint8_t* m_Mapped{ nullptr };
+
+	VkDeviceSize m_Alignment{};
+	VkDeviceSize m_BytesPerFrame{};
+	VkDeviceSize m_CameraRange{};
+	VkDeviceSize m_ObjectRange{};
+
+	VkDeviceSize m_FrameEnd{};
+	VkDeviceSize m_Head{};
+
+	uint32_t m_IdentityObjectOffset{};
+
+	VkDescriptorSetLayout m_DescriptorSetLayout{ VK_NULL_HANDLE };
+	VkDescriptorSet m_DescriptorSet{ VK_NULL_HANDLE };
+};
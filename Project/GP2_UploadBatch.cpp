@@ -0,0 +1,243 @@
+#include "GP2_UploadBatch.h"
+#include "GP2_CpuProfiler.h"
+#include "GP2_Buffer.h"
+#include "GP2_TextureCompression.h"
+
+#include <vulkanbase/VulkanBase.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+void GP2_UploadBatch::Initialize(VkDevice device, const QueueFamilyIndices& queueFamInd)
+{
+	GP2_CPU_ZONE("GP2_UploadBatch::Initialize");
+	m_VkDevice = device;
+	m_CommandPool.Initialize(device, queueFamInd);
+}
+
+void GP2_UploadBatch::Destroy()
+{
+	for (GP2_Buffer* stagingBuffer : m_StagingBuffers)
+	{
+		stagingBuffer->Destroy();
+		delete stagingBuffer;
+	}
+	m_StagingBuffers.clear();
+
+	m_CommandPool.Destroy();
+}
+
+void GP2_UploadBatch::AddImage(const GP2_ImageUpload& upload)
+{
+	if (upload.regions.empty()) {
+		throw std::invalid_argument("image upload without a copied level!");
+	}
+
+	m_Uploads.push_back(upload);
+}
+
+void GP2_UploadBatch::AddTransition(VkImage image, const VkImageSubresourceRange& range, VkImageLayout newLayout, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStage)
+{
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = range;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = dstAccessMask;
+
+	m_Transitions.push_back(barrier);
+	m_TransitionStages |= dstStage;
+}
+
+void GP2_UploadBatch::AddStagingBuffer(GP2_Buffer* stagingBuffer)
+{
+	m_StagingBuffers.push_back(stagingBuffer);
+}
+
+void GP2_UploadBatch::Submit(VkQueue graphicsQueue)
+{
+	if (m_Uploads.empty() && m_Transitions.empty())
+		return;
+
+	GP2_CommandBuffer cmdBuffer = m_CommandPool.CreateCommandBuffer();
+	cmdBuffer.BeginRecording(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	// every image out of UNDEFINED at once, the data-less transitions included
+	std::vector<VkImageMemoryBarrier> barriers{ m_Transitions };
+	for (const GP2_ImageUpload& upload : m_Uploads)
+	{
+		barrier.image = upload.image;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = upload.mipLevels;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barriers.push_back(barrier);
+	}
+
+	vkCmdPipelineBarrier(cmdBuffer.GetVkCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | m_TransitionStages,
+		0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	for (const GP2_ImageUpload& upload : m_Uploads)
+	{
+		vkCmdCopyBufferToImage(cmdBuffer.GetVkCommandBuffer(), upload.buffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(upload.regions.size()), upload.regions.data());
+	}
+
+	RecordMipmaps(cmdBuffer.GetVkCommandBuffer());
+
+	// blit sources ended in TRANSFER_SRC, everything else is still TRANSFER_DST
+	barriers.clear();
+	for (const GP2_ImageUpload& upload : m_Uploads)
+	{
+		barrier.image = upload.image;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		const uint32_t copiedLevels = static_cast<uint32_t>(upload.regions.size());
+		const uint32_t firstSource = copiedLevels < upload.mipLevels ? copiedLevels - 1 : upload.mipLevels;
+		const uint32_t lastLevel = upload.mipLevels - 1;
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		if (firstSource > 0)
+		{
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = (std::min)(firstSource, upload.mipLevels);
+			barriers.push_back(barrier);
+		}
+		if (firstSource < upload.mipLevels)
+		{
+			barrier.subresourceRange.baseMipLevel = lastLevel;
+			barrier.subresourceRange.levelCount = 1;
+			barriers.push_back(barrier);
+
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.subresourceRange.baseMipLevel = firstSource;
+			barrier.subresourceRange.levelCount = lastLevel - firstSource;
+			barriers.push_back(barrier);
+		}
+	}
+
+	if (!barriers.empty())
+	{
+		vkCmdPipelineBarrier(cmdBuffer.GetVkCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+	}
+
+	cmdBuffer.EndRecording();
+
+	VkSubmitInfo submitInfo{};
+	cmdBuffer.Submit(submitInfo);
+	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	vkQueueWaitIdle(graphicsQueue);
+
+	auto rawBuffer = cmdBuffer.GetVkCommandBuffer();
+	vkFreeCommandBuffers(m_VkDevice, m_CommandPool.GetVkCommandPool(), 1, &rawBuffer);
+
+	for (GP2_Buffer* stagingBuffer : m_StagingBuffers)
+	{
+		stagingBuffer->Destroy();
+		delete stagingBuffer;
+	}
+	m_StagingBuffers.clear();
+	m_Uploads.clear();
+	m_Transitions.clear();
+	m_TransitionStages = 0;
+}
+
+void GP2_UploadBatch::RecordTransitions(VkCommandBuffer cmdBuffer)
+{
+	if (!m_Uploads.empty()) {
+		throw std::runtime_error("image uploads can't be recorded into a frame!");
+	}
+
+	if (m_Transitions.empty())
+		return;
+
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_TransitionStages,
+		0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(m_Transitions.size()), m_Transitions.data());
+
+	m_Transitions.clear();
+	m_TransitionStages = 0;
+}
+
+void GP2_UploadBatch::RecordMipmaps(VkCommandBuffer cmdBuffer) const
+{
+	uint32_t maxLevels = 0;
+	for (const GP2_ImageUpload& upload : m_Uploads)
+	{
+		maxLevels = (std::max)(maxLevels, upload.mipLevels);
+	}
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	// level by level across all images, so each level costs one barrier for the whole batch
+	std::vector<VkImageMemoryBarrier> barriers{};
+	std::vector<const GP2_ImageUpload*> blitted{};
+	for (uint32_t level = 1; level < maxLevels; ++level)
+	{
+		barriers.clear();
+		blitted.clear();
+		for (const GP2_ImageUpload& upload : m_Uploads)
+		{
+			if (level < upload.regions.size() || level >= upload.mipLevels)
+				continue;
+
+			// the level above has been written, it becomes the blit source
+			barrier.image = upload.image;
+			barrier.subresourceRange.baseMipLevel = level - 1;
+			barriers.push_back(barrier);
+			blitted.push_back(&upload);
+		}
+
+		if (barriers.empty())
+			continue;
+
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+		for (const GP2_ImageUpload* upload : blitted)
+		{
+			VkImageBlit blit{};
+			blit.srcOffsets[0] = { 0, 0, 0 };
+			blit.srcOffsets[1] = { static_cast<int32_t>(GP2_TextureCompression::GetMipDimension(upload->width, level - 1)),
+				static_cast<int32_t>(GP2_TextureCompression::GetMipDimension(upload->height, level - 1)), 1 };
+			blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+			blit.dstOffsets[0] = { 0, 0, 0 };
+			blit.dstOffsets[1] = { static_cast<int32_t>(GP2_TextureCompression::GetMipDimension(upload->width, level)),
+				static_cast<int32_t>(GP2_TextureCompression::GetMipDimension(upload->height, level)), 1 };
+			blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+
+			vkCmdBlitImage(cmdBuffer,
+				upload->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				upload->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &blit, VK_FILTER_LINEAR);
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+
+#include "GP2_CommandPool.h"
+
+#include <vector>
+
+class GP2_Buffer;
+struct QueueFamilyIndices;
+
+// one image filled from a staging buffer, mip levels past the copied ones are blitted from the level above
+struct GP2_ImageUpload {
+	VkImage image{ VK_NULL_HANDLE };
+	uint32_t width{};
+	uint32_t height{};
+	uint32_t mipLevels{ 1 };
+	VkBuffer buffer{ VK_NULL_HANDLE };
+	// one region per copied level, starting at level 0
+	std::vector<VkBufferImageCopy> regions{};
+};
+
+// Collects the startup uploads of several images and records them into a single command buffer: one barrier
+// moves every image to TRANSFER_DST, then all buffer copies, one barrier per mip level blitted across all
+// images, and one barrier hands everything to the shaders. Submit is the only queue round-trip.
+class GP2_UploadBatch
+{
+public:
+	GP2_UploadBatch() = default;
+	~GP2_UploadBatch() = default;
+
+	void Initialize(VkDevice device, const QueueFamilyIndices& queueFamInd);
+	void Destroy();
+
+	// ends in SHADER_READ_ONLY_OPTIMAL
+	void AddImage(const GP2_ImageUpload& upload);
+	// layout change out of UNDEFINED without any data, for attachments and storage images
+	void AddTransition(VkImage image, const VkImageSubresourceRange& range, VkImageLayout newLayout, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStage);
+	// destroyed once the batch has executed
+	void AddStagingBuffer(GP2_Buffer* stagingBuffer);
+
+	// records everything added since the last submit, submits once and waits for it
+	void Submit(VkQueue graphicsQueue);
+	// records only the transitions into a frame's command buffer instead, for images replaced while frames are
+	// in flight; throws if images with data were added
+	void RecordTransitions(VkCommandBuffer cmdBuffer);
+
+private:
+	void RecordMipmaps(VkCommandBuffer cmdBuffer) const;
+
+	VkDevice m_VkDevice{ VK_NULL_HANDLE };
+	GP2_CommandPool m_CommandPool{};
+
+	std::vector<GP2_ImageUpload> m_Uploads{};
+	std::vector<VkImageMemoryBarrier> m_Transitions{};
+	VkPipelineStageFlags m_TransitionStages{ 0 };
+	std::vector<GP2_Buffer*> m_StagingBuffers{};
+};
@@ -111,6 +111,36 @@ struct GP2_PBRVertex {
 	}
 };
 
+// per-instance transform, streamed through vertex binding 1 at locations 4-7 (one vec4 column each)
+struct GP2_InstanceData {
+	glm::mat4 model;
+
+	static VkVertexInputBindingDescription GetBindingDescription()
+	{
+		VkVertexInputBindingDescription bindingDescription{};
+
+		bindingDescription.binding = 1;
+		bindingDescription.stride = sizeof(GP2_InstanceData);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		return bindingDescription;
+	}
+
+	static std::array<VkVertexInputAttributeDescription, 4> GetAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+
+		for (uint32_t column = 0; column < 4; ++column)
+		{
+			attributeDescriptions[column].binding = 1;
+			attributeDescriptions[column].location = 4 + column;
+			attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			attributeDescriptions[column].offset = offsetof(GP2_InstanceData, model) + sizeof(glm::vec4) * column;
+		}
+
+		return attributeDescriptions;
+	}
+};
+
 struct GP2_ViewProjection {
 	glm::mat4 proj;
 	glm::mat4 view;
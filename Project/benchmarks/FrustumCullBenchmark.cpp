@@ -0,0 +1,88 @@
+#include "GP2_FrustumCuller.h"
+#include "GP2_BVH.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// Culls 100k random spheres against the app's camera frustum with the scalar and the simd path, and
+// with a bvh query over the same spheres.
+// Usage: FrustumCullBenchmark [objectCount] [iterations]
+
+namespace
+{
+	template<class Function>
+	double MeasureMilliseconds(int iterations, Function function)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		for (int idx = 0; idx < iterations; ++idx)
+		{
+			function();
+		}
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t objectCount = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 100000;
+	const int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+
+	std::mt19937 generator{ 1337 };
+	std::uniform_real_distribution<float> position{ -500.f, 500.f };
+	std::uniform_real_distribution<float> radius{ 0.5f, 5.f };
+
+	GP2_FrustumCuller culler{};
+	std::vector<GP2_AABB> bounds{};
+	for (size_t idx = 0; idx < objectCount; ++idx)
+	{
+		const glm::vec4 sphere{ position(generator), position(generator), position(generator), radius(generator) };
+		culler.AddSphere(sphere);
+		bounds.push_back(GP2_AABB::FromSphere(sphere));
+	}
+
+	GP2_BVH bvh{};
+	const auto buildStart = std::chrono::high_resolution_clock::now();
+	bvh.Build(bounds);
+	const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - buildStart).count();
+	const double refitMs = MeasureMilliseconds(10, [&]() { bvh.Refit(bounds); });
+
+	// same camera setup as VulkanBase::drawFrame
+	glm::mat4 proj = glm::perspective(glm::radians(45.f), 800.f / 600.f, 0.1f, 100.f);
+	proj[1][1] *= -1;
+	const glm::mat4 view = glm::lookAt(glm::vec3{ 0.f, 5.f, 50.f }, glm::vec3{ 0.f, 5.f, 0.f }, glm::vec3{ 0.f, 1.f, 0.f });
+	const glm::mat4 viewProjection = proj * view;
+
+	std::vector<uint32_t> scalarVisible{};
+	std::vector<uint32_t> simdVisible{};
+	scalarVisible.reserve(objectCount);
+	simdVisible.reserve(objectCount);
+
+	const double scalarMs = MeasureMilliseconds(iterations, [&]() { culler.CullScalar(viewProjection, scalarVisible); });
+	const double simdMs = MeasureMilliseconds(iterations, [&]() { culler.Cull(viewProjection, simdVisible); });
+
+	// boxes are looser than the spheres, so the bvh returns a superset of the sphere results
+	std::vector<uint32_t> bvhVisible{};
+	bvhVisible.reserve(objectCount);
+	const double bvhMs = MeasureMilliseconds(iterations, [&]() { bvhVisible.clear(); bvh.QueryFrustum(viewProjection, glm::vec3{ 0.f, 5.f, 50.f }, bvhVisible); });
+
+	std::cout << objectCount << " spheres, " << iterations << " iterations\n";
+	std::cout << "scalar: " << scalarMs << " ms, " << scalarVisible.size() << " visible\n";
+	std::cout << GP2_FrustumCuller::GetSimdName() << ": " << simdMs << " ms, " << simdVisible.size() << " visible\n";
+	std::cout << "speedup: " << scalarMs / simdMs << "x\n";
+	std::cout << "bvh: " << bvhMs << " ms, " << bvhVisible.size() << " visible, " << bvh.GetNodeCount() << " nodes, build "
+		<< buildMs << " ms, refit " << refitMs << " ms\n";
+
+	if (scalarVisible != simdVisible)
+	{
+		std::cerr << "simd and scalar results differ!\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
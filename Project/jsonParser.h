@@ -3,9 +3,11 @@
 #include <vulkanbase/VulkanUtil.h>
 #include <vulkan/vulkan_core.h>
 #include <fstream>
+#include <algorithm>
 #include "3rdParty/json.hpp"
 
 #include "GP2_UniformBufferObject.h"
+#include "GP2_CpuProfiler.h"
 
 #include "GP2_PBRMetalnessPipeline.h"
 #include "GP2_PBRSpecularPipeline.h"
@@ -27,6 +29,7 @@ struct Pipeline {
     std::string pipeline;
     std::string vertex_file;
     std::string fragment_file;
+    std::string gbuffer_fragment_file;
     std::vector<Object> objects;
 };
 
@@ -39,10 +42,11 @@ struct QueueFamilyIndices {
 	}
 };
 
-static std::vector<GP2_PBRBasePipeline<UniformBufferObject, GP2_PBRVertex>* > parseScene(const std::string& file, const VulkanContext& context, GP2_CommandBuffer cmdBuffer, QueueFamilyIndices queueFam,
-    VkQueue graphicsQueue, int maxFrames)
+static std::vector<GP2_PBRBasePipeline<GP2_PBRVertex>* > parseScene(const std::string& file, const VulkanContext& context, GP2_CommandBuffer cmdBuffer, QueueFamilyIndices queueFam,
+    VkQueue graphicsQueue, int maxFrames, GP2_GeometryArena<GP2_PBRVertex>& geometryArena)
 {
-    std::vector<GP2_PBRBasePipeline<UniformBufferObject, GP2_PBRVertex>* > createdPipelines;
+    GP2_CPU_ZONE("parseScene");
+    std::vector<GP2_PBRBasePipeline<GP2_PBRVertex>* > createdPipelines;
 
 	std::ifstream f(file);
 
@@ -54,31 +58,69 @@ static std::vector<GP2_PBRBasePipeline<UniformBufferObject, GP2_PBRVertex>* > pa
         for (const json& pipeline : j["pipelines"])
         {
             if (pipeline["pipeline"].get<std::string>() == "PBRMetalness")
-                createdPipelines.push_back(new GP2_PBRMetalnessPipeline<UniformBufferObject, GP2_PBRVertex>{
-                    pipeline["vertex file"], pipeline["fragment file"] });
+                createdPipelines.push_back(new GP2_PBRMetalnessPipeline<GP2_PBRVertex>{
+                    pipeline["vertex file"], pipeline["fragment file"], pipeline["gbuffer fragment file"] });
             else if (pipeline["pipeline"].get<std::string>() == "PBRSpecular")
-                createdPipelines.push_back(new GP2_PBRSpecularPipeline<UniformBufferObject, GP2_PBRVertex>{
-                    pipeline["vertex file"], pipeline["fragment file"] });
+                createdPipelines.push_back(new GP2_PBRSpecularPipeline<GP2_PBRVertex>{
+                    pipeline["vertex file"], pipeline["fragment file"], pipeline["gbuffer fragment file"] });
             else throw std::invalid_argument("unknown pipeline type to parser");
 
+            // objects in a pipeline share its material, so every object using the same obj file
+            // becomes an instance of one mesh and the whole group is a single draw call
+            std::vector<std::pair<std::string, std::unique_ptr<GP2_Mesh<GP2_PBRVertex>>>> meshes;
             for (const json& meshj : pipeline["objects"])
             {
-                auto mesh = std::make_unique<GP2_Mesh<GP2_PBRVertex>>();
-                mesh->ParseOBJ(meshj["file"], meshj["winding"]);
-                mesh->Initialize(context, cmdBuffer, queueFam, graphicsQueue);
+                const std::string meshKey = meshj["file"].get<std::string>() + (meshj["winding"].get<bool>() ? "|flipped" : "");
+
+                auto it = std::find_if(meshes.begin(), meshes.end(), [&meshKey](const auto& entry) { return entry.first == meshKey; });
+                if (it == meshes.end())
+                {
+                    auto mesh = std::make_unique<GP2_Mesh<GP2_PBRVertex>>();
+                    mesh->ParseOBJ(meshj["file"], meshj["winding"]);
+                    meshes.emplace_back(meshKey, std::move(mesh));
+                    it = meshes.end() - 1;
+                }
 
                 auto model = glm::translate(glm::mat4{ 1.f }, glm::vec3{ meshj["translation"][0], meshj["translation"][1] , meshj["translation"][2] });
                 model = glm::rotate(model, glm::radians(meshj["rotation angle"].get<float>()), glm::vec3{meshj["rotation axis"][0], meshj["rotation axis"][1], meshj["rotation axis"][2]});
                 model = glm::scale(model, glm::vec3{ meshj["scale"][0], meshj["scale"][1], meshj["scale"][2] });
-                mesh->SetVertexConstant(model);
 
-                createdPipelines[createdPipelines.size() - 1]->AddMesh(std::move(mesh));
+                // optional "instance grid": { "count": [x, y, z], "spacing": [x, y, z] } repeats the object on a grid
+                if (meshj.contains("instance grid"))
+                {
+                    const json& grid = meshj["instance grid"];
+                    for (int x = 0; x < grid["count"][0].get<int>(); ++x)
+                        for (int y = 0; y < grid["count"][1].get<int>(); ++y)
+                            for (int z = 0; z < grid["count"][2].get<int>(); ++z)
+                            {
+                                const glm::vec3 offset{ x * grid["spacing"][0].get<float>(), y * grid["spacing"][1].get<float>(), z * grid["spacing"][2].get<float>() };
+                                it->second->AddInstance(glm::translate(glm::mat4{ 1.f }, offset) * model);
+                            }
+                }
+                else it->second->AddInstance(model);
+            }
+
+            // no per-mesh buffers, the geometry arena uploads everything once after parsing
+            for (auto& mesh : meshes)
+            {
+                createdPipelines[createdPipelines.size() - 1]->AddMesh(std::move(mesh.second));
             }
 
             createdPipelines[createdPipelines.size() - 1]->SetTextureMaps(context, pipeline["texture files"][0], pipeline["texture files"][1], 
-                pipeline["texture files"][2], pipeline["texture files"][3], queueFam, graphicsQueue);
-            createdPipelines[createdPipelines.size() - 1]->Initialize(context, maxFrames);
+                pipeline["texture files"][2], pipeline["texture files"][3]);
+        }
+
+        // every texture of the scene is decoding by now, uploading waits for each in turn and the whole scene
+        // goes to the gpu in one submit
+        GP2_UploadBatch uploadBatch{};
+        uploadBatch.Initialize(context.device, queueFam);
+        for (auto* createdPipeline : createdPipelines)
+        {
+            createdPipeline->UploadTextureMaps(uploadBatch);
+            createdPipeline->Initialize(context, maxFrames, geometryArena);
         }
+        uploadBatch.Submit(graphicsQueue);
+        uploadBatch.Destroy();
 
         f.close();
     }
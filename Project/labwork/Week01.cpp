@@ -2,15 +2,22 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <cmath>
+#include <algorithm>
 
 void VulkanBase::initWindow() {
 	glfwInit();
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 	window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
 
-	// camera stuff
 	glfwSetWindowUserPointer(window, this);
+	// not every platform reports a resize through the swap chain
+	glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height) {
+		void* pUser = glfwGetWindowUserPointer(window);
+		VulkanBase* vBase = static_cast<VulkanBase*>(pUser);
+		vBase->m_FramebufferResized = true;
+		});
+
+	// camera stuff
 	glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
 		void* pUser = glfwGetWindowUserPointer(window);
 		VulkanBase* vBase = static_cast<VulkanBase*>(pUser);
@@ -50,7 +57,38 @@ void VulkanBase::keyEvent(int key, int scancode, int action, int mods)
 		{
 			pipeline->CycleRenderMode();
 		}
+		m_DeferredLighting.CycleRenderMode();
+	}
+
+	if (key == GLFW_KEY_F4 && action == GLFW_PRESS)
+		m_OcclusionCulling = !m_OcclusionCulling;
+
+	if (key == GLFW_KEY_F5 && action == GLFW_PRESS)
+		m_UseDepthPrepass = !m_UseDepthPrepass;
+
+	// the g-buffer pass and its targets only exist in a deferred graph, the frame in flight may still use the old one
+	if (key == GLFW_KEY_F6 && action == GLFW_PRESS)
+	{
+		m_UseDeferred = !m_UseDeferred;
+		m_FrameGraph.Retire(m_RetireQueue);
+		createFrameGraph();
+		createGBufferPipelines();
 	}
+
+	if (key == GLFW_KEY_F7 && action == GLFW_PRESS)
+		m_ShadowCascades.SetEnabled(!m_ShadowCascades.IsEnabled());
+
+	if (key == GLFW_KEY_F8 && action == GLFW_PRESS)
+		m_TextureStreamer.PrintStatistics();
+
+	if (key == GLFW_KEY_F9 && action == GLFW_PRESS)
+		m_GpuProfiler.CaptureTrace("gpu_trace.json", m_TraceFrameCount);
+
+	if (key == GLFW_KEY_F10 && action == GLFW_PRESS)
+		m_GpuProfiler.PrintAverages();
+
+	if (key == GLFW_KEY_F11 && action == GLFW_PRESS)
+		GP2_CpuProfiler::WriteTrace("cpu_trace.json");
 }
 
 void VulkanBase::mouseMove(GLFWwindow* window, double xpos, double ypos)
@@ -78,6 +116,64 @@ void VulkanBase::mouseEvent(GLFWwindow* window, int button, int action, int mods
 		m_PrevMousePos.x = static_cast<float>(xpos);
 		m_PrevMousePos.y = static_cast<float>(ypos);
 	}
+
+	if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
+	{
+		double xpos, ypos;
+		glfwGetCursorPos(window, &xpos, &ypos);
+		pickObject(xpos, ypos);
+	}
+}
+
+void VulkanBase::buildSceneBVH()
+{
+	std::vector<GP2_AABB> bounds{};
+	for (const GP2_CullObject& object : m_PBRGeometry.GetCullObjects())
+	{
+		bounds.push_back(GP2_AABB::FromSphere(object.sphere));
+	}
+
+	m_SceneBVH.Build(bounds);
+}
+
+void VulkanBase::createSceneLights()
+{
+	GP2_AABB sceneBounds = GP2_AABB::Empty();
+	for (const GP2_CullObject& object : m_PBRGeometry.GetCullObjects())
+	{
+		sceneBounds.Grow(GP2_AABB::FromSphere(object.sphere));
+	}
+
+	if (m_PBRGeometry.GetCullObjects().empty())
+		sceneBounds = GP2_AABB{ glm::vec3{ -10.f }, glm::vec3{ 10.f } };
+
+	// lights spread through the scene with a radius that overlaps a few neighbours
+	const glm::vec3 size = sceneBounds.max - sceneBounds.min;
+	const float radius = (std::max)(glm::length(size) / std::cbrt(static_cast<float>(m_SceneLightCount)), 1.f);
+
+	m_LightSet.Clear();
+	m_LightSet.GenerateLights(m_SceneLightCount, sceneBounds.min, sceneBounds.max, radius, 1337);
+	m_LightSet.Upload();
+}
+
+void VulkanBase::pickObject(double xpos, double ypos)
+{
+	// the projection is y-flipped, so window y maps straight onto ndc y
+	const glm::vec2 ndc{ 2.f * static_cast<float>(xpos) / swapChainExtent.width - 1.f, 2.f * static_cast<float>(ypos) / swapChainExtent.height - 1.f };
+	const glm::mat4 inverseViewProjection = glm::inverse(m_LastCamera.proj * m_LastCamera.view);
+
+	glm::vec4 nearPoint = inverseViewProjection * glm::vec4{ ndc, 0.f, 1.f };
+	glm::vec4 farPoint = inverseViewProjection * glm::vec4{ ndc, 1.f, 1.f };
+	nearPoint /= nearPoint.w;
+	farPoint /= farPoint.w;
+
+	uint32_t hitObject{};
+	float hitDistance{};
+	if (m_SceneBVH.Raycast(glm::vec3(nearPoint), glm::vec3(farPoint - nearPoint), hitObject, hitDistance))
+	{
+		const GP2_CullObject& object = m_PBRGeometry.GetCullObjects()[hitObject];
+		std::cout << "picked instance " << hitObject << " of draw " << object.commandIndex << "\n";
+	}
 }
 
 glm::mat4 VulkanBase::UpdateCamera()
@@ -16,7 +16,11 @@ QueueFamilyIndices VulkanBase::findQueueFamilies(VkPhysicalDevice device) {
 		}
 
 		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		// without a surface nothing is presented, the graphics queue stands in for the present queue
+		if (m_Headless)
+			presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		else
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 
 		if (presentSupport) {
 			indices.presentFamily = i;
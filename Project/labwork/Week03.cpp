@@ -1,86 +1,61 @@
 #include "vulkanbase/VulkanBase.h"
 #include "GP2_DepthBuffer.h"
 
-void VulkanBase::createFrameBuffers() {
-	swapChainFramebuffers.resize(swapChainImageViews.size());
-	for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-		std::array<VkImageView, 2> attachments = {
-			swapChainImageViews[i],
-			m_DepthBuffer.GetDepthImageView()
-		};
-
-		VkFramebufferCreateInfo framebufferInfo{};
-		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = renderPass;
-		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		framebufferInfo.pAttachments = attachments.data();
-		framebufferInfo.width = swapChainExtent.width;
-		framebufferInfo.height = swapChainExtent.height;
-		framebufferInfo.layers = 1;
-
-		if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create framebuffer!");
-		}
-	}
+void VulkanBase::createFrameGraph() {
+	m_FrameGraph.Initialize(getVulkanContext());
+
+	m_GBuffer.AddToGraph(getVulkanContext(), m_FrameGraph, [this](VkCommandBuffer) { recordGBufferPass(); });
+
+	// the offscreen target is copied into the readback buffer right after the graph
+	const GP2_RenderGraph::ImageState acquired{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 };
+	const GP2_RenderGraph::ImageState presented = m_Headless ?
+		GP2_RenderGraph::ImageState{ VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT } :
+		GP2_RenderGraph::ImageState{ VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, 0 };
+	const GP2_RenderGraph::ResourceHandle backBuffer = m_FrameGraph.ImportImage("Back buffer", swapChainImages, swapChainImageViews,
+		swapChainImageFormat, swapChainExtent, acquired, presented);
+
+	// the main pass clears depth, so how last frame's hi-z pass left it doesn't matter; the stages also cover
+	// the transition of a newly created buffer, recorded at the start of the frame
+	const GP2_RenderGraph::ImageState depthBefore{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0 };
+	const GP2_RenderGraph::ImageState depthAfter{ VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, 0, 0 };
+	const GP2_RenderGraph::ResourceHandle depthBuffer = m_FrameGraph.ImportImage("Depth buffer", { m_DepthBuffer.GetDepthImage() },
+		{ m_DepthBuffer.GetDepthImageView() }, m_DepthBuffer.GetDepthFormat(), m_DepthBuffer.GetExtent(), depthBefore, depthAfter);
+
+	// this frame's culling pass samples the pyramid before the graph runs, next frame's once it is done
+	const GP2_RenderGraph::ImageState culling{ VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+	const GP2_RenderGraph::ResourceHandle hiZPyramid = m_FrameGraph.ImportImage("Hi-Z pyramid", { m_HiZPyramid.GetImage() },
+		{ m_HiZPyramid.GetView() }, VK_FORMAT_R32_SFLOAT, m_HiZPyramid.GetExtent(), culling, culling);
+
+	m_MainPass = m_FrameGraph.AddRasterPass("Main", [this](VkCommandBuffer) { recordMainPass(); });
+	m_FrameGraph.WriteColor(m_MainPass, backBuffer, VkClearColorValue{ {0.f, 0.f, 0.f, 1.f} });
+	m_FrameGraph.WriteDepth(m_MainPass, depthBuffer, VkClearDepthStencilValue{ 1.f, 0 });
+	// without reads the g-buffer pass is culled and its targets never get memory
+	if (m_UseDeferred)
+		m_GBuffer.ReadTargets(m_FrameGraph, m_MainPass);
+
+	// next frame's occlusion test reads this frame's depth
+	const GP2_RenderGraph::PassHandle hiZPass = m_FrameGraph.AddComputePass("Hi-Z pyramid", [this](VkCommandBuffer cmdBuffer) {
+		const uint32_t scope = m_GpuProfiler.BeginScope(cmdBuffer, "Hi-Z pyramid");
+		m_HiZPyramid.Build(cmdBuffer);
+		m_GpuProfiler.EndScope(cmdBuffer, scope);
+		});
+	m_FrameGraph.ReadTexture(hiZPass, depthBuffer);
+	m_FrameGraph.WriteStorage(hiZPass, hiZPyramid);
+
+	m_FrameGraph.Compile();
+
+	// every pipeline drawing into the back buffer is created against the main pass
+	renderPass = m_FrameGraph.GetRenderPass(m_MainPass);
+	m_GBuffer.Initialize(getVulkanContext(), m_FrameGraph);
 }
 
-void VulkanBase::createRenderPass() {
-	VkAttachmentDescription colorAttachment{};
-	colorAttachment.format = swapChainImageFormat;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference colorAttachmentRef{};
-	colorAttachmentRef.attachment = 0;
-	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentDescription depthAttachment{};
-	depthAttachment.format = findSupportedFormat(physicalDevice, { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
-	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+void VulkanBase::createGBufferPipelines() {
+	// nothing to create against until a graph keeps the g-buffer pass
+	if (m_GBuffer.GetRenderPass() == VK_NULL_HANDLE)
+		return;
 
-	VkAttachmentReference depthAttachmentRef{};
-	depthAttachmentRef.attachment = 1;
-	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass{};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentRef;
-	subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-	std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
-	VkSubpassDependency dependency{};
-	dependency.srcSubpass = 0;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-	dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	VkRenderPassCreateInfo renderPassInfo{};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-	renderPassInfo.pAttachments = attachments.data();
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
-
-	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create render pass!");
+	for (auto& pipeline : m_PBRPipelines)
+	{
+		pipeline->InitializeGBuffer(m_GBuffer.GetRenderPass(), GP2_GBuffer::ColorAttachmentCount);
 	}
-}
\ No newline at end of file
+}
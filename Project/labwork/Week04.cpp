@@ -104,7 +104,8 @@ void VulkanBase::createSwapChain() {
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
 
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	// lets the driver hand resources over from the swap chain being replaced
+	createInfo.oldSwapchain = swapChain;
 
 	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create swap chain!");
@@ -124,4 +125,50 @@ void VulkanBase::createImageViews() {
 	for (size_t i = 0; i < swapChainImages.size(); i++) {
 		swapChainImageViews[i] = GP2_ImageBuffer::createImageViewStatic(device, swapChainImages[i], swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
 	}
+}
+
+void VulkanBase::recreateSwapChain() {
+	GP2_CPU_ZONE("VulkanBase::recreateSwapChain");
+
+	// a minimized window has nothing to present to, wait until it's restored
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+	while (width == 0 || height == 0) {
+		glfwWaitEvents();
+		glfwGetFramebufferSize(window, &width, &height);
+	}
+	m_FramebufferResized = false;
+
+	// the frame in flight may still render into and present from the old images, so they are retired instead of destroyed
+	const VkSwapchainKHR oldSwapChain = swapChain;
+	const std::vector<VkImageView> oldImageViews = swapChainImageViews;
+	m_RetireQueue.Push([this, oldSwapChain, oldImageViews]() {
+		for (VkImageView imageView : oldImageViews) {
+			vkDestroyImageView(device, imageView, nullptr);
+		}
+		vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+		});
+
+	createSwapChain();
+	createImageViews();
+
+	// pipelines use a dynamic viewport and the light clusters take the extent every frame, only the targets change
+	GP2_DepthBuffer oldDepthBuffer = m_DepthBuffer;
+	m_RetireQueue.Push([oldDepthBuffer]() mutable { oldDepthBuffer.Destroy(); });
+	m_DepthBuffer.Initialize(getVulkanContext(), m_TransitionBatch);
+
+	// the frame in flight may still bind sets pointing at the old pyramid, they go with their pools once it's done
+	GP2_DescriptorAllocator* oldDescriptorAllocator = m_SwapChainDescriptorAllocator;
+	m_RetireQueue.Push([oldDescriptorAllocator]() {
+		oldDescriptorAllocator->Destroy();
+		delete oldDescriptorAllocator;
+		});
+	createSwapChainDescriptorAllocator();
+
+	m_HiZPyramid.Resize(getVulkanContext(), m_DepthBuffer, m_TransitionBatch, m_RetireQueue);
+	m_PBRGeometry.UpdateHiZPyramid(getVulkanContext());
+
+	// declaring the graph again recreates the g-buffer targets and framebuffers at the new size
+	m_FrameGraph.Retire(m_RetireQueue);
+	createFrameGraph();
 }
\ No newline at end of file
@@ -29,12 +29,12 @@ void VulkanBase::pickPhysicalDevice() {
 
 bool VulkanBase::isDeviceSuitable(VkPhysicalDevice device) {
 	QueueFamilyIndices indices = findQueueFamilies(device);
-	bool extensionsSupported = checkDeviceExtensionSupport(device);
+	bool extensionsSupported = m_Headless || checkDeviceExtensionSupport(device);
 
 	VkPhysicalDeviceFeatures supportedFeatures;
 	vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-	return indices.isComplete() && extensionsSupported && supportedFeatures.samplerAnisotropy;
+	return indices.isComplete() && extensionsSupported && supportedFeatures.samplerAnisotropy && supportedFeatures.drawIndirectFirstInstance;
 
 }
 
@@ -59,8 +59,16 @@ void VulkanBase::createLogicalDevice() {
 	queueCreateInfo.queueFamilyIndex = indices.graphicsFamily.value();
 	queueCreateInfo.queueCount = 1;
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	// the geometry arena's indirect commands address their instances through firstInstance
+	deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	// cooked textures are only loaded when this is on, otherwise the png sources are used
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -70,8 +78,23 @@ void VulkanBase::createLogicalDevice() {
 
 	createInfo.pEnabledFeatures = &deviceFeatures;
 
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	// draw count read from a buffer lets the culling pass skip empty indirect commands
+	std::vector<const char*> extensions{};
+	if (!m_Headless)
+		extensions = deviceExtensions;
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+	for (const auto& extension : availableExtensions) {
+		if (strcmp(extension.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0) {
+			extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+			break;
+		}
+	}
+
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	createInfo.ppEnabledExtensionNames = extensions.data();
 
 	if (enableValidationLayers) {
 		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -45,40 +45,55 @@ void VulkanBase::createSyncObjects() {
 	}
 }
 
-void VulkanBase::beginRenderPass(const GP2_CommandBuffer& cmdBuffer, VkFramebuffer currentBuffer, VkExtent2D extent)
-{
-	VkRenderPassBeginInfo renderPassInfo{};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = renderPass;
-	renderPassInfo.framebuffer = currentBuffer;
-	renderPassInfo.renderArea.offset = { 0, 0 };
-	renderPassInfo.renderArea.extent = extent;
-
-	std::array<VkClearValue,2> clearValues{};
-	clearValues[0].color = { {0.f, 0.f, 0.f, 1.f} };
-	clearValues[1].depthStencil = { 1.f, 0 };
-	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassInfo.pClearValues = clearValues.data();
-
-	vkCmdBeginRenderPass(cmdBuffer.GetVkCommandBuffer(), &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+void VulkanBase::createDescriptorAllocators() {
+	m_StaticDescriptorAllocator.Initialize(device, 16, GP2_DescriptorAllocator::DefaultPoolRatios());
+
+	m_FrameDescriptorAllocators.resize(MAX_FRAMES_IN_FLIGHT);
+	for (auto& allocator : m_FrameDescriptorAllocators)
+	{
+		allocator.Initialize(device, 64, GP2_DescriptorAllocator::DefaultPoolRatios());
+	}
+
+	createSwapChainDescriptorAllocator();
 }
 
-void VulkanBase::endRenderPass(const GP2_CommandBuffer& cmdBuffer)
-{
-	vkCmdEndRenderPass(cmdBuffer.GetVkCommandBuffer());
+void VulkanBase::createSwapChainDescriptorAllocator() {
+	// a hi-z set per mip and the culling set
+	m_SwapChainDescriptorAllocator = new GP2_DescriptorAllocator{};
+	m_SwapChainDescriptorAllocator->Initialize(device, 16, GP2_DescriptorAllocator::DefaultPoolRatios());
 }
 
-void VulkanBase::drawFrame() {
-	vkWaitForFences(device, 1, &inFlightFences[CURRENT_FRAME], VK_TRUE, UINT64_MAX);
-	vkResetFences(device, 1, &inFlightFences[CURRENT_FRAME]);
+void VulkanBase::recordGBufferPass()
+{
+	const VkCommandBuffer profiledBuffer = m_CommandBuffer.GetVkCommandBuffer();
+	const uint32_t gBufferScope = m_GpuProfiler.BeginScope(profiledBuffer, "G-buffer");
+	for (uint32_t idx = 0; idx < m_PBRPipelines.size(); ++idx)
+	{
+		const uint32_t pipelineScope = m_GpuProfiler.BeginScope(profiledBuffer, m_PBRScopeNames[idx]);
+		m_PBRPipelines[idx]->BindGBuffer(m_CommandBuffer, swapChainExtent, CURRENT_FRAME, m_FrameState.camera3DOffset);
+		m_PBRPipelines[idx]->Draw(m_CommandBuffer);
+		m_GpuProfiler.EndScope(profiledBuffer, pipelineScope);
+	}
+	m_GpuProfiler.EndScope(profiledBuffer, gBufferScope);
+}
 
-	uint32_t imageIndex;
-	vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[CURRENT_FRAME], VK_NULL_HANDLE, &imageIndex);
+void VulkanBase::recordMainPass()
+{
+	const VkCommandBuffer profiledBuffer = m_CommandBuffer.GetVkCommandBuffer();
+	const UniformBufferObject& ubo = m_FrameState.camera;
+	const uint32_t camera3DOffset = m_FrameState.camera3DOffset;
+	const bool deferred = m_FrameState.deferred;
 
-	m_CommandBuffer.Reset();
-	m_CommandBuffer.BeginRecording();
+	const uint32_t mainPassScope = m_GpuProfiler.BeginScope(profiledBuffer, "Main pass");
+	uint32_t scope = GP2_GpuProfiler::InvalidScope;
 
-	beginRenderPass(m_CommandBuffer, swapChainFramebuffers[imageIndex], swapChainExtent);
+	// also restores the g-buffer depth, so everything after it depth tests against the deferred geometry
+	if (deferred)
+	{
+		scope = m_GpuProfiler.BeginScope(profiledBuffer, "Deferred lighting");
+		m_DeferredLighting.Draw(m_CommandBuffer.GetVkCommandBuffer(), swapChainExtent, ubo, CURRENT_FRAME);
+		m_GpuProfiler.EndScope(profiledBuffer, scope);
+	}
 
 	// 2d camera matrix
 	GP2_ViewProjection vp{ glm::mat4(1.0f) ,glm::mat4(1.0f) };
@@ -87,35 +102,186 @@ void VulkanBase::drawFrame() {
 	vp.view = glm::translate(vp.view, glm::vec3(0, 0, 0));
 
 	// draw 2d graphics pipeline
-	m_GP2D.SetUBO(vp, 0);
-	m_GP2D.Record(m_CommandBuffer, swapChainExtent, CURRENT_FRAME);
+	const uint32_t camera2DOffset = m_UniformRing.Push(vp);
+	scope = m_GpuProfiler.BeginScope(profiledBuffer, "2D");
+	m_GP2D.Record(m_CommandBuffer, swapChainExtent, camera2DOffset);
+	m_GpuProfiler.EndScope(profiledBuffer, scope);
+
+	// lays down the pbr depth first so their expensive fragment shaders run once per pixel
+	const bool depthPrepass = !deferred && m_UseDepthPrepass && m_PBRGeometry.GetCommandCount() > 0;
+	if (depthPrepass)
+	{
+		scope = m_GpuProfiler.BeginScope(profiledBuffer, "Depth prepass");
+		m_DepthPrepass.Bind(m_CommandBuffer.GetVkCommandBuffer(), swapChainExtent, camera3DOffset);
+		m_PBRGeometry.BindPositions(m_CommandBuffer.GetVkCommandBuffer());
+		m_PBRGeometry.DrawAll(m_CommandBuffer.GetVkCommandBuffer());
+		m_GpuProfiler.EndScope(profiledBuffer, scope);
+	}
+
+	// 3d draws are recorded in sort key order: front to back by depth bucket, by pipeline within one
+	m_RenderQueue.Clear();
+	m_RenderQueue.SetDepthRange(m_NearPlane, m_FarPlane);
+	m_GP3D.QueueDraws(m_RenderQueue, 0, ubo);
+	for (uint32_t idx = 0; !deferred && idx < m_PBRPipelines.size(); ++idx)
+	{
+		m_PBRPipelines[idx]->QueueDraws(m_RenderQueue, idx + 1, ubo);
+	}
+	m_RenderQueue.Sort();
+
+	// a pipeline can come back in a later depth bucket, the profiler sums its scopes by name
+	const std::vector<GP2_RenderQueue::Entry>& entries = m_RenderQueue.GetEntries();
+	uint32_t boundPipeline = UINT32_MAX;
+	uint32_t pipelineScope = GP2_GpuProfiler::InvalidScope;
+	for (size_t entryIdx = 0; entryIdx < entries.size(); ++entryIdx)
+	{
+		const GP2_RenderQueue::Entry& entry = entries[entryIdx];
+		const uint32_t pipelineId = GP2_RenderQueue::GetPipelineId(entry.key);
+		const bool rebind = pipelineId != boundPipeline;
+		boundPipeline = pipelineId;
+
+		if (rebind)
+		{
+			m_GpuProfiler.EndScope(profiledBuffer, pipelineScope);
+			pipelineScope = m_GpuProfiler.BeginScope(profiledBuffer, pipelineId == 0 ? "3D" : m_PBRScopeNames[pipelineId - 1]);
+		}
+
+		if (pipelineId == 0)
+		{
+			if (rebind)
+				m_GP3D.Bind(m_CommandBuffer, swapChainExtent, CURRENT_FRAME);
+			m_GP3D.DrawMesh(m_CommandBuffer, entry.payload, camera3DOffset);
+		}
+		else
+		{
+			auto& pipeline = m_PBRPipelines[pipelineId - 1];
+			if (rebind)
+				pipeline->Bind(m_CommandBuffer, swapChainExtent, CURRENT_FRAME, camera3DOffset, depthPrepass);
+
+			// consecutive commands that stayed in order are one multi-draw
+			uint32_t commandCount = 1;
+			while (entryIdx + 1 < entries.size() && GP2_RenderQueue::GetPipelineId(entries[entryIdx + 1].key) == pipelineId &&
+				entries[entryIdx + 1].payload == entry.payload + commandCount)
+			{
+				++commandCount;
+				++entryIdx;
+			}
+			pipeline->DrawCommands(m_CommandBuffer, entry.payload, commandCount);
+		}
+	}
 
-	// 3d camera matrix
-	GP2_MeshData meshData{ glm::mat4(1.f) };
+	m_GpuProfiler.EndScope(profiledBuffer, pipelineScope);
+	m_GpuProfiler.EndScope(profiledBuffer, mainPassScope);
+}
+
+void VulkanBase::drawFrame() {
+	GP2_CPU_ZONE("VulkanBase::drawFrame");
+
+	GP2_CPU_ZONE_BEGIN(waitZone);
+	vkWaitForFences(device, 1, &inFlightFences[CURRENT_FRAME], VK_TRUE, UINT64_MAX);
+	GP2_CPU_ZONE_END(waitZone, "Wait for fence");
+
+	// the fence guarantees the gpu is done with last use of this frame's transient sets
+	m_FrameDescriptorAllocators[CURRENT_FRAME].Reset();
+	// and with whatever the last resize replaced
+	m_RetireQueue.BeginFrame();
+
+	// the offscreen target is the only image when headless
+	uint32_t imageIndex = 0;
+	if (!m_Headless)
+	{
+		GP2_CPU_ZONE("Acquire");
+		const VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[CURRENT_FRAME], VK_NULL_HANDLE, &imageIndex);
+		// nothing was submitted, so the fence stays signaled for the next try
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			recreateSwapChain();
+			return;
+		}
+		if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+			throw std::runtime_error("failed to acquire swap chain image!");
+		}
+	}
+
+	vkResetFences(device, 1, &inFlightFences[CURRENT_FRAME]);
+
+	GP2_CPU_ZONE_BEGIN(recordZone);
+	m_CommandBuffer.Reset();
+	m_CommandBuffer.BeginRecording();
+	m_GpuProfiler.BeginFrame(m_CommandBuffer.GetVkCommandBuffer());
+	const VkCommandBuffer profiledBuffer = m_CommandBuffer.GetVkCommandBuffer();
+
+	// images recreated by a resize leave UNDEFINED before anything uses them
+	m_TransitionBatch.RecordTransitions(m_CommandBuffer.GetVkCommandBuffer());
+
+	m_UniformRing.BeginFrame(CURRENT_FRAME);
+
+	// swaps in the levels last frame's draws asked for, before anything samples the textures
+	uint32_t scope = m_GpuProfiler.BeginScope(profiledBuffer, "Texture streaming");
+	m_TextureStreamer.Update(m_CommandBuffer.GetVkCommandBuffer());
+	m_GpuProfiler.EndScope(profiledBuffer, scope);
+
+	// 3d camera matrix, written once and shared by the culling pass and every 3d pipeline
 	UniformBufferObject ubo{};
 	ubo.view = UpdateCamera();
-	ubo.proj = glm::perspective(glm::radians(m_FovAngle), m_AspectRatio, 0.1f, 100.f);
+	const float aspectRatio = swapChainExtent.width / static_cast<float>(swapChainExtent.height);
+	ubo.proj = glm::perspective(glm::radians(m_FovAngle), aspectRatio, m_NearPlane, m_FarPlane);
 	ubo.proj[1][1] *= -1;
 
-	m_GP3D.SetUBO(ubo, 0);
-	m_GP3D.Record(m_CommandBuffer, swapChainExtent, CURRENT_FRAME);
+	const uint32_t camera3DOffset = m_UniformRing.Push(ubo);
+	m_LastCamera = ubo;
+
+	// whole commands off screen stay off the render queue, the gpu pass still culls the remaining instances
+	m_PBRGeometry.CullCommands(ubo.proj * ubo.view);
 
 	for (auto& pipeline : m_PBRPipelines)
 	{
-		pipeline->SetUBO(ubo, 0);
-		pipeline->Record(m_CommandBuffer, swapChainExtent, CURRENT_FRAME);
+		pipeline->RequestTextureLevels(ubo, swapChainExtent);
 	}
 
+	// compute work has to be recorded outside of the render pass
+	scope = m_GpuProfiler.BeginScope(profiledBuffer, "Culling");
+	m_PBRGeometry.Cull(m_CommandBuffer.GetVkCommandBuffer(), camera3DOffset, m_OcclusionCulling);
+	m_GpuProfiler.EndScope(profiledBuffer, scope);
+
+	m_LightClusters.Update(ubo, swapChainExtent, m_NearPlane, m_FarPlane, m_LightSet.GetLightCount());
+	scope = m_GpuProfiler.BeginScope(profiledBuffer, "Light clusters");
+	m_LightClusters.Record(m_CommandBuffer.GetVkCommandBuffer());
+	m_GpuProfiler.EndScope(profiledBuffer, scope);
+
+	m_ShadowCascades.Update(ubo, m_NearPlane, m_FarPlane, m_SunDirection);
+	scope = m_GpuProfiler.BeginScope(profiledBuffer, "Shadows");
+	m_ShadowCascades.Record(m_CommandBuffer.GetVkCommandBuffer(), m_PBRGeometry);
+	m_GpuProfiler.EndScope(profiledBuffer, scope);
+
+	// deferred path: the pbr geometry only fills the g-buffer, it is lit by one fullscreen pass in the main pass
+	m_FrameState.camera = ubo;
+	m_FrameState.camera3DOffset = camera3DOffset;
+	m_FrameState.deferred = m_UseDeferred && m_PBRGeometry.GetCommandCount() > 0;
+	m_FrameGraph.SetPassEnabled(m_GBuffer.GetPass(), m_FrameState.deferred);
+	m_FrameGraph.Execute(m_CommandBuffer.GetVkCommandBuffer(), imageIndex);
+
 	m_Yaw = 0;
 	m_Pitch = 0;
 
-	endRenderPass(m_CommandBuffer);
+	if (m_Headless)
+		recordReadback(m_CommandBuffer);
 
+	m_GpuProfiler.EndFrame(m_CommandBuffer.GetVkCommandBuffer());
 	m_CommandBuffer.EndRecording();
+	GP2_CPU_ZONE_END(recordZone, "Record");
 
+	GP2_CPU_ZONE_BEGIN(submitZone);
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+	if (m_Headless) {
+		m_CommandBuffer.Submit(submitInfo);
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[CURRENT_FRAME]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit draw command buffer!");
+		}
+		GP2_CPU_ZONE_END(submitZone, "Submit");
+		return;
+	}
+
 	VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[CURRENT_FRAME] };
 	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 	submitInfo.waitSemaphoreCount = 1;
@@ -131,7 +297,9 @@ void VulkanBase::drawFrame() {
 	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[CURRENT_FRAME]) != VK_SUCCESS) {
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
+	GP2_CPU_ZONE_END(submitZone, "Submit");
 
+	GP2_CPU_ZONE("Present");
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -144,7 +312,13 @@ void VulkanBase::drawFrame() {
 
 	presentInfo.pImageIndices = &imageIndex;
 
-	vkQueuePresentKHR(presentQueue, &presentInfo);
+	const VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_FramebufferResized) {
+		recreateSwapChain();
+	}
+	else if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to present swap chain image!");
+	}
 }
 
 bool checkValidationLayerSupport() {
@@ -173,11 +347,16 @@ bool checkValidationLayerSupport() {
 }
 
 std::vector<const char*> VulkanBase::getRequiredExtensions() {
-	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	std::vector<const char*> extensions{};
+
+	// glfw is never initialized when headless, and no surface extension is needed
+	if (!m_Headless) {
+		uint32_t glfwExtensionCount = 0;
+		const char** glfwExtensions;
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
 
 	if (enableValidationLayers) {
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
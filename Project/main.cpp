@@ -1,21 +1,92 @@
 #include "vulkanbase/VulkanBase.h"
 
+// png and jpg decodes land in the texture decoder's destination buffers, see GP2_TextureDecoder
+#define STBI_MALLOC(size) GP2_TextureDecoder::Allocate(size)
+#define STBI_REALLOC_SIZED(pointer, oldSize, newSize) GP2_TextureDecoder::Reallocate(pointer, oldSize, newSize)
+#define STBI_FREE(pointer) GP2_TextureDecoder::Free(pointer)
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-int main() {
+#include <string>
+
+struct LaunchOptions {
+	bool headless{ false };
+	bool benchmark{ false };
+	HeadlessSettings headlessSettings{};
+	BenchmarkSettings benchmarkSettings{};
+};
+
+// --headless [--width W] [--height H] [--output DIR]
+// --benchmark PATH [--timestep SECONDS] [--results FILE]
+// --warmup N and --frames N apply to whichever of the two runs
+LaunchOptions parseLaunchOptions(int argc, char* argv[]) {
+	LaunchOptions options{};
+	for (int idx = 1; idx < argc; ++idx) {
+		const std::string arg{ argv[idx] };
+		if (arg == "--headless") {
+			options.headless = true;
+			continue;
+		}
+
+		if (idx + 1 >= argc)
+			throw std::runtime_error("missing value for " + arg);
+		const std::string value{ argv[++idx] };
+
+		if (arg == "--benchmark") {
+			options.benchmark = true;
+			options.benchmarkSettings.cameraPath = value;
+		}
+		else if (arg == "--width")
+			options.headlessSettings.width = static_cast<uint32_t>(std::stoul(value));
+		else if (arg == "--height")
+			options.headlessSettings.height = static_cast<uint32_t>(std::stoul(value));
+		else if (arg == "--warmup") {
+			options.headlessSettings.warmupFrames = static_cast<uint32_t>(std::stoul(value));
+			options.benchmarkSettings.warmupFrames = options.headlessSettings.warmupFrames;
+		}
+		else if (arg == "--frames") {
+			options.headlessSettings.frameCount = static_cast<uint32_t>(std::stoul(value));
+			options.benchmarkSettings.frameCount = options.headlessSettings.frameCount;
+		}
+		else if (arg == "--output")
+			options.headlessSettings.outputDirectory = value;
+		else if (arg == "--timestep")
+			options.benchmarkSettings.timeStep = std::stof(value);
+		else if (arg == "--results")
+			options.benchmarkSettings.outputPath = value;
+		else
+			throw std::runtime_error("unknown argument " + arg);
+	}
+
+	if (options.headlessSettings.width == 0 || options.headlessSettings.height == 0)
+		throw std::runtime_error("headless size must not be 0");
+	if (options.benchmarkSettings.timeStep <= 0.f)
+		throw std::runtime_error("benchmark time step must be positive");
+
+	return options;
+}
+
+int main(int argc, char* argv[]) {
 	// DISABLE_LAYER_AMD_SWITCHABLE_GRAPHICS_1 = 1
 	//DISABLE_LAYER_NV_OPTIMUS_1 = 1
 	//_putenv_s("DISABLE_LAYER_AMD_SWITCHABLE_GRAPHICS_1", "1");
 	//_putenv_s("DISABLE_LAYER_NV_OPTIMUS_1", "1");
+	GP2_CPU_THREAD_NAME("Main");
 	VulkanBase app;
 
 	try {
-		app.run();
+		const LaunchOptions options = parseLaunchOptions(argc, argv);
+		if (options.benchmark)
+			app.setBenchmark(options.benchmarkSettings);
+
+		if (options.headless)
+			app.runHeadless(options.headlessSettings);
+		else
+			app.run();
 	}
 	catch (const std::exception& e) {
 		std::cerr << e.what() << std::endl;
 		return EXIT_FAILURE;
 	}
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -1,6 +1,6 @@
 #version 450
 
-layout(push_constant)uniform PushConstants{
+layout(set =0,binding = 1) uniform ObjectData{
     mat4 model;
 } mesh;
 
@@ -11,11 +11,13 @@ layout(set =0,binding = 0) uniform UniformBufferObject {
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inTexCoord;
+layout(location = 4) in mat4 inInstanceModel;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * mesh.model * vec4(inPosition, 1.0);
+    const mat4 model = mesh.model * inInstanceModel;
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 1.0);
     fragTexCoord = inTexCoord;
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+// Shared declarations for shaders that read GP2_LightClusters. Define CLUSTER_SET before including this,
+// the compute pass that fills the clusters also defines CLUSTER_ACCESS to drop the readonly qualifier.
+
+#ifndef CLUSTER_ACCESS
+#define CLUSTER_ACCESS readonly
+#endif
+
+#define MAX_LIGHTS_PER_CLUSTER 128
+
+layout(std140, set = CLUSTER_SET, binding = 0) uniform ClusterParams {
+    mat4 view;
+    mat4 inverseProjection;
+    vec4 cameraPosition;
+    // xyz grid size, w light count
+    uvec4 gridSize;
+    // xy screen size in pixels, z near plane, w far plane
+    vec4 screenDepth;
+    // slice = log(viewDepth) * x + y
+    vec4 sliceScaleBias;
+} clusterParams;
+
+struct Light {
+    vec4 positionRadius;
+    vec4 colorIntensity;
+    vec4 spotDirectionCone;
+};
+
+layout(std430, set = CLUSTER_SET, binding = 1) readonly buffer Lights {
+    Light lights[];
+};
+
+layout(std430, set = CLUSTER_SET, binding = 2) CLUSTER_ACCESS buffer ClusterCounts {
+    uint clusterLightCounts[];
+};
+
+layout(std430, set = CLUSTER_SET, binding = 3) CLUSTER_ACCESS buffer ClusterIndices {
+    uint clusterLightIndices[];
+};
+
+uint GetClusterIndex(vec2 fragCoord, float viewDepth)
+{
+    const uvec2 tile = min(uvec2(fragCoord / clusterParams.screenDepth.xy * vec2(clusterParams.gridSize.xy)), clusterParams.gridSize.xy - 1u);
+    const float slice = log(max(viewDepth, clusterParams.screenDepth.z)) * clusterParams.sliceScaleBias.x + clusterParams.sliceScaleBias.y;
+    const uint z = min(uint(max(slice, 0.f)), clusterParams.gridSize.z - 1u);
+
+    return tile.x + clusterParams.gridSize.x * (tile.y + clusterParams.gridSize.y * z);
+}
+
+// radiance scale of a light at a world position, 0 outside of its radius or spot cone
+float GetLightAttenuation(Light light, vec3 position, out vec3 lightDirection)
+{
+    const vec3 toLight = light.positionRadius.xyz - position;
+    const float distance = length(toLight);
+    lightDirection = toLight / max(distance, 1e-4f);
+
+    if (distance >= light.positionRadius.w)
+        return 0.f;
+
+    // smooth falloff that reaches exactly zero at the radius
+    const float ratio = distance / light.positionRadius.w;
+    const float window = clamp(1.f - ratio * ratio * ratio * ratio, 0.f, 1.f);
+    float attenuation = window * window / (distance * distance + 1.f);
+
+    const float cosOuter = light.spotDirectionCone.w;
+    if (cosOuter > -1.f)
+    {
+        const float cosAngle = dot(-lightDirection, light.spotDirectionCone.xyz);
+        attenuation *= smoothstep(cosOuter, mix(cosOuter, 1.f, 0.2f), cosAngle);
+    }
+
+    return attenuation * light.colorIntensity.w;
+}
@@ -0,0 +1,173 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// ------------------ LAYOUT ------------------------------
+
+layout(push_constant) uniform PushConstants{
+    mat4 inverseViewProjection;
+    int mode;
+} constants;
+
+layout(set = 0, binding = 0) uniform sampler2D albedoSampler;
+layout(set = 0, binding = 1) uniform sampler2D normalSampler;
+layout(set = 0, binding = 2) uniform sampler2D materialSampler;
+layout(set = 0, binding = 3) uniform sampler2D depthSampler;
+
+#define CLUSTER_SET 1
+#include "ClusteredLights.glsl"
+
+#define SHADOW_SET 2
+#include "ShadowCascades.glsl"
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+const float PI = 3.14159265358979323846f;
+
+// the directional light the forward shaders hardcode
+const vec3 sunDirection = vec3(0.577f, 0.577f, 0.577f);
+const vec3 sunRadiance = vec3(7.f, 7.f, 7.f);
+
+// ------------------ HELPERS ------------------------------
+
+vec3 FresnelFunction_Schlick(vec3 h, vec3 v, vec3 f0)
+{
+	const float schlick = 1 - max(dot(h, v), 0.f);
+	return clamp(f0 + (1.f - f0) * pow(schlick, 5), 0.f, 1.f);
+}
+
+float NormalDistribution_GGX(vec3 n, vec3 h, float roughness)
+{
+	const float a = roughness * roughness;
+	const float dotNH = max(dot(n, h), 0.f);
+
+	const float denom = dotNH * dotNH * (a - 1.f) + 1.f;
+	return a / (PI * denom * denom);
+}
+
+float GeometryFunction_SchlickGGX(vec3 n, vec3 v, float k)
+{
+	const float dotNV = max(dot(n, v), 0.f);
+	return dotNV / (dotNV * (1.f - k) + k);
+}
+
+float GeometryFunction_Smith(vec3 n, vec3 v, vec3 l, float roughness)
+{
+	const float remappedK = ((roughness + 1) * (roughness + 1)) / 8;
+	return GeometryFunction_SchlickGGX(n, v, remappedK) * GeometryFunction_SchlickGGX(n, l, remappedK);
+}
+
+float Phong(vec3 l, float reflection, float exponent, vec3 v, vec3 n)
+{
+	const vec3 reflected = reflect(-l, n);
+	return reflection * pow(max(dot(reflected, v), 0.f), exponent);
+}
+
+// diffuse and specular reflected towards v for light arriving along l, before radiance and n.l
+void Shade(vec3 n, vec3 v, vec3 l, vec3 albedo, vec4 material, out vec3 diffuse, out vec3 specular)
+{
+	if (material.a > 0.5f)
+	{
+		// metalness workflow
+		const float metalness = material.r;
+		const float roughness = clamp(material.g, 0.01f, 0.99f);
+
+		const vec3 h = normalize(v + l);
+		const vec3 f0 = mix(vec3(0.04f), albedo, metalness);
+
+		const vec3 F = FresnelFunction_Schlick(h, v, f0);
+		const float D = NormalDistribution_GGX(n, h, roughness * roughness);
+		const float G = GeometryFunction_Smith(n, v, l, roughness * roughness);
+
+		specular = F * D * G / max(4.f * max(dot(n, v), 0.f) * max(dot(n, l), 0.f), 1e-4f);
+		diffuse = (1.f - F) * (1.f - metalness) * albedo / PI;
+	}
+	else
+	{
+		// specular workflow
+		specular = vec3(Phong(l, material.r, material.g * 25.f, v, n));
+		diffuse = albedo / PI;
+	}
+}
+
+// ------------------ MAIN -------------------------------------
+
+void main() {
+	const float depth = texture(depthSampler, fragTexCoord).r;
+	if (depth >= 1.f)
+		discard;
+
+	gl_FragDepth = depth;
+
+	const vec3 albedo = texture(albedoSampler, fragTexCoord).rgb;
+	if (constants.mode == 1)
+	{
+		outColor = vec4(albedo, 1.f);
+		return;
+	}
+
+	const vec3 normal = normalize(texture(normalSampler, fragTexCoord).xyz);
+	if (constants.mode == 2)
+	{
+		outColor = vec4(normal, 1.f);
+		return;
+	}
+
+	const vec4 material = texture(materialSampler, fragTexCoord);
+
+	const vec4 clipPosition = vec4(fragTexCoord * 2.f - 1.f, depth, 1.f);
+	const vec4 worldPosition = constants.inverseViewProjection * clipPosition;
+	const vec3 position = worldPosition.xyz / worldPosition.w;
+	const vec3 viewDirection = normalize(clusterParams.cameraPosition.xyz - position);
+
+	vec3 diffuseSum = vec3(0.f);
+	vec3 specularSum = vec3(0.f);
+
+	vec3 diffuse;
+	vec3 specular;
+
+	const float viewDepth = -(clusterParams.view * vec4(position, 1.f)).z;
+
+	const float sunArea = dot(normal, sunDirection);
+	if (sunArea > 0.f)
+	{
+		// the g-buffer only keeps the mapped normal, it offsets the lookup just as well
+		const float shadow = GetShadow(position, viewDepth, normal);
+
+		Shade(normal, viewDirection, sunDirection, albedo, material, diffuse, specular);
+		diffuseSum += sunRadiance * diffuse * sunArea * shadow;
+		specularSum += sunRadiance * specular * sunArea * shadow;
+	}
+
+	// only the lights binned into this pixel's cluster
+	const uint cluster = GetClusterIndex(gl_FragCoord.xy, viewDepth);
+	const uint clusterLightCount = clusterLightCounts[cluster];
+	for (uint idx = 0; idx < clusterLightCount; ++idx)
+	{
+		const Light light = lights[clusterLightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + idx]];
+
+		vec3 lightDirection;
+		const float attenuation = GetLightAttenuation(light, position, lightDirection);
+		const float observedArea = dot(normal, lightDirection);
+		if (attenuation <= 0.f || observedArea <= 0.f)
+			continue;
+
+		const vec3 radiance = light.colorIntensity.rgb * attenuation;
+
+		Shade(normal, viewDirection, lightDirection, albedo, material, diffuse, specular);
+		diffuseSum += radiance * diffuse * observedArea;
+		specularSum += radiance * specular * observedArea;
+	}
+
+	if (constants.mode == 3)
+	{
+		outColor = vec4(specularSum, 1.f);
+		return;
+	}
+
+	// the forward specular shader's small ambient term
+	const vec3 ambient = material.a > 0.5f ? vec3(0.f) : vec3(0.03f) * albedo;
+
+	outColor = vec4(diffuseSum + specularSum + ambient, 1.f);
+}
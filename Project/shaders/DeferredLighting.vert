@@ -0,0 +1,13 @@
+#version 450
+
+// ------------------ LAYOUT ------------------------------
+
+layout(location = 0) out vec2 fragTexCoord;
+
+// ------------------ MAIN ----------------------------------
+
+void main() {
+    // one triangle that covers the whole screen, uv (0,0) is the top left pixel
+    fragTexCoord = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(fragTexCoord * 2.f - 1.f, 0.f, 1.f);
+}
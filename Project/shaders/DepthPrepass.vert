@@ -0,0 +1,25 @@
+#version 450
+
+// ------------------ LAYOUT ------------------------------
+
+layout(set =0,binding = 1) uniform ObjectData{
+    mat4 model;
+} mesh;
+
+layout(set =0,binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 4) in mat4 inInstanceModel;
+
+// the pbr vertex shaders declare the same, so the EQUAL depth test in the main pass matches exactly
+invariant gl_Position;
+
+// ------------------ MAIN ----------------------------------
+
+void main() {
+    const mat4 model = mesh.model * inInstanceModel;
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 1.0);
+}
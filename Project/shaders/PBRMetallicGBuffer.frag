@@ -0,0 +1,34 @@
+#version 450
+
+// ------------------ LAYOUT ------------------------------
+
+layout(set = 1, binding = 0) uniform sampler2D diffuseSampler;
+layout(set = 1, binding = 1) uniform sampler2D normalSampler;
+// metalness in red, roughness in green
+layout(set = 1, binding = 2) uniform sampler2D materialSampler;
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec3 fragTangent;
+layout(location = 3) in vec3 fragViewDirection;
+
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec4 outNormal;
+layout(location = 2) out vec4 outMaterial;
+
+// ------------------ MAIN -------------------------------------
+
+void main() {
+	// calculate normals
+	const vec3 binormal = cross(fragNormal, fragTangent);
+	const mat3 tangentSpaceAxis = mat3(fragTangent, binormal, fragNormal);
+	// z is rebuilt from x and y, bc5 normal maps only store those two
+	vec3 normal = vec3(2.f * texture(normalSampler, fragTexCoord).rg - 1.f, 0.f);
+	normal.z = sqrt(clamp(1.f - dot(normal.xy, normal.xy), 0.f, 1.f));
+	normal = normalize(tangentSpaceAxis * normal);
+
+	outAlbedo = vec4(texture(diffuseSampler, fragTexCoord).rgb, 1.f);
+	outNormal = vec4(normal, 0.f);
+	// alpha 1 marks the metalness workflow for the lighting pass
+	outMaterial = vec4(texture(materialSampler, fragTexCoord).rg, 0.f, 1.f);
+}
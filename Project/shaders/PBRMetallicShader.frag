@@ -1,20 +1,29 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 // ------------------ LAYOUT ------------------------------
 
 layout(push_constant)uniform PushConstants{
-    layout(offset=64) int mode;
+    int mode;
 } rendermode;
 
-layout(binding = 1) uniform sampler2D diffuseSampler;
-layout(binding = 2) uniform sampler2D normalSampler;
-layout(binding = 3) uniform sampler2D metalnessSampler;
-layout(binding = 4) uniform sampler2D roughnessSampler;
+layout(set = 1, binding = 0) uniform sampler2D diffuseSampler;
+layout(set = 1, binding = 1) uniform sampler2D normalSampler;
+// metalness in red, roughness in green
+layout(set = 1, binding = 2) uniform sampler2D materialSampler;
 
 layout(location = 0) in vec2 fragTexCoord;
 layout(location = 1) in vec3 fragNormal;
 layout(location = 2) in vec3 fragTangent;
 layout(location = 3) in vec3 fragViewDirection;
+layout(location = 4) in vec3 fragWorldPosition;
+layout(location = 5) in float fragViewDepth;
+
+#define CLUSTER_SET 2
+#include "ClusteredLights.glsl"
+
+#define SHADOW_SET 3
+#include "ShadowCascades.glsl"
 
 layout(location = 0) out vec4 outColor;
 
@@ -52,6 +61,25 @@ float GeometryFunction_Smith(vec3 n, vec3 v, vec3 l, float roughness)
 	return GeometryFunction_SchlickGGX(n,v,remappedK) * GeometryFunction_SchlickGGX(n,l,remappedK);
 }
 
+// diffuse and specular reflected towards v for light arriving along l, before radiance and n.l
+void ShadeLight(vec3 normal, vec3 v, vec3 l, vec3 albedo, float metalnessValue, float roughnessValue, out vec3 diffuse, out vec3 specular)
+{
+	const vec3 f0 = ( abs(metalnessValue - 0) < 1e-5f ) ? vec3(0.04f, 0.04f, 0.04f) : albedo;
+
+	const vec3 h = normalize(v + l);
+
+	const vec3 F = FresnelFunction_Schlick(h, v, f0);
+	const float D = NormalDistribution_GGX(normal, h, roughnessValue*roughnessValue);
+	const float G = GeometryFunction_Smith(normal, v, l, roughnessValue*roughnessValue);
+
+	const float divisor = 4* dot(v, normal) * dot(l, normal);
+	specular = F*D*G;
+	specular /= divisor;
+
+	vec3 kd = ( abs(metalnessValue - 0) < 1e-5f ) ? 1.f - F : vec3(0.f);
+	diffuse = Lambert(kd, albedo);
+}
+
 // ------------------ MAIN -------------------------------------
 
 void main() {
@@ -59,13 +87,16 @@ void main() {
     vec3 albedo = texture(diffuseSampler, fragTexCoord).rgb;
 
 	vec3 normalMap = texture(normalSampler, fragTexCoord).rgb;
-    float roughnessValue = clamp(texture(roughnessSampler, fragTexCoord).x, 0.01f, 0.99f);
-	float metalnessValue = texture(metalnessSampler, fragTexCoord).x;
+	const vec2 material = texture(materialSampler, fragTexCoord).rg;
+    float roughnessValue = clamp(material.y, 0.01f, 0.99f);
+	float metalnessValue = material.x;
 
 	// calculate normals
 	const vec3 binormal = cross(fragNormal, fragTangent);
 	const mat3 tangentSpaceAxis = mat3(fragTangent, binormal, fragNormal);
-	vec3 normal = 2.f * normalMap - 1.f;
+	// z is rebuilt from x and y, bc5 normal maps only store those two
+	vec3 normal = vec3(2.f * normalMap.rg - 1.f, 0.f);
+	normal.z = sqrt(clamp(1.f - dot(normal.xy, normal.xy), 0.f, 1.f));
 	normal = normalize(tangentSpaceAxis * normal);
 
 	if(rendermode.mode == 2)
@@ -74,42 +105,54 @@ void main() {
 		return;
 	}
 
+	vec3 diffuseSum = vec3(0.f);
+	vec3 specularSum = vec3(0.f);
+	vec3 diffuse;
+	vec3 specular;
+
 	const vec3 lightDirection = normalize(vec3(0.577f, 0.577f, 0.577f));
 	const vec3 radiance = vec3(7.f,7.f,7.f);
 
 	const float observedArea = dot(normal, lightDirection);
-	if( observedArea <= 0.f) 
+	if( observedArea > 0.f)
 	{
-		outColor = vec4(0.f,0.f,0.f,0.f);
-		return;
-	}
+		const float shadow = GetShadow(fragWorldPosition, fragViewDepth, normalize(fragNormal));
 
-	const vec3 f0 = ( abs(metalnessValue - 0) < 1e-5f ) ? vec3(0.04f, 0.04f, 0.04f) : albedo;
+		ShadeLight(normal, fragViewDirection, lightDirection, albedo, metalnessValue, roughnessValue, diffuse, specular);
+		diffuseSum += radiance * diffuse * observedArea * shadow;
+		specularSum += radiance * specular * observedArea * shadow;
+	}
 
-	const vec3 h = normalize(fragViewDirection + lightDirection);
+	// only the lights binned into this pixel's cluster
+	const vec3 viewDirection = normalize(clusterParams.cameraPosition.xyz - fragWorldPosition);
+	const uint cluster = GetClusterIndex(gl_FragCoord.xy, fragViewDepth);
+	const uint clusterLightCount = clusterLightCounts[cluster];
+	for (uint idx = 0; idx < clusterLightCount; ++idx)
+	{
+		const Light light = lights[clusterLightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + idx]];
 
-	const vec3 F = FresnelFunction_Schlick(h, fragViewDirection, f0);
-	const float D = NormalDistribution_GGX(normal, h, roughnessValue*roughnessValue);
-	const float G = GeometryFunction_Smith(normal, fragViewDirection, lightDirection, roughnessValue*roughnessValue);
+		vec3 pointDirection;
+		const float attenuation = GetLightAttenuation(light, fragWorldPosition, pointDirection);
+		const float pointArea = dot(normal, pointDirection);
+		if (attenuation <= 0.f || pointArea <= 0.f || dot(normal, viewDirection) <= 0.f)
+			continue;
 
-	const float divisor = 4* dot(fragViewDirection, normal) * dot(lightDirection, normal);
-	vec3 specular = F*D*G;
-	specular /= divisor;
+		ShadeLight(normal, viewDirection, pointDirection, albedo, metalnessValue, roughnessValue, diffuse, specular);
+		diffuseSum += light.colorIntensity.rgb * attenuation * diffuse * pointArea;
+		specularSum += light.colorIntensity.rgb * attenuation * specular * pointArea;
+	}
 
 	if(rendermode.mode == 3)
 	{
-		outColor = vec4(specular, 1.f);
+		outColor = vec4(specularSum, 1.f);
 		return;
 	}
 
-	vec3 kd = ( abs(metalnessValue - 0) < 1e-5f ) ? 1.f - F : vec3(0.f);
-	const vec3 diffuse = Lambert(kd, albedo);
-
 	if(rendermode.mode == 1)
 	{
-		outColor = vec4(diffuse, 1.f);
+		outColor = vec4(diffuseSum, 1.f);
 		return;
 	}
 
-	outColor = vec4(radiance * (diffuse + specular) * observedArea ,0.f);
+	outColor = vec4(diffuseSum + specularSum, 0.f);
 }
\ No newline at end of file
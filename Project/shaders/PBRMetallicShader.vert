@@ -2,7 +2,7 @@
 
 // ------------------ LAYOUT ------------------------------
 
-layout(push_constant)uniform PushConstants{
+layout(set =0,binding = 1) uniform ObjectData{
     mat4 model;
 } mesh;
 
@@ -15,20 +15,32 @@ layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inTexCoord;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec3 inTangent;
+layout(location = 4) in mat4 inInstanceModel;
 
 layout(location = 0) out vec2 fragTexCoord;
 layout(location = 1) out vec3 fragNormal;
 layout(location = 2) out vec3 fragTangent;
 layout(location = 3) out vec3 fragViewDirection;
+layout(location = 4) out vec3 fragWorldPosition;
+layout(location = 5) out float fragViewDepth;
+
+// has to match DepthPrepass.vert bit for bit for the EQUAL depth test
+invariant gl_Position;
 
 // ------------------ MAIN ----------------------------------
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * mesh.model * vec4(inPosition, 1.0);
+    const mat4 model = mesh.model * inInstanceModel;
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 1.0);
 
     fragViewDirection = normalize(vec3(gl_Position) - vec3(ubo.view[1][0], ubo.view[1][1], ubo.view[1][2]));
 
+    // clustered lighting needs the world position and the distance along the view direction
+    const vec4 worldPosition = model * vec4(inPosition, 1.0);
+    fragWorldPosition = worldPosition.xyz;
+    fragViewDepth = -(ubo.view * worldPosition).z;
+
     fragTexCoord = inTexCoord;
-    fragNormal = normalize(mat3(mesh.model) * inNormal);
-    fragTangent = normalize(mat3(mesh.model) * inTangent);
+    fragNormal = normalize(mat3(model) * inNormal);
+    fragTangent = normalize(mat3(model) * inTangent);
 }
\ No newline at end of file
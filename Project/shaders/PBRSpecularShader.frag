@@ -1,20 +1,29 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 // ------------------ LAYOUT ------------------------------
 
 layout(push_constant)uniform PushConstants{
-    layout(offset=64) int mode;
+    int mode;
 } rendermode;
 
-layout(binding = 1) uniform sampler2D diffuseSampler;
-layout(binding = 2) uniform sampler2D normalSampler;
-layout(binding = 3) uniform sampler2D glossSampler;
-layout(binding = 4) uniform sampler2D specularSampler;
+layout(set = 1, binding = 0) uniform sampler2D diffuseSampler;
+layout(set = 1, binding = 1) uniform sampler2D normalSampler;
+// gloss in red, specular in green
+layout(set = 1, binding = 2) uniform sampler2D materialSampler;
 
 layout(location = 0) in vec2 fragTexCoord;
 layout(location = 1) in vec3 fragNormal;
 layout(location = 2) in vec3 fragTangent;
 layout(location = 3) in vec3 fragViewDirection;
+layout(location = 4) in vec3 fragWorldPosition;
+layout(location = 5) in float fragViewDepth;
+
+#define CLUSTER_SET 2
+#include "ClusteredLights.glsl"
+
+#define SHADOW_SET 3
+#include "ShadowCascades.glsl"
 
 layout(location = 0) out vec4 outColor;
 
@@ -46,13 +55,16 @@ void main() {
 	}
 
     vec3 normalMap = texture(normalSampler, fragTexCoord).rgb;
-    float glossValue = texture(glossSampler, fragTexCoord).x;
-    float specularValue = texture(specularSampler, fragTexCoord).x;
+    const vec2 material = texture(materialSampler, fragTexCoord).rg;
+    float glossValue = material.x;
+    float specularValue = material.y;
 
 	// calculate normals
 	const vec3 binormal = cross(fragNormal, fragTangent);
 	const mat3 tangentSpaceAxis = mat3(fragTangent, binormal, fragNormal);
-	vec3 normal = 2.f * normalMap - 1.f;
+	// z is rebuilt from x and y, bc5 normal maps only store those two
+	vec3 normal = vec3(2.f * normalMap.rg - 1.f, 0.f);
+	normal.z = sqrt(clamp(1.f - dot(normal.xy, normal.xy), 0.f, 1.f));
 	normal = normalize(tangentSpaceAxis * normal);
 
 	if(rendermode.mode == 2)
@@ -64,21 +76,43 @@ void main() {
 	const vec3 lightDirection = vec3(0.577f, 0.577, 0.577f);
 	const vec3 radiance = vec3(7.f,7.f,7.f);
 
+	vec3 phong = vec3(0.f);
+	vec3 lambert = vec3(0.f);
+
 	const float observedArea = dot(normal, lightDirection);
-	if( observedArea <= 0.f) 
+	if( observedArea > 0.f)
 	{
-		outColor = vec4(0.f,0.f,0.f,0.f);
-		return;
+		const float shadow = GetShadow(fragWorldPosition, fragViewDepth, normalize(fragNormal));
+
+		phong += Phong(lightDirection, specularValue, glossValue * 25.f, -fragViewDirection, normal) * observedArea * shadow;
+		lambert += (Lambert(radiance, albedo) * shadow + vec3(0.03f, 0.03f, 0.03f)) * observedArea;
+	}
+
+	// only the lights binned into this pixel's cluster
+	const vec3 viewDirection = normalize(clusterParams.cameraPosition.xyz - fragWorldPosition);
+	const uint cluster = GetClusterIndex(gl_FragCoord.xy, fragViewDepth);
+	const uint clusterLightCount = clusterLightCounts[cluster];
+	for (uint idx = 0; idx < clusterLightCount; ++idx)
+	{
+		const Light light = lights[clusterLightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + idx]];
+
+		vec3 pointDirection;
+		const float attenuation = GetLightAttenuation(light, fragWorldPosition, pointDirection);
+		const float pointArea = dot(normal, pointDirection);
+		if (attenuation <= 0.f || pointArea <= 0.f)
+			continue;
+
+		const vec3 pointRadiance = light.colorIntensity.rgb * attenuation;
+		// Phong reflects -l, so it gets the direction the light travels in
+		phong += pointRadiance * Phong(-pointDirection, specularValue, glossValue * 25.f, viewDirection, normal) * pointArea;
+		lambert += Lambert(pointRadiance, albedo) * pointArea;
 	}
 
-	vec3 phong = Phong(lightDirection, specularValue, glossValue * 25.f, -fragViewDirection, normal);
 	if(rendermode.mode == 3)
 	{
 		outColor = vec4(phong, 1.f);
 		return;
 	}
 
-	vec3 lambert = Lambert(radiance, albedo);
-
-	outColor = vec4( (lambert + phong + vec3(0.03f, 0.03f, 0.03f)) * observedArea, 1.f);
+	outColor = vec4(lambert + phong, 1.f);
 }
\ No newline at end of file
@@ -0,0 +1,49 @@
+// Shared declarations for shaders that receive the directional light's shadow from GP2_ShadowCascades.
+// Define SHADOW_SET before including this.
+
+#define MAX_SHADOW_CASCADES 4
+
+layout(set = SHADOW_SET, binding = 0) uniform sampler2DArrayShadow shadowMap;
+
+layout(std140, set = SHADOW_SET, binding = 1) uniform ShadowParams {
+    mat4 cascadeViewProjection[MAX_SHADOW_CASCADES];
+    // far view depth of every cascade
+    vec4 splitDepths;
+    // world size of one shadow texel per cascade
+    vec4 texelWorldSizes;
+    // x cascade count (0 disables the lookup), y shadow texel size in uv, z pcf radius
+    vec4 settings;
+} shadowParams;
+
+// 1 fully lit, 0 fully shadowed; normal is the surface normal used to push the lookup off the surface
+float GetShadow(vec3 position, float viewDepth, vec3 normal)
+{
+    const int cascadeCount = int(shadowParams.settings.x);
+    if (cascadeCount == 0 || viewDepth >= shadowParams.splitDepths[cascadeCount - 1])
+        return 1.f;
+
+    int cascade = 0;
+    while (cascade < cascadeCount - 1 && viewDepth >= shadowParams.splitDepths[cascade])
+        ++cascade;
+
+    // offsetting along the normal by about a texel hides most acne on surfaces at grazing angles
+    const vec3 offsetPosition = position + normal * shadowParams.texelWorldSizes[cascade] * 1.5f;
+    const vec4 shadowPosition = shadowParams.cascadeViewProjection[cascade] * vec4(offsetPosition, 1.f);
+    const vec3 shadowCoord = shadowPosition.xyz / shadowPosition.w;
+    const vec2 uv = shadowCoord.xy * 0.5f + 0.5f;
+
+    // every tap is a bilinear comparison of 4 texels, so the kernel blends smoothly
+    const int radius = int(shadowParams.settings.z);
+    float lit = 0.f;
+    for (int y = -radius; y <= radius; ++y)
+    {
+        for (int x = -radius; x <= radius; ++x)
+        {
+            const vec2 offset = vec2(x, y) * shadowParams.settings.y;
+            lit += texture(shadowMap, vec4(uv + offset, float(cascade), shadowCoord.z));
+        }
+    }
+
+    const float taps = float((2 * radius + 1) * (2 * radius + 1));
+    return lit / taps;
+}
@@ -0,0 +1,16 @@
+#version 450
+
+// ------------------ LAYOUT ------------------------------
+
+layout(push_constant) uniform PushConstants{
+    mat4 lightViewProjection;
+} cascade;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 4) in mat4 inInstanceModel;
+
+// ------------------ MAIN ----------------------------------
+
+void main() {
+    gl_Position = cascade.lightViewProjection * inInstanceModel * vec4(inPosition, 1.0);
+}
@@ -1,6 +1,6 @@
 #version 450
 
-layout(push_constant)uniform PushConstants{
+layout(set =0,binding = 1) uniform ObjectData{
     mat4 model;
 } mesh;
 
@@ -11,10 +11,12 @@ layout(set =0,binding = 0) uniform GP2_ViewProjection {
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
+layout(location = 4) in mat4 inInstanceModel;
 
 layout(location = 0) out vec3 fragColor;
 
 void main() {
-    gl_Position = vp.proj * vp.view * mesh.model * vec4(inPosition, 1.0);
+    const mat4 model = mesh.model * inInstanceModel;
+    gl_Position = vp.proj * vp.view * model * vec4(inPosition, 1.0);
     fragColor = inColor;
 }
\ No newline at end of file
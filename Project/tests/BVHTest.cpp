@@ -0,0 +1,120 @@
+#include "GP2_BVH.h"
+#include "GP2_FrustumCuller.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// Builds a bvh over random boxes, moves them, refits and checks every frustum query against a brute-force
+// test of each box, before and after the move.
+
+namespace
+{
+	int g_Failures{ 0 };
+
+	void Check(bool condition, const char* message)
+	{
+		if (condition)
+			return;
+
+		std::cerr << "FAILED: " << message << "\n";
+		++g_Failures;
+	}
+
+	// same box against plane test as the bvh's leaves, without the hierarchy
+	std::vector<uint32_t> CullBruteForce(const std::vector<GP2_AABB>& bounds, const glm::mat4& viewProjection)
+	{
+		const std::array<glm::vec4, 6> planes = GP2_FrustumCuller::ExtractPlanes(viewProjection);
+
+		std::vector<uint32_t> visible{};
+		for (size_t idx = 0; idx < bounds.size(); ++idx)
+		{
+			const glm::vec3 center = bounds[idx].GetCenter();
+			const glm::vec3 halfExtent = bounds[idx].max - center;
+
+			const bool outside = std::any_of(planes.begin(), planes.end(), [&](const glm::vec4& plane)
+				{
+					return glm::dot(glm::vec3(plane), center) + plane.w < -glm::dot(halfExtent, glm::abs(glm::vec3(plane)));
+				});
+			if (!outside)
+				visible.push_back(static_cast<uint32_t>(idx));
+		}
+		return visible;
+	}
+
+	std::vector<uint32_t> Query(const GP2_BVH& bvh, const glm::mat4& viewProjection, const glm::vec3& eye)
+	{
+		std::vector<uint32_t> visible{};
+		bvh.QueryFrustum(viewProjection, eye, visible);
+		std::sort(visible.begin(), visible.end());
+		return visible;
+	}
+}
+
+int main()
+{
+	std::mt19937 generator{ 42 };
+	std::uniform_real_distribution<float> position{ -200.f, 200.f };
+	std::uniform_real_distribution<float> radius{ 0.5f, 8.f };
+	std::uniform_real_distribution<float> offset{ -60.f, 60.f };
+
+	std::vector<GP2_AABB> bounds{};
+	for (size_t idx = 0; idx < 5000; ++idx)
+	{
+		bounds.push_back(GP2_AABB::FromSphere(glm::vec4{ position(generator), position(generator), position(generator), radius(generator) }));
+	}
+
+	GP2_BVH bvh{};
+	bvh.Build(bounds);
+	Check(bvh.GetObjectCount() == bounds.size(), "bvh does not reference every object");
+
+	std::vector<glm::vec3> eyes{};
+	std::vector<glm::mat4> cameras{};
+	for (int camera = 0; camera < 32; ++camera)
+	{
+		glm::mat4 proj = glm::perspective(glm::radians(45.f), 800.f / 600.f, 0.1f, 100.f);
+		proj[1][1] *= -1;
+
+		const glm::vec3 eye{ position(generator), position(generator), position(generator) };
+		const glm::vec3 target{ position(generator), position(generator), position(generator) };
+		eyes.push_back(eye);
+		cameras.push_back(proj * glm::lookAt(eye, target, glm::vec3{ 0.f, 1.f, 0.f }));
+	}
+
+	for (size_t camera = 0; camera < cameras.size(); ++camera)
+	{
+		Check(Query(bvh, cameras[camera], eyes[camera]) == CullBruteForce(bounds, cameras[camera]), "built bvh disagrees with brute force");
+	}
+
+	// moves most objects far enough to leave their leaves' original boxes, then only refits
+	for (GP2_AABB& box : bounds)
+	{
+		const glm::vec3 move{ offset(generator), offset(generator), offset(generator) };
+		box.min = box.min + move;
+		box.max = box.max + move;
+	}
+	bvh.Refit(bounds);
+
+	for (size_t camera = 0; camera < cameras.size(); ++camera)
+	{
+		Check(Query(bvh, cameras[camera], eyes[camera]) == CullBruteForce(bounds, cameras[camera]), "refitted bvh disagrees with brute force");
+	}
+
+	// a ray through the middle of a moved box has to hit something no further away than that box
+	const GP2_AABB& target = bounds[1234];
+	const glm::vec3 origin = target.GetCenter() + glm::vec3{ 0.f, 0.f, 500.f };
+	uint32_t hitObject{};
+	float hitDistance{};
+	Check(bvh.Raycast(origin, glm::vec3{ 0.f, 0.f, -1.f }, hitObject, hitDistance), "ray at a moved box missed");
+	Check(hitDistance <= origin.z - target.max.z + 0.001f, "ray hit is further away than the moved box");
+
+	if (g_Failures > 0)
+		return EXIT_FAILURE;
+
+	std::cout << "bvh: build and refit match brute force over " << bounds.size() << " boxes\n";
+	return EXIT_SUCCESS;
+}
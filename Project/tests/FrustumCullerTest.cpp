@@ -0,0 +1,96 @@
+#include "GP2_FrustumCuller.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// Checks the simd culling path against the scalar reference for random spheres and cameras, and both
+// against a few spheres whose result is known.
+
+namespace
+{
+	int g_Failures{ 0 };
+
+	void Check(bool condition, const char* message)
+	{
+		if (condition)
+			return;
+
+		std::cerr << "FAILED: " << message << "\n";
+		++g_Failures;
+	}
+
+	glm::mat4 MakeViewProjection(const glm::vec3& eye, const glm::vec3& target)
+	{
+		// same camera setup as VulkanBase::drawFrame
+		glm::mat4 proj = glm::perspective(glm::radians(45.f), 800.f / 600.f, 0.1f, 100.f);
+		proj[1][1] *= -1;
+		return proj * glm::lookAt(eye, target, glm::vec3{ 0.f, 1.f, 0.f });
+	}
+}
+
+int main()
+{
+	std::mt19937 generator{ 1337 };
+	std::uniform_real_distribution<float> position{ -150.f, 150.f };
+	std::uniform_real_distribution<float> radius{ 0.1f, 10.f };
+
+	// not a multiple of the simd width, so the padded tail is exercised
+	GP2_FrustumCuller culler{};
+	for (size_t idx = 0; idx < 4099; ++idx)
+	{
+		culler.AddSphere(glm::vec4{ position(generator), position(generator), position(generator), radius(generator) });
+	}
+
+	std::vector<uint32_t> scalarVisible{};
+	std::vector<uint32_t> simdVisible{};
+	for (int camera = 0; camera < 64; ++camera)
+	{
+		const glm::vec3 eye{ position(generator), position(generator), position(generator) };
+		const glm::vec3 target{ position(generator), position(generator), position(generator) };
+		const glm::mat4 viewProjection = MakeViewProjection(eye, target);
+
+		culler.CullScalar(viewProjection, scalarVisible);
+		culler.Cull(viewProjection, simdVisible);
+		Check(scalarVisible == simdVisible, "simd and scalar results differ for a random camera");
+	}
+
+	// camera at z 50 looking down -z
+	const glm::mat4 viewProjection = MakeViewProjection(glm::vec3{ 0.f, 0.f, 50.f }, glm::vec3{ 0.f });
+
+	GP2_FrustumCuller known{};
+	const uint32_t ahead = known.AddSphere(glm::vec4{ 0.f, 0.f, 0.f, 1.f });
+	const uint32_t behind = known.AddSphere(glm::vec4{ 0.f, 0.f, 60.f, 1.f });
+	const uint32_t left = known.AddSphere(glm::vec4{ -200.f, 0.f, 0.f, 1.f });
+	const uint32_t straddling = known.AddSphere(glm::vec4{ -28.f, 0.f, 0.f, 5.f });
+	const uint32_t beyondFar = known.AddSphere(glm::vec4{ 0.f, 0.f, -80.f, 1.f });
+
+	for (bool simd : { false, true })
+	{
+		std::vector<uint32_t> visible{};
+		if (simd)
+			known.Cull(viewProjection, visible);
+		else
+			known.CullScalar(viewProjection, visible);
+
+		const auto contains = [&visible](uint32_t index) { return std::find(visible.begin(), visible.end(), index) != visible.end(); };
+		Check(contains(ahead), "sphere in front of the camera was culled");
+		Check(!contains(behind), "sphere behind the camera passed");
+		Check(!contains(left), "sphere far outside the left plane passed");
+		Check(contains(straddling), "sphere crossing the left plane was culled");
+		Check(!contains(beyondFar), "sphere beyond the far plane passed");
+	}
+
+	known.Clear();
+	known.Cull(viewProjection, simdVisible);
+	Check(simdVisible.empty(), "cleared culler still returns spheres");
+
+	if (g_Failures > 0)
+		return EXIT_FAILURE;
+
+	std::cout << "frustum culler: scalar and " << GP2_FrustumCuller::GetSimdName() << " agree\n";
+	return EXIT_SUCCESS;
+}
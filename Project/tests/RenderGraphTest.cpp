@@ -0,0 +1,369 @@
+#include "GP2_RenderGraph.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Compiles render graphs against stubbed vulkan calls and checks what the graph records: a chain of transient
+// images where the first and last never live at the same time and share memory, a pass nobody reads that is
+// culled with its image, and the depth -> hi-z edges of the frame graph with the barriers between them.
+
+namespace
+{
+	int g_Failures{ 0 };
+
+	void Check(bool condition, const char* message)
+	{
+		if (condition)
+			return;
+
+		std::cerr << "FAILED: " << message << "\n";
+		++g_Failures;
+	}
+
+	// every image is the same 256 byte aligned size, one device local memory type
+	constexpr VkDeviceSize g_ImageSize{ 64 * 1024 };
+
+	struct Binding {
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkDeviceSize offset{};
+	};
+
+	struct RecordedBarrier {
+		// passes executed before it, the barrier is recorded right before that pass or after the last one
+		size_t passIndex{};
+		VkPipelineStageFlags srcStages{};
+		VkPipelineStageFlags dstStages{};
+		std::vector<VkImageMemoryBarrier> imageBarriers{};
+	};
+
+	uint64_t g_NextHandle{ 0 };
+	uint32_t g_CreatedImages{ 0 };
+	std::vector<VkDeviceSize> g_Allocations{};
+	std::map<VkImage, Binding> g_Bindings{};
+	std::vector<std::string> g_ExecutedPasses{};
+	std::vector<RecordedBarrier> g_Barriers{};
+
+	template <typename Handle>
+	Handle MakeHandle()
+	{
+		return (Handle)(++g_NextHandle);
+	}
+
+	void Reset()
+	{
+		g_CreatedImages = 0;
+		g_Allocations.clear();
+		g_Bindings.clear();
+		g_ExecutedPasses.clear();
+		g_Barriers.clear();
+	}
+
+	GP2_RenderGraph::ExecuteFunction Record(const std::string& name)
+	{
+		return [name](VkCommandBuffer) { g_ExecutedPasses.push_back(name); };
+	}
+
+	// the barrier for image before the pass at passIndex, nullptr when there is none
+	const VkImageMemoryBarrier* FindBarrier(size_t passIndex, VkImage image, const RecordedBarrier** batch = nullptr)
+	{
+		for (const RecordedBarrier& recorded : g_Barriers)
+		{
+			if (recorded.passIndex != passIndex)
+				continue;
+
+			for (const VkImageMemoryBarrier& barrier : recorded.imageBarriers)
+			{
+				if (barrier.image != image)
+					continue;
+
+				if (batch != nullptr)
+					*batch = &recorded;
+				return &barrier;
+			}
+		}
+		return nullptr;
+	}
+
+	VulkanContext MakeContext()
+	{
+		VulkanContext context{};
+		context.device = MakeHandle<VkDevice>();
+		context.physicalDevice = MakeHandle<VkPhysicalDevice>();
+		return context;
+	}
+}
+
+// the graph's vulkan calls, recording what the checks look at
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateImage(VkDevice, const VkImageCreateInfo*, const VkAllocationCallbacks*, VkImage* pImage)
+{
+	++g_CreatedImages;
+	*pImage = MakeHandle<VkImage>();
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetImageMemoryRequirements(VkDevice, VkImage, VkMemoryRequirements* pMemoryRequirements)
+{
+	pMemoryRequirements->size = g_ImageSize;
+	pMemoryRequirements->alignment = 256;
+	pMemoryRequirements->memoryTypeBits = 1;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceMemoryProperties(VkPhysicalDevice, VkPhysicalDeviceMemoryProperties* pMemoryProperties)
+{
+	*pMemoryProperties = VkPhysicalDeviceMemoryProperties{};
+	pMemoryProperties->memoryTypeCount = 1;
+	pMemoryProperties->memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAllocateMemory(VkDevice, const VkMemoryAllocateInfo* pAllocateInfo, const VkAllocationCallbacks*, VkDeviceMemory* pMemory)
+{
+	g_Allocations.push_back(pAllocateInfo->allocationSize);
+	*pMemory = MakeHandle<VkDeviceMemory>();
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBindImageMemory(VkDevice, VkImage image, VkDeviceMemory memory, VkDeviceSize memoryOffset)
+{
+	g_Bindings[image] = Binding{ memory, memoryOffset };
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateImageView(VkDevice, const VkImageViewCreateInfo*, const VkAllocationCallbacks*, VkImageView* pView)
+{
+	*pView = MakeHandle<VkImageView>();
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateRenderPass(VkDevice, const VkRenderPassCreateInfo*, const VkAllocationCallbacks*, VkRenderPass* pRenderPass)
+{
+	*pRenderPass = MakeHandle<VkRenderPass>();
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateFramebuffer(VkDevice, const VkFramebufferCreateInfo*, const VkAllocationCallbacks*, VkFramebuffer* pFramebuffer)
+{
+	*pFramebuffer = MakeHandle<VkFramebuffer>();
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdBeginRenderPass(VkCommandBuffer, const VkRenderPassBeginInfo*, VkSubpassContents)
+{
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdEndRenderPass(VkCommandBuffer)
+{
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdPipelineBarrier(VkCommandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, VkDependencyFlags,
+	uint32_t, const VkMemoryBarrier*, uint32_t, const VkBufferMemoryBarrier*,
+	uint32_t imageMemoryBarrierCount, const VkImageMemoryBarrier* pImageMemoryBarriers)
+{
+	RecordedBarrier recorded{};
+	recorded.passIndex = g_ExecutedPasses.size();
+	recorded.srcStages = srcStageMask;
+	recorded.dstStages = dstStageMask;
+	recorded.imageBarriers.assign(pImageMemoryBarriers, pImageMemoryBarriers + imageMemoryBarrierCount);
+	g_Barriers.push_back(recorded);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyFramebuffer(VkDevice, VkFramebuffer, const VkAllocationCallbacks*)
+{
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyRenderPass(VkDevice, VkRenderPass, const VkAllocationCallbacks*)
+{
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyImageView(VkDevice, VkImageView, const VkAllocationCallbacks*)
+{
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyImage(VkDevice, VkImage, const VkAllocationCallbacks*)
+{
+}
+
+VKAPI_ATTR void VKAPI_CALL vkFreeMemory(VkDevice, VkDeviceMemory, const VkAllocationCallbacks*)
+{
+}
+
+namespace
+{
+	// first -> second -> third -> output, each pass samples the image the one before it wrote
+	void CheckTransientChain()
+	{
+		Reset();
+		const VkExtent2D extent{ 128, 128 };
+		const VkImage outputImage = MakeHandle<VkImage>();
+
+		GP2_RenderGraph graph{};
+		graph.Initialize(MakeContext());
+
+		const GP2_RenderGraph::ResourceHandle first = graph.CreateImage("First", VK_FORMAT_R8G8B8A8_UNORM, extent);
+		const GP2_RenderGraph::ResourceHandle second = graph.CreateImage("Second", VK_FORMAT_R8G8B8A8_UNORM, extent);
+		const GP2_RenderGraph::ResourceHandle third = graph.CreateImage("Third", VK_FORMAT_R8G8B8A8_UNORM, extent);
+		const GP2_RenderGraph::ResourceHandle unread = graph.CreateImage("Unread", VK_FORMAT_R8G8B8A8_UNORM, extent);
+		const GP2_RenderGraph::ResourceHandle output = graph.ImportImage("Output", { outputImage }, { MakeHandle<VkImageView>() }, VK_FORMAT_R8G8B8A8_SRGB, extent,
+			GP2_RenderGraph::ImageState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 },
+			GP2_RenderGraph::ImageState{ VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT });
+
+		const VkClearColorValue clear{ {0.f, 0.f, 0.f, 0.f} };
+		const GP2_RenderGraph::PassHandle firstPass = graph.AddRasterPass("First", Record("First"));
+		graph.WriteColor(firstPass, first, clear);
+
+		const GP2_RenderGraph::PassHandle unreadPass = graph.AddRasterPass("Unread", Record("Unread"));
+		graph.WriteColor(unreadPass, unread, clear);
+
+		const GP2_RenderGraph::PassHandle secondPass = graph.AddRasterPass("Second", Record("Second"));
+		graph.ReadTexture(secondPass, first);
+		graph.WriteColor(secondPass, second, clear);
+
+		const GP2_RenderGraph::PassHandle thirdPass = graph.AddRasterPass("Third", Record("Third"));
+		graph.ReadTexture(thirdPass, second);
+		graph.WriteColor(thirdPass, third, clear);
+
+		const GP2_RenderGraph::PassHandle outputPass = graph.AddRasterPass("Output", Record("Output"));
+		graph.ReadTexture(outputPass, third);
+		graph.WriteColor(outputPass, output, clear);
+
+		graph.Compile();
+
+		Check(graph.IsCulled(unreadPass), "pass nobody reads was not culled");
+		Check(!graph.IsCulled(firstPass) && !graph.IsCulled(outputPass), "pass feeding the output was culled");
+		Check(g_CreatedImages == 3, "culled pass's image was created anyway");
+
+		// first lives in passes 0-1 and third in 2-3, second overlaps both
+		std::vector<Binding> bindings{};
+		for (const auto& [image, binding] : g_Bindings)
+		{
+			bindings.push_back(binding);
+		}
+		Check(bindings.size() == 3, "every live transient image has to be bound once");
+		Check(g_Allocations.size() == 1 && g_Allocations[0] == 2 * g_ImageSize, "three images with disjoint ends should fit in two images of memory");
+
+		uint32_t sharedOffsets = 0;
+		for (size_t idx = 0; idx < bindings.size(); ++idx)
+		{
+			for (size_t other = idx + 1; other < bindings.size(); ++other)
+			{
+				Check(bindings[idx].memory == bindings[other].memory, "transients are spread over several allocations");
+				if (bindings[idx].offset == bindings[other].offset)
+					++sharedOffsets;
+			}
+		}
+		Check(sharedOffsets == 1, "exactly first and third should alias");
+
+		graph.Execute(MakeHandle<VkCommandBuffer>(), 0);
+		Check(g_ExecutedPasses == std::vector<std::string>{ "First", "Second", "Third", "Output" }, "passes ran out of order or the culled one ran");
+
+		// handles only grow, so the map has them in creation order: first, second, third
+		std::vector<VkImage> images{};
+		for (const auto& [image, binding] : g_Bindings)
+		{
+			images.push_back(image);
+		}
+
+		const RecordedBarrier* batch = nullptr;
+		const VkImageMemoryBarrier* barrier = FindBarrier(1, images[0], &batch);
+		Check(barrier != nullptr && barrier->oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL && barrier->newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			"first is not moved to the read only layout before the second pass samples it");
+		Check(barrier != nullptr && barrier->srcAccessMask == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT && barrier->dstAccessMask == VK_ACCESS_SHADER_READ_BIT,
+			"first's attachment writes are not made visible to the second pass's reads");
+		Check(batch != nullptr && (batch->srcStages & VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT) != 0 && (batch->dstStages & VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT) != 0,
+			"second pass doesn't wait for the first pass's color output");
+
+		barrier = FindBarrier(2, images[2], &batch);
+		Check(barrier != nullptr && barrier->oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && barrier->newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			"third doesn't discard the contents it shares with first");
+		Check(batch != nullptr && (batch->srcStages & VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT) != 0,
+			"third overwrites first's memory before the second pass is done sampling it");
+
+		barrier = FindBarrier(4, outputImage, &batch);
+		Check(barrier != nullptr && barrier->newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL && barrier->dstAccessMask == VK_ACCESS_TRANSFER_READ_BIT,
+			"output is not handed back in its final layout");
+		Check(batch != nullptr && batch->dstStages == VK_PIPELINE_STAGE_TRANSFER_BIT, "final barrier doesn't wait for the owner's transfer");
+
+		graph.Destroy();
+	}
+
+	// the frame graph's main and hi-z passes, depth goes from attachment to sampled and the pyramid is written in between culling reads
+	void CheckDepthToHiZ()
+	{
+		Reset();
+		const VkExtent2D extent{ 64, 32 };
+		const VkImage backImage = MakeHandle<VkImage>();
+		const VkImage depthImage = MakeHandle<VkImage>();
+		const VkImage pyramidImage = MakeHandle<VkImage>();
+
+		GP2_RenderGraph graph{};
+		graph.Initialize(MakeContext());
+
+		const GP2_RenderGraph::ResourceHandle backBuffer = graph.ImportImage("Back buffer", { backImage }, { MakeHandle<VkImageView>() }, VK_FORMAT_B8G8R8A8_SRGB, extent,
+			GP2_RenderGraph::ImageState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 },
+			GP2_RenderGraph::ImageState{ VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, 0 });
+		const GP2_RenderGraph::ResourceHandle depthBuffer = graph.ImportImage("Depth buffer", { depthImage }, { MakeHandle<VkImageView>() }, VK_FORMAT_D24_UNORM_S8_UINT, extent,
+			GP2_RenderGraph::ImageState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0 },
+			GP2_RenderGraph::ImageState{ VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, 0, 0 });
+		const GP2_RenderGraph::ImageState culling{ VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+		const GP2_RenderGraph::ResourceHandle pyramid = graph.ImportImage("Hi-Z pyramid", { pyramidImage }, { MakeHandle<VkImageView>() }, VK_FORMAT_R32_SFLOAT, extent,
+			culling, culling);
+
+		const GP2_RenderGraph::PassHandle mainPass = graph.AddRasterPass("Main", Record("Main"));
+		graph.WriteColor(mainPass, backBuffer, VkClearColorValue{ {0.f, 0.f, 0.f, 1.f} });
+		graph.WriteDepth(mainPass, depthBuffer, VkClearDepthStencilValue{ 1.f, 0 });
+
+		const GP2_RenderGraph::PassHandle hiZPass = graph.AddComputePass("Hi-Z pyramid", Record("Hi-Z pyramid"));
+		graph.ReadTexture(hiZPass, depthBuffer);
+		graph.WriteStorage(hiZPass, pyramid);
+
+		graph.Compile();
+		Check(!graph.IsCulled(hiZPass), "hi-z pass writes an imported image and must not be culled");
+		Check(g_CreatedImages == 0 && g_Allocations.empty(), "graph without transients allocated memory");
+
+		graph.Execute(MakeHandle<VkCommandBuffer>(), 0);
+		Check(g_ExecutedPasses == std::vector<std::string>{ "Main", "Hi-Z pyramid" }, "main and hi-z passes didn't both run in order");
+
+		const RecordedBarrier* batch = nullptr;
+		const VkImageMemoryBarrier* barrier = FindBarrier(0, depthImage, &batch);
+		Check(barrier != nullptr && barrier->oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && barrier->newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			"depth is not moved to the attachment layout before the main pass");
+		Check(batch != nullptr && (batch->srcStages & VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) != 0,
+			"main pass clears depth while last frame's hi-z pass may still read it");
+
+		barrier = FindBarrier(1, depthImage, &batch);
+		Check(barrier != nullptr && barrier->oldLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL && barrier->newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+			"depth is not moved to the read only layout before the hi-z pass samples it");
+		Check(barrier != nullptr && barrier->srcAccessMask == VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT && barrier->dstAccessMask == VK_ACCESS_SHADER_READ_BIT,
+			"depth writes are not made visible to the hi-z reads");
+		Check(barrier != nullptr && barrier->subresourceRange.aspectMask == (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT),
+			"combined depth stencil barrier has to name both aspects");
+		Check(batch != nullptr && (batch->srcStages & VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT) != 0 && batch->dstStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			"hi-z pass doesn't wait for the main pass's depth tests");
+
+		barrier = FindBarrier(1, pyramidImage, &batch);
+		Check(barrier != nullptr && barrier->oldLayout == VK_IMAGE_LAYOUT_GENERAL && barrier->newLayout == VK_IMAGE_LAYOUT_GENERAL,
+			"pyramid writes don't wait for this frame's culling reads");
+		Check(barrier != nullptr && barrier->subresourceRange.levelCount == VK_REMAINING_MIP_LEVELS, "pyramid barrier doesn't cover every mip");
+
+		barrier = FindBarrier(2, pyramidImage, &batch);
+		Check(barrier != nullptr && barrier->srcAccessMask == VK_ACCESS_SHADER_WRITE_BIT && barrier->dstAccessMask == VK_ACCESS_SHADER_READ_BIT,
+			"pyramid writes are not made visible to next frame's culling");
+		Check(FindBarrier(2, depthImage) == nullptr, "depth is already in its final layout, it needs no barrier after the graph");
+
+		graph.Destroy();
+	}
+}
+
+int main()
+{
+	CheckTransientChain();
+	CheckDepthToHiZ();
+
+	if (g_Failures > 0)
+		return EXIT_FAILURE;
+
+	std::cout << "render graph: transient aliasing and barriers as expected\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+#include "GP2_FrustumCuller.h"
+#include "GP2_TextureCompression.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Checks the mip level GP2_PBRBasePipeline::RequestTextureLevels asks for: every instance is measured at its
+// own nearest point, so a camera standing inside a range's bounds still gets a coarse level for instances that
+// are far away.
+
+namespace
+{
+	int g_Failures{ 0 };
+
+	void Check(bool condition, const char* message)
+	{
+		if (condition)
+			return;
+
+		std::cerr << "FAILED: " << message << "\n";
+		++g_Failures;
+	}
+
+	constexpr float g_ViewportHeight{ 600.f };
+	constexpr uint32_t g_TextureSize{ 1024 };
+
+	glm::mat4 MakeProjection()
+	{
+		// same camera setup as VulkanBase::drawFrame
+		glm::mat4 proj = glm::perspective(glm::radians(45.f), 800.f / g_ViewportHeight, 0.1f, 100.f);
+		proj[1][1] *= -1;
+		return proj;
+	}
+
+	// the largest instance on screen, as RequestTextureLevels takes it over the visible commands
+	float GetLargestScreenSize(const std::vector<glm::vec4>& spheres, const glm::mat4& view, const glm::mat4& proj)
+	{
+		float screenPixels = 0.f;
+		for (const glm::vec4& sphere : spheres)
+		{
+			screenPixels = (std::max)(screenPixels, GP2_FrustumCuller::GetScreenSize(view, proj, g_ViewportHeight, sphere));
+		}
+		return screenPixels;
+	}
+}
+
+int main()
+{
+	const glm::mat4 proj = MakeProjection();
+	const glm::mat4 view = glm::lookAt(glm::vec3{ 0.f }, glm::vec3{ 0.f, 0.f, -1.f }, glm::vec3{ 0.f, 1.f, 0.f });
+
+	// a ring of unit spheres 30 units around the camera, their bounds contain it
+	std::vector<glm::vec4> ring{};
+	glm::vec4 bounds{};
+	for (int idx = 0; idx < 16; ++idx)
+	{
+		const float angle = glm::radians(22.5f * idx);
+		const glm::vec4 sphere{ 30.f * std::sin(angle), 0.f, -30.f * std::cos(angle), 1.f };
+		bounds = idx == 0 ? sphere : GP2_FrustumCuller::MergeSpheres(bounds, sphere);
+		ring.push_back(sphere);
+	}
+	Check(glm::length(glm::vec3(bounds)) < bounds.w, "the ring's bounds do not contain the camera");
+
+	// measuring the bounds instead clamps to the near plane and asks for the full resolution
+	const float boundsPixels = GP2_FrustumCuller::GetScreenSize(view, proj, g_ViewportHeight, bounds);
+	Check(GP2_TextureCompression::GetScreenLevel(g_TextureSize, g_TextureSize, boundsPixels) == 0, "the range bounds around the camera did not ask for level 0");
+
+	const float ringPixels = GetLargestScreenSize(ring, view, proj);
+	const uint32_t ringLevel = GP2_TextureCompression::GetScreenLevel(g_TextureSize, g_TextureSize, ringPixels);
+	Check(ringPixels > 0.f, "no instance of the ring is on screen");
+	Check(ringLevel > 0, "instances 30 units away asked for level 0 with the camera inside their bounds");
+	Check(ringLevel < GP2_TextureCompression::GetMipCount(g_TextureSize, g_TextureSize), "level is past the mip chain");
+
+	// the nearest instance decides, moving one closer asks for a finer level
+	std::vector<glm::vec4> closer = ring;
+	closer.push_back(glm::vec4{ 0.f, 0.f, -5.f, 1.f });
+	Check(GP2_TextureCompression::GetScreenLevel(g_TextureSize, g_TextureSize, GetLargestScreenSize(closer, view, proj)) < ringLevel, "a closer instance did not ask for a finer level");
+
+	// standing inside an instance needs the full resolution, where an instance is in the view does not matter
+	Check(GP2_TextureCompression::GetScreenLevel(g_TextureSize, g_TextureSize, GP2_FrustumCuller::GetScreenSize(view, proj, g_ViewportHeight, glm::vec4{ 0.f, 0.f, -0.5f, 2.f })) == 0, "an instance around the camera did not ask for level 0");
+	Check(std::abs(GP2_FrustumCuller::GetScreenSize(view, proj, g_ViewportHeight, ring[4]) - GP2_FrustumCuller::GetScreenSize(view, proj, g_ViewportHeight, ring[0])) < 0.01f, "an instance beside the camera measures differently from one ahead");
+
+	Check(GP2_TextureCompression::GetMipCount(1024, 512) == 11, "mip count of 1024x512");
+	Check(GP2_TextureCompression::GetMipCount(1, 1) == 1, "mip count of 1x1");
+	Check(GP2_TextureCompression::GetScreenLevel(1024, 1024, 2048.f) == 0, "a texture smaller than its screen size is not at level 0");
+	Check(GP2_TextureCompression::GetScreenLevel(1024, 1024, 0.f) == 10, "a texture covering nothing is not at its last level");
+
+	if (g_Failures > 0)
+		return EXIT_FAILURE;
+
+	std::cout << "texture levels: camera inside the range's bounds asks for level " << ringLevel << " of a " << g_TextureSize << " texture\n";
+	return EXIT_SUCCESS;
+}
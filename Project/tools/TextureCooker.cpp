@@ -0,0 +1,139 @@
+#include "GP2_TextureCompression.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "3rdParty/json.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+// Cooks png maps into block compressed dds files. The renderer loads a .dds next to a texture instead of
+// the png itself when the device supports bc formats.
+// Usage: TextureCooker <scene.json>
+//            cooks every "texture files" entry: albedo, normal and the two single channel maps packed into one
+//        TextureCooker <albedo|normal|mask> <input> [output]
+//        TextureCooker pack <red input> <green input> [output]
+
+namespace
+{
+	void CookPixels(const std::string& input, const std::string& output, const uint8_t* pixels, int width, int height, GP2_TextureUsage usage)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		const GP2_CompressedTexture texture = GP2_TextureCompression::Cook(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height), usage);
+		const double cookMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		GP2_TextureCompression::WriteDDS(output, texture);
+
+		size_t compressedBytes = 0;
+		for (const std::vector<uint8_t>& mip : texture.mips)
+			compressedBytes += mip.size();
+
+		std::cout << input << " -> " << output << ": " << width << "x" << height << ", " << texture.mips.size() << " mips, "
+			<< compressedBytes / 1024 << " KiB (rgba8 level 0 alone is " << size_t(width) * height * 4 / 1024 << " KiB), "
+			<< cookMs << " ms\n";
+	}
+
+	void CookFile(const std::string& input, const std::string& output, GP2_TextureUsage usage)
+	{
+		int width{};
+		int height{};
+		int channels{};
+		stbi_uc* pixels = stbi_load(input.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+		if (!pixels)
+			throw std::runtime_error("failed to load " + input + "!");
+
+		CookPixels(input, output, pixels, width, height, usage);
+		stbi_image_free(pixels);
+	}
+
+	// same packing as the streamed Packed textures of GP2_TextureStreamer, red input in red and green input in green
+	void CookPacked(const std::string& redInput, const std::string& greenInput, const std::string& output)
+	{
+		int width{};
+		int height{};
+		int greenWidth{};
+		int greenHeight{};
+		int channels{};
+		stbi_uc* red = stbi_load(redInput.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+		stbi_uc* green = stbi_load(greenInput.c_str(), &greenWidth, &greenHeight, &channels, STBI_rgb_alpha);
+		if (!red || !green || width != greenWidth || height != greenHeight)
+		{
+			stbi_image_free(red);
+			stbi_image_free(green);
+			throw std::runtime_error("failed to load " + redInput + " and " + greenInput + " as two maps of the same size!");
+		}
+
+		const std::vector<uint8_t> packed = GP2_TextureCompression::PackChannels(red, green, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+		stbi_image_free(red);
+		stbi_image_free(green);
+
+		CookPixels(redInput + " + " + greenInput, output, packed.data(), width, height, GP2_TextureUsage::Packed);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		std::cout << "encoders: " << GP2_TextureCompression::GetSimdName() << "\n";
+
+		if (argc == 2)
+		{
+			std::ifstream file{ argv[1] };
+			if (!file.is_open())
+				throw std::runtime_error(std::string{ "failed to open " } + argv[1] + "!");
+
+			nlohmann::json scene;
+			file >> scene;
+
+			// same order as SetTextureMaps: albedo, normal, then metalness/roughness or gloss/specular packed together
+			for (const nlohmann::json& pipeline : scene["pipelines"])
+			{
+				const std::vector<std::string> files = pipeline["texture files"].get<std::vector<std::string>>();
+				if (files.size() < 4)
+					throw std::runtime_error("pipelines need four texture files!");
+
+				CookFile(files[0], GP2_TextureCompression::GetCookedPath(files[0]), GP2_TextureUsage::Albedo);
+				CookFile(files[1], GP2_TextureCompression::GetCookedPath(files[1]), GP2_TextureUsage::Normal);
+				CookPacked(files[2], files[3], GP2_TextureCompression::GetPackedPath(files[2]));
+			}
+		}
+		else if ((argc == 4 || argc == 5) && std::string{ argv[1] } == "pack")
+		{
+			CookPacked(argv[2], argv[3], argc == 5 ? argv[4] : GP2_TextureCompression::GetPackedPath(argv[2]));
+		}
+		else if (argc == 3 || argc == 4)
+		{
+			const std::string usageName{ argv[1] };
+			GP2_TextureUsage usage{};
+			if (usageName == "albedo")
+				usage = GP2_TextureUsage::Albedo;
+			else if (usageName == "normal")
+				usage = GP2_TextureUsage::Normal;
+			else if (usageName == "mask")
+				usage = GP2_TextureUsage::Mask;
+			else
+				throw std::invalid_argument("unknown texture usage " + usageName + ", expected albedo, normal or mask");
+
+			CookFile(argv[2], argc == 4 ? argv[3] : GP2_TextureCompression::GetCookedPath(argv[2]), usage);
+		}
+		else
+		{
+			std::cerr << "usage: TextureCooker <scene.json>\n"
+				<< "       TextureCooker <albedo|normal|mask> <input> [output]\n"
+				<< "       TextureCooker pack <red input> <green input> [output]\n";
+			return EXIT_FAILURE;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -1,10 +1,14 @@
 #pragma once
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
+#endif
 #include "VulkanUtil.h"
 
 #include "stb_image.h"
@@ -27,6 +31,30 @@
 #include "GP2_PBRMetalnessPipeline.h"
 #include "GP2_UniformBufferObject.h"
 #include "GP2_DepthBuffer.h"
+#include "GP2_ResourceCache.h"
+#include "GP2_DescriptorAllocator.h"
+#include "GP2_UniformRing.h"
+#include "GP2_GeometryArena.h"
+#include "GP2_HiZPyramid.h"
+#include "GP2_BVH.h"
+#include "GP2_RenderQueue.h"
+#include "GP2_DepthPrepass.h"
+#include "GP2_GBuffer.h"
+#include "GP2_RenderGraph.h"
+#include "GP2_RetireQueue.h"
+#include "GP2_LightSet.h"
+#include "GP2_LightClusters.h"
+#include "GP2_DeferredLighting.h"
+#include "GP2_ShadowCascades.h"
+#include "GP2_TextureDecoder.h"
+#include "GP2_TextureStreamer.h"
+#include "GP2_UploadBatch.h"
+#include "GP2_ImageWriter.h"
+#include "GP2_CameraPath.h"
+#include "GP2_FrameStats.h"
+#include "GP2_FrameTimer.h"
+#include "GP2_GpuProfiler.h"
+#include "GP2_CpuProfiler.h"
 
 const std::vector<const char*> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"
@@ -42,8 +70,39 @@ struct SwapChainSupportDetails {
 	std::vector<VkPresentModeKHR> presentModes;
 };
 
+// renders into an offscreen image instead of a window, for machines without a display or gpu (lavapipe)
+struct HeadlessSettings {
+	uint32_t width{ 1280 };
+	uint32_t height{ 720 };
+	// rendered before the first saved frame, and after them until the texture streamer has no loads left
+	uint32_t warmupFrames{ 8 };
+	uint32_t maxWarmupFrames{ 600 };
+	// every one of these is written to outputDirectory/frame_0000.png and on
+	uint32_t frameCount{ 1 };
+	std::string outputDirectory{ "." };
+};
+
+// plays a recorded camera path at a fixed time step and writes the frame timings, windowed or headless
+struct BenchmarkSettings {
+	std::string cameraPath{ "resources/benchmark_path.json" };
+	// not measured, the camera holds the path's first keyframe
+	uint32_t warmupFrames{ 60 };
+	uint32_t maxWarmupFrames{ 600 };
+	// 0 measures the whole path
+	uint32_t frameCount{ 0 };
+	float timeStep{ 1.f / 60.f };
+	// .json and .csv are appended
+	std::string outputPath{ "benchmark" };
+};
+
 class VulkanBase {
 public:
+	// before run or runHeadless, which then benchmark instead of running until closed or saving frames
+	void setBenchmark(const BenchmarkSettings& settings) {
+		m_Benchmarking = true;
+		m_BenchmarkSettings = settings;
+	}
+
 	void run() {
 		initWindow();
 		initVulkan();
@@ -51,6 +110,15 @@ public:
 		cleanup();
 	}
 
+	void runHeadless(const HeadlessSettings& settings) {
+		m_Headless = true;
+		m_HeadlessSettings = settings;
+
+		initVulkan();
+		headlessLoop();
+		cleanup();
+	}
+
 private:
 	// camera stuff
 	void keyEvent(int key, int scancode, int action, int mods);
@@ -69,37 +137,61 @@ private:
 	const float m_MouseSensitivity{ 0.001f };
 
 	const float m_FovAngle{ 45.f };
-	const float m_AspectRatio{ swapChainExtent.width / (float)swapChainExtent.height };
+	const float m_NearPlane{ 0.1f };
+	const float m_FarPlane{ 100.f };
 
 	glm::mat4 UpdateCamera();
+	UniformBufferObject m_LastCamera{ glm::mat4(1.f), glm::mat4(1.f) };
+
+	// every pbr instance, for picking with the right mouse button
+	GP2_BVH m_SceneBVH{};
+	void buildSceneBVH();
+	void pickObject(double xpos, double ypos);
 
 	void initVulkan() {
+		GP2_CPU_ZONE("VulkanBase::initVulkan");
 		// week 06
 		createInstance();
 		setupDebugMessenger();
-		createSurface();
+		if (!m_Headless)
+			createSurface();
 
 		// week 05
 		pickPhysicalDevice();
 		createLogicalDevice();
 
+		m_ResourceCache.Initialize(device);
+		m_RetireQueue.Initialize(MAX_FRAMES_IN_FLIGHT);
+		createDescriptorAllocators();
+		m_UniformRing.Initialize(getVulkanContext(), MAX_FRAMES_IN_FLIGHT, m_UniformRingBytesPerFrame, sizeof(UniformBufferObject), sizeof(GP2_MeshData));
+
 		// week 04 
-		createSwapChain();
+		if (m_Headless)
+			createOffscreenTarget();
+		else
+			createSwapChain();
 		createImageViews();
 
 		auto queueFam = findQueueFamilies(physicalDevice);
 
 		m_CommandPool.Initialize(device, queueFam);
 		m_CommandBuffer = m_CommandPool.CreateCommandBuffer();
+		m_GpuProfiler.Initialize(getVulkanContext(), queueFam.graphicsFamily.value());
+		m_GpuProfiler.SetVerbose(m_Benchmarking);
+		m_FrameTimer.Initialize(m_GpuProfiler);
 
-		m_DepthBuffer.Initialize(VulkanContext{ device, physicalDevice, renderPass, swapChainExtent }, queueFam, graphicsQueue);
+		// both only need a layout transition, recorded into one submit
+		m_TransitionBatch.Initialize(device, queueFam);
+		m_DepthBuffer.Initialize(getVulkanContext(), m_TransitionBatch);
+		m_HiZPyramid.Initialize(getVulkanContext(), m_DepthBuffer, m_TransitionBatch);
+		m_TransitionBatch.Submit(graphicsQueue);
 
 		std::unique_ptr<GP2_Mesh<GP2_2DVertex>> m_TriangleMesh = std::make_unique<GP2_Mesh<GP2_2DVertex>>();
 		m_TriangleMesh->AddVertex({ GP2_2DVertex{ { 0.f, -0.5f, 0.f }, { 1.f, 1.f, 1.f }},
 			GP2_2DVertex{ { 0.5f, 0.5f, 0.f }, { 0.f, 1.f, 0.f }},
 			GP2_2DVertex{ { -0.5f, 0.5f, 0.f }, { 0.f, 0.f, 1.f }} });
 		m_TriangleMesh->AddIndex({ 2,1,0 });
-		m_TriangleMesh->Initialize(VulkanContext{ device, physicalDevice, renderPass, swapChainExtent }, m_CommandBuffer, queueFam, graphicsQueue);
+		m_TriangleMesh->Initialize(getVulkanContext(), m_CommandBuffer, queueFam, graphicsQueue);
 		m_GP2D.AddMesh(std::move(m_TriangleMesh));
 
 		std::unique_ptr<GP2_Mesh<GP2_2DVertex>> m_FlatRectMesh = std::make_unique<GP2_Mesh<GP2_2DVertex>>();
@@ -108,34 +200,71 @@ private:
 			GP2_2DVertex{ {0.75f, -0.5f, 0.f}, { 1.f, 1.f, 0.f}},
 			GP2_2DVertex{ {0.75f, -0.75f, 0.f}, {1.f, 1.f, 1.f}} });
 		m_FlatRectMesh->AddIndex({ 2,1,0,3,1,2 });
-		m_FlatRectMesh->Initialize(VulkanContext{ device, physicalDevice, renderPass, swapChainExtent }, m_CommandBuffer, findQueueFamilies(physicalDevice), graphicsQueue);
+		m_FlatRectMesh->Initialize(getVulkanContext(), m_CommandBuffer, findQueueFamilies(physicalDevice), graphicsQueue);
 		m_GP2D.AddMesh(std::move(m_FlatRectMesh));
 
-		createRenderPass();
+		createFrameGraph();
+		// aliasing savings go with the benchmark results, a normal run stays quiet
+		if (m_Benchmarking)
+			m_FrameGraph.PrintStatistics();
 
-		m_GP2D.Initialize(VulkanContext{ device, physicalDevice, renderPass, swapChainExtent }, MAX_FRAMES_IN_FLIGHT);
-		m_GP3D.Initialize(VulkanContext{ device, physicalDevice, renderPass, swapChainExtent }, MAX_FRAMES_IN_FLIGHT,
+		m_GP2D.Initialize(getVulkanContext());
+		m_GP3D.Initialize(getVulkanContext(), MAX_FRAMES_IN_FLIGHT,
 			"resources/vehicle_diffuse.png", queueFam, graphicsQueue);
 
-		m_PBRPipelines = parseScene("resources/scene.json", VulkanContext{ device, physicalDevice, renderPass, swapChainExtent }, m_CommandBuffer,
-			queueFam, graphicsQueue, MAX_FRAMES_IN_FLIGHT);
+		// the pbr pipelines bind the cluster and shadow sets, so they have to exist before they are created
+		m_LightSet.Initialize(getVulkanContext(), m_MaxLights);
+		m_LightClusters.Initialize(getVulkanContext(), m_LightSet);
+		// its transition is recorded at the start of the first frame, the batch was already submitted
+		m_ShadowCascades.Initialize(getVulkanContext(), m_ShadowSettings, m_TransitionBatch);
+		m_TextureStreamer.Initialize(getVulkanContext(), m_StreamingSettings);
+
+		m_PBRPipelines = parseScene("resources/scene.json", getVulkanContext(), m_CommandBuffer,
+			queueFam, graphicsQueue, MAX_FRAMES_IN_FLIGHT, m_PBRGeometry);
+		// decode rates go with the benchmark results, a normal run stays quiet
+		if (m_Benchmarking)
+			m_TextureDecoder.PrintStatistics();
+		for (size_t idx = 0; idx < m_PBRPipelines.size(); ++idx)
+		{
+			m_PBRScopeNames.push_back("PBR " + std::to_string(idx));
+		}
+		m_PBRGeometry.Build(getVulkanContext(), queueFam, graphicsQueue, m_HiZPyramid);
+		m_ShadowCascades.SetCasters(m_PBRGeometry.GetCullObjects());
+		m_DepthPrepass.Initialize(getVulkanContext());
+		buildSceneBVH();
 
-		createFrameBuffers();
+		createGBufferPipelines();
+		createSceneLights();
+		m_DeferredLighting.Initialize(getVulkanContext(), m_GBuffer, m_LightClusters, m_ShadowCascades);
 
 		// week 06
 		createSyncObjects();
 	}
 
 	void mainLoop() {
+		if (m_Benchmarking) {
+			benchmarkLoop();
+			return;
+		}
+
+		uint32_t frame = 0;
 		while (!glfwWindowShouldClose(window)) {
 			glfwPollEvents();
 			//drawFrame week 06
 			drawFrame();
+
+			// the title doubles as the profiler overlay
+			if (++frame % m_TitleUpdateInterval == 0)
+				glfwSetWindowTitle(window, ("Vulkan | " + m_GpuProfiler.GetSummary(4)).c_str());
 		}
 		vkDeviceWaitIdle(device);
 	}
 
 	void cleanup() {
+		// the device is idle, whatever a resize left behind can go
+		m_RetireQueue.Destroy();
+		m_TransitionBatch.Destroy();
+
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 		{
 			vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
@@ -144,11 +273,11 @@ private:
 		}
 
 		m_CommandPool.Destroy();
+		m_GpuProfiler.Destroy();
 
-		for (auto framebuffer : swapChainFramebuffers) {
-			vkDestroyFramebuffer(device, framebuffer, nullptr);
-		}
+		m_FrameGraph.Destroy();
 
+		m_HiZPyramid.Destroy();
 		m_DepthBuffer.Destroy();
 
 		m_GP2D.CleanUp();
@@ -158,8 +287,27 @@ private:
 		{
 			pipeline->CleanUp();
 		}
+		m_TextureStreamer.Destroy();
+		m_PBRGeometry.Destroy();
+		m_DepthPrepass.Destroy();
+
+		m_DeferredLighting.Destroy();
+		m_ShadowCascades.Destroy();
+		m_LightClusters.Destroy();
+		m_LightSet.Destroy();
+
+		m_UniformRing.Destroy();
+
+		m_StaticDescriptorAllocator.Destroy();
+		for (auto& allocator : m_FrameDescriptorAllocators)
+		{
+			allocator.Destroy();
+		}
+		m_SwapChainDescriptorAllocator->Destroy();
+		delete m_SwapChainDescriptorAllocator;
+		m_SwapChainDescriptorAllocator = nullptr;
 
-		vkDestroyRenderPass(device, renderPass, nullptr);
+		m_ResourceCache.Destroy();
 
 		for (auto imageView : swapChainImageViews) {
 			vkDestroyImageView(device, imageView, nullptr);
@@ -168,15 +316,22 @@ private:
 		if (enableValidationLayers) {
 			DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 		}
-		vkDestroySwapchainKHR(device, swapChain, nullptr);
+		if (m_Headless)
+			destroyOffscreenTarget();
+		else
+			vkDestroySwapchainKHR(device, swapChain, nullptr);
 
 		vkDestroyDevice(device, nullptr);
 
-		vkDestroySurfaceKHR(instance, surface, nullptr);
+		if (!m_Headless)
+			vkDestroySurfaceKHR(instance, surface, nullptr);
 		vkDestroyInstance(instance, nullptr);
 
-		glfwDestroyWindow(window);
-		glfwTerminate();
+		if (!m_Headless)
+		{
+			glfwDestroyWindow(window);
+			glfwTerminate();
+		}
 	}
 
 	void createSurface() {
@@ -186,6 +341,27 @@ private:
 	}
 
 	GP2_DepthBuffer m_DepthBuffer{};
+	// built from last frame's depth, the culling pass tests instances against it
+	GP2_HiZPyramid m_HiZPyramid{};
+	bool m_OcclusionCulling{ true };
+	GP2_ResourceCache m_ResourceCache{};
+
+	// long-lived sets (materials) come from the static allocator, per-frame sets from the frame allocators
+	GP2_DescriptorAllocator m_StaticDescriptorAllocator{};
+	std::vector<GP2_DescriptorAllocator> m_FrameDescriptorAllocators{};
+	// one per swap chain size, the previous one is handed to the retire queue on resize
+	GP2_DescriptorAllocator* m_SwapChainDescriptorAllocator{};
+
+	void createDescriptorAllocators();
+	void createSwapChainDescriptorAllocator();
+
+	// camera and per-object constants for every pipeline, one slice per frame in flight
+	GP2_UniformRing m_UniformRing{};
+	const VkDeviceSize m_UniformRingBytesPerFrame{ 1024 * 1024 };
+
+	VulkanContext getVulkanContext() {
+		return VulkanContext{ device, physicalDevice, renderPass, swapChainExtent, &m_ResourceCache, &m_StaticDescriptorAllocator, m_FrameDescriptorAllocators.data(), m_SwapChainDescriptorAllocator, &m_UniformRing, &m_LightClusters, &m_ShadowCascades, &m_TextureDecoder, &m_TextureStreamer };
+	}
 
 	const size_t MAX_FRAMES_IN_FLIGHT = 1;
 	const int CURRENT_FRAME = 0;
@@ -208,24 +384,65 @@ private:
 	// Week 03
 	// Renderpass concept
 	// Graphics pipeline
-	std::vector<VkFramebuffer> swapChainFramebuffers;
 
+	// the g-buffer, main and hi-z passes, with their render passes, framebuffers and barriers
+	GP2_RenderGraph m_FrameGraph{};
+	GP2_RenderGraph::PassHandle m_MainPass{};
+	// the main pass's render pass, shared by every pipeline drawing into the back buffer
 	VkRenderPass renderPass;
 
-	GP2_GraphicsPipeline2D<GP2_ViewProjection, GP2_2DVertex> m_GP2D{ "shaders/shader.vert.spv", "shaders/shader.frag.spv" };
-	GP2_GraphicsPipeline3D<UniformBufferObject, GP2_3DVertex> m_GP3D{ "shaders/3Dshader.vert.spv", "shaders/3Dshader.frag.spv" };
-	std::vector<GP2_PBRBasePipeline<UniformBufferObject, GP2_PBRVertex>* > m_PBRPipelines;
-
-	void createFrameBuffers();
-	void createRenderPass();
-
-	void beginRenderPass(const GP2_CommandBuffer& cmdBuffer, VkFramebuffer currentBuffer, VkExtent2D extent);
-	void endRenderPass(const GP2_CommandBuffer& cmdBuffer);
+	// what the pass callbacks record with, set by drawFrame before the graph runs
+	struct FrameState {
+		UniformBufferObject camera{};
+		uint32_t camera3DOffset{};
+		bool deferred{ false };
+	};
+	FrameState m_FrameState{};
+
+	GP2_GraphicsPipeline2D<GP2_2DVertex> m_GP2D{ "shaders/shader.vert.spv", "shaders/shader.frag.spv" };
+	GP2_GraphicsPipeline3D<GP2_3DVertex> m_GP3D{ "shaders/3Dshader.vert.spv", "shaders/3Dshader.frag.spv" };
+	std::vector<GP2_PBRBasePipeline<GP2_PBRVertex>* > m_PBRPipelines;
+	GP2_GeometryArena<GP2_PBRVertex> m_PBRGeometry{};
+	// pipeline id 0 is m_GP3D, pbr pipeline i has id i + 1
+	GP2_RenderQueue m_RenderQueue{};
+
+	GP2_DepthPrepass m_DepthPrepass{ "shaders/DepthPrepass.vert.spv" };
+	bool m_UseDepthPrepass{ true };
+
+	// point and spot lights, binned into view space clusters every frame for both the forward and deferred path
+	GP2_LightSet m_LightSet{};
+	GP2_LightClusters m_LightClusters{};
+	const uint32_t m_MaxLights{ 4096 };
+	const uint32_t m_SceneLightCount{ 2048 };
+
+	// deferred path: the pbr geometry fills the g-buffer, a fullscreen pass then lights it
+	GP2_GBuffer m_GBuffer{};
+	GP2_DeferredLighting m_DeferredLighting{ "shaders/DeferredLighting.vert.spv", "shaders/DeferredLighting.frag.spv" };
+	// switching declares the frame graph again, a forward one culls the g-buffer pass
+	bool m_UseDeferred{ false };
+
+	// shadows of the directional light, the pbr shaders hardcode the same direction
+	GP2_ShadowCascades m_ShadowCascades{ "shaders/ShadowDepth.vert.spv" };
+	const GP2_ShadowCascades::Settings m_ShadowSettings{ 2048, 4, 60.f, 0.75f, 1 };
+	const glm::vec3 m_SunDirection{ 0.577f, 0.577f, 0.577f };
+
+	// png and jpg textures decode on its threads while the scene loads
+	GP2_TextureDecoder m_TextureDecoder{};
+	// pbr material textures, only their coarse mips are loaded at startup
+	GP2_TextureStreamer m_TextureStreamer{};
+	const GP2_TextureStreamer::Settings m_StreamingSettings{ 256ull * 1024 * 1024, 64, 4 };
+
+	void createSceneLights();
+
+	void createFrameGraph();
+	void createGBufferPipelines();
+	void recordGBufferPass();
+	void recordMainPass();
 
 	// Week 04
 	// Swap chain and image view support
 
-	VkSwapchainKHR swapChain;
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 	std::vector<VkImage> swapChainImages;
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
@@ -239,6 +456,16 @@ private:
 	void createSwapChain();
 	void createImageViews();
 
+	// set by the framebuffer size callback, the swap chain is recreated after the next present
+	bool m_FramebufferResized{ false };
+	// the old swap chain and everything sized like it live on until the frames using them are done
+	GP2_RetireQueue m_RetireQueue{};
+	// layout transitions of images created after startup, recorded at the start of the next frame
+	GP2_UploadBatch m_TransitionBatch{};
+
+	// rebuilds only what depends on the window size, without waiting for the device
+	void recreateSwapChain();
+
 	// Week 05 
 	// Logical and physical device
 
@@ -271,6 +498,42 @@ private:
 	void createSyncObjects();
 	void drawFrame();
 
+	// Headless
+	// the offscreen image stands in for the swap chain's only image, every frame is copied into the readback
+	// buffer after rendering
+
+	bool m_Headless{ false };
+	HeadlessSettings m_HeadlessSettings{};
+
+	VkImage m_OffscreenImage{ VK_NULL_HANDLE };
+	VkDeviceMemory m_OffscreenMemory{ VK_NULL_HANDLE };
+	GP2_Buffer* m_ReadbackBuffer{ nullptr };
+	uint8_t* m_ReadbackData{ nullptr };
+
+	void headlessLoop();
+	void createOffscreenTarget();
+	void destroyOffscreenTarget();
+	void recordReadback(const GP2_CommandBuffer& cmdBuffer);
+	void writeFrame(const std::string& filePath);
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+	// at least minFrames, then until the texture streamer is idle or maxFrames were drawn
+	uint32_t warmUp(uint32_t minFrames, uint32_t maxFrames);
+
+	// Benchmark
+
+	bool m_Benchmarking{ false };
+	BenchmarkSettings m_BenchmarkSettings{};
+	GP2_FrameTimer m_FrameTimer{};
+
+	// per pass gpu times, F9 captures a trace and F10 prints the averages; F11 writes the cpu zones
+	GP2_GpuProfiler m_GpuProfiler{};
+	std::vector<std::string> m_PBRScopeNames{};
+	const uint32_t m_TitleUpdateInterval{ 30 };
+	const uint32_t m_TraceFrameCount{ 120 };
+
+	void benchmarkLoop();
+	void setCamera(const glm::vec3& position, const glm::vec3& forward);
+
 	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData) {
 		std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
 		return VK_FALSE;
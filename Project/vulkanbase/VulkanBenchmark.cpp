@@ -0,0 +1,74 @@
+#include "VulkanBase.h"
+
+#include <chrono>
+#include <sstream>
+
+void VulkanBase::benchmarkLoop() {
+	GP2_CameraPath cameraPath{};
+	cameraPath.Load(m_BenchmarkSettings.cameraPath);
+
+	const float timeStep = m_BenchmarkSettings.timeStep;
+	uint32_t frameCount = m_BenchmarkSettings.frameCount;
+	if (frameCount == 0)
+		frameCount = static_cast<uint32_t>(cameraPath.GetDuration() / timeStep) + 1;
+
+	glm::vec3 position{};
+	glm::vec3 forward{};
+	cameraPath.Sample(0.f, position, forward);
+	setCamera(position, forward);
+
+	const uint32_t warmupFrames = warmUp(m_BenchmarkSettings.warmupFrames, m_BenchmarkSettings.maxWarmupFrames);
+
+	// the per pass breakdown of the measured frames
+	m_GpuProfiler.CaptureTrace(m_BenchmarkSettings.outputPath + ".gpu_trace.json", frameCount);
+
+	// every frame waits for its fence before the next one starts, so the gpu time read back belongs to it
+	GP2_FrameStats stats{};
+	auto frameStart = std::chrono::steady_clock::now();
+	for (uint32_t frame = 0; frame < frameCount; ++frame) {
+		if (!m_Headless) {
+			glfwPollEvents();
+			if (glfwWindowShouldClose(window))
+				break;
+		}
+
+		cameraPath.Sample(frame * timeStep, position, forward);
+		setCamera(position, forward);
+
+		drawFrame();
+		const auto cpuEnd = std::chrono::steady_clock::now();
+
+		vkWaitForFences(device, 1, &inFlightFences[CURRENT_FRAME], VK_TRUE, UINT64_MAX);
+		const auto frameEnd = std::chrono::steady_clock::now();
+
+		GP2_FrameStats::Frame timings{};
+		timings.cpuMilliseconds = std::chrono::duration<double, std::milli>(cpuEnd - frameStart).count();
+		timings.gpuMilliseconds = m_FrameTimer.GetGpuMilliseconds();
+		timings.frameMilliseconds = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+		stats.AddFrame(timings);
+
+		frameStart = frameEnd;
+	}
+
+	vkDeviceWaitIdle(device);
+	m_GpuProfiler.Flush();
+
+	std::ostringstream description{};
+	description << m_BenchmarkSettings.cameraPath << ", " << swapChainExtent.width << "x" << swapChainExtent.height
+		<< (m_Headless ? " headless" : " windowed") << ", " << warmupFrames << " warmup frames, time step " << timeStep << " s";
+
+	std::cout << "benchmark: " << description.str() << "\n";
+	stats.PrintSummary();
+	m_GpuProfiler.PrintAverages();
+	GP2_CpuProfiler::WriteTrace(m_BenchmarkSettings.outputPath + ".cpu_trace.json");
+	stats.WriteJSON(m_BenchmarkSettings.outputPath + ".json", description.str());
+	stats.WriteCSV(m_BenchmarkSettings.outputPath + ".csv");
+}
+
+void VulkanBase::setCamera(const glm::vec3& position, const glm::vec3& forward) {
+	// UpdateCamera rebuilds right and up from the forward vector
+	m_CameraPos = position;
+	m_CameraForward = forward;
+	m_Yaw = 0.f;
+	m_Pitch = 0.f;
+}
@@ -0,0 +1,146 @@
+#include "VulkanBase.h"
+
+#include <iomanip>
+#include <sstream>
+
+void VulkanBase::headlessLoop() {
+	if (m_Benchmarking) {
+		benchmarkLoop();
+		return;
+	}
+
+	const uint32_t warmupFrames = warmUp(m_HeadlessSettings.warmupFrames, m_HeadlessSettings.maxWarmupFrames);
+
+	for (uint32_t frame = 0; frame < m_HeadlessSettings.frameCount; ++frame) {
+		drawFrame();
+		vkWaitForFences(device, 1, &inFlightFences[CURRENT_FRAME], VK_TRUE, UINT64_MAX);
+
+		std::ostringstream filePath{};
+		filePath << m_HeadlessSettings.outputDirectory << "/frame_" << std::setw(4) << std::setfill('0') << frame << ".png";
+		writeFrame(filePath.str());
+	}
+
+	std::cout << "rendered " << warmupFrames << " warmup frames, wrote " << m_HeadlessSettings.frameCount
+		<< " frames to " << m_HeadlessSettings.outputDirectory << "\n";
+
+	vkDeviceWaitIdle(device);
+}
+
+uint32_t VulkanBase::warmUp(uint32_t minFrames, uint32_t maxFrames) {
+	// the streamer only loads what last frame's draws asked for, so keep going until two frames in a row start
+	// nothing new; measured and saved frames then no longer depend on how fast the decoder threads happened to be
+	uint32_t frame = 0;
+	uint32_t idleFrames = 0;
+	while (frame < minFrames || (idleFrames < 2 && frame < maxFrames)) {
+		if (!m_Headless)
+			glfwPollEvents();
+
+		drawFrame();
+		vkWaitForFences(device, 1, &inFlightFences[CURRENT_FRAME], VK_TRUE, UINT64_MAX);
+
+		idleFrames = m_TextureStreamer.GetLoadsInFlight() == 0 ? idleFrames + 1 : 0;
+		++frame;
+	}
+
+	return frame;
+}
+
+void VulkanBase::createOffscreenTarget() {
+	// rgba so the read back rows can be written out as they are, srgb like the swap chain
+	swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+	swapChainExtent = { m_HeadlessSettings.width, m_HeadlessSettings.height };
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = swapChainExtent.width;
+	imageInfo.extent.height = swapChainExtent.height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = swapChainImageFormat;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &m_OffscreenImage) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create offscreen image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, m_OffscreenImage, &memRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &m_OffscreenMemory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate offscreen image memory!");
+	}
+	vkBindImageMemory(device, m_OffscreenImage, m_OffscreenMemory, 0);
+
+	swapChainImages = { m_OffscreenImage };
+
+	// stays mapped, the fence wait makes every copy into it visible
+	const VkDeviceSize frameBytes = static_cast<VkDeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4;
+	m_ReadbackBuffer = new GP2_Buffer{ getVulkanContext(), frameBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+	m_ReadbackBuffer->MapMemory(reinterpret_cast<void**>(&m_ReadbackData));
+}
+
+void VulkanBase::destroyOffscreenTarget() {
+	m_ReadbackBuffer->Destroy();
+	delete m_ReadbackBuffer;
+	m_ReadbackBuffer = nullptr;
+	m_ReadbackData = nullptr;
+
+	vkDestroyImage(device, m_OffscreenImage, nullptr);
+	vkFreeMemory(device, m_OffscreenMemory, nullptr);
+}
+
+void VulkanBase::recordReadback(const GP2_CommandBuffer& cmdBuffer) {
+	// the frame graph's last barrier left the image in TRANSFER_SRC, visible to transfer reads
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { swapChainExtent.width, swapChainExtent.height, 1 };
+
+	vkCmdCopyImageToBuffer(cmdBuffer.GetVkCommandBuffer(), m_OffscreenImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		m_ReadbackBuffer->GetVkBuffer(), 1, &region);
+
+	VkBufferMemoryBarrier bufferBarrier{};
+	bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.buffer = m_ReadbackBuffer->GetVkBuffer();
+	bufferBarrier.offset = 0;
+	bufferBarrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(cmdBuffer.GetVkCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+}
+
+void VulkanBase::writeFrame(const std::string& filePath) {
+	GP2_ImageWriter::WritePNG(filePath, swapChainExtent.width, swapChainExtent.height, m_ReadbackData);
+}
+
+uint32_t VulkanBase::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find suitable memory type!");
+}
@@ -2,11 +2,15 @@
 
 #pragma once
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
+#endif
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
@@ -26,9 +30,28 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 
 std::vector<char> readFile(const std::string& filename);
 
+class GP2_ResourceCache;
+class GP2_DescriptorAllocator;
+class GP2_UniformRing;
+class GP2_LightClusters;
+class GP2_ShadowCascades;
+class GP2_TextureDecoder;
+class GP2_TextureStreamer;
+
 struct VulkanContext {
 	VkDevice device;
 	VkPhysicalDevice physicalDevice;
 	VkRenderPass renderPass;
 	VkExtent2D swapChainExtent;
+	GP2_ResourceCache* resourceCache;
+	GP2_DescriptorAllocator* descriptorAllocator;
+	// one per frame in flight, index with the frame; reset once its fence has been waited on
+	GP2_DescriptorAllocator* frameDescriptorAllocators;
+	// sets that point at targets sized after the swap chain, replaced and retired as a whole on every resize
+	GP2_DescriptorAllocator* swapChainDescriptorAllocator;
+	GP2_UniformRing* uniformRing;
+	GP2_LightClusters* lightClusters;
+	GP2_ShadowCascades* shadowCascades;
+	GP2_TextureDecoder* textureDecoder;
+	GP2_TextureStreamer* textureStreamer;
 };
\ No newline at end of file